@@ -0,0 +1,238 @@
+//
+// File: Benchmark.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+// From the STL:
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+/******************************************************************************/
+
+// Allocations are counted by replacing the global allocation functions.
+// Other forms of operator new (arrays, nothrow) call these ones by default.
+
+namespace
+{
+atomic<uint64_t> nbAllocations_(0);
+atomic<uint64_t> nbAllocatedBytes_(0);
+}
+
+void* operator new(size_t size)
+{
+  nbAllocations_.fetch_add(1, memory_order_relaxed);
+  nbAllocatedBytes_.fetch_add(size, memory_order_relaxed);
+  void* p = malloc(size == 0 ? 1 : size);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+uint64_t bpp::bench::getNumberOfAllocations()
+{
+  return nbAllocations_.load(memory_order_relaxed);
+}
+
+uint64_t bpp::bench::getNumberOfAllocatedBytes()
+{
+  return nbAllocatedBytes_.load(memory_order_relaxed);
+}
+
+/******************************************************************************/
+
+namespace
+{
+vector<Benchmark>& getRegistry_()
+{
+  static vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+}
+
+void bpp::bench::registerBenchmark(const string& name, const function<void (State&)>& function)
+{
+  Benchmark benchmark;
+  benchmark.name = name;
+  benchmark.function = function;
+  getRegistry_().push_back(benchmark);
+}
+
+const vector<Benchmark>& bpp::bench::getBenchmarks()
+{
+  return getRegistry_();
+}
+
+/******************************************************************************/
+
+namespace
+{
+
+/*
+ * Run a benchmark with an increasing number of iterations, until it lasts at least minTime seconds.
+ */
+State runBenchmark_(const Benchmark& benchmark, double minTime)
+{
+  size_t nbIterations = 1;
+  while (true)
+  {
+    State state(nbIterations);
+    benchmark.function(state);
+    if (state.getNumberOfIterations() == 0)
+      throw runtime_error("Benchmark " + benchmark.name + " did not run any iteration.");
+    double elapsed = state.getElapsedSeconds();
+    if (elapsed >= minTime || nbIterations >= 1000000000)
+      return state;
+    // Aim a bit above the minimum time, without growing too fast:
+    size_t next = (elapsed > 0. ? static_cast<size_t>(1.4 * minTime / elapsed * static_cast<double>(nbIterations)) : nbIterations * 10);
+    nbIterations = max(nbIterations + 1, min(next, nbIterations * 10));
+  }
+}
+
+void printUsage_()
+{
+  cout << "Usage: bpp_phyl_bench [--filter=<substring>] [--min-time=<seconds>] [--quick] [--csv] [--list]" << endl;
+}
+
+}
+
+/******************************************************************************/
+
+int main(int argc, char** argv)
+{
+  string filter;
+  double minTime = 0.5;
+  bool quick = false;
+  bool csv = false;
+  bool list = false;
+  for (int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    if (arg.compare(0, 9, "--filter=") == 0)
+      filter = arg.substr(9);
+    else if (arg.compare(0, 11, "--min-time=") == 0)
+      minTime = atof(arg.substr(11).c_str());
+    else if (arg == "--quick")
+      quick = true;
+    else if (arg == "--csv")
+      csv = true;
+    else if (arg == "--list")
+      list = true;
+    else
+    {
+      printUsage_();
+      return arg == "--help" ? 0 : 1;
+    }
+  }
+
+  registerLikelihoodBenchmarks(quick);
+  registerModelBenchmarks(quick);
+  registerMappingBenchmarks(quick);
+  registerTreeBenchmarks(quick);
+  registerParsimonyBenchmarks(quick);
+
+  if (csv)
+    cout << "name,iterations,seconds_per_iteration,items_per_second,allocations_per_iteration,bytes_per_iteration" << endl;
+  else if (!list)
+    cout << left << setw(48) << "Benchmark" << right
+         << setw(12) << "Iterations"
+         << setw(16) << "Time/iter (us)"
+         << setw(16) << "Items/s"
+         << setw(14) << "Allocs/iter"
+         << setw(16) << "Bytes/iter" << endl;
+
+  const vector<Benchmark>& benchmarks = getBenchmarks();
+  for (size_t i = 0; i < benchmarks.size(); i++)
+  {
+    const Benchmark& benchmark = benchmarks[i];
+    if (!filter.empty() && benchmark.name.find(filter) == string::npos)
+      continue;
+    if (list)
+    {
+      cout << benchmark.name << endl;
+      continue;
+    }
+    try
+    {
+      State state = runBenchmark_(benchmark, minTime);
+      double nbIterations = static_cast<double>(state.getNumberOfIterations());
+      double timePerIteration = state.getElapsedSeconds() / nbIterations;
+      double itemsPerSecond = static_cast<double>(state.getItemsPerIteration()) / timePerIteration;
+      double allocationsPerIteration = static_cast<double>(state.getNumberOfAllocations()) / nbIterations;
+      double bytesPerIteration = static_cast<double>(state.getNumberOfAllocatedBytes()) / nbIterations;
+      if (csv)
+        cout << benchmark.name << "," << state.getNumberOfIterations() << "," << timePerIteration << ","
+             << itemsPerSecond << "," << allocationsPerIteration << "," << bytesPerIteration << endl;
+      else
+        cout << left << setw(48) << benchmark.name << right << fixed
+             << setw(12) << state.getNumberOfIterations()
+             << setw(16) << setprecision(2) << timePerIteration * 1e6
+             << setw(16) << setprecision(0) << itemsPerSecond
+             << setw(14) << setprecision(1) << allocationsPerIteration
+             << setw(16) << setprecision(0) << bytesPerIteration << endl;
+    }
+    catch (exception& e)
+    {
+      cerr << benchmark.name << ": " << e.what() << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
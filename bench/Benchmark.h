@@ -0,0 +1,196 @@
+//
+// File: Benchmark.h
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+namespace bpp
+{
+namespace bench
+{
+
+/**
+ * @brief Number of memory allocations performed so far by the program (operator new calls).
+ */
+uint64_t getNumberOfAllocations();
+
+/**
+ * @brief Number of bytes allocated so far by the program.
+ */
+uint64_t getNumberOfAllocatedBytes();
+
+/**
+ * @brief Measurement state, passed to each benchmark function.
+ *
+ * A benchmark function prepares its data, then runs the code to measure in a loop:
+ * @code
+ * while (state.keepRunning()) {
+ *   // Code to measure
+ * }
+ * state.setItemsProcessed(nbSites);
+ * @endcode
+ * Only the loop is timed. The loop is run for the number of iterations chosen by the runner,
+ * which calls the benchmark function several times until the measurement is long enough.
+ */
+class State
+{
+  private:
+    size_t maxIterations_;
+    size_t iterations_;
+    size_t itemsPerIteration_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::duration elapsed_;
+    uint64_t allocations_;
+    uint64_t bytes_;
+    bool running_;
+
+  public:
+    State(size_t maxIterations) :
+      maxIterations_(maxIterations),
+      iterations_(0),
+      itemsPerIteration_(0),
+      start_(),
+      elapsed_(0),
+      allocations_(0),
+      bytes_(0),
+      running_(false)
+    {}
+
+  public:
+    /**
+     * @return True while iterations remain. Timing starts with the first call and stops with the last one.
+     */
+    bool keepRunning()
+    {
+      if (!running_)
+      {
+        if (iterations_ > 0)
+          return false;
+        running_ = true;
+        allocations_ = getNumberOfAllocations();
+        bytes_ = getNumberOfAllocatedBytes();
+        start_ = std::chrono::steady_clock::now();
+      }
+      if (iterations_ < maxIterations_)
+      {
+        iterations_++;
+        return true;
+      }
+      elapsed_ = std::chrono::steady_clock::now() - start_;
+      allocations_ = getNumberOfAllocations() - allocations_;
+      bytes_ = getNumberOfAllocatedBytes() - bytes_;
+      running_ = false;
+      return false;
+    }
+
+    /**
+     * @brief Set the number of items (sites, matrices, trees...) processed by one iteration.
+     *
+     * This is used to report a throughput.
+     */
+    void setItemsProcessed(size_t nbItems) { itemsPerIteration_ = nbItems; }
+
+    size_t getNumberOfIterations() const { return iterations_; }
+    size_t getItemsPerIteration() const { return itemsPerIteration_; }
+    double getElapsedSeconds() const { return std::chrono::duration<double>(elapsed_).count(); }
+    uint64_t getNumberOfAllocations() const { return allocations_; }
+    uint64_t getNumberOfAllocatedBytes() const { return bytes_; }
+};
+
+/**
+ * @brief A registered benchmark.
+ */
+struct Benchmark
+{
+  std::string name;
+  std::function<void (State&)> function;
+};
+
+/**
+ * @brief Register a new benchmark.
+ *
+ * @param name     The name of the benchmark, as "category/method/dataset".
+ * @param function The benchmark function.
+ */
+void registerBenchmark(const std::string& name, const std::function<void (State&)>& function);
+
+/**
+ * @return All registered benchmarks, in registration order.
+ */
+const std::vector<Benchmark>& getBenchmarks();
+
+/**
+ * @name Registration functions, one per benchmark file.
+ *
+ * @param quick If true, only small datasets are used.
+ * @{
+ */
+void registerLikelihoodBenchmarks(bool quick);
+void registerModelBenchmarks(bool quick);
+void registerMappingBenchmarks(bool quick);
+void registerTreeBenchmarks(bool quick);
+void registerParsimonyBenchmarks(bool quick);
+/** @} */
+
+/**
+ * @brief Prevent the compiler from optimizing away a computed value.
+ */
+template<class T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile ("" : : "r,m" (value) : "memory");
+#else
+  static const void* volatile sink;
+  sink = &value;
+#endif
+}
+
+} //end of namespace bench.
+} //end of namespace bpp.
+
+#endif //_BENCHMARK_H_
+
@@ -0,0 +1,168 @@
+//
+// File: Datasets.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Datasets.h"
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Protein/JTT92.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+
+// From the STL:
+#include <map>
+#include <tuple>
+#include <mutex>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+/******************************************************************************/
+
+Dataset::Dataset(Type type, size_t nbTaxa, size_t nbSites, long seed) :
+  type_(type),
+  nbTaxa_(nbTaxa),
+  nbSites_(nbSites),
+  geneticCode_(),
+  model_(),
+  rateDistribution_(new GammaDiscreteRateDistribution(4, 0.5)),
+  tree_(),
+  sites_()
+{
+  if (nbTaxa < 3)
+    throw Exception("Dataset::Dataset. At least 3 taxa are needed.");
+  RandomTools::setSeed(seed);
+
+  switch (type)
+  {
+  case NUCLEOTIDE:
+    model_.reset(new GTR(&AlphabetTools::DNA_ALPHABET, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2));
+    break;
+  case PROTEIN:
+    model_.reset(new JTT92(&AlphabetTools::PROTEIN_ALPHABET));
+    break;
+  case CODON:
+    geneticCode_.reset(new StandardGeneticCode(&AlphabetTools::DNA_ALPHABET));
+    model_.reset(new YN98(geneticCode_.get(), CodonFrequencySet::getFrequencySetForCodons(CodonFrequencySet::F0, geneticCode_.get())));
+    break;
+  }
+
+  // Random topology with exponentially distributed branch lengths:
+  vector<string> names(nbTaxa);
+  for (size_t i = 0; i < nbTaxa; i++)
+  {
+    names[i] = "T" + TextTools::toString(i + 1);
+  }
+  tree_.reset(TreeTemplateTools::getRandomTree(names, false));
+  vector<Node*> nodes = tree_->getNodes();
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    if (nodes[i]->hasFather())
+      nodes[i]->setDistanceToFather(RandomTools::randExponential(0.1) + 0.001);
+  }
+
+  HomogeneousSequenceSimulator simulator(model_.get(), rateDistribution_.get(), tree_.get());
+  sites_.reset(simulator.simulate(nbSites));
+}
+
+/******************************************************************************/
+
+const Dataset& Dataset::get(const Spec& spec)
+{
+  static map<tuple<int, size_t, size_t>, unique_ptr<Dataset> > datasets;
+  static mutex datasetsMutex;
+  lock_guard<mutex> lock(datasetsMutex);
+  unique_ptr<Dataset>& dataset = datasets[make_tuple(static_cast<int>(spec.type), spec.nbTaxa, spec.nbSites)];
+  if (!dataset)
+    dataset.reset(new Dataset(spec.type, spec.nbTaxa, spec.nbSites));
+  return *dataset;
+}
+
+/******************************************************************************/
+
+vector<Dataset::Spec> Dataset::getStandardSpecs(bool quick)
+{
+  vector<Spec> specs;
+  if (quick)
+  {
+    specs.push_back({NUCLEOTIDE, 16, 500});
+    specs.push_back({PROTEIN, 16, 200});
+    specs.push_back({CODON, 8, 100});
+  }
+  else
+  {
+    specs.push_back({NUCLEOTIDE, 16, 1000});
+    specs.push_back({NUCLEOTIDE, 64, 1000});
+    specs.push_back({NUCLEOTIDE, 256, 1000});
+    specs.push_back({PROTEIN, 32, 500});
+    specs.push_back({CODON, 16, 300});
+  }
+  return specs;
+}
+
+/******************************************************************************/
+
+string Dataset::getName(const Spec& spec)
+{
+  string name;
+  switch (spec.type)
+  {
+  case NUCLEOTIDE:
+    name = "dna";
+    break;
+  case PROTEIN:
+    name = "protein";
+    break;
+  case CODON:
+    name = "codon";
+    break;
+  }
+  return name + "/" + TextTools::toString(spec.nbTaxa) + "x" + TextTools::toString(spec.nbSites);
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,161 @@
+//
+// File: Datasets.h
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _DATASETS_H_
+#define _DATASETS_H_
+
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+#include <Bpp/Seq/GeneticCode/GeneticCode.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/Model/SubstitutionModel.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace bpp
+{
+namespace bench
+{
+
+/**
+ * @brief A synthetic dataset: a random tree, a model and an alignment simulated along the tree.
+ *
+ * Datasets are fully determined by their type, size and seed, so that measures can be compared
+ * between versions. They are built once and shared by all benchmarks, see get().
+ *
+ * - Nucleotide datasets use a GTR model,
+ * - protein datasets use JTT92,
+ * - codon datasets use YN98 with the standard genetic code.
+ * In all cases, rates follow a discretized gamma distribution with 4 classes.
+ */
+class Dataset
+{
+  public:
+    enum Type {
+      NUCLEOTIDE = 0,
+      PROTEIN = 1,
+      CODON = 2
+    };
+
+    /**
+     * @brief The description of a dataset.
+     */
+    struct Spec
+    {
+      Type type;
+      size_t nbTaxa;
+      size_t nbSites;
+    };
+
+  private:
+    Type type_;
+    size_t nbTaxa_;
+    size_t nbSites_;
+    std::unique_ptr<GeneticCode> geneticCode_;
+    std::unique_ptr<SubstitutionModel> model_;
+    std::unique_ptr<DiscreteDistribution> rateDistribution_;
+    std::unique_ptr<TreeTemplate<Node> > tree_;
+    std::unique_ptr<SiteContainer> sites_;
+
+  public:
+    /**
+     * @brief Build a new dataset.
+     *
+     * @param type    The type of sequences.
+     * @param nbTaxa  The number of leaves in the tree.
+     * @param nbSites The number of sites to simulate.
+     * @param seed    The seed of the random generator.
+     */
+    Dataset(Type type, size_t nbTaxa, size_t nbSites, long seed = 1);
+
+  private:
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+
+  public:
+    /**
+     * @return A dataset, built on first request only.
+     * @param spec The description of the dataset.
+     */
+    static const Dataset& get(const Spec& spec);
+
+    /**
+     * @return The datasets used by default in benchmarks.
+     * @param quick If true, only small datasets are returned.
+     */
+    static std::vector<Spec> getStandardSpecs(bool quick);
+
+    /**
+     * @return A short name for the dataset, as "dna/16x1000".
+     * @param spec The description of the dataset.
+     */
+    static std::string getName(const Spec& spec);
+
+    std::string getName() const { return getName(Spec{type_, nbTaxa_, nbSites_}); }
+
+    Type getType() const { return type_; }
+    size_t getNumberOfTaxa() const { return nbTaxa_; }
+    size_t getNumberOfSites() const { return nbSites_; }
+
+    /**
+     * @brief The model and rate distribution used for simulation.
+     *
+     * Benchmarks which modify parameters should work on copies.
+     * @{
+     */
+    const SubstitutionModel& getModel() const { return *model_; }
+    const DiscreteDistribution& getRateDistribution() const { return *rateDistribution_; }
+    /** @} */
+
+    /**
+     * @return The tree used for simulation (unrooted, with random branch lengths).
+     */
+    const TreeTemplate<Node>& getTree() const { return *tree_; }
+
+    const SiteContainer& getSites() const { return *sites_; }
+};
+
+} //end of namespace bench.
+} //end of namespace bpp.
+
+#endif //_DATASETS_H_
+
@@ -0,0 +1,215 @@
+//
+// File: bench_likelihood.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+#include "Datasets.h"
+
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+
+// From the STL:
+#include <memory>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+namespace
+{
+
+/*
+ * Full computation of the likelihood, from the transition probabilities to the root.
+ */
+template<class TL>
+void benchLikelihood_(State& state, const Dataset& dataset)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  TL tl(dataset.getTree(), dataset.getSites(), model.get(), rDist.get(), true, false);
+  tl.initialize();
+  while (state.keepRunning())
+  {
+    tl.computeTreeLikelihood();
+    doNotOptimize(tl.getLogLikelihood());
+  }
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+/*
+ * Update after a change of a single branch length, as during branch length optimization.
+ */
+template<class TL>
+void benchBranchLengthUpdate_(State& state, const Dataset& dataset)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  TL tl(dataset.getTree(), dataset.getSites(), model.get(), rDist.get(), true, false);
+  tl.initialize();
+  ParameterList brLens = tl.getBranchLengthsParameters();
+  size_t i = 0;
+  while (state.keepRunning())
+  {
+    // Each round over all branches switches between the original and modified lengths:
+    ParameterList pl;
+    pl.addParameter(brLens[i % brLens.size()]);
+    pl[0].setValue(pl[0].getValue() * ((i / brLens.size()) % 2 == 0 ? 1.1 : 1.));
+    tl.setParameters(pl);
+    doNotOptimize(tl.getValue());
+    i++;
+  }
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+/*
+ * First and second order derivatives with respect to each branch length in turn.
+ */
+template<class TL>
+void benchDerivatives_(State& state, const Dataset& dataset)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  TL tl(dataset.getTree(), dataset.getSites(), model.get(), rDist.get(), true, false);
+  tl.initialize();
+  vector<string> brLens = tl.getBranchLengthsParameters().getParameterNames();
+  size_t i = 0;
+  while (state.keepRunning())
+  {
+    const string& name = brLens[i % brLens.size()];
+    doNotOptimize(tl.getFirstOrderDerivative(name));
+    doNotOptimize(tl.getSecondOrderDerivative(name));
+    i++;
+  }
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+/*
+ * Scoring of all possible NNI moves on the tree. 0 threads means all hardware threads.
+ */
+void benchNNI_(State& state, const Dataset& dataset, size_t nbThreads)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  NNIHomogeneousTreeLikelihood tl(dataset.getTree(), dataset.getSites(), model.get(), rDist.get(), true, false);
+  tl.setNumberOfThreads(nbThreads);
+  tl.initialize();
+  tl.getValue();
+  const Tree& tree = tl.getTopology();
+  vector<int> ids = tree.getNodesId();
+  vector<int> nodeIds;
+  for (size_t i = 0; i < ids.size(); i++)
+  {
+    if (tree.hasFather(ids[i]) && tree.hasFather(tree.getFatherId(ids[i])))
+      nodeIds.push_back(ids[i]);
+  }
+  vector<double> diffs;
+  while (state.keepRunning())
+  {
+    tl.testNNIs(nodeIds, diffs);
+    doNotOptimize(diffs[0]);
+  }
+  state.setItemsProcessed(nodeIds.size());
+}
+
+/*
+ * Simulation of an alignment of the same size as the dataset, along the same tree.
+ */
+void benchSimulation_(State& state, const Dataset& dataset, bool byBlocks, size_t nbThreads)
+{
+  HomogeneousSequenceSimulator simulator(&dataset.getModel(), &dataset.getRateDistribution(), &dataset.getTree());
+  simulator.enableBlockSimulation(byBlocks);
+  simulator.setNumberOfThreads(nbThreads);
+  while (state.keepRunning())
+  {
+    unique_ptr<SiteContainer> sites(simulator.simulate(dataset.getNumberOfSites()));
+    doNotOptimize(sites->getNumberOfSites());
+  }
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+}
+
+/******************************************************************************/
+
+void bpp::bench::registerLikelihoodBenchmarks(bool quick)
+{
+  vector<Dataset::Spec> specs = Dataset::getStandardSpecs(quick);
+  for (size_t i = 0; i < specs.size(); i++)
+  {
+    Dataset::Spec spec = specs[i];
+    string name = Dataset::getName(spec);
+    registerBenchmark("likelihood/R/" + name, [spec](State& state) {
+        benchLikelihood_<RHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("likelihood/DR/" + name, [spec](State& state) {
+        benchLikelihood_<DRHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("brlen_update/R/" + name, [spec](State& state) {
+        benchBranchLengthUpdate_<RHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("brlen_update/DR/" + name, [spec](State& state) {
+        benchBranchLengthUpdate_<DRHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("derivatives/R/" + name, [spec](State& state) {
+        benchDerivatives_<RHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("derivatives/DR/" + name, [spec](State& state) {
+        benchDerivatives_<DRHomogeneousTreeLikelihood>(state, Dataset::get(spec));
+      });
+    registerBenchmark("nni/test_all/" + name, [spec](State& state) {
+        benchNNI_(state, Dataset::get(spec), 1);
+      });
+    registerBenchmark("nni/test_all_threads/" + name, [spec](State& state) {
+        benchNNI_(state, Dataset::get(spec), 0);
+      });
+    registerBenchmark("simulation/sites/" + name, [spec](State& state) {
+        benchSimulation_(state, Dataset::get(spec), false, 1);
+      });
+    registerBenchmark("simulation/sites_blocks/" + name, [spec](State& state) {
+        benchSimulation_(state, Dataset::get(spec), true, 1);
+      });
+    registerBenchmark("simulation/sites_blocks_threads/" + name, [spec](State& state) {
+        benchSimulation_(state, Dataset::get(spec), true, 0);
+      });
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,138 @@
+//
+// File: bench_mapping.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+#include "Datasets.h"
+
+#include <Bpp/Seq/Container/SiteContainerTools.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Mapping/SubstitutionRegister.h>
+#include <Bpp/Phyl/Mapping/UniformizationSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/DecompositionSubstitutionCount.h>
+#include <Bpp/Phyl/Mapping/ProbabilisticSubstitutionMapping.h>
+#include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/Mapping/StochasticMapping.h>
+
+// From the STL:
+#include <memory>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+namespace
+{
+
+/*
+ * Probabilistic substitution mapping on all branches, with the given counting method.
+ */
+template<class SC>
+void benchSubstitutionMapping_(State& state, const Dataset& dataset, size_t nbThreads)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  DRHomogeneousTreeLikelihood tl(dataset.getTree(), dataset.getSites(), model.get(), rDist.get(), true, false);
+  tl.initialize();
+  SC count(model.get(), new TotalSubstitutionRegister(model.get()));
+  while (state.keepRunning())
+  {
+    unique_ptr<ProbabilisticSubstitutionMapping> mapping(SubstitutionMappingTools::computeSubstitutionVectors(tl, count, false, nbThreads));
+    doNotOptimize(mapping->getNumberOfSites());
+  }
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+/*
+ * Sampling of stochastic mappings for the first site of the alignment.
+ */
+void benchStochasticMapping_(State& state, const Dataset& dataset, size_t nbMappings, StochasticMapping::SamplingMethod method)
+{
+  unique_ptr<SubstitutionModel> model(dataset.getModel().clone());
+  unique_ptr<DiscreteDistribution> rDist(dataset.getRateDistribution().clone());
+  SiteSelection selection(1, 0);
+  unique_ptr<SiteContainer> site(SiteContainerTools::getSelectedSites(dataset.getSites(), selection));
+  RHomogeneousTreeLikelihood tl(dataset.getTree(), *site, model.get(), rDist.get(), false, false);
+  tl.initialize();
+  StochasticMapping stochasticMapping(&tl, nbMappings);
+  stochasticMapping.setSamplingMethod(method);
+  while (state.keepRunning())
+  {
+    vector<Tree*> mappings;
+    stochasticMapping.generateStochasticMapping(mappings);
+    doNotOptimize(mappings.size());
+    for (size_t i = 0; i < mappings.size(); i++)
+    {
+      delete mappings[i];
+    }
+  }
+  state.setItemsProcessed(nbMappings);
+}
+
+}
+
+/******************************************************************************/
+
+void bpp::bench::registerMappingBenchmarks(bool quick)
+{
+  vector<Dataset::Spec> specs = Dataset::getStandardSpecs(quick);
+  for (size_t i = 0; i < specs.size(); i++)
+  {
+    Dataset::Spec spec = specs[i];
+    string name = Dataset::getName(spec);
+    registerBenchmark("mapping/uniformization/" + name, [spec](State& state) {
+        benchSubstitutionMapping_<UniformizationSubstitutionCount>(state, Dataset::get(spec), 1);
+      });
+    registerBenchmark("mapping/uniformization_threads/" + name, [spec](State& state) {
+        benchSubstitutionMapping_<UniformizationSubstitutionCount>(state, Dataset::get(spec), 0);
+      });
+    registerBenchmark("mapping/decomposition/" + name, [spec](State& state) {
+        benchSubstitutionMapping_<DecompositionSubstitutionCount>(state, Dataset::get(spec), 1);
+      });
+    registerBenchmark("mapping/stochastic/" + name, [spec](State& state) {
+        benchStochasticMapping_(state, Dataset::get(spec), 100, StochasticMapping::REJECTION);
+      });
+    registerBenchmark("mapping/stochastic_uniformization/" + name, [spec](State& state) {
+        benchStochasticMapping_(state, Dataset::get(spec), 100, StochasticMapping::UNIFORMIZATION);
+      });
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,164 @@
+//
+// File: bench_models.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
+#include <Bpp/Phyl/Model/Protein/JTT92.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+
+// From the STL:
+#include <memory>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+namespace
+{
+
+/*
+ * The branch lengths used for all measures.
+ */
+vector<double> getTimes_(size_t nbTimes)
+{
+  vector<double> times(nbTimes);
+  for (size_t i = 0; i < nbTimes; i++)
+  {
+    times[i] = 0.001 + 0.01 * static_cast<double>(i);
+  }
+  return times;
+}
+
+void benchPij_t_(State& state, const SubstitutionModel& model, size_t nbTimes)
+{
+  vector<double> times = getTimes_(nbTimes);
+  while (state.keepRunning())
+  {
+    for (size_t i = 0; i < times.size(); i++)
+    {
+      doNotOptimize(model.getPij_t(times[i])(0, 0));
+    }
+  }
+  state.setItemsProcessed(nbTimes);
+}
+
+void benchComputePij_t_(State& state, const SubstitutionModel& model, size_t nbTimes)
+{
+  vector<double> times = getTimes_(nbTimes);
+  vector< RowMatrix<double> > matrices;
+  while (state.keepRunning())
+  {
+    model.computePij_t(times, matrices);
+    doNotOptimize(matrices[0](0, 0));
+  }
+  state.setItemsProcessed(nbTimes);
+}
+
+void benchDerivatives_(State& state, const SubstitutionModel& model, size_t nbTimes)
+{
+  vector<double> times = getTimes_(nbTimes);
+  while (state.keepRunning())
+  {
+    for (size_t i = 0; i < times.size(); i++)
+    {
+      doNotOptimize(model.getdPij_dt(times[i])(0, 0));
+      doNotOptimize(model.getd2Pij_dt2(times[i])(0, 0));
+    }
+  }
+  state.setItemsProcessed(nbTimes);
+}
+
+/*
+ * Eigen decomposition of the generator, triggered by a parameter change.
+ */
+void benchUpdateMatrices_(State& state, SubstitutionModel& model, const string& parameter)
+{
+  double value = model.getParameterValue(parameter);
+  size_t i = 0;
+  while (state.keepRunning())
+  {
+    model.setParameterValue(parameter, value * (i % 2 == 0 ? 1.1 : 1.));
+    i++;
+  }
+  model.setParameterValue(parameter, value);
+  state.setItemsProcessed(1);
+}
+
+/*
+ * Register all benchmarks for a model. The parameter is used to trigger matrix updates, none if empty.
+ */
+void registerModel_(const string& name, const shared_ptr<SubstitutionModel>& model, const string& parameter)
+{
+  size_t nbTimes = 100;
+  registerBenchmark("pij_t/single/" + name, [model, nbTimes](State& state) {
+      benchPij_t_(state, *model, nbTimes);
+    });
+  registerBenchmark("pij_t/batch/" + name, [model, nbTimes](State& state) {
+      benchComputePij_t_(state, *model, nbTimes);
+    });
+  registerBenchmark("pij_t/derivatives/" + name, [model, nbTimes](State& state) {
+      benchDerivatives_(state, *model, nbTimes);
+    });
+  if (!parameter.empty())
+    registerBenchmark("model/update/" + name, [model, parameter](State& state) {
+        benchUpdateMatrices_(state, *model, parameter);
+      });
+}
+
+}
+
+/******************************************************************************/
+
+void bpp::bench::registerModelBenchmarks(bool quick)
+{
+  static StandardGeneticCode geneticCode(&AlphabetTools::DNA_ALPHABET);
+  registerModel_("hky85", shared_ptr<SubstitutionModel>(new HKY85(&AlphabetTools::DNA_ALPHABET, 2.)), "kappa");
+  registerModel_("gtr", shared_ptr<SubstitutionModel>(new GTR(&AlphabetTools::DNA_ALPHABET, 1., 0.2, 0.3, 0.4, 0.4, 0.1, 0.35, 0.35, 0.2)), "a");
+  registerModel_("jtt92", shared_ptr<SubstitutionModel>(new JTT92(&AlphabetTools::PROTEIN_ALPHABET)), "");
+  if (!quick)
+    registerModel_("yn98", shared_ptr<SubstitutionModel>(new YN98(&geneticCode, CodonFrequencySet::getFrequencySetForCodons(CodonFrequencySet::F3X4, &geneticCode))), "kappa");
+}
+
+/******************************************************************************/
+
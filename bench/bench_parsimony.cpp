@@ -0,0 +1,129 @@
+//
+// File: bench_parsimony.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:47 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+#include "Datasets.h"
+
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/Parsimony/ParsimonyKernels.h>
+
+// From the STL:
+#include <memory>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+namespace
+{
+
+/*
+ * Full computation of the parsimony score, including data compression.
+ */
+void benchParsimonyScore_(State& state, const Dataset& dataset, ParsimonyKernels::InstructionSet set)
+{
+  ParsimonyKernels::InstructionSet previous = ParsimonyKernels::getInstructionSet();
+  ParsimonyKernels::setInstructionSet(set);
+  while (state.keepRunning())
+  {
+    DRTreeParsimonyScore pars(dataset.getTree(), dataset.getSites(), false);
+    doNotOptimize(pars.getScore());
+  }
+  ParsimonyKernels::setInstructionSet(previous);
+  state.setItemsProcessed(dataset.getNumberOfSites());
+}
+
+/*
+ * Test all possible NNIs, as done at each step of a topology search.
+ */
+void benchParsimonyNNI_(State& state, const Dataset& dataset, ParsimonyKernels::InstructionSet set)
+{
+  ParsimonyKernels::InstructionSet previous = ParsimonyKernels::getInstructionSet();
+  ParsimonyKernels::setInstructionSet(set);
+  DRTreeParsimonyScore pars(dataset.getTree(), dataset.getSites(), false);
+  vector<int> nodeIds;
+  const Tree& tree = pars.getTopology();
+  vector<int> ids = tree.getNodesId();
+  for (size_t i = 0; i < ids.size(); i++)
+  {
+    if (tree.hasFather(ids[i]) && tree.hasFather(tree.getFatherId(ids[i])))
+      nodeIds.push_back(ids[i]);
+  }
+  while (state.keepRunning())
+  {
+    double diff = 0;
+    for (size_t i = 0; i < nodeIds.size(); i++)
+    {
+      diff += pars.testNNI(nodeIds[i]);
+    }
+    doNotOptimize(diff);
+  }
+  ParsimonyKernels::setInstructionSet(previous);
+  state.setItemsProcessed(nodeIds.size());
+}
+
+}
+
+/******************************************************************************/
+
+void bpp::bench::registerParsimonyBenchmarks(bool quick)
+{
+  vector<Dataset::Spec> specs = Dataset::getStandardSpecs(quick);
+  for (size_t i = 0; i < specs.size(); i++)
+  {
+    Dataset::Spec spec = specs[i];
+    string name = Dataset::getName(spec);
+    for (int k = 0; k < 2; k++)
+    {
+      ParsimonyKernels::InstructionSet set = (k == 0 ? LikelihoodKernels::SCALAR : LikelihoodKernels::AVX2);
+      if (!ParsimonyKernels::isSupported(set))
+        continue;
+      string setName = (k == 0 ? "scalar" : "avx2");
+      registerBenchmark("parsimony/score/" + setName + "/" + name, [spec, set](State& state) {
+          benchParsimonyScore_(state, Dataset::get(spec), set);
+        });
+      registerBenchmark("parsimony/nni/" + setName + "/" + name, [spec, set](State& state) {
+          benchParsimonyNNI_(state, Dataset::get(spec), set);
+        });
+    }
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,243 @@
+//
+// File: bench_trees.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:40 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "Benchmark.h"
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+
+// From the STL:
+#include <memory>
+#include <sstream>
+#include <map>
+
+using namespace bpp;
+using namespace bpp::bench;
+using namespace std;
+
+namespace
+{
+
+/*
+ * A set of random trees on the same taxa, with random branch lengths, built once.
+ */
+class TreeSet
+{
+  private:
+    vector<Tree*> trees_;
+
+  public:
+    TreeSet(size_t nbTaxa, size_t nbTrees) :
+      trees_()
+    {
+      RandomTools::setSeed(static_cast<long>(nbTaxa * 1000 + nbTrees));
+      vector<string> names(nbTaxa);
+      for (size_t i = 0; i < nbTaxa; i++)
+      {
+        names[i] = "T" + TextTools::toString(i + 1);
+      }
+      for (size_t i = 0; i < nbTrees; i++)
+      {
+        TreeTemplate<Node>* tree = TreeTemplateTools::getRandomTree(names, false);
+        vector<Node*> nodes = tree->getNodes();
+        for (size_t j = 0; j < nodes.size(); j++)
+        {
+          if (nodes[j]->hasFather())
+            nodes[j]->setDistanceToFather(RandomTools::randExponential(0.1));
+        }
+        trees_.push_back(tree);
+      }
+    }
+
+    ~TreeSet()
+    {
+      for (size_t i = 0; i < trees_.size(); i++)
+      {
+        delete trees_[i];
+      }
+    }
+
+  private:
+    TreeSet(const TreeSet&) = delete;
+    TreeSet& operator=(const TreeSet&) = delete;
+
+  public:
+    const vector<Tree*>& getTrees() const { return trees_; }
+
+    static const TreeSet& get(size_t nbTaxa, size_t nbTrees)
+    {
+      static map<pair<size_t, size_t>, unique_ptr<TreeSet> > sets;
+      unique_ptr<TreeSet>& treeSet = sets[make_pair(nbTaxa, nbTrees)];
+      if (!treeSet)
+        treeSet.reset(new TreeSet(nbTaxa, nbTrees));
+      return *treeSet;
+    }
+};
+
+void benchNewickWrite_(State& state, const vector<Tree*>& trees)
+{
+  Newick newick;
+  while (state.keepRunning())
+  {
+    ostringstream out;
+    newick.writeTrees(trees, out);
+    doNotOptimize(out.str().size());
+  }
+  state.setItemsProcessed(trees.size());
+}
+
+void benchNewickRead_(State& state, const vector<Tree*>& trees)
+{
+  Newick newick;
+  ostringstream out;
+  newick.writeTrees(trees, out);
+  string text = out.str();
+  while (state.keepRunning())
+  {
+    istringstream in(text);
+    vector<Tree*> readTrees;
+    newick.readTrees(in, readTrees);
+    doNotOptimize(readTrees.size());
+    for (size_t i = 0; i < readTrees.size(); i++)
+    {
+      delete readTrees[i];
+    }
+  }
+  state.setItemsProcessed(trees.size());
+}
+
+void benchConsensus_(State& state, const vector<Tree*>& trees, size_t nbThreads)
+{
+  while (state.keepRunning())
+  {
+    unique_ptr<TreeTemplate<Node> > consensus(TreeTools::majorityConsensus(trees, true, nbThreads));
+    doNotOptimize(consensus->getNumberOfNodes());
+  }
+  state.setItemsProcessed(trees.size());
+}
+
+void benchRobinsonFoulds_(State& state, const vector<Tree*>& trees, size_t nbThreads)
+{
+  while (state.keepRunning())
+  {
+    unique_ptr<DistanceMatrix> mat(TreeTools::getRobinsonFouldsDistanceMatrix(trees, nbThreads));
+    doNotOptimize((*mat)(0, 1));
+  }
+  state.setItemsProcessed(trees.size() * (trees.size() - 1) / 2);
+}
+
+void benchNeighborJoining_(State& state, const Tree& tree, bool bionj, size_t nbThreads)
+{
+  unique_ptr<DistanceMatrix> mat(TreeTools::getDistanceMatrix(tree));
+  unique_ptr<NeighborJoining> nj(bionj ? new BioNJ(false, false, false) : new NeighborJoining(false, false, false));
+  nj->setNumberOfThreads(nbThreads);
+  while (state.keepRunning())
+  {
+    nj->setDistanceMatrix(*mat);
+    nj->computeTree();
+    unique_ptr<TreeTemplate<Node> > njTree(nj->getTree());
+    doNotOptimize(njTree->getNumberOfNodes());
+  }
+  state.setItemsProcessed(mat->size());
+}
+
+}
+
+/******************************************************************************/
+
+void bpp::bench::registerTreeBenchmarks(bool quick)
+{
+  vector<size_t> nbTaxa;
+  nbTaxa.push_back(16);
+  nbTaxa.push_back(64);
+  if (!quick)
+    nbTaxa.push_back(256);
+  size_t nbTrees = (quick ? 20 : 100);
+  for (size_t i = 0; i < nbTaxa.size(); i++)
+  {
+    size_t n = nbTaxa[i];
+    string name = TextTools::toString(nbTrees) + "x" + TextTools::toString(n);
+    registerBenchmark("newick/write/" + name, [n, nbTrees](State& state) {
+        benchNewickWrite_(state, TreeSet::get(n, nbTrees).getTrees());
+      });
+    registerBenchmark("newick/read/" + name, [n, nbTrees](State& state) {
+        benchNewickRead_(state, TreeSet::get(n, nbTrees).getTrees());
+      });
+    registerBenchmark("consensus/majority/" + name, [n, nbTrees](State& state) {
+        benchConsensus_(state, TreeSet::get(n, nbTrees).getTrees(), 1);
+      });
+    registerBenchmark("consensus/majority-threads/" + name, [n, nbTrees](State& state) {
+        benchConsensus_(state, TreeSet::get(n, nbTrees).getTrees(), 0);
+      });
+    registerBenchmark("rf/matrix/" + name, [n, nbTrees](State& state) {
+        benchRobinsonFoulds_(state, TreeSet::get(n, nbTrees).getTrees(), 1);
+      });
+    registerBenchmark("rf/matrix-threads/" + name, [n, nbTrees](State& state) {
+        benchRobinsonFoulds_(state, TreeSet::get(n, nbTrees).getTrees(), 0);
+      });
+  }
+
+  vector<size_t> nbTaxaNJ;
+  nbTaxaNJ.push_back(256);
+  if (!quick)
+    nbTaxaNJ.push_back(2048);
+  for (size_t i = 0; i < nbTaxaNJ.size(); i++)
+  {
+    size_t n = nbTaxaNJ[i];
+    string name = TextTools::toString(n);
+    registerBenchmark("distance/nj/" + name, [n](State& state) {
+        benchNeighborJoining_(state, *TreeSet::get(n, 1).getTrees()[0], false, 1);
+      });
+    registerBenchmark("distance/nj-threads/" + name, [n](State& state) {
+        benchNeighborJoining_(state, *TreeSet::get(n, 1).getTrees()[0], false, 0);
+      });
+    registerBenchmark("distance/bionj/" + name, [n](State& state) {
+        benchNeighborJoining_(state, *TreeSet::get(n, 1).getTrees()[0], true, 1);
+      });
+  }
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,302 @@
+//
+// File: BipartitionCounter.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:54 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "BipartitionCounter.h"
+#include "BipartitionTools.h"
+#include "TreeTemplate.h"
+#include "ThreadPool.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+
+inline size_t popCount_(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_popcountll(x));
+#else
+  size_t n = 0;
+  for ( ; x; x &= x - 1)
+    n++;
+  return n;
+#endif
+}
+
+} //end of anonymous namespace.
+
+/******************************************************************************/
+
+size_t BipartitionCounter::WordsHash::operator()(const std::vector<uint64_t>& words) const
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < words.size(); i++)
+  {
+    uint64_t w = words[i] * 0x9e3779b97f4a7c15ULL;
+    h ^= w ^ (w >> 32);
+    h *= 0x100000001b3ULL;
+  }
+  return static_cast<size_t>(h ^ (h >> 29));
+}
+
+/******************************************************************************/
+
+BipartitionCounter::BipartitionCounter(const std::vector<std::string>& leavesNames) :
+  elements_(leavesNames),
+  elementIndex_(),
+  nbWords_(0),
+  lastWordMask_(0),
+  nbTrees_(0),
+  occurrences_(),
+  subtrees_(),
+  key_()
+{
+  if (elements_.size() < 2)
+    throw Exception("BipartitionCounter::BipartitionCounter. At least two leaves are needed.");
+  sort(elements_.begin(), elements_.end());
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    if (!elementIndex_.insert(make_pair(elements_[i], i)).second)
+      throw Exception("BipartitionCounter::BipartitionCounter. Duplicated leaf name: " + elements_[i] + ".");
+  }
+  nbWords_ = (elements_.size() + 63) / 64;
+  size_t nbLastBits = elements_.size() % 64;
+  lastWordMask_ = (nbLastBits == 0 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << nbLastBits) - 1);
+  key_.resize(nbWords_);
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::addTree(const Tree& tree)
+{
+  size_t branch = 0;
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  if (ttree)
+  {
+    addSubtree_(ttree->getRootNode(), 0, branch);
+  }
+  else
+  {
+    TreeTemplate<Node> tmp(tree);
+    addSubtree_(tmp.getRootNode(), 0, branch);
+  }
+  size_t nbLeaves = 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    nbLeaves += popCount_(subtrees_[w]);
+  }
+  if (nbLeaves != elements_.size())
+    throw Exception("BipartitionCounter::addTree. The tree does not contain all leaves.");
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::addSubtree_(const Node* node, size_t depth, size_t& branch)
+{
+  // Words for the subtree at depth d are stored at position d * nbWords_ in the buffer:
+  size_t offset = depth * nbWords_;
+  if (subtrees_.size() < offset + 2 * nbWords_)
+    subtrees_.resize(offset + 2 * nbWords_);
+  fill(subtrees_.begin() + static_cast<ptrdiff_t>(offset), subtrees_.begin() + static_cast<ptrdiff_t>(offset + nbWords_), 0);
+
+  size_t nbSons = node->getNumberOfSons();
+  if (nbSons == 0)
+  {
+    map<string, size_t>::const_iterator it = elementIndex_.find(node->getName());
+    if (it == elementIndex_.end())
+      throw Exception("BipartitionCounter::addTree. Unknown leaf: " + node->getName() + ".");
+    uint64_t bit = static_cast<uint64_t>(1) << (it->second % 64);
+    uint64_t& word = subtrees_[offset + it->second / 64];
+    if (word & bit)
+      throw Exception("BipartitionCounter::addTree. Duplicated leaf: " + node->getName() + ".");
+    word |= bit;
+    return;
+  }
+
+  bool isRoot = !node->hasFather();
+  for (size_t i = 0; i < nbSons; i++)
+  {
+    addSubtree_(node->getSon(i), depth + 1, branch);
+    // The buffer may have been reallocated:
+    uint64_t* subtree = &subtrees_[offset];
+    const uint64_t* sonSubtree = &subtrees_[offset + nbWords_];
+    for (size_t w = 0; w < nbWords_; w++)
+    {
+      subtree[w] |= sonSubtree[w];
+    }
+    // Skip the second son of a bifurcating root, as it defines the same bipartition as the first one:
+    if (!(isRoot && nbSons == 2 && i == 1))
+      addBipartition_(sonSubtree, branch);
+    branch++;
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::addBipartition_(const uint64_t* subtree, size_t branch)
+{
+  size_t n = elements_.size();
+  size_t size = 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    size += popCount_(subtree[w]);
+  }
+  if (size < 2 || n - size < 2)
+    return; // Trivial bipartition.
+
+  // Canonical form: the side which does not contain the first leaf.
+  bool hasFirst = (subtree[0] & 1) != 0;
+  for (size_t w = 0; w < nbWords_; w++)
+  {
+    key_[w] = (hasFirst ? ~subtree[w] : subtree[w]);
+  }
+  key_[nbWords_ - 1] &= lastWordMask_;
+
+  // BipartitionList codes the smallest side (or the subtree if sides have the same size) with ones:
+  bool onesAreSubtree = (size <= n / 2);
+  Occurrence& occurrence = occurrences_[key_];
+  occurrence.count++;
+  occurrence.last.tree = nbTrees_;
+  occurrence.last.branch = branch;
+  occurrence.flipped = (onesAreSubtree == hasFirst);
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::addTrees(const std::vector<Tree*>& trees, size_t nbThreads)
+{
+  if (nbThreads == 1 || trees.size() < 2)
+  {
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+      addTree(*trees[i]);
+    }
+    return;
+  }
+
+  ThreadPool pool(nbThreads);
+  size_t nbChunks = min(pool.getNumberOfThreads(), trees.size());
+  vector<BipartitionCounter> counters(nbChunks, BipartitionCounter(elements_));
+  pool.run(nbChunks, [&] (size_t chunk)
+  {
+    size_t begin, end;
+    ThreadPool::getChunkBounds(trees.size(), nbChunks, chunk, begin, end);
+    for (size_t i = begin; i < end; i++)
+    {
+      counters[chunk].addTree(*trees[i]);
+    }
+  });
+  // Merge in order, so that the position of the last occurrences does not depend on the number of threads:
+  for (size_t chunk = 0; chunk < nbChunks; chunk++)
+  {
+    merge(counters[chunk]);
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionCounter::merge(const BipartitionCounter& counter)
+{
+  if (counter.elements_ != elements_)
+    throw Exception("BipartitionCounter::merge. Counters do not have the same leaves.");
+  for (OccurrenceMap::const_iterator it = counter.occurrences_.begin(); it != counter.occurrences_.end(); it++)
+  {
+    Occurrence& occurrence = occurrences_[it->first];
+    occurrence.count += it->second.count;
+    occurrence.last.tree = nbTrees_ + it->second.last.tree;
+    occurrence.last.branch = it->second.last.branch;
+    occurrence.flipped = it->second.flipped;
+  }
+  nbTrees_ += counter.nbTrees_;
+}
+
+/******************************************************************************/
+
+BipartitionList* BipartitionCounter::getBipartitionList(std::vector<size_t>& bipScore, double threshold) const
+{
+  vector< pair<Position, const OccurrenceMap::value_type*> > selected;
+  for (OccurrenceMap::const_iterator it = occurrences_.begin(); it != occurrences_.end(); it++)
+  {
+    double score = static_cast<double>(it->second.count) / static_cast<double>(nbTrees_);
+    if (score <= threshold && score != 1.)
+      continue;
+    selected.push_back(make_pair(it->second.last, &(*it)));
+  }
+  sort(selected.begin(), selected.end(),
+       [] (const pair<Position, const OccurrenceMap::value_type*>& a, const pair<Position, const OccurrenceMap::value_type*>& b)
+       {
+         return a.first < b.first;
+       });
+
+  size_t n = elements_.size();
+  vector<uint64_t> bitBipL(selected.size() * nbWords_);
+  bipScore.resize(selected.size());
+  for (size_t i = 0; i < selected.size(); i++)
+  {
+    const vector<uint64_t>& words = selected[i].second->first;
+    uint64_t* bitBip = &bitBipL[i * nbWords_];
+    if (selected[i].second->second.flipped)
+      BipartitionTools::bitNot(bitBip, words.data(), n);
+    else
+      copy(words.begin(), words.end(), bitBip);
+    bipScore[i] = selected[i].second->second.count;
+  }
+
+  BipartitionList* bipL = new BipartitionList(elements_, bitBipL);
+
+  /* add terminal branches */
+  bipL->addTrivialBipartitions(false);
+  for (size_t i = 0; i < n; i++)
+  {
+    bipScore.push_back(nbTrees_);
+  }
+  return bipL;
+}
+
+/******************************************************************************/
+
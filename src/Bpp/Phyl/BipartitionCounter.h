@@ -0,0 +1,193 @@
+//
+// File: BipartitionCounter.h
+// Created by: agent
+// Created on: Fri Oct 16 20:54 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _BIPARTITIONCOUNTER_H_
+#define _BIPARTITIONCOUNTER_H_
+
+#include "Tree.h"
+#include "BipartitionList.h"
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+namespace bpp
+{
+
+class Node;
+
+/**
+ * @brief Count the occurrences of bipartitions in a set of trees.
+ *
+ * Trees are added one at a time, so that large sets of trees (for instance posterior samples,
+ * see Newick::processTrees()) can be summarized without storing them.
+ * Each bipartition is coded as an array of 64-bit words, one bit per leaf, and stored in its canonical form,
+ * that is the side of the bipartition which does not contain the first leaf.
+ * Occurrences are counted using a hash table, so that adding a tree takes a time linear
+ * in the number of its branches (times the number of words per bipartition).
+ * Trivial bipartitions (corresponding to external branches) are not counted.
+ *
+ * Leaves are identified by their names, which are indexed once, in alphabetic order,
+ * when the counter is built. All trees must have exactly the same leaves.
+ *
+ * @see TreeTools::bipartitionOccurrences
+ * @see TreeTools::thresholdConsensus
+ */
+class BipartitionCounter
+{
+  private:
+    /*
+     * The position of a bipartition, as the index of the tree and the index of the branch in this tree
+     * (in postorder, as in BipartitionList).
+     */
+    struct Position
+    {
+      size_t tree;
+      size_t branch;
+
+      bool operator<(const Position& pos) const
+      {
+        return tree < pos.tree || (tree == pos.tree && branch < pos.branch);
+      }
+    };
+
+    struct Occurrence
+    {
+      size_t count;
+      Position last;
+      bool flipped; // Tell if the last occurrence was coded with the first leaf on the side of ones.
+    };
+
+    struct WordsHash
+    {
+      size_t operator()(const std::vector<uint64_t>& words) const;
+    };
+
+    typedef std::unordered_map<std::vector<uint64_t>, Occurrence, WordsHash> OccurrenceMap;
+
+    std::vector<std::string> elements_;
+    std::map<std::string, size_t> elementIndex_;
+    size_t nbWords_;
+    uint64_t lastWordMask_;
+    size_t nbTrees_;
+    OccurrenceMap occurrences_;
+    std::vector<uint64_t> subtrees_;
+    std::vector<uint64_t> key_;
+
+  public:
+    /**
+     * @brief Build a new counter.
+     *
+     * @param leavesNames The names of the leaves of the trees that will be added.
+     */
+    BipartitionCounter(const std::vector<std::string>& leavesNames);
+
+    virtual ~BipartitionCounter() {}
+
+  public:
+    /**
+     * @brief Count all bipartitions of a tree.
+     *
+     * @param tree The tree to add.
+     * @throw Exception If the tree does not have the same leaves as the counter.
+     */
+    void addTree(const Tree& tree);
+
+    /**
+     * @brief Count all bipartitions of a set of trees, possibly in parallel.
+     *
+     * Results do not depend on the number of threads used.
+     *
+     * @param trees     The trees to add.
+     * @param nbThreads The number of threads to use (0 means the number of hardware threads).
+     * @throw Exception If trees do not have the same leaves as the counter.
+     */
+    void addTrees(const std::vector<Tree*>& trees, size_t nbThreads = 1);
+
+    /**
+     * @brief Add the counts of another counter.
+     *
+     * The trees counted by the other counter are considered as added after the ones of this counter.
+     *
+     * @param counter The counter to merge with this one.
+     * @throw Exception If the two counters do not have the same leaves.
+     */
+    void merge(const BipartitionCounter& counter);
+
+    /**
+     * @return The number of trees counted.
+     */
+    size_t getNumberOfTrees() const { return nbTrees_; }
+
+    /**
+     * @return The number of distinct non-trivial bipartitions found.
+     */
+    size_t getNumberOfBipartitions() const { return occurrences_.size(); }
+
+    /**
+     * @return The names of the leaves, in alphabetic order.
+     */
+    const std::vector<std::string>& getElementNames() const { return elements_; }
+
+    /**
+     * @brief Get the distinct bipartitions found, with their number of occurrences.
+     *
+     * Bipartitions are returned in the order of their last occurrence, followed by all trivial bipartitions,
+     * which are assigned the number of trees as number of occurrences.
+     * This is the list returned by TreeTools::bipartitionOccurrences.
+     *
+     * @param bipScore  [out] The number of occurrences of each returned bipartition.
+     * @param threshold Non-trivial bipartitions found in a proportion of trees lower or equal to this threshold
+     *                  are not returned, unless they are found in all trees. With the default value (0), all bipartitions are returned.
+     * @return A new BipartitionList object.
+     */
+    BipartitionList* getBipartitionList(std::vector<size_t>& bipScore, double threshold = 0.) const;
+
+  private:
+    void addSubtree_(const Node* node, size_t depth, size_t& branch);
+    void addBipartition_(const uint64_t* subtree, size_t branch);
+};
+
+} //end of namespace bpp.
+
+#endif //_BIPARTITIONCOUNTER_H_
+
@@ -102,48 +102,42 @@ bool operator<(IntAndInt iai1, IntAndInt iai2)
 /******************************************************************************/
 
 BipartitionList::BipartitionList(const Tree& tr, bool sorted, std::vector<int>* index) :
-  bitBipartitionList_(),
-  elements_(),
+  elements_(tr.getLeavesNames()),
+  nbWords_(0),
+  nbBipartitions_(0),
+  bitBipartitions_(),
   sorted_(sorted)
 {
-  size_t nbbip;
+  if (sorted)
+    std::sort(elements_.begin(), elements_.end());
+  nbWords_ = BipartitionTools::getNumberOfWords(elements_.size());
 
-  elements_ = tr.getLeavesNames();
+  // Index of each element (the first one is used if names are duplicated):
+  map<string, size_t> elementIndex;
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    elementIndex.insert(make_pair(elements_[i], i));
+  }
 
+  size_t nbbip;
   if (tr.isRooted())
     nbbip = tr.getNumberOfNodes() - 2;
   else
     nbbip = tr.getNumberOfNodes() - 1;
+  bitBipartitions_.reserve(nbbip * nbWords_);
 
-  if (sorted)
-    std::sort(elements_.begin(), elements_.end());
-
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  for (size_t i = 0; i < nbbip; i++)
-  {
-    bitBipartitionList_.push_back(new int[nbint]);
-    for (size_t j = 0; j < nbint; j++)
-    {
-      bitBipartitionList_[i][j] = 0;
-    }
-  }
-
-  size_t cpt = 0;
-  vector<string> underlyingNames;
+  vector<uint64_t> subtree(nbWords_);
   const Tree* tree = &tr;
   const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(tree);
   if (ttree)
   {
     // Gain some time...
-    buildBitBipartitions(ttree->getRootNode(), bitBipartitionList_, elements_, &cpt, index);
+    buildBitBipartitions(ttree->getRootNode(), subtree.data(), elementIndex, index);
   }
   else
   {
     TreeTemplate<Node> tmp(tr);
-    buildBitBipartitions(tmp.getRootNode(), bitBipartitionList_, elements_, &cpt, index);
+    buildBitBipartitions(tmp.getRootNode(), subtree.data(), elementIndex, index);
   }
 }
 
@@ -152,20 +146,19 @@ BipartitionList::BipartitionList(const Tree& tr, bool sorted, std::vector<int>*
 BipartitionList::BipartitionList(
   const std::vector<std::string>& elements,
   const std::vector<int*>& bitBipL) :
-  bitBipartitionList_(),
   elements_(elements),
+  nbWords_(BipartitionTools::getNumberOfWords(elements.size())),
+  nbBipartitions_(bitBipL.size()),
+  bitBipartitions_(bitBipL.size() * BipartitionTools::getNumberOfWords(elements.size()), 0),
   sorted_()
 {
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  for (size_t i = 0; i < bitBipL.size(); i++)
+  for (size_t i = 0; i < nbBipartitions_; i++)
   {
-    bitBipartitionList_.push_back(new int[nbint]);
-    for (size_t j = 0; j < nbint; j++)
+    uint64_t* bip = getBitBipartition(i);
+    for (size_t j = 0; j < elements_.size(); j++)
     {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
+      if (BipartitionTools::testBit(bitBipL[i], static_cast<int>(j)))
+        BipartitionTools::bit1(bip, j);
     }
   }
 
@@ -179,64 +172,61 @@ BipartitionList::BipartitionList(
 
 /******************************************************************************/
 
-BipartitionList::BipartitionList(const BipartitionList& bipL) :
-  bitBipartitionList_(),
-  elements_(bipL.elements_),
-  sorted_(bipL.sorted_)
+BipartitionList::BipartitionList(
+  const std::vector<std::string>& elements,
+  const std::vector<uint64_t>& bitBipL) :
+  elements_(elements),
+  nbWords_(BipartitionTools::getNumberOfWords(elements.size())),
+  nbBipartitions_(0),
+  bitBipartitions_(bitBipL),
+  sorted_()
 {
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (bipL.getNumberOfElements() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  bitBipartitionList_.resize(bipL.getNumberOfBipartitions());
-  vector<int*> bitBipL = bipL.getBitBipartitionList();
-  for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++)
-  {
-    bitBipartitionList_[i] = new int[nbint];
-    for (size_t j = 0; j < nbint; j++)
+  if (nbWords_ > 0)
+  {
+    if (bitBipL.size() % nbWords_ != 0)
+      throw Exception("BipartitionList::BipartitionList. The size of the bit matrix does not match the number of elements.");
+    nbBipartitions_ = bitBipL.size() / nbWords_;
+    // Make sure unused bits are set to zero:
+    uint64_t mask = BipartitionTools::getLastWordMask(elements_.size());
+    for (size_t i = 0; i < nbBipartitions_; i++)
     {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
+      bitBipartitions_[(i + 1) * nbWords_ - 1] &= mask;
     }
   }
+
+  vector<string> cpelements_ = elements;
+  std::sort(cpelements_.begin(), cpelements_.end());
+  if (cpelements_ == elements)
+    sorted_ = true;
+  else
+    sorted_ = false;
 }
 
 /******************************************************************************/
 
-BipartitionList& BipartitionList::operator=(const BipartitionList& bipL)
-{
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (bipL.getNumberOfElements() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+BipartitionList::BipartitionList(const BipartitionList& bipL) :
+  elements_(bipL.elements_),
+  nbWords_(bipL.nbWords_),
+  nbBipartitions_(bipL.nbBipartitions_),
+  bitBipartitions_(bipL.bitBipartitions_),
+  sorted_(bipL.sorted_)
+{}
 
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
-  {
-    delete[] bitBipartitionList_[i];
-  }
-  bitBipartitionList_.resize(bipL.getNumberOfBipartitions());
-  vector<int*> bitBipL = bipL.getBitBipartitionList();
-  for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++)
-  {
-    bitBipartitionList_[i] = new int[nbint];
-    for (size_t j = 0; j < nbint; j++)
-    {
-      bitBipartitionList_[i][j] = bitBipL[i][j];
-    }
-  }
+/******************************************************************************/
 
-  elements_ = bipL.elements_;
-  sorted_   = bipL.sorted_;
+BipartitionList& BipartitionList::operator=(const BipartitionList& bipL)
+{
+  elements_        = bipL.elements_;
+  nbWords_         = bipL.nbWords_;
+  nbBipartitions_  = bipL.nbBipartitions_;
+  bitBipartitions_ = bipL.bitBipartitions_;
+  sorted_          = bipL.sorted_;
   return *this;
 }
 
 /******************************************************************************/
 
-BipartitionList::~BipartitionList()
-{
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
-  {
-    delete[] bitBipartitionList_[i];
-  }
-}
+BipartitionList::~BipartitionList() {}
 
 /******************************************************************************/
 
@@ -244,12 +234,13 @@ map<string, bool> BipartitionList::getBipartition(size_t i) const
 {
   map<string, bool> bip;
 
-  if (i >= bitBipartitionList_.size())
+  if (i >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
+  const uint64_t* bitBip = getBitBipartition(i);
   for (size_t j = 0; j < elements_.size(); j++)
   {
-    if (BipartitionTools::testBit(bitBipartitionList_[i], static_cast<int>(j)))
+    if (BipartitionTools::testBit(bitBip, j))
       bip[elements_[j]] = true;
     else
       bip[elements_[j]] = false;
@@ -259,12 +250,22 @@ map<string, bool> BipartitionList::getBipartition(size_t i) const
 
 /******************************************************************************/
 
-int* BipartitionList::getBitBipartition(size_t i)
+uint64_t* BipartitionList::getBitBipartition(size_t i)
 {
-  if (i >= bitBipartitionList_.size())
+  if (i >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  return bitBipartitionList_[i];
+  return bitBipartitions_.data() + i * nbWords_;
+}
+
+/******************************************************************************/
+
+const uint64_t* BipartitionList::getBitBipartition(size_t i) const
+{
+  if (i >= nbBipartitions_)
+    throw Exception("Bipartition index exceeds BipartitionList size");
+
+  return bitBipartitions_.data() + i * nbWords_;
 }
 
 /******************************************************************************/
@@ -296,22 +297,14 @@ void BipartitionList::addBipartition(map<string, bool>& bipart, bool checkElemen
   if (checkElements && !BipartitionList::haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
 
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-  bitBipartitionList_.push_back(new int[nbint]);
-  size_t ind    = bitBipartitionList_.size() - 1;
-  for (size_t j = 0; j < nbint; j++)
-  {
-    bitBipartitionList_[ind][j] = 0;
-  }
+  bitBipartitions_.resize((nbBipartitions_ + 1) * nbWords_, 0);
+  nbBipartitions_++;
+  uint64_t* bitBip = getBitBipartition(nbBipartitions_ - 1);
 
   for (size_t i = 0; i < elements_.size(); i++)
   {
     if (bipart[elements_[i]] == true)
-      BipartitionTools::bit1(bitBipartitionList_[ind], static_cast<int>(i));
-    else
-      BipartitionTools::bit0(bitBipartitionList_[ind], static_cast<int>(i));
+      BipartitionTools::bit1(bitBip, i);
   }
 }
 
@@ -319,46 +312,31 @@ void BipartitionList::addBipartition(map<string, bool>& bipart, bool checkElemen
 
 void BipartitionList::deleteBipartition(size_t i)
 {
-  if (i >= bitBipartitionList_.size())
+  if (i >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  delete[] bitBipartitionList_[i];
-  bitBipartitionList_.erase(bitBipartitionList_.begin() + static_cast<ptrdiff_t>(i));
+  bitBipartitions_.erase(bitBipartitions_.begin() + static_cast<ptrdiff_t>(i * nbWords_),
+                         bitBipartitions_.begin() + static_cast<ptrdiff_t>((i + 1) * nbWords_));
+  nbBipartitions_--;
 }
 
 /******************************************************************************/
 
 bool BipartitionList::containsBipartition(map<string, bool>& bipart, bool checkElements) const
 {
-  size_t i, j;
-  bool dac, padac;
-
   if (checkElements && !BipartitionList::haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
 
-  for (i = 0; i < bitBipartitionList_.size(); i++)
+  vector<uint64_t> bitBip(nbWords_, 0);
+  for (size_t j = 0; j < elements_.size(); j++)
   {
-    dac = padac = false;
-    for (j = 0; j < elements_.size(); j++)
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[i], static_cast<int>(j)))
-      {
-        if (bipart[elements_[j]])
-          dac = true;
-        else
-          padac = true;
-      }
-      else
-      {
-        if (bipart[elements_[j]])
-          padac = true;
-        else
-          dac = true;
-      }
-      if (dac && padac)
-        break;
-    }
-    if (j == elements_.size())
+    if (bipart[elements_[j]])
+      BipartitionTools::bit1(bitBip.data(), j);
+  }
+
+  for (size_t i = 0; i < nbBipartitions_; i++)
+  {
+    if (BipartitionTools::areIdentical(getBitBipartition(i), bitBip.data(), elements_.size()))
       return true;
   }
   return false;
@@ -368,79 +346,33 @@ bool BipartitionList::containsBipartition(map<string, bool>& bipart, bool checkE
 
 bool BipartitionList::areIdentical(size_t k1, size_t k2) const
 {
-  bool dac, padac;
-
-  if (k1 >= bitBipartitionList_.size())
+  if (k1 >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
-  if (k2 >= bitBipartitionList_.size())
+  if (k2 >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  dac = padac = false;
-  for (size_t j = 0; j < elements_.size(); j++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k1], static_cast<int>(j)))
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        dac = true;
-      else
-        padac = true;
-    }
-    else
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        padac = true;
-      else
-        dac = true;
-    }
-    if (dac && padac)
-      return false;
-  }
-  return true;
+  return BipartitionTools::areIdentical(getBitBipartition(k1), getBitBipartition(k2), elements_.size());
 }
 
 /******************************************************************************/
 
 bool BipartitionList::areCompatible(size_t k1, size_t k2) const
 {
-  bool uu, uz, zu, zz;
-
-  if (k1 >= bitBipartitionList_.size())
+  if (k1 >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
-  if (k2 >= bitBipartitionList_.size())
+  if (k2 >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  uu = uz = zu = zz = false;
-
-  for (size_t j = 0; j < elements_.size(); j++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k1], static_cast<int>(j)))
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        uu = true;
-      else
-        uz = true;
-    }
-    else
-    {
-      if (BipartitionTools::testBit(bitBipartitionList_[k2], static_cast<int>(j)))
-        zu = true;
-      else
-        zz = true;
-    }
-    if (uu && uz && zu && zz)
-      return false;
-  }
-
-  return true;
+  return BipartitionTools::areCompatible(getBitBipartition(k1), getBitBipartition(k2), elements_.size());
 }
 
 /******************************************************************************/
 
 bool BipartitionList::areAllCompatible() const
 {
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  for (size_t i = 0; i < nbBipartitions_; i++)
   {
-    for (size_t j = i + 1; j < bitBipartitionList_.size(); j++)
+    for (size_t j = i + 1; j < nbBipartitions_; j++)
     {
       if (!BipartitionList::areCompatible(i, j))
         return false;
@@ -455,7 +387,7 @@ bool BipartitionList::areAllCompatibleWith(map<string, bool>& bipart, bool check
 {
   if (checkElements && !haveSameElementsThan(bipart))
     throw Exception("Distinct bipartition element sets");
-  size_t nbBip = bitBipartitionList_.size();
+  size_t nbBip = nbBipartitions_;
   const_cast<BipartitionList*>(this)->addBipartition(bipart, false);
 
   for (size_t i = 0; i < nbBip; i++)
@@ -476,7 +408,6 @@ void BipartitionList::sortElements()
 {
   vector<StringAndInt> relements_;
   StringAndInt sai;
-  size_t nbbip;
 
   for (size_t i = 0; i < elements_.size(); i++)
   {
@@ -492,34 +423,19 @@ void BipartitionList::sortElements()
     elements_[i] = relements_[i].str;
   }
 
-  nbbip = bitBipartitionList_.size();
-  bitBipartitionList_.resize(2 * nbbip);
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
-  for (size_t j = nbbip; j < 2 * nbbip; j++)
+  vector<uint64_t> sortedBitBipL(bitBipartitions_.size(), 0);
+  for (size_t j = 0; j < nbBipartitions_; j++)
   {
-    bitBipartitionList_[j] = new int[nbint];
-    for (size_t k = 0; k < nbint; k++)
-    {
-      bitBipartitionList_[j][k] = 0;
-    }
+    const uint64_t* bitBip = getBitBipartition(j);
+    uint64_t* sortedBitBip = sortedBitBipL.data() + j * nbWords_;
     for (size_t i = 0; i < elements_.size(); i++)
     {
-      if (BipartitionTools::testBit(bitBipartitionList_[j - nbbip], relements_[i].ind))
-        BipartitionTools::bit1(bitBipartitionList_[j], static_cast<int>(i));
-      else
-        BipartitionTools::bit0(bitBipartitionList_[j], static_cast<int>(i));
+      if (BipartitionTools::testBit(bitBip, static_cast<size_t>(relements_[i].ind)))
+        BipartitionTools::bit1(sortedBitBip, i);
     }
   }
 
-  for (size_t j = 0; j < nbbip; j++)
-  {
-    delete[] bitBipartitionList_[j];
-  }
-
-  bitBipartitionList_.erase(bitBipartitionList_.begin(), bitBipartitionList_.begin() + static_cast<ptrdiff_t>(nbbip));
+  bitBipartitions_.swap(sortedBitBipL);
   sorted_ = true;
 }
 
@@ -527,15 +443,10 @@ void BipartitionList::sortElements()
 
 size_t BipartitionList::getPartitionSize(size_t k) const
 {
-  size_t size = 0;
-  if (k >= bitBipartitionList_.size())
+  if (k >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
 
-  for (size_t i = 0; i < elements_.size(); i++)
-  {
-    if (BipartitionTools::testBit(bitBipartitionList_[k], static_cast<int>(i)))
-      size++;
-  }
+  size_t size = BipartitionTools::bitCount(getBitBipartition(k), nbWords_);
 
   if (size <= elements_.size() / 2)
     return size;
@@ -547,12 +458,18 @@ size_t BipartitionList::getPartitionSize(size_t k) const
 
 void BipartitionList::removeTrivialBipartitions()
 {
-  size_t size = bitBipartitionList_.size();
-  for (size_t i = size; i > 0; i--)
+  // Compact the matrix in a single pass:
+  size_t nbKept = 0;
+  for (size_t i = 0; i < nbBipartitions_; i++)
   {
-    if (BipartitionList::getPartitionSize(i - 1) < 2)
-      BipartitionList::deleteBipartition(i - 1);
+    if (BipartitionList::getPartitionSize(i) < 2)
+      continue;
+    if (nbKept != i)
+      std::copy(getBitBipartition(i), getBitBipartition(i) + nbWords_, getBitBipartition(nbKept));
+    nbKept++;
   }
+  nbBipartitions_ = nbKept;
+  bitBipartitions_.resize(nbKept * nbWords_);
 }
 
 /******************************************************************************/
@@ -579,11 +496,10 @@ void BipartitionList::addTrivialBipartitions(bool checkExisting)
 
 void BipartitionList::sortByPartitionSize()
 {
-  vector<int*> sortedBitBipL;
   vector<IntAndInt> iaiVec;
   IntAndInt iai;
 
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  for (size_t i = 0; i < nbBipartitions_; i++)
   {
     iai.ind = i;
     iai.val = static_cast<int>(BipartitionList::getPartitionSize(i));
@@ -592,31 +508,24 @@ void BipartitionList::sortByPartitionSize()
 
   std::sort(iaiVec.begin(), iaiVec.end());
 
-  for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+  vector<uint64_t> sortedBitBipL(bitBipartitions_.size());
+  for (size_t i = 0; i < nbBipartitions_; i++)
   {
-    sortedBitBipL.push_back(bitBipartitionList_[iaiVec[i].ind]);
+    const uint64_t* bitBip = getBitBipartition(iaiVec[i].ind);
+    std::copy(bitBip, bitBip + nbWords_, sortedBitBipL.begin() + static_cast<ptrdiff_t>(i * nbWords_));
   }
 
-  bitBipartitionList_ = sortedBitBipL;
+  bitBipartitions_.swap(sortedBitBipL);
 }
 
 /******************************************************************************/
 
 void BipartitionList::flip(size_t k)
 {
-  if (k >= bitBipartitionList_.size())
+  if (k >= nbBipartitions_)
     throw Exception("Bipartition index exceeds BipartitionList size");
-  size_t lword = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (elements_.size() + lword - 1) / lword;
-  size_t nbint = nbword * lword / (CHAR_BIT * sizeof(int));
-  int* flipbip = new int[nbint];
-  for (size_t i = 0; i < nbint; i++)
-  {
-    flipbip[i] = 0;
-  }
-  BipartitionTools::bitNot(flipbip, bitBipartitionList_[k], nbint);
-  delete[] bitBipartitionList_[k];
-  bitBipartitionList_[k] = flipbip;
+  uint64_t* bitBip = getBitBipartition(k);
+  BipartitionTools::bitNot(bitBip, bitBip, elements_.size());
 }
 
 /******************************************************************************/
@@ -628,9 +537,9 @@ void BipartitionList::removeRedundantBipartitions()
   while (deletion)
   {
     deletion = false;
-    for (size_t i = 0; i < bitBipartitionList_.size(); i++)
+    for (size_t i = 0; i < nbBipartitions_; i++)
     {
-      for (size_t j = i + 1; j < bitBipartitionList_.size(); j++)
+      for (size_t j = i + 1; j < nbBipartitions_; j++)
       {
         if (BipartitionList::areIdentical(i, j))
         {
@@ -650,11 +559,8 @@ void BipartitionList::removeRedundantBipartitions()
 TreeTemplate<Node>* BipartitionList::toTree() const
 {
   BipartitionList* sortedBipL;
-  vector<int*> sortedBitBipL;
-  int* bip;
   vector<Node*> vecNd, sonNd;
   vector<bool> alive;
-  size_t lword, nbword, nbint, ii;
 
   /* check, copy and prepare bipartition list */
 
@@ -669,26 +575,22 @@ TreeTemplate<Node>* BipartitionList::toTree() const
   }
   sortedBipL->sortByPartitionSize();
   sortedBipL->removeRedundantBipartitions();
-  sortedBitBipL = sortedBipL->getBitBipartitionList();
 
   for (size_t i = 0; i < sortedBipL->getNumberOfBipartitions(); i++)
   {
     alive.push_back(true);
   }
   vecNd.resize(sortedBipL->getNumberOfBipartitions() + 1);
-  lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  nbword = (elements_.size() + lword - 1) / lword;
-  nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-  bip    = new int[1]; bip[0] = 0;
 
   /* main loop: create one node per bipartition */
   for (size_t i = 0; i < sortedBipL->getNumberOfBipartitions(); i++)
   {
+    const uint64_t* bitBip = sortedBipL->getBitBipartition(i);
     if (sortedBipL->getPartitionSize(i) == 1)
     { // terminal
       for (size_t j = 0; j < sortedBipL->getNumberOfElements(); j++)
       {
-        if (BipartitionTools::testBit(sortedBitBipL[i], static_cast<int>(j)))
+        if (BipartitionTools::testBit(bitBip, j))
         {
           vecNd[i] = new Node(elements_[j]);
           break;
@@ -700,19 +602,10 @@ TreeTemplate<Node>* BipartitionList::toTree() const
       sonNd.clear();
       for (size_t j = 0; j < i; j++)
       {
-        if (alive[j])
+        if (alive[j] && BipartitionTools::isIncluded(sortedBipL->getBitBipartition(j), bitBip, nbWords_))
         {
-          for (ii = 0; ii < nbint; ii++)
-          {
-            BipartitionTools::bitOr(bip, sortedBitBipL[j] + ii, sortedBitBipL[i] + ii, 1);
-            if (bip[0] != sortedBitBipL[i][ii])
-              break;
-          }
-          if (ii == nbint)
-          {
-            sonNd.push_back(vecNd[j]);
-            alive[j] = false;
-          }
+          sonNd.push_back(vecNd[j]);
+          alive[j] = false;
         }
       }
       vecNd[i] = new Node();
@@ -740,63 +633,52 @@ TreeTemplate<Node>* BipartitionList::toTree() const
 
 /******************************************************************************/
 
-vector<string> BipartitionList::buildBitBipartitions(const Node* nd, vector<int*>& bitbip, const vector<string>& elements, size_t* cpt, vector<int>* index) const
+size_t BipartitionList::buildBitBipartitions(const Node* nd, uint64_t* subtree, const map<string, size_t>& elementIndex, vector<int>* index)
 {
-  vector<string> underelements_, retelements_;
+  size_t nbLeaves = 0;
+  std::fill(subtree, subtree + nbWords_, 0);
 
   if (nd->getNumberOfSons() == 0)
-    underelements_.push_back(nd->getName());
+  {
+    map<string, size_t>::const_iterator it = elementIndex.find(nd->getName());
+    if (it != elementIndex.end())
+      BipartitionTools::bit1(subtree, it->second);
+    nbLeaves = 1;
+  }
 
-  for (size_t i = 0; i < nd->getNumberOfSons(); i++)
+  if (nd->getNumberOfSons() > 0)
   {
-    retelements_ = BipartitionList::buildBitBipartitions(nd->getSon(i), bitbip, elements, cpt, index);
-    for (size_t j = 0; j < retelements_.size(); j++)
+    vector<uint64_t> sonSubtree(nbWords_);
+    for (size_t i = 0; i < nd->getNumberOfSons(); i++)
     {
-      underelements_.push_back(retelements_[j]);
+      nbLeaves += buildBitBipartitions(nd->getSon(i), sonSubtree.data(), elementIndex, index);
+      BipartitionTools::bitOr(subtree, subtree, sonSubtree.data(), nbWords_);
     }
   }
 
   if (!nd->hasFather())
-    return underelements_;  // root node
+    return nbLeaves;  // root node
 
   if (!nd->getFather()->hasFather())
   {
     size_t nbrootson = nd->getFather()->getNumberOfSons();
     if (nbrootson == 2 && nd == nd->getFather()->getSon(1))
-      return underelements_;  // son 2 of root node when root node has 2 sons
+      return nbLeaves;  // son 2 of root node when root node has 2 sons
   }
 
-  bool ones;
-  if (underelements_.size() <= elements.size() / 2)
-    ones = true;
+  // The smallest side of the bipartition is coded with ones:
+  bitBipartitions_.resize((nbBipartitions_ + 1) * nbWords_);
+  nbBipartitions_++;
+  uint64_t* bitBip = getBitBipartition(nbBipartitions_ - 1);
+  if (nbLeaves <= elements_.size() / 2)
+    std::copy(subtree, subtree + nbWords_, bitBip);
   else
-    ones = false;
-
-  for (size_t i = 0; i < elements.size(); i++)
-  {
-    if (ones)
-      BipartitionTools::bit0(bitbip[*cpt], static_cast<int>(i));
-    else
-      BipartitionTools::bit1(bitbip[*cpt], static_cast<int>(i));
-  }
-
-  for (size_t i = 0; i < underelements_.size(); i++)
-  {
-    size_t taxa_ind = 0;
-    while (underelements_[i] != elements[taxa_ind])
-      taxa_ind++;
-    if (ones)
-      BipartitionTools::bit1(bitbip[*cpt], static_cast<int>(taxa_ind));
-    else
-      BipartitionTools::bit0(bitbip[*cpt], static_cast<int>(taxa_ind));
-  }
-
-  (*cpt)++;
+    BipartitionTools::bitNot(bitBip, subtree, elements_.size());
 
   if (index)
     index->push_back(nd->getId());
 
-  return underelements_;
+  return nbLeaves;
 }
 
 /******************************************************************************/
@@ -48,6 +48,7 @@ knowledge of the CeCILL license and that you accept its terms.
 // From the STL:
 #include <map>
 #include <algorithm>
+#include <cstdint>
 
 namespace bpp
 {
@@ -64,8 +65,9 @@ template<class N> class TreeTemplate;
  * Coding trees this way is useful for comparing topologies, calculating topological distances,
  * producing consensus trees or super-trees, calculating bootstrap support.
  *
- * A BipartitionList includes a set of element names (typically leaf names) and a vector of arrays of bits
- * (int*, not bitsets, are used to allow for dynamic memory allocation). Each array of bit codes for one bipartition.
+ * A BipartitionList includes a set of element names (typically leaf names) and a matrix of bits, stored
+ * as a single contiguous array of 64-bit words, with one row of getNumberOfWords() words per bipartition.
+ * Each row of bits codes for one bipartition.
  * Each bit in an array of bit corresponds to one element, so the order of element names matter.
  * Bits set to zero versus bits set to one define the two partitions of elements.
  * A BipartitionList is called sorted if its elements (leaf names) are in alphabetic order (recommended).
@@ -85,8 +87,10 @@ class BipartitionList:
 {
   private:
 
-    std::vector<int*> bitBipartitionList_;
     std::vector<std::string> elements_;
+    size_t nbWords_;
+    size_t nbBipartitions_;
+    std::vector<uint64_t> bitBipartitions_;
     bool sorted_;
 
   public:
@@ -108,6 +112,14 @@ class BipartitionList:
      */
     BipartitionList(const std::vector<std::string>& elements, const std::vector<int*>& bipl);
 
+    /**
+     * @brief Build a list from elements and bipartitions stored as 64-bit words
+     * @param elements Leaf names
+     * @param bipl The bit-encoded bipartitions, as a matrix with one row of BipartitionTools::getNumberOfWords(elements.size()) words per bipartition.
+     * Unused bits of the last word of each row must be zero.
+     */
+    BipartitionList(const std::vector<std::string>& elements, const std::vector<uint64_t>& bipl);
+
     /**
      * @brief Copy-constructor
      */
@@ -128,13 +140,39 @@ class BipartitionList:
 
     const std::vector<std::string>& getElementNames() const { return elements_; }
 
-    size_t getNumberOfBipartitions() const { return bitBipartitionList_.size(); }
+    size_t getNumberOfBipartitions() const { return nbBipartitions_; }
+
+    /**
+     * @return The number of words used to store one bipartition.
+     */
+    size_t getNumberOfWords() const { return nbWords_; }
+
+    /**
+     * @return All bipartitions, as a matrix of words with one row per bipartition.
+     */
+    const std::vector<uint64_t>& getBitBipartitions() const { return bitBipartitions_; }
 
-    const std::vector<int*> & getBitBipartitionList() const { return bitBipartitionList_; }
+    /**
+     * @return A pointer toward each bipartition.
+     *
+     * @deprecated Bipartitions are now stored as arrays of uint64_t, in a single matrix.
+     * Use getBitBipartitions() or getBitBipartition() instead, which do not copy anything.
+     */
+    std::vector<const uint64_t*> getBitBipartitionList() const
+    {
+      std::vector<const uint64_t*> list(nbBipartitions_);
+      for (size_t i = 0; i < nbBipartitions_; i++)
+      {
+        list[i] = getBitBipartition(i);
+      }
+      return list;
+    }
 
     std::map<std::string, bool> getBipartition(size_t i) const;
 
-    int* getBitBipartition(size_t i);
+    uint64_t* getBitBipartition(size_t i);
+
+    const uint64_t* getBitBipartition(size_t i) const;
 
     bool haveSameElementsThan(std::map<std::string, bool>& bipart) const;
 
@@ -219,7 +257,7 @@ class BipartitionList:
 
   private:
 
-    std::vector<std::string> buildBitBipartitions(const Node* nd, std::vector<int*>& bitbip, const std::vector<std::string> & elements, size_t* cpt, std::vector<int>* index) const;
+    size_t buildBitBipartitions(const Node* nd, uint64_t* subtree, const std::map<std::string, size_t>& elementIndex, std::vector<int>* index);
 
 };
 
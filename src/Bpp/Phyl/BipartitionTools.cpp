@@ -123,12 +123,119 @@ bool BipartitionTools::testBit(int* plist, int num)
 
 /******************************************************************************/
 
+/* functions dealing with arrays of 64-bit words */
+
+void BipartitionTools::bitAnd(uint64_t* listet, const uint64_t* list1, const uint64_t* list2, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    listet[i] = list1[i] & list2[i];
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionTools::bitOr(uint64_t* listou, const uint64_t* list1, const uint64_t* list2, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    listou[i] = list1[i] | list2[i];
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionTools::bitNot(uint64_t* listnon, const uint64_t* list, size_t nbElements)
+{
+  size_t len = getNumberOfWords(nbElements);
+  for (size_t i = 0; i < len; i++)
+  {
+    listnon[i] = ~list[i];
+  }
+  if (len > 0)
+    listnon[len - 1] &= getLastWordMask(nbElements);
+}
+
+/******************************************************************************/
+
+size_t BipartitionTools::bitCount(const uint64_t* list, size_t len)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    count += static_cast<size_t>(__builtin_popcountll(list[i]));
+#else
+    for (uint64_t x = list[i]; x; x &= x - 1)
+      count++;
+#endif
+  }
+  return count;
+}
+
+/******************************************************************************/
+
+bool BipartitionTools::isIncluded(const uint64_t* list1, const uint64_t* list2, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if (list1[i] & ~list2[i])
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+bool BipartitionTools::areIdentical(const uint64_t* list1, const uint64_t* list2, size_t nbElements)
+{
+  size_t len = getNumberOfWords(nbElements);
+  uint64_t lastMask = getLastWordMask(nbElements);
+  bool same = true;
+  bool flipped = true;
+  for (size_t i = 0; i < len; i++)
+  {
+    uint64_t mask = (i == len - 1 ? lastMask : ~static_cast<uint64_t>(0));
+    uint64_t diff = (list1[i] ^ list2[i]) & mask;
+    if (diff != 0)
+      same = false;
+    if (diff != mask)
+      flipped = false;
+    if (!same && !flipped)
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+bool BipartitionTools::areCompatible(const uint64_t* list1, const uint64_t* list2, size_t nbElements)
+{
+  size_t len = getNumberOfWords(nbElements);
+  uint64_t lastMask = getLastWordMask(nbElements);
+  uint64_t uu = 0, uz = 0, zu = 0, zz = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    uint64_t mask = (i == len - 1 ? lastMask : ~static_cast<uint64_t>(0));
+    uint64_t a = list1[i];
+    uint64_t b = list2[i];
+    uu |= a & b;
+    uz |= a & ~b & mask;
+    zu |= ~a & b & mask;
+    zz |= ~a & ~b & mask;
+    if (uu && uz && zu && zz)
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
 BipartitionList* BipartitionTools::buildBipartitionPair(
   const BipartitionList& bipartL1, size_t i1,
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
-  vector<int*> bitBipL1, bitBipL2, twoBitBipL;
   vector<string> elements;
 
   if (i1 >= bipartL1.getNumberOfBipartitions())
@@ -139,37 +246,38 @@ BipartitionList* BipartitionTools::buildBipartitionPair(
   if (checkElements && !VectorTools::haveSameElements(bipartL1.getElementNames(), bipartL2.getElementNames()))
     throw Exception("Distinct bipartition element sets");
 
-  /* get sorted bit bipartition lists */
+  /* get sorted bit bipartitions */
   /* (if input is sorted: easy; otherwise: first copy, then sort) */
 
+  size_t nbWords = getNumberOfWords(bipartL1.getNumberOfElements());
+  vector<uint64_t> twoBitBipL(2 * nbWords, 0);
+
   if (bipartL1.isSorted())
   {
     elements = bipartL1.getElementNames();
-    bitBipL1 = bipartL1.getBitBipartitionList();
+    std::copy(bipartL1.getBitBipartition(i1), bipartL1.getBitBipartition(i1) + nbWords, twoBitBipL.begin());
   }
   else
   {
-    BipartitionList provBipartL(bipartL1.getElementNames(), bipartL1.getBitBipartitionList());
+    BipartitionList provBipartL(bipartL1);
     provBipartL.sortElements();
     elements = provBipartL.getElementNames();
-    bitBipL1 = provBipartL.getBitBipartitionList();
+    std::copy(provBipartL.getBitBipartition(i1), provBipartL.getBitBipartition(i1) + nbWords, twoBitBipL.begin());
   }
 
   if (bipartL2.isSorted())
   {
-    bitBipL2 = bipartL2.getBitBipartitionList();
+    std::copy(bipartL2.getBitBipartition(i2), bipartL2.getBitBipartition(i2) + nbWords, twoBitBipL.begin() + static_cast<ptrdiff_t>(nbWords));
   }
   else
   {
-    BipartitionList provBipartL(bipartL2.getElementNames(), bipartL2.getBitBipartitionList());
+    BipartitionList provBipartL(bipartL2);
     provBipartL.sortElements();
-    bitBipL2 = provBipartL.getBitBipartitionList();
+    std::copy(provBipartL.getBitBipartition(i2), provBipartL.getBitBipartition(i2) + nbWords, twoBitBipL.begin() + static_cast<ptrdiff_t>(nbWords));
   }
 
   /* create a new BipartitionList with just the two focal bipartitions */
 
-  twoBitBipL.push_back(bitBipL1[i1]);
-  twoBitBipL.push_back(bitBipL2[i2]);
   BipartitionList* twoBipL = new BipartitionList(elements, twoBitBipL);
   return twoBipL;
 }
@@ -181,6 +289,17 @@ bool BipartitionTools::areIdentical(
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
+  if (bipartL1.isSorted() && bipartL2.isSorted() && bipartL1.getNumberOfElements() == bipartL2.getNumberOfElements())
+  {
+    // Both lists use the same bit order, no copy needed:
+    if (i1 >= bipartL1.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (i2 >= bipartL2.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (checkElements && !VectorTools::haveSameElements(bipartL1.getElementNames(), bipartL2.getElementNames()))
+      throw Exception("Distinct bipartition element sets");
+    return areIdentical(bipartL1.getBitBipartition(i1), bipartL2.getBitBipartition(i2), bipartL1.getNumberOfElements());
+  }
   BipartitionList* twoBipL = buildBipartitionPair(bipartL1, i1, bipartL2, i2, checkElements);
   bool test = twoBipL->areIdentical(0, 1);
   delete twoBipL;
@@ -194,6 +313,17 @@ bool BipartitionTools::areCompatible(
   const BipartitionList& bipartL2, size_t i2,
   bool checkElements)
 {
+  if (bipartL1.isSorted() && bipartL2.isSorted() && bipartL1.getNumberOfElements() == bipartL2.getNumberOfElements())
+  {
+    // Both lists use the same bit order, no copy needed:
+    if (i1 >= bipartL1.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (i2 >= bipartL2.getNumberOfBipartitions())
+      throw Exception("Bipartition index exceeds BipartitionList size");
+    if (checkElements && !VectorTools::haveSameElements(bipartL1.getElementNames(), bipartL2.getElementNames()))
+      throw Exception("Distinct bipartition element sets");
+    return areCompatible(bipartL1.getBitBipartition(i1), bipartL2.getBitBipartition(i2), bipartL1.getNumberOfElements());
+  }
   BipartitionList* twoBipL = buildBipartitionPair(bipartL1, i1, bipartL2, i2, checkElements);
   bool test = twoBipL->areCompatible(0, 1);
   delete twoBipL;
@@ -207,8 +337,7 @@ BipartitionList* BipartitionTools::mergeBipartitionLists(
   bool checkElements)
 {
   vector<string> elements;
-  vector<int*> mergedBitBipL;
-  int* provBitBip;
+  vector<uint64_t> mergedBitBipL;
   BipartitionList* mergedBipL;
 
   if (vecBipartL.size() == 0)
@@ -223,37 +352,31 @@ BipartitionList* BipartitionTools::mergeBipartitionLists(
     }
   }
 
-  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
-  size_t nbword = (vecBipartL[0]->getElementNames().size() + lword - 1) / lword;
-  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
-
   elements = vecBipartL[0]->getElementNames();
   if (!vecBipartL[0]->isSorted())
     std::sort(elements.begin(), elements.end());
 
+  size_t nbWords = getNumberOfWords(elements.size());
+  size_t nbBip = 0;
+  for (size_t i = 0; i < vecBipartL.size(); i++)
+  {
+    nbBip += vecBipartL[i]->getNumberOfBipartitions();
+  }
+  mergedBitBipL.reserve(nbBip * nbWords);
+
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
-    vector<int*> bitBipL;
     if (vecBipartL[i]->isSorted())
     {
-      bitBipL = vecBipartL[i]->getBitBipartitionList();
+      const vector<uint64_t>& bitBipL = vecBipartL[i]->getBitBipartitions();
+      mergedBitBipL.insert(mergedBitBipL.end(), bitBipL.begin(), bitBipL.end());
     }
     else
     {
-      // We don't need the extra recopy here, do we?
-      // BipartitionList provBipartL(BipartitionList(vecBipartL[i]->getElementNames(), vecBipartL[i]->getBitBipartitionList()));
-      BipartitionList provBipartL(vecBipartL[i]->getElementNames(), vecBipartL[i]->getBitBipartitionList());
+      BipartitionList provBipartL(*vecBipartL[i]);
       provBipartL.sortElements();
-      bitBipL = provBipartL.getBitBipartitionList();
-    }
-    for (size_t j = 0; j < bitBipL.size(); j++)
-    {
-      provBitBip = new int[nbint];
-      for (size_t k = 0; k < nbint; k++)
-      {
-        provBitBip[k] = bitBipL[j][k];
-      }
-      mergedBitBipL.push_back(provBitBip);
+      const vector<uint64_t>& bitBipL = provBipartL.getBitBipartitions();
+      mergedBitBipL.insert(mergedBitBipL.end(), bitBipL.begin(), bitBipL.end());
     }
   }
 
@@ -267,8 +390,6 @@ VectorSiteContainer* BipartitionTools::MRPEncode(
   const vector<BipartitionList*>& vecBipartL)
 {
   vector<string> all_elements;
-  map<string, bool> bip;
-  vector<string> bip_elements;
   const DNA* alpha = &AlphabetTools::DNA_ALPHABET;
   vector<string> sequences;
 
@@ -276,33 +397,49 @@ VectorSiteContainer* BipartitionTools::MRPEncode(
     throw Exception("Empty vector passed");
 
   vector< vector<string> > vecElementLists;
+  size_t nbBip = 0;
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
     vecElementLists.push_back(vecBipartL[i]->getElementNames());
+    nbBip += vecBipartL[i]->getNumberOfBipartitions();
   }
 
   all_elements = VectorTools::vectorUnion(vecElementLists);
+  map<string, size_t> allIndex;
+  for (size_t k = 0; k < all_elements.size(); k++)
+  {
+    allIndex[all_elements[k]] = k;
+  }
 
   sequences.resize(all_elements.size());
+  for (size_t k = 0; k < all_elements.size(); k++)
+  {
+    sequences[k].reserve(nbBip);
+  }
 
+  const size_t missing = all_elements.size();
+  vector<size_t> positions(all_elements.size());
   for (size_t i = 0; i < vecBipartL.size(); i++)
   {
-    for (size_t j = 0; j < vecBipartL[i]->getNumberOfBipartitions(); j++)
+    /* position of each element in the current list, if present */
+    const vector<string>& elements = vecBipartL[i]->getElementNames();
+    std::fill(positions.begin(), positions.end(), missing);
+    for (size_t j = 0; j < elements.size(); j++)
     {
-      bip = vecBipartL[i]->getBipartition(j);
-      bip_elements = MapTools::getKeys(bip);
+      positions[allIndex[elements[j]]] = j;
+    }
 
+    for (size_t j = 0; j < vecBipartL[i]->getNumberOfBipartitions(); j++)
+    {
+      const uint64_t* bip = vecBipartL[i]->getBitBipartition(j);
       for (size_t k = 0; k < all_elements.size(); k++)
       {
-        if (VectorTools::contains(bip_elements, all_elements[k]))
-        {
-          if (bip[all_elements[k]])
-            sequences[k].push_back('C');
-          else
-            sequences[k].push_back('A');
-        }
-        else
+        if (positions[k] == missing)
           sequences[k].push_back('N');
+        else if (testBit(bip, positions[k]))
+          sequences[k].push_back('C');
+        else
+          sequences[k].push_back('A');
       }
     }
   }
@@ -45,6 +45,9 @@
 // From bpp-seq:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <cstdint>
+
 namespace bpp
 {
 /**
@@ -133,6 +136,85 @@ public:
    */
   static bool testBit(int* list, int num);
 
+  /**
+   * @name Arrays of 64-bit words
+   *
+   * These are the arrays used by BipartitionList, where bit number num is stored in word num / 64.
+   * Unused bits of the last word are always zero.
+   * Functions working on whole arrays process them one word at a time, and stop as soon as the result is known.
+   *
+   * @{
+   */
+
+  /**
+   * @return The number of words needed to store nbElements bits.
+   */
+  static size_t getNumberOfWords(size_t nbElements) { return (nbElements + 63) / 64; }
+
+  /**
+   * @return A mask with the bits used in the last word set to one.
+   */
+  static uint64_t getLastWordMask(size_t nbElements)
+  {
+    return nbElements % 64 == 0 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << (nbElements % 64)) - 1;
+  }
+
+  /**
+   * @brief Sets bit number num of bit array list to one
+   */
+  static void bit1(uint64_t* list, size_t num) { list[num / 64] |= static_cast<uint64_t>(1) << (num % 64); }
+
+  /**
+   * @brief Sets bit number num of bit array list to zero
+   */
+  static void bit0(uint64_t* list, size_t num) { list[num / 64] &= ~(static_cast<uint64_t>(1) << (num % 64)); }
+
+  /**
+   * @brief Tells whether bit number num in bit array list is one
+   */
+  static bool testBit(const uint64_t* list, size_t num) { return ((list[num / 64] >> (num % 64)) & 1) != 0; }
+
+  /**
+   * @brief bit-wise logical AND between two arrays of words
+   */
+  static void bitAnd(uint64_t* listet, const uint64_t* list1, const uint64_t* list2, size_t len);
+
+  /**
+   * @brief bit-wise logical OR between two arrays of words
+   */
+  static void bitOr(uint64_t* listou, const uint64_t* list1, const uint64_t* list2, size_t len);
+
+  /**
+   * @brief bit-wise logical NOT of an array coding for nbElements bits
+   *
+   * Unused bits of the last word are left to zero.
+   */
+  static void bitNot(uint64_t* listnon, const uint64_t* list, size_t nbElements);
+
+  /**
+   * @return The number of bits set to one in an array of words.
+   */
+  static size_t bitCount(const uint64_t* list, size_t len);
+
+  /**
+   * @brief Tells whether all bits set in list1 are also set in list2.
+   */
+  static bool isIncluded(const uint64_t* list1, const uint64_t* list2, size_t len);
+
+  /**
+   * @brief Tells whether two arrays of nbElements bits code for the same bipartition (possibly flipped).
+   */
+  static bool areIdentical(const uint64_t* list1, const uint64_t* list2, size_t nbElements);
+
+  /**
+   * @brief Tells whether two arrays of nbElements bits code for compatible bipartitions.
+   *
+   * @see BipartitionList::areCompatible
+   */
+  static bool areCompatible(const uint64_t* list1, const uint64_t* list2, size_t nbElements);
+
+  /** @} */
+
   /**
    * @brief Makes one BipartitionList out of several
    *
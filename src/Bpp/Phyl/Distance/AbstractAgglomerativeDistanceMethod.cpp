@@ -47,6 +47,7 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -54,26 +55,32 @@ void AbstractAgglomerativeDistanceMethod::setDistanceMatrix(const DistanceMatrix
 {
   if (matrix.size() <= 3)
     throw Exception("AbstractAgglomerativeDistanceMethod::setDistanceMatrix(): matrix must be at least of dimension 3.");
-  matrix_ = matrix;
+  matrix_ = PackedDistanceMatrix(matrix);
   currentNodes_.clear();
+  activeNodes_.clear();
   if (tree_) delete tree_;
+  tree_ = 0;
 }
     
 void AbstractAgglomerativeDistanceMethod::computeTree()
 {
   // Initialization:
-  for (size_t i = 0; i < matrix_.size(); ++i)
+  size_t n = matrix_.size();
+  currentNodes_.resize(n);
+  activeNodes_.resize(n);
+  for (size_t i = 0; i < n; ++i)
   {
     currentNodes_[i] = getLeafNode(static_cast<int>(i), matrix_.getName(i));
+    activeNodes_[i] = i;
   }
-  int idNextNode = static_cast<int>(matrix_.size());
-  vector<double> newDist(matrix_.size());
+  int idNextNode = static_cast<int>(n);
+  vector<double> newDist(n);
   
   // Build tree:
-  while (currentNodes_.size() > (rootTree_ ? 2 : 3))
+  while (activeNodes_.size() > (rootTree_ ? 2 : 3))
   {
     if (verbose_)
-      ApplicationTools::displayGauge(matrix_.size() - currentNodes_.size(), matrix_.size() - (rootTree_ ? 2 : 3) - 1);
+      ApplicationTools::displayGauge(n - activeNodes_.size(), n - (rootTree_ ? 2 : 3) - 1);
     vector<size_t> bestPair = getBestPair();
     vector<double> distances = computeBranchLengthsForPair(bestPair);
     Node* best1 = currentNodes_[bestPair[0]];
@@ -83,12 +90,11 @@ void AbstractAgglomerativeDistanceMethod::computeTree()
     best2->setDistanceToFather(distances[1]);
     Node* parent = getParentNode(idNextNode, best1, best2);
     idNextNode++;
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+    for (size_t k = 0; k < activeNodes_.size(); ++k)
     {
-      size_t id = i->first;
+      size_t id = activeNodes_[k];
       if (id != bestPair[0] && id != bestPair[1])
       {
-        assert (id < newDist.size()); //DEBUG
         newDist[id] = computeDistancesFromPair(bestPair, distances, id);
       }
       else
@@ -96,18 +102,25 @@ void AbstractAgglomerativeDistanceMethod::computeTree()
         newDist[id] = 0;
       }
     }
-    // Actualize currentNodes_:
+    // Actualize current nodes:
     currentNodes_[bestPair[0]] = parent;
-    currentNodes_.erase(bestPair[1]);
-    for (map<size_t, Node *>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
-    {
-      size_t id = i->first;
-      matrix_(bestPair[0], id) = matrix_(id, bestPair[0]) = newDist[id];
-    }  
+    currentNodes_[bestPair[1]] = 0;
+    activeNodes_.erase(std::lower_bound(activeNodes_.begin(), activeNodes_.end(), bestPair[1]));
+    updateDistancesFromPair(bestPair, newDist);
   }
   finalStep(idNextNode);
 }
 
+void AbstractAgglomerativeDistanceMethod::updateDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& newDistances)
+{
+  for (size_t k = 0; k < activeNodes_.size(); ++k)
+  {
+    size_t id = activeNodes_[k];
+    if (id != pair[0])
+      matrix_.set(pair[0], id, newDistances[id]);
+  }
+}
+
 Node* AbstractAgglomerativeDistanceMethod::getLeafNode(int id, const std::string& name)
 {
   return new Node(id, name);
@@ -42,11 +42,12 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _ABSTRACTAGGLOMERATIVEDISTANCEMETHOD_H_
 
 #include "DistanceMethod.h"
+#include "PackedDistanceMatrix.h"
 #include "../Node.h"
 #include "../TreeTemplate.h"
 
 // From the STL:
-#include <map>
+#include <vector>
 
 namespace bpp
 {
@@ -54,8 +55,11 @@ namespace bpp
 /**
  * @brief Partial implementation of the AgglomerativeDistanceMethod interface.
  *
- * This class provides a DistanceMatrix object for computations, and a map
- * with pivot indices and a pointer toward the corresponding subtree.
+ * This class provides a distance matrix for computations, and a vector
+ * with a pointer toward the subtree corresponding to each pivot index.
+ * The matrix is stored as a packed upper triangle (see PackedDistanceMatrix),
+ * and the indices of the current nodes are kept in increasing order in a vector,
+ * so that all loops over current pairs work on contiguous memory.
  *
  * Several methods, commons to several algorithm are provided.
  */
@@ -63,10 +67,18 @@ class AbstractAgglomerativeDistanceMethod:
   public virtual AgglomerativeDistanceMethod
 {
 	protected:
-		DistanceMatrix matrix_;
+		PackedDistanceMatrix matrix_;
 		Tree* tree_;
 
-    std::map<size_t, Node*> currentNodes_;
+    /**
+     * @brief Subtrees corresponding to each pivot index, 0 for indices which are not current anymore.
+     */
+    std::vector<Node*> currentNodes_;
+
+    /**
+     * @brief Indices of the current nodes, in increasing order.
+     */
+    std::vector<size_t> activeNodes_;
     bool verbose_;
     bool rootTree_;
 	
@@ -75,10 +87,10 @@ class AbstractAgglomerativeDistanceMethod:
     //  matrix_(0), tree_(0), currentNodes_(), verbose_(true), rootTree_(false) {}
 
 		AbstractAgglomerativeDistanceMethod(bool verbose = true, bool rootTree = false) :
-      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree) {}
+      matrix_(), tree_(0), currentNodes_(), activeNodes_(), verbose_(verbose), rootTree_(rootTree) {}
 		
     AbstractAgglomerativeDistanceMethod(const DistanceMatrix& matrix, bool verbose = true, bool rootTree = false) :
-      matrix_(0), tree_(0), currentNodes_(), verbose_(verbose), rootTree_(rootTree)
+      matrix_(), tree_(0), currentNodes_(), activeNodes_(), verbose_(verbose), rootTree_(rootTree)
     {
       setDistanceMatrix(matrix);
     }
@@ -90,7 +102,7 @@ class AbstractAgglomerativeDistanceMethod:
     }
     
     AbstractAgglomerativeDistanceMethod(const AbstractAgglomerativeDistanceMethod& a) :
-      matrix_(a.matrix_), tree_(0), currentNodes_(), verbose_(a.verbose_), rootTree_(a.rootTree_)
+      matrix_(a.matrix_), tree_(0), currentNodes_(), activeNodes_(), verbose_(a.verbose_), rootTree_(a.rootTree_)
     {
       // Hard copy of inner tree:
       if (a.tree_)
@@ -105,6 +117,7 @@ class AbstractAgglomerativeDistanceMethod:
         tree_ = new TreeTemplate<Node>(* a.tree_);
       else tree_ = 0;
       currentNodes_.clear();
+      activeNodes_.clear();
       verbose_ = a.verbose_;
       rootTree_ = a.rootTree_;
       return *this;
@@ -135,9 +148,10 @@ class AbstractAgglomerativeDistanceMethod:
      * 2) Get the best pair to agglomerate (getBestPair method)
      * 3) Compute the branch lengths for this pair (computeBranchLengthsForPair method)
      * 4) Build the parent node of the pair (getParentNode method)
-     * 5) For each remaining node, update distances from the pair (computeDistancesFromPair method)
-     * 6) Return to step 2 while there are more than 3 remaining nodes.
-     * 7) Perform the final step, and send a rooted or unrooted tree.
+     * 5) For each remaining node, compute distances from the pair (computeDistancesFromPair method)
+     * 6) Update the distance matrix (updateDistancesFromPair method)
+     * 7) Return to step 2 while there are more than 3 remaining nodes.
+     * 8) Perform the final step, and send a rooted or unrooted tree.
      */
 		virtual void computeTree();
 
@@ -157,7 +171,7 @@ class AbstractAgglomerativeDistanceMethod:
      * Define the criterion to chose the next pair of nodes to agglomerate.
      * This criterion uses the matrix_ distance matrix.
      *
-     * @return A size 2 vector with the indices of the nodes.
+     * @return A size 2 vector with the indices of the nodes, the smallest one first.
      * @throw Exception If an error occured.
      */
 		virtual std::vector<size_t> getBestPair() = 0;
@@ -186,6 +200,19 @@ class AbstractAgglomerativeDistanceMethod:
      * @return The distance between the 'pos' node and the agglomerated pair.
      */
 		virtual double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos) = 0;
+
+    /**
+     * @brief Store the distances from the agglomerated pair in the distance matrix.
+     *
+     * This method is called once the pair has been agglomerated: the new node takes
+     * the index pair[0], and pair[1] has been removed from the current nodes.
+     * When it is called, matrix_ still contains the distances from the two nodes of the pair,
+     * so that derived classes can use them to update their own data before calling this implementation.
+     *
+     * @param pair The indices of the agglomerated nodes.
+     * @param newDistances The distances from the new node, for each current node index.
+     */
+    virtual void updateDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& newDistances);
 		
     /**
      * @brief Method called when there ar eonly three remaining node to agglomerate, and creates the root node of the tree.
@@ -40,8 +40,6 @@
 #include "BioNJ.h"
 #include "../Tree.h"
 
-#include <Bpp/App/ApplicationTools.h>
-
 using namespace bpp;
 
 // From the STL:
@@ -57,74 +55,39 @@ double BioNJ::computeDistancesFromPair(const vector<size_t>& pair, const vector<
          :          lambda_ * (matrix_(pair[0], pos) - branchLengths[0]) + (1 - lambda_) * (matrix_(pair[1], pos) - branchLengths[1]);
 }
 
-void BioNJ::computeTree()
+vector<double> BioNJ::computeBranchLengthsForPair(const vector<size_t>& pair)
 {
-  // Initialization:
-  for (size_t i = 0; i < matrix_.size(); i++)
-  {
-    currentNodes_[i] = getLeafNode(static_cast<int>(i), matrix_.getName(i));
-  }
-  int idNextNode = static_cast<int>(matrix_.size());
-  vector<double> newDist(matrix_.size());
-  vector<double> newVar(matrix_.size());
-
-  // Build tree:
-  while (currentNodes_.size() > (rootTree_ ? 2 : 3))
+  // compute lambda
+  lambda_ = 0;
+  if (variance_(pair[0], pair[1]) == 0)
+    lambda_ = .5;
+  else
   {
-    if (verbose_)
-      ApplicationTools::displayGauge(matrix_.size() - currentNodes_.size(), matrix_.size() - (rootTree_ ? 2 : 3) - 1);
-    vector<size_t> bestPair = getBestPair();
-    vector<double> distances = computeBranchLengthsForPair(bestPair);
-    Node* best1 = currentNodes_[bestPair[0]];
-    Node* best2 = currentNodes_[bestPair[1]];
-    // Distances may be used by getParentNodes (PGMA for instance).
-    best1->setDistanceToFather(distances[0]);
-    best2->setDistanceToFather(distances[1]);
-    Node* parent = getParentNode(idNextNode++, best1, best2);
-    // compute lambda
-    lambda_ = 0;
-    if (variance_(bestPair[0], bestPair[1]) == 0)
-      lambda_ = .5;
-    else
-    {
-      for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
-      {
-        size_t id = i->first;
-        if (id != bestPair[0] && id != bestPair[1])
-          lambda_ += (variance_(bestPair[1], id) - variance_(bestPair[0], id));
-      }
-      double div = 2 * static_cast<double>(currentNodes_.size() - 2) * variance_(bestPair[0], bestPair[1]);
-      lambda_ /= div;
-      lambda_ += .5;
-    }
-    if (lambda_ < 0.)
-      lambda_ = 0.;
-    if (lambda_ > 1.)
-      lambda_ = 1.;
-
-    for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+    for (size_t k = 0; k < activeNodes_.size(); k++)
     {
-      size_t id = i->first;
-      if (id != bestPair[0] && id != bestPair[1])
-      {
-        newDist[id] = computeDistancesFromPair(bestPair, distances, id);
-        newVar[id] = lambda_ * variance_(bestPair[0], id) + (1 - lambda_) * variance_(bestPair[1], id) - lambda_ * (1 - lambda_) * variance_(bestPair[0], bestPair[1]);
-      }
-      else
-      {
-        newDist[id] = 0;
-      }
-    }
-    // Actualize currentNodes_:
-    currentNodes_[bestPair[0]] = parent;
-    currentNodes_.erase(bestPair[1]);
-    for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
-    {
-      size_t id = i->first;
-      matrix_(  bestPair[0], id) =    matrix_(id, bestPair[0]) = newDist[id];
-      variance_(bestPair[0], id) =  variance_(id, bestPair[0]) = newVar[id];
+      size_t id = activeNodes_[k];
+      if (id != pair[0] && id != pair[1])
+        lambda_ += (variance_(pair[1], id) - variance_(pair[0], id));
     }
+    double div = 2 * static_cast<double>(activeNodes_.size() - 2) * variance_(pair[0], pair[1]);
+    lambda_ /= div;
+    lambda_ += .5;
   }
-  finalStep(idNextNode);
+  if (lambda_ < 0.)
+    lambda_ = 0.;
+  if (lambda_ > 1.)
+    lambda_ = 1.;
+  return NeighborJoining::computeBranchLengthsForPair(pair);
 }
 
+void BioNJ::updateDistancesFromPair(const vector<size_t>& pair, const vector<double>& newDistances)
+{
+  double var01 = variance_(pair[0], pair[1]);
+  for (size_t k = 0; k < activeNodes_.size(); k++)
+  {
+    size_t id = activeNodes_[k];
+    if (id != pair[0])
+      variance_.set(pair[0], id, lambda_ * variance_(pair[0], id) + (1 - lambda_) * variance_(pair[1], id) - lambda_ * (1 - lambda_) * var01);
+  }
+  NeighborJoining::updateDistancesFromPair(pair, newDistances);
+}
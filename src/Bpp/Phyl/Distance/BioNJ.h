@@ -56,7 +56,7 @@ class BioNJ :
   public NeighborJoining
 {
 private:
-  DistanceMatrix variance_;
+  PackedDistanceMatrix variance_;
   double lambda_;
 
 public:
@@ -69,7 +69,7 @@ public:
    */
   BioNJ(bool rooted = false, bool positiveLengths = false, bool verbose = true) :
     NeighborJoining(rooted, positiveLengths, verbose),
-    variance_(0),
+    variance_(),
     lambda_(0) {}
 
   /**
@@ -83,7 +83,7 @@ public:
   BioNJ(const DistanceMatrix& matrix, bool rooted = false, bool positiveLengths = false, bool verbose = true) :
     NeighborJoining(rooted, positiveLengths, verbose),
     // Use the default constructor, because the other one call computeTree.
-    variance_(matrix),
+    variance_(),
     lambda_(0)
   {
     setDistanceMatrix(matrix);
@@ -101,10 +101,13 @@ public:
   void setDistanceMatrix(const DistanceMatrix& matrix)
   {
     NeighborJoining::setDistanceMatrix(matrix);
-    variance_ = matrix;
+    variance_ = PackedDistanceMatrix(matrix);
   }
-  void computeTree();
+
+protected:
+  std::vector<double> computeBranchLengthsForPair(const std::vector<size_t>& pair);
   double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
+  void updateDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& newDistances);
 };
 } // end of namespace bpp.
 
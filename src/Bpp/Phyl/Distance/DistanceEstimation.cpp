@@ -42,6 +42,7 @@
 #include "../Tree.h"
 #include "../PatternTools.h"
 #include "../SitePatterns.h"
+#include "../ThreadPool.h"
 
 // From bpp-core:
 #include <Bpp/App/ApplicationTools.h>
@@ -60,6 +61,8 @@ using namespace bpp;
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <mutex>
 
 using namespace std;
 
@@ -644,47 +647,124 @@ double TwoTreeLikelihood::getSecondOrderDerivative(const string& variable) const
 
 /******************************************************************************/
 
+double DistanceEstimation::estimateDistance_(const SiteContainer& sites, const string& name1, const string& name2,
+    TransitionModel* model, DiscreteDistribution* rateDist, Optimizer* optimizer) const
+{
+  unique_ptr<TwoTreeLikelihood> lik(
+    new TwoTreeLikelihood(name1, name2, sites, model, rateDist, verbose_ > 3));
+  lik->initialize();
+  lik->enableDerivatives(true);
+  const Sequence& seq1 = sites.getSequence(name1);
+  const Sequence& seq2 = sites.getSequence(name2);
+  size_t d = SymbolListTools::getNumberOfDistinctPositions(seq1, seq2);
+  size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(seq1, seq2);
+  lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
+  // Optimization:
+  optimizer->setFunction(lik.get());
+  optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+  ParameterList params = lik->getBranchLengthsParameters();
+  params.addParameters(parameters_);
+  optimizer->init(params);
+  optimizer->optimize();
+  return lik->getParameterValue("BrLen");
+}
+
+/******************************************************************************/
+
 void DistanceEstimation::computeMatrix()
 {
   size_t n = sites_->getNumberOfSequences();
   vector<string> names = sites_->getSequencesNames();
   if (dist_ != 0) delete dist_;
   dist_ = new DistanceMatrix(names);
-  optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
-  for (size_t i = 0; i < n; ++i)
+  unsigned int optimizerVerbose = static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0));
+  optimizer_->setVerbose(optimizerVerbose);
+  unique_ptr<ThreadPool> pool;
+  if (nbThreads_ != 1 && n > 2)
   {
-    (*dist_)(i, i) = 0;
-    if (verbose_ == 1)
-    {
-      ApplicationTools::displayGauge(i, n - 1, '=');
-    }
-    for (size_t j = i + 1; j < n; j++)
+    pool.reset(new ThreadPool(nbThreads_));
+    if (pool->getNumberOfThreads() == 1)
+      pool.reset();
+  }
+
+  if (!pool)
+  {
+    for (size_t i = 0; i < n; ++i)
     {
-      if (verbose_ > 1)
+      (*dist_)(i, i) = 0;
+      if (verbose_ == 1)
       {
-        ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+        ApplicationTools::displayGauge(i, n - 1, '=');
+      }
+      for (size_t j = i + 1; j < n; j++)
+      {
+        if (verbose_ > 1)
+        {
+          ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
+        }
+        (*dist_)(i, j) = (*dist_)(j, i) = estimateDistance_(*sites_, names[i], names[j], model_.get(), rateDist_.get(), optimizer_);
       }
-      TwoTreeLikelihood* lik =
-        new TwoTreeLikelihood(names[i], names[j], *sites_, model_.get(), rateDist_.get(), verbose_ > 3);
-      lik->initialize();
-      lik->enableDerivatives(true);
-      size_t d = SymbolListTools::getNumberOfDistinctPositions(sites_->getSequence(i), sites_->getSequence(j));
-      size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sites_->getSequence(i), sites_->getSequence(j));
-      lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
-      // Optimization:
-      optimizer_->setFunction(lik);
-      optimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
-      ParameterList params = lik->getBranchLengthsParameters();
-      params.addParameters(parameters_);
-      optimizer_->init(params);
-      optimizer_->optimize();
-      // Store results:
-      (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
-      delete lik;
+      if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
     }
-    if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
+    return;
   }
+
+  // Each thread works on its own copy of the model, rate distribution and optimizer:
+  size_t nbWorkers = pool->getNumberOfThreads();
+  vector< unique_ptr<TransitionModel> > models(nbWorkers);
+  vector< unique_ptr<DiscreteDistribution> > rateDists(nbWorkers);
+  vector< unique_ptr<Optimizer> > optimizers(nbWorkers);
+  for (size_t w = 0; w < nbWorkers; ++w)
+  {
+    models[w].reset(model_->clone());
+    rateDists[w].reset(rateDist_->clone());
+    optimizers[w].reset(dynamic_cast<Optimizer*>(optimizer_->clone()));
+    optimizers[w]->setMessageHandler(0);
+    optimizers[w]->setProfiler(0);
+    optimizers[w]->setVerbose(optimizerVerbose);
+  }
+  const ParameterList& modelParameters = model_->getParameters();
+  const ParameterList& rateDistParameters = rateDist_->getParameters();
+
+  // Containers may cache sequences when they are accessed, and must not be shared between threads.
+  // Sequences are therefore copied here, and each thread builds its own container for each pair:
+  vector< unique_ptr<Sequence> > sequences(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    sequences[i].reset(sites_->getSequence(i).clone());
+  }
+  const Alphabet* alphabet = sites_->getAlphabet();
+
+  // Rows are distributed dynamically, the longest ones first.
+  // Each entry of the matrix is written by one thread only, the matrix is therefore not locked.
+  atomic<size_t> nextRow(0);
+  size_t nbRowsDone = 0;
+  mutex gaugeMutex;
+  pool->run(nbWorkers, [&](size_t w) {
+      TransitionModel* model = models[w].get();
+      DiscreteDistribution* rateDist = rateDists[w].get();
+      for (size_t i = nextRow++; i < n; i = nextRow++)
+      {
+        (*dist_)(i, i) = 0;
+        for (size_t j = i + 1; j < n; j++)
+        {
+          if (parameters_.size() > 0)
+          {
+            model->matchParametersValues(modelParameters);
+            rateDist->matchParametersValues(rateDistParameters);
+          }
+          AlignedSequenceContainer pair(alphabet);
+          pair.addSequence(*sequences[i], false);
+          pair.addSequence(*sequences[j], false);
+          (*dist_)(i, j) = (*dist_)(j, i) = estimateDistance_(pair, names[i], names[j], model, rateDist, optimizers[w].get());
+        }
+        if (verbose_ > 0)
+        {
+          lock_guard<mutex> lock(gaugeMutex);
+          ApplicationTools::displayGauge(nbRowsDone++, n - 1, '=');
+        }
+      }
+    });
 }
 
 /******************************************************************************/
-
@@ -302,6 +302,8 @@ namespace bpp
  * For now it is not possible to retrieve estimated values.
  * You'll have to specify a 'profiler' to the optimizer and then look at the file
  * if you want to do so.
+ *
+ * Pairs of sequences can be processed in parallel, see setNumberOfThreads().
  */
   class DistanceEstimation:
     public virtual Clonable
@@ -315,6 +317,7 @@ namespace bpp
     MetaOptimizer* defaultOptimizer_;
     size_t verbose_;
     ParameterList parameters_;
+    size_t nbThreads_;
 
   public:
   
@@ -343,7 +346,8 @@ namespace bpp
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1)
     {
       init_();
     }
@@ -378,7 +382,8 @@ namespace bpp
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1)
     {
       init_();
       if(computeMat) computeMatrix();
@@ -399,7 +404,8 @@ namespace bpp
       optimizer_(dynamic_cast<Optimizer *>(distanceEstimation.optimizer_->clone())),
       defaultOptimizer_(dynamic_cast<MetaOptimizer *>(distanceEstimation.defaultOptimizer_->clone())),
       verbose_(distanceEstimation.verbose_),
-      parameters_(distanceEstimation.parameters_)
+      parameters_(distanceEstimation.parameters_),
+      nbThreads_(distanceEstimation.nbThreads_)
     {
       if(distanceEstimation.dist_ != 0)
         dist_ = new DistanceMatrix(*distanceEstimation.dist_);
@@ -428,6 +434,7 @@ namespace bpp
       // _defaultOptimizer has already been initialized since the default constructor has been called.
       verbose_    = distanceEstimation.verbose_;
       parameters_ = distanceEstimation.parameters_;
+      nbThreads_  = distanceEstimation.nbThreads_;
       return *this;
     }
 
@@ -540,6 +547,45 @@ namespace bpp
      * @return Verbose level.
      */
     size_t getVerbose() const { return verbose_; }
+
+    /**
+     * @brief Set the number of threads used by computeMatrix().
+     *
+     * When several threads are used, each of them works with its own copy of the
+     * substitution model, rate distribution and optimizer, and rows of the matrix
+     * are distributed dynamically between threads, longest rows first.
+     * Each pair of sequences is estimated starting from the parameter values of
+     * the model and rate distribution of this instance, so that results do not depend
+     * on the number of threads. In sequential mode, additional parameters
+     * (see setAdditionalParameters()) are estimated starting from the values
+     * obtained for the previous pair, results may therefore differ slightly
+     * between the two modes when such parameters are used.
+     * The message handler and profiler of the optimizer are not used in parallel mode,
+     * and only one gauge by row is displayed.
+     *
+     * @param nbThreads The number of threads to use. 1 (the default) disables multithreading,
+     * 0 uses as many threads as available on the machine.
+     */
+    void setNumberOfThreads(size_t nbThreads) { nbThreads_ = nbThreads; }
+
+    /**
+     * @return The number of threads used by computeMatrix(), 0 meaning as many as available.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+  private:
+    /**
+     * @brief Estimate the distance between two sequences.
+     *
+     * @param sites        A container with the two sequences. It must not be used by other threads.
+     * @param name1, name2 The names of the two sequences.
+     * @param model        The substitution model to use (parameters may be modified).
+     * @param rateDist     The rate distribution to use (parameters may be modified).
+     * @param optimizer    The optimizer to use.
+     * @return The estimated distance.
+     */
+    double estimateDistance_(const SiteContainer& sites, const std::string& name1, const std::string& name2,
+        TransitionModel* model, DiscreteDistribution* rateDist, Optimizer* optimizer) const;
   };
 
 } //end of namespace bpp.
@@ -45,53 +45,150 @@ using namespace bpp;
 
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
-std::vector<size_t> NeighborJoining::getBestPair()
+void NeighborJoining::computeTree()
 {
-  for (std::map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  size_t n = matrix_.size();
+  sumDist_.assign(n, 0.);
+  rowMin_.resize(n);
+  rowMinIndex_.resize(n);
+  for (size_t i = 0; i < n; i++)
   {
-    size_t id = i->first;
-    sumDist_[id] = 0;
-    for (map<size_t, Node*>::iterator j = currentNodes_.begin(); j != currentNodes_.end(); j++)
+    const double* row = matrix_.getRow(i);
+    double rowMin = -std::log(0.);
+    size_t rowMinIndex = n;
+    for (size_t j = i + 1; j < n; j++)
     {
-      size_t jd = j->first;
-      sumDist_[id] += matrix_(id, jd);
+      double d = row[j - i - 1];
+      sumDist_[i] += d;
+      sumDist_[j] += d;
+      if (d < rowMin)
+      {
+        rowMin = d;
+        rowMinIndex = j;
+      }
     }
+    rowMin_[i] = rowMin;
+    rowMinIndex_[i] = rowMinIndex;
   }
 
-  vector<size_t> bestPair(2);
-  double critMax = std::log(0.);
-  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  if (nbThreads_ != 1 && n > 3)
+  {
+    pool_.reset(new ThreadPool(nbThreads_));
+    if (pool_->getNumberOfThreads() == 1)
+      pool_.reset();
+  }
+  AbstractAgglomerativeDistanceMethod::computeTree();
+  pool_.reset();
+}
+
+std::vector<size_t> NeighborJoining::getBestPair()
+{
+  size_t r = activeNodes_.size();
+
+  // Largest sum among the nodes at or after each position:
+  maxSumDist_.resize(r + 1);
+  maxSumDist_[r] = std::log(0.);
+  for (size_t p = r; p > 0; p--)
+  {
+    maxSumDist_[p - 1] = std::max(maxSumDist_[p], sumDist_[activeNodes_[p - 1]]);
+  }
+
+  // Start with the best pair among the closest ones of each row:
+  Candidate_ best;
+  best.crit = std::log(0.);
+  best.i = best.j = matrix_.size();
+  double scale = static_cast<double>(r - 2);
+  for (size_t p = 0; p + 1 < r; p++)
   {
-    size_t id = i->first;
-    map<size_t, Node*>::iterator j = i;
-    j++;
-    for ( ; j != currentNodes_.end(); j++)
+    size_t id = activeNodes_[p];
+    size_t jd = rowMinIndex_[id];
+    if (jd < matrix_.size())
     {
-      size_t jd = j->first;
-      double crit = sumDist_[id] + sumDist_[jd] - static_cast<double>(currentNodes_.size() - 2) * matrix_(id, jd);
-      // cout << "\t" << id << "\t" << jd << "\t" << crit << endl;
-      if (crit > critMax)
+      double crit = sumDist_[id] + sumDist_[jd] - scale * rowMin_[id];
+      if (isBetter_(crit, id, jd, best))
       {
-        critMax = crit;
-        bestPair[0] = id;
-        bestPair[1] = jd;
+        best.crit = crit;
+        best.i = id;
+        best.j = jd;
       }
     }
   }
 
-  if (critMax == std::log(0.))
+  if (!pool_ || r < 64)
+  {
+    searchRows_(0, r, best);
+  }
+  else
+  {
+    // Rows are split in chunks with approximately the same number of pairs,
+    // each chunk starting from the same candidate. Chunks are then compared in order,
+    // so that the result is the same as with a sequential search.
+    size_t nbChunks = 4 * pool_->getNumberOfThreads();
+    vector<size_t> bounds(nbChunks + 1, r);
+    bounds[0] = 0;
+    size_t nbPairs = r * (r - 1) / 2;
+    size_t c = 1, nbPairsBefore = 0;
+    for (size_t p = 0; p < r && c < nbChunks; p++)
+    {
+      nbPairsBefore += r - p - 1;
+      if (nbPairsBefore * nbChunks >= c * nbPairs)
+        bounds[c++] = p + 1;
+    }
+    vector<Candidate_> results(nbChunks, best);
+    pool_->run(nbChunks, [&](size_t k) {
+        searchRows_(bounds[k], bounds[k + 1], results[k]);
+      });
+    for (size_t k = 0; k < nbChunks; k++)
+    {
+      if (isBetter_(results[k].crit, results[k].i, results[k].j, best))
+        best = results[k];
+    }
+  }
+
+  if (best.crit == std::log(0.))
   {
     throw Exception("Unexpected error: no maximum criterium found.");
   }
+  vector<size_t> bestPair(2);
+  bestPair[0] = best.i;
+  bestPair[1] = best.j;
   return bestPair;
 }
 
+void NeighborJoining::searchRows_(size_t begin, size_t end, Candidate_& best) const
+{
+  size_t r = activeNodes_.size();
+  double scale = static_cast<double>(r - 2);
+  for (size_t p = begin; p < end; p++)
+  {
+    size_t id = activeNodes_[p];
+    double sumId = sumDist_[id];
+    // No pair in this row can have a criterion greater than this bound:
+    double bound = sumId + maxSumDist_[p + 1] - scale * rowMin_[id];
+    if (bound < best.crit || (bound == best.crit && id > best.i))
+      continue;
+    const double* row = matrix_.getRow(id);
+    for (size_t q = p + 1; q < r; q++)
+    {
+      size_t jd = activeNodes_[q];
+      double crit = sumId + sumDist_[jd] - scale * row[jd - id - 1];
+      if (isBetter_(crit, id, jd, best))
+      {
+        best.crit = crit;
+        best.i = id;
+        best.j = jd;
+      }
+    }
+  }
+}
+
 std::vector<double> NeighborJoining::computeBranchLengthsForPair(const std::vector<size_t>& pair)
 {
-  double ratio = (sumDist_[pair[0]] - sumDist_[pair[1]]) / static_cast<double>(currentNodes_.size() - 2);
+  double ratio = (sumDist_[pair[0]] - sumDist_[pair[1]]) / static_cast<double>(activeNodes_.size() - 2);
   vector<double> d(2);
   if (positiveLengths_)
   {
@@ -114,16 +211,69 @@ double NeighborJoining::computeDistancesFromPair(const std::vector<size_t>& pair
     :          .5 * (matrix_(pair[0], pos) - branchLengths[0] + matrix_(pair[1], pos) - branchLengths[1]);
 }
 
+void NeighborJoining::updateDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& newDistances)
+{
+  size_t a = pair[0];
+  size_t b = pair[1];
+  double sumA = 0;
+  vector<size_t> rowsToUpdate;
+  for (size_t k = 0; k < activeNodes_.size(); k++)
+  {
+    size_t id = activeNodes_[k];
+    if (id == a)
+      continue;
+    double d = newDistances[id];
+    sumDist_[id] += d - matrix_(a, id) - matrix_(b, id);
+    sumA += d;
+    if (id < a)
+    {
+      if (rowMinIndex_[id] == b || (rowMinIndex_[id] == a && !(d <= rowMin_[id])))
+        rowsToUpdate.push_back(id);
+      else if (d < rowMin_[id] || rowMinIndex_[id] == a)
+      {
+        rowMin_[id] = d;
+        rowMinIndex_[id] = a;
+      }
+    }
+    else if (id < b && rowMinIndex_[id] == b)
+      rowsToUpdate.push_back(id);
+  }
+  sumDist_[a] = sumA;
+  AbstractAgglomerativeDistanceMethod::updateDistancesFromPair(pair, newDistances);
+  updateRowMin_(a);
+  for (size_t k = 0; k < rowsToUpdate.size(); k++)
+  {
+    updateRowMin_(rowsToUpdate[k]);
+  }
+}
+
+void NeighborJoining::updateRowMin_(size_t i)
+{
+  const double* row = matrix_.getRow(i);
+  double rowMin = -std::log(0.);
+  size_t rowMinIndex = matrix_.size();
+  vector<size_t>::const_iterator it = std::upper_bound(activeNodes_.begin(), activeNodes_.end(), i);
+  for ( ; it != activeNodes_.end(); it++)
+  {
+    double d = row[*it - i - 1];
+    if (d < rowMin)
+    {
+      rowMin = d;
+      rowMinIndex = *it;
+    }
+  }
+  rowMin_[i] = rowMin;
+  rowMinIndex_[i] = rowMinIndex;
+}
+
 void NeighborJoining::finalStep(int idRoot)
 {
   Node* root = new Node(idRoot);
-  map<size_t, Node* >::iterator it = currentNodes_.begin();
-  size_t i1 = it->first;
-  Node* n1       = it->second;
-  it++;
-  size_t i2 = it->first;
-  Node* n2       = it->second;
-  if (currentNodes_.size() == 2)
+  size_t i1 = activeNodes_[0];
+  Node* n1       = currentNodes_[i1];
+  size_t i2 = activeNodes_[1];
+  Node* n2       = currentNodes_[i2];
+  if (activeNodes_.size() == 2)
   {
     // Rooted
     double d = matrix_(i1, i2) / 2;
@@ -135,9 +285,8 @@ void NeighborJoining::finalStep(int idRoot)
   else
   {
     // Unrooted
-    it++;
-    size_t i3 = it->first;
-    Node* n3       = it->second;
+    size_t i3 = activeNodes_[2];
+    Node* n3       = currentNodes_[i3];
     double d1 = positiveLengths_ ?
                 std::max(matrix_(i1, i2) + matrix_(i1, i3) - matrix_(i2, i3), 0.)
                 :          matrix_(i1, i2) + matrix_(i1, i3) - matrix_(i2, i3);
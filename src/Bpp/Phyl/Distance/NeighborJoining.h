@@ -42,6 +42,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _NEIGHBORJOINING_H_
 
 #include "AbstractAgglomerativeDistanceMethod.h"
+#include "../ThreadPool.h"
+
+// From the STL:
+#include <memory>
 
 namespace bpp
 {
@@ -51,6 +55,14 @@ namespace bpp
  *
  * Reference:
  * N Saitou and M Nei (1987), _Molecular Biology and Evolution_ 4(4) 406-25.
+ *
+ * Sums of distances are cached and updated after each agglomeration, and the
+ * search for the best pair skips rows which cannot contain a better pair than the
+ * best one found so far, using a bound computed from the smallest distance in each row
+ * (see Simonsen et al. (2008), _Algorithms in Bioinformatics_, LNCS 5251, 113-22,
+ * for a similar approach). The search can be split between several threads,
+ * see setNumberOfThreads(). The pair found is always the same as with an exhaustive
+ * search, whatever the number of threads.
  */ 
 class NeighborJoining :
   public AbstractAgglomerativeDistanceMethod
@@ -58,6 +70,17 @@ class NeighborJoining :
 	protected:
     std::vector<double> sumDist_;
     bool positiveLengths_;
+    size_t nbThreads_;
+
+  private:
+    /**
+     * @brief Smallest distance between each node i and the current nodes with an index greater than i,
+     * and index of the corresponding node.
+     */
+    std::vector<double> rowMin_;
+    std::vector<size_t> rowMinIndex_;
+    std::vector<double> maxSumDist_;
+    std::unique_ptr<ThreadPool> pool_;
 		
 	public:
     /**
@@ -70,7 +93,12 @@ class NeighborJoining :
     NeighborJoining(bool rooted = false, bool positiveLengths = false, bool verbose = true) :
       AbstractAgglomerativeDistanceMethod(verbose, rooted),
       sumDist_(),
-      positiveLengths_(false)
+      positiveLengths_(false),
+      nbThreads_(1),
+      rowMin_(),
+      rowMinIndex_(),
+      maxSumDist_(),
+      pool_()
     {}
 
     /**
@@ -84,12 +112,37 @@ class NeighborJoining :
 		NeighborJoining(const DistanceMatrix& matrix, bool rooted = false, bool positiveLengths = false, bool verbose = true) :
       AbstractAgglomerativeDistanceMethod(matrix, verbose, rooted),
       sumDist_(),
-      positiveLengths_(positiveLengths) 
+      positiveLengths_(positiveLengths),
+      nbThreads_(1),
+      rowMin_(),
+      rowMinIndex_(),
+      maxSumDist_(),
+      pool_()
 		{
 			sumDist_.resize(matrix.size());
 			computeTree();
 		}
    
+    NeighborJoining(const NeighborJoining& nj) :
+      AbstractAgglomerativeDistanceMethod(nj),
+      sumDist_(nj.sumDist_),
+      positiveLengths_(nj.positiveLengths_),
+      nbThreads_(nj.nbThreads_),
+      rowMin_(),
+      rowMinIndex_(),
+      maxSumDist_(),
+      pool_()
+    {}
+
+    NeighborJoining& operator=(const NeighborJoining& nj)
+    {
+      AbstractAgglomerativeDistanceMethod::operator=(nj);
+      sumDist_         = nj.sumDist_;
+      positiveLengths_ = nj.positiveLengths_;
+      nbThreads_       = nj.nbThreads_;
+      return *this;
+    }
+
 		virtual ~NeighborJoining() {}
 
     NeighborJoining* clone() const { return new NeighborJoining(*this); }
@@ -104,13 +157,45 @@ class NeighborJoining :
 		}
 
     virtual void outputPositiveLengths(bool yn) { positiveLengths_ = yn; }
+
+    /**
+     * @brief Set the number of threads used to search for the best pair.
+     *
+     * @param nbThreads The number of threads to use. 1 (the default) disables multithreading,
+     * 0 uses as many threads as available on the machine.
+     */
+    void setNumberOfThreads(size_t nbThreads) { nbThreads_ = nbThreads; }
+
+    /**
+     * @return The number of threads used, 0 meaning as many as available.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
+    virtual void computeTree();
 	
 	protected:
 		std::vector<size_t> getBestPair();
 		std::vector<double> computeBranchLengthsForPair(const std::vector<size_t>& pair);
 		double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
+    void updateDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& newDistances);
 		void finalStep(int idRoot);	
 
+  private:
+    struct Candidate_
+    {
+      double crit;
+      size_t i;
+      size_t j;
+    };
+
+    static bool isBetter_(double crit, size_t i, size_t j, const Candidate_& best)
+    {
+      return crit > best.crit || (crit == best.crit && (i < best.i || (i == best.i && j < best.j)));
+    }
+
+    void searchRows_(size_t begin, size_t end, Candidate_& best) const;
+    void updateRowMin_(size_t i);
+
 };
 
 } //end of namespace bpp.
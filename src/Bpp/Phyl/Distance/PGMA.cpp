@@ -61,15 +61,14 @@ vector<size_t> PGMA::getBestPair()
 {
   vector<size_t> bestPair(2);
   double distMin = -std::log(0.);
-  for (map<size_t, Node*>::iterator i = currentNodes_.begin(); i != currentNodes_.end(); i++)
+  for (size_t p = 0; p < activeNodes_.size(); p++)
   {
-    size_t id = i->first;
-    map<size_t, Node*>::iterator j = i;
-    j++;
-    for ( ; j != currentNodes_.end(); j++)
+    size_t id = activeNodes_[p];
+    const double* row = matrix_.getRow(id);
+    for (size_t q = p + 1; q < activeNodes_.size(); q++)
     {
-      size_t jd = j->first;
-      double dist = matrix_(id, jd);
+      size_t jd = activeNodes_[q];
+      double dist = row[jd - id - 1];
       if (dist < distMin)
       {
         distMin = dist;
@@ -115,12 +114,10 @@ double PGMA::computeDistancesFromPair(const vector<size_t>& pair, const vector<d
 void PGMA::finalStep(int idRoot)
 {
   NodeTemplate<PGMAInfos>* root = new NodeTemplate<PGMAInfos>(idRoot);
-  map<size_t, Node*>::iterator it = currentNodes_.begin();
-  size_t i1 = it->first;
-  Node* n1        = it->second;
-  it++;
-  size_t i2 = it->first;
-  Node* n2        = it->second;
+  size_t i1 = activeNodes_[0];
+  Node* n1        = currentNodes_[i1];
+  size_t i2 = activeNodes_[1];
+  Node* n2        = currentNodes_[i2];
   double d = matrix_(i1, i2) / 2;
   root->addSon(n1);
   root->addSon(n2);
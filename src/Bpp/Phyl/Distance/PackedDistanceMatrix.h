@@ -0,0 +1,134 @@
+//
+// File: PackedDistanceMatrix.h
+// Created by: agent
+// Created on: Fri Oct 16 22:13 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _PACKEDDISTANCEMATRIX_H_
+#define _PACKEDDISTANCEMATRIX_H_
+
+#include <Bpp/Seq/DistanceMatrix.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+
+namespace bpp
+{
+
+/**
+ * @brief A symmetric distance matrix with null diagonal, stored as a flat array.
+ *
+ * Only the upper triangle is stored, row by row, so that the matrix takes
+ * n(n-1)/2 values instead of n² for a DistanceMatrix object.
+ * Row i contains the distances d(i, j) for all j > i, and is contiguous in memory,
+ * see getRow().
+ */
+class PackedDistanceMatrix
+{
+  private:
+    std::vector<std::string> names_;
+    std::vector<double> distances_;
+
+  public:
+    PackedDistanceMatrix() : names_(), distances_() {}
+
+    /**
+     * @brief Build a packed matrix from the upper triangle of a distance matrix.
+     *
+     * @param matrix The matrix to copy.
+     */
+    PackedDistanceMatrix(const DistanceMatrix& matrix) :
+      names_(matrix.getNames()), distances_()
+    {
+      size_t n = names_.size();
+      distances_.resize(n > 1 ? n * (n - 1) / 2 : 0);
+      for (size_t i = 0; i < n; ++i)
+      {
+        double* row = getRow(i);
+        for (size_t j = i + 1; j < n; ++j)
+        {
+          row[j - i - 1] = matrix(i, j);
+        }
+      }
+    }
+
+    virtual ~PackedDistanceMatrix() {}
+
+  public:
+    size_t size() const { return names_.size(); }
+
+    const std::string& getName(size_t i) const { return names_[i]; }
+
+    const std::vector<std::string>& getNames() const { return names_; }
+
+    /**
+     * @return The distance between elements i and j (0 if i == j).
+     */
+    double operator()(size_t i, size_t j) const
+    {
+      if (i == j) return 0.;
+      return i < j ? distances_[getIndex_(i, j)] : distances_[getIndex_(j, i)];
+    }
+
+    /**
+     * @brief Set the distance between two distinct elements.
+     */
+    void set(size_t i, size_t j, double d)
+    {
+      if (i < j)
+        distances_[getIndex_(i, j)] = d;
+      else
+        distances_[getIndex_(j, i)] = d;
+    }
+
+    /**
+     * @return A pointer toward row i, such that getRow(i)[j - i - 1] = d(i, j) for all j > i.
+     */
+    double* getRow(size_t i) { return &distances_[0] + getIndex_(i, i + 1); }
+    const double* getRow(size_t i) const { return &distances_[0] + getIndex_(i, i + 1); }
+
+  private:
+    size_t getIndex_(size_t i, size_t j) const
+    {
+      return i * (2 * names_.size() - i - 1) / 2 + j - i - 1;
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_PACKEDDISTANCEMATRIX_H_
+
@@ -43,12 +43,18 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../TreeTemplateTools.h"
 
 #include <Bpp/Text/TextTools.h>
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/BppString.h>
+#include <Bpp/App/ApplicationTools.h>
 
 using namespace bpp;
 
 // From the STL:
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <locale>
 
 using namespace std;
 
@@ -70,25 +76,259 @@ TreeTemplate<Node> * Newick::readTree(istream& in) const
 {
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
-  
-  //We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (getline(in, temp, '\n'))
+  TreeTemplate<Node>* tree = readNextTree(in);
+  if (!tree)
+    throw IOException("Newick::read: no tree was found!");
+  return tree;
+}
+
+/******************************************************************************/
+
+namespace
+{
+
+// Remove white spaces at both ends of a string, without reallocating it.
+void trim_(string& text)
+{
+  size_t end = text.size();
+  while (end > 0 && TextTools::isWhiteSpaceCharacter(text[end - 1]))
+    end--;
+  size_t begin = 0;
+  while (begin < end && TextTools::isWhiteSpaceCharacter(text[begin]))
+    begin++;
+  text.resize(end);
+  text.erase(0, begin);
+}
+
+// Tell if a string only contains white spaces from position begin.
+bool isBlank_(const string& text, size_t begin)
+{
+  for (size_t i = begin; i < text.size(); i++)
+  {
+    if (!TextTools::isWhiteSpaceCharacter(text[i]))
+      return false;
+  }
+  return true;
+}
+
+// Parse a number from position begin to the end of a string, surrounding white spaces being ignored.
+// The classic locale is used, so that the decimal separator is always a dot.
+bool toDouble_(const string& text, size_t begin, double& value)
+{
+  istringstream iss(text.substr(begin));
+  iss.imbue(locale::classic());
+  iss >> value;
+  if (iss.fail())
+    return false;
+  if (iss.eof())
+    return true;
+  return isBlank_(text, begin + static_cast<size_t>(iss.tellg()));
+}
+
+}
+
+/******************************************************************************/
+
+void Newick::setNodeLabel_(Node* node, string& text, bool isLeaf) const
+{
+  string::size_type colon = text.rfind(':');
+  if (colon != string::npos)
   {
-    string::size_type index = temp.find(";");
-    if(index != string::npos)
+    if (!isBlank_(text, colon + 1))
     {
-      description += temp.substr(0, index + 1);
-      break;
+      double length;
+      if (!toDouble_(text, colon + 1, length))
+        throw IOException("Newick::read: invalid branch length in '" + text + "'.");
+      node->setDistanceToFather(length);
+    }
+    text.resize(colon);
+  }
+  trim_(text);
+  if (isLeaf)
+  {
+    node->setName(text);
+  }
+  else if (!text.empty())
+  {
+    if (useBootstrap_)
+    {
+      double bootstrap;
+      if (!toDouble_(text, 0, bootstrap))
+        throw IOException("Newick::read: invalid bootstrap value '" + text + "'.");
+      node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(bootstrap));
+    }
+    else
+    {
+      node->setBranchProperty(bootstrapPropertyName_, BppString(text));
+    }
+  }
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Newick::readNextTree(istream& in) const
+{
+  if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
+
+  // The stream is parsed character by character, nodes being created as soon as they are found.
+  // Internal nodes whose closing parenthesis has not been read yet are stored in openNodes,
+  // and the text following the last delimiter (name or label, and branch length) in text.
+  streambuf* buffer = in.rdbuf();
+  vector<Node*> openNodes;
+  Node* root = 0;
+  Node* closedNode = 0; // Set if the last delimiter was a closing parenthesis.
+  bool started = false;
+  string text;
+  unsigned int nodeCounter = 0;
+  try
+  {
+    while (true)
+    {
+      int c = buffer->sbumpc();
+      if (c == char_traits<char>::eof())
+      {
+        in.setstate(ios::eofbit);
+        if (!started && isBlank_(text, 0))
+          return 0;
+        throw IOException("Newick::read: unexpected end of stream, no semi-colon found.");
+      }
+      char ch = static_cast<char>(c);
+      if (ch == '\n')
+      {
+        // Trees may span several lines.
+        continue;
+      }
+      else if (ch == '[' && allowComments_)
+      {
+        for (int depth = 1; depth > 0; )
+        {
+          c = buffer->sbumpc();
+          if (c == char_traits<char>::eof())
+            throw IOException("Newick::read: unexpected end of stream in comment.");
+          if (c == '[') depth++;
+          else if (c == ']') depth--;
+        }
+      }
+      else if (ch == '(')
+      {
+        if (closedNode || !isBlank_(text, 0))
+          throw IOException("Newick::read: unexpected opening parenthesis after '" + text + "'.");
+        text.clear();
+        Node* node = new Node();
+        if (openNodes.empty())
+        {
+          if (root) throw IOException("Newick::read: several trees found before the semi-colon.");
+          root = node;
+        }
+        else
+        {
+          openNodes.back()->addSon(node);
+        }
+        openNodes.push_back(node);
+        started = true;
+      }
+      else if (ch == ',' || ch == ')' || ch == ';')
+      {
+        // The element preceding the delimiter is complete:
+        if (closedNode)
+        {
+          setNodeLabel_(closedNode, text, false);
+        }
+        else
+        {
+          Node* leaf = new Node();
+          if (openNodes.empty())
+          {
+            if (root)
+            {
+              delete leaf;
+              throw IOException("Newick::read: several trees found before the semi-colon.");
+            }
+            root = leaf;
+          }
+          else
+          {
+            openNodes.back()->addSon(leaf);
+          }
+          setNodeLabel_(leaf, text, true);
+        }
+        nodeCounter++;
+        if (verbose_)
+          ApplicationTools::displayUnlimitedGauge(nodeCounter);
+        text.clear();
+        started = true;
+        closedNode = 0;
+        if (ch == ')')
+        {
+          if (openNodes.empty())
+            throw IOException("Newick::read: unexpected closing parenthesis.");
+          closedNode = openNodes.back();
+          openNodes.pop_back();
+        }
+        else if (ch == ',')
+        {
+          if (openNodes.empty())
+            throw IOException("Newick::read: unexpected comma outside of parentheses.");
+        }
+        else
+        {
+          if (!openNodes.empty())
+            throw IOException("Newick::read: missing closing parenthesis.");
+          break;
+        }
+      }
+      else
+      {
+        text += ch;
+      }
+    }
+  }
+  catch (...)
+  {
+    if (root)
+    {
+      TreeTemplateTools::deleteSubtree(root);
+      delete root;
     }
-    else description += temp;
+    throw;
   }
 
-  if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-  if (TextTools::isEmpty(description))
-    throw IOException("Newick::read: no tree was found!");
-  return TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  TreeTemplate<Node>* tree = new TreeTemplate<Node>();
+  tree->setRootNode(root);
+  tree->resetNodesId();
+  if (verbose_)
+  {
+    (*ApplicationTools::message) << " nodes loaded.";
+    ApplicationTools::message->endLine();
+  }
+  return tree;
+}
+
+/******************************************************************************/
+
+size_t Newick::processTrees(istream& in, const std::function<bool (TreeTemplate<Node>&)>& handler) const
+{
+  size_t nbTrees = 0;
+  while (true)
+  {
+    unique_ptr< TreeTemplate<Node> > tree(readNextTree(in));
+    if (!tree)
+      break;
+    nbTrees++;
+    if (!handler(*tree))
+      break;
+  }
+  return nbTrees;
+}
+
+/******************************************************************************/
+
+size_t Newick::processTrees(const string& path, const std::function<bool (TreeTemplate<Node>&)>& handler) const
+{
+  ifstream input(path.c_str(), ios::in);
+  size_t nbTrees = processTrees(input, handler);
+  input.close();
+  return nbTrees;
 }
 
 /******************************************************************************/
@@ -130,24 +370,12 @@ void Newick::readTrees(istream& in, vector<Tree*>& trees) const
 {
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
-  
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  //We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+
+  // In case the file is empty, the method will not add any new tree to the vector.
+  for (TreeTemplate<Node>* tree = readNextTree(in); tree; tree = readNextTree(in))
   {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else description += temp;
+    trees.push_back(tree);
   }
-  //In case the file is empty, the method will not add any neww tree to the vector.
 }
 
 /******************************************************************************/
@@ -43,6 +43,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "IoTree.h"
 #include "../TreeTemplate.h"
 
+// From the STL:
+#include <functional>
+
 namespace bpp
 {
 
@@ -79,6 +82,18 @@ namespace bpp
  * This is achieved by calling the enableExtendedBootstrapProperty method, and providing a property name to use.
  * The additional information will be stored at each node as a property, in a String object.
  * The disableExtendedBootstrapProperty method restores the default behavior.
+ *
+ * Trees are parsed in a single pass, character by character, directly from the input stream,
+ * and the stream is only read up to the semi-colon ending the tree.
+ * Large multi-tree files (for instance posterior samples of a Bayesian analysis) can be processed
+ * one tree at a time with readNextTree() or processTrees(), without storing all trees in memory:
+ * @code
+ * Newick newick;
+ * size_t nbTrees = newick.processTrees("samples.trees", [&](TreeTemplate<Node>& tree) {
+ *   // Do something with the tree, which will be deleted after the call.
+ *   return true; // Or false to stop reading.
+ * });
+ * @endcode
  */
 class Newick:
   public AbstractITree,
@@ -148,6 +163,39 @@ class Newick:
     TreeTemplate<Node>* readTree(std::istream& in) const;
     /** @} */
 
+    /**
+     * @brief Read the next tree in a stream.
+     *
+     * The stream is read up to the semi-colon ending the tree, so that successive calls
+     * return all trees in the stream, whatever the number of trees per line.
+     *
+     * @param in The input stream.
+     * @return A pointer toward a new tree, or 0 if no tree remains in the stream.
+     * @throw IOException If the tree description is not valid, or if the stream ends before the end of the tree.
+     */
+    TreeTemplate<Node>* readNextTree(std::istream& in) const;
+
+    /**
+     * @brief Read all trees in a stream, and pass them one by one to a function.
+     *
+     * Only one tree is kept in memory at a time.
+     *
+     * @param in      The input stream.
+     * @param handler The function to call for each tree. The tree is deleted once the function returns,
+     *                and should be cloned if it has to be kept. If the function returns false, reading stops.
+     * @return The number of trees read.
+     */
+    size_t processTrees(std::istream& in, const std::function<bool (TreeTemplate<Node>&)>& handler) const;
+
+    /**
+     * @brief Same as processTrees(std::istream&, handler), but read trees from a file.
+     *
+     * @param path    The path of the file.
+     * @param handler The function to call for each tree.
+     * @return The number of trees read.
+     */
+    size_t processTrees(const std::string& path, const std::function<bool (TreeTemplate<Node>&)>& handler) const;
+
     /**
      * @name The OTree interface
      *
@@ -193,6 +241,16 @@ class Newick:
 
   protected:
     void write_(const Tree& tree, std::ostream& out) const;
+
+    /**
+     * @brief Set the name or label and the branch length of a node, from the text following it.
+     *
+     * @param node   The node to modify.
+     * @param text   The text read after the node (leaf name or closing parenthesis) and before the next delimiter.
+     *               It is modified.
+     * @param isLeaf Tell if the node is a leaf, in which case the label is its name.
+     */
+    void setNodeLabel_(Node* node, std::string& text, bool isLeaf) const;
     
     template<class N>
     void write_(const TreeTemplate<N>& tree, std::ostream& out) const;
@@ -307,6 +307,16 @@ void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
 
 /******************************************************************************/
 
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
+  const ConditionalLikelihoodArray& likelihoodArray)
+{
+  VVVdouble array;
+  likelihoodArray.toVVVdouble(array);
+  displayLikelihoodArray(array);
+}
+
+/******************************************************************************/
+
 VVdouble AbstractDiscreteRatesAcrossSitesTreeLikelihood::getTransitionProbabilities(int nodeId, size_t siteIndex) const
 {
   VVVdouble p3 = getTransitionProbabilitiesPerRateClass(nodeId, siteIndex);
@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "AbstractTreeLikelihood.h"
 #include "DiscreteRatesAcrossSitesTreeLikelihood.h"
+#include "ConditionalLikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 
 namespace bpp
@@ -130,6 +131,13 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
      */
     static void resetLikelihoodArray(VVVdouble & likelihoodArray);
 
+    /**
+     * @brief Set all conditional likelihoods to 1.
+     *
+     * @param likelihoodArray the likelihood array.
+     */
+    static void resetLikelihoodArray(const ConditionalLikelihoodArray & likelihoodArray) { likelihoodArray.fill(1.); }
+
     /**
      * @brief Print the likelihood array to terminal (debugging tool).
      * 
@@ -137,6 +145,13 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
      */
     static void displayLikelihoodArray(const VVVdouble & likelihoodArray);
 
+    /**
+     * @brief Print the likelihood array to terminal (debugging tool).
+     * 
+     * @param likelihoodArray the likelihood array.
+     */
+    static void displayLikelihoodArray(const ConditionalLikelihoodArray & likelihoodArray);
+
     /** @} */
     
 };
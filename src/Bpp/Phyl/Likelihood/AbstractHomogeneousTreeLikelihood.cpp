@@ -38,6 +38,7 @@
  */
 
 #include "AbstractHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -51,6 +52,7 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -68,6 +70,8 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   pxy_(),
   dpxy_(),
   d2pxy_(),
+  flatPxy_(),
+  flatPyx_(),
   rootFreqs_(),
   nodes_(),
   nbSites_(),
@@ -78,7 +82,8 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   verbose_(),
   minimumBrLen_(),
   maximumBrLen_(),
-  brLenConstraint_()
+  brLenConstraint_(),
+  batchTransitionProbabilities_(false)
 {
   init_(tree, model, rDist, checkRooted, verbose);
 }
@@ -93,6 +98,8 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   pxy_(lik.pxy_),
   dpxy_(lik.dpxy_),
   d2pxy_(lik.d2pxy_),
+  flatPxy_(lik.flatPxy_),
+  flatPyx_(lik.flatPyx_),
   rootFreqs_(lik.rootFreqs_),
   nodes_(),
   nbSites_(lik.nbSites_),
@@ -103,7 +110,8 @@ AbstractHomogeneousTreeLikelihood::AbstractHomogeneousTreeLikelihood(
   verbose_(lik.verbose_),
   minimumBrLen_(lik.minimumBrLen_),
   maximumBrLen_(lik.maximumBrLen_),
-  brLenConstraint_(lik.brLenConstraint_->clone())
+  brLenConstraint_(lik.brLenConstraint_->clone()),
+  batchTransitionProbabilities_(lik.batchTransitionProbabilities_)
 {
   nodes_ = tree_->getNodes();
   nodes_.pop_back(); // Remove the root node (the last added!).
@@ -120,6 +128,8 @@ AbstractHomogeneousTreeLikelihood& AbstractHomogeneousTreeLikelihood::operator=(
   pxy_             = lik.pxy_;
   dpxy_            = lik.dpxy_;
   d2pxy_           = lik.d2pxy_;
+  flatPxy_         = lik.flatPxy_;
+  flatPyx_         = lik.flatPyx_;
   rootFreqs_       = lik.rootFreqs_;
   nodes_ = tree_->getNodes();
   nodes_.pop_back(); // Remove the root node (the last added!).
@@ -132,6 +142,7 @@ AbstractHomogeneousTreeLikelihood& AbstractHomogeneousTreeLikelihood::operator=(
   minimumBrLen_    = lik.minimumBrLen_;
   maximumBrLen_    = lik.maximumBrLen_;
   brLenConstraint_ = std::shared_ptr<Constraint>(lik.brLenConstraint_->clone());
+  batchTransitionProbabilities_ = lik.batchTransitionProbabilities_;
   return *this;
 }
 
@@ -187,11 +198,16 @@ void AbstractHomogeneousTreeLikelihood::setModel(TransitionModel* model)
   nbStates_ = model->getNumberOfStates();
 
   // Allocate transition probabilities arrays:
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
   for (unsigned int l = 0; l < nbNodes_; l++)
   {
     // For each son node,i
     Node* son = nodes_[l];
 
+    // Padding values are never written, they remain 0:
+    flatPxy_[son->getId()].assign(nbClasses_ * nbStates_ * stride, 0.);
+    flatPyx_[son->getId()].assign(nbClasses_ * nbStates_ * stride, 0.);
+
     VVVdouble* pxy__son = &pxy_[son->getId()];
     pxy__son->resize(nbClasses_);
     for (unsigned int c = 0; c < nbClasses_; c++)
@@ -340,37 +356,142 @@ void AbstractHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verbose
 
 void AbstractHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
 {
+  if (!batchTransitionProbabilities_)
+  {
+    for (unsigned int l = 0; l < nbNodes_; l++)
+    {
+      // For each node,
+      Node* node = nodes_[l];
+      computeTransitionProbabilitiesForNode(node);
+    }
+    rootFreqs_ = model_->getFrequencies();
+    return;
+  }
+
+  // All branches and rate classes are sent to the model at once,
+  // so that it can share computations between them:
+  vector<double> times(nbNodes_ * nbClasses_);
   for (unsigned int l = 0; l < nbNodes_; l++)
   {
-    // For each node,
-    Node* node = nodes_[l];
-    computeTransitionProbabilitiesForNode(node);
+    double d = nodes_[l]->getDistanceToFather();
+    for (unsigned int c = 0; c < nbClasses_; c++)
+    {
+      times[l * nbClasses_ + c] = d * rateDistribution_->getCategory(c);
+    }
+  }
+
+  // Matrices are written by the model in a single flat buffer,
+  // with the padded rows used by the likelihood kernels:
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  size_t size = nbClasses_ * nbStates_ * stride;
+  vector<double> matrices(nbNodes_ * size);
+  model_->fillPij_t(times, matrices.data(), stride);
+  for (unsigned int l = 0; l < nbNodes_; l++)
+  {
+    setTransitionProbabilities_(nodes_[l]->getId(), &matrices[l * size]);
+  }
+
+  if (computeFirstOrderDerivatives_)
+  {
+    model_->filldPij_dt(times, matrices.data(), stride);
+    copyTransitionMatrices_(matrices, stride, dpxy_, 1);
+  }
+
+  if (computeSecondOrderDerivatives_)
+  {
+    model_->filld2Pij_dt2(times, matrices.data(), stride);
+    copyTransitionMatrices_(matrices, stride, d2pxy_, 2);
   }
   rootFreqs_ = model_->getFrequencies();
 }
 
 /*******************************************************************************/
 
-void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
+void AbstractHomogeneousTreeLikelihood::copyTransitionMatrices_(const vector<double>& matrices, size_t stride, map<int, VVVdouble>& pxy, unsigned int order) const
 {
-  double l = node->getDistanceToFather();
+  for (unsigned int l = 0; l < nbNodes_; l++)
+  {
+    VVVdouble* pxy__node = &pxy[nodes_[l]->getId()];
+    for (unsigned int c = 0; c < nbClasses_; c++)
+    {
+      VVdouble* pxy__node_c = &(*pxy__node)[c];
+      const double* Q = &matrices[(l * nbClasses_ + c) * nbStates_ * stride];
+      // Derivatives are with respect to the branch length, not the scaled one:
+      double rc = rateDistribution_->getCategory(c);
+      double f = (order == 1 ? rc : rc * rc);
+      for (unsigned int x = 0; x < nbStates_; x++)
+      {
+        Vdouble* pxy__node_c_x = &(*pxy__node_c)[x];
+        const double* Q_x = Q + x * stride;
+        for (unsigned int y = 0; y < nbStates_; y++)
+        {
+          (*pxy__node_c_x)[y] = f * Q_x[y];
+        }
+      }
+    }
+  }
+}
 
-  // Computes all pxy and pyx once for all:
-  VVVdouble* pxy__node = &pxy_[node->getId()];
+/*******************************************************************************/
+
+void AbstractHomogeneousTreeLikelihood::setTransitionProbabilities_(int nodeId, const double* matrices)
+{
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  size_t size = nbStates_ * stride;
+  VVVdouble* pxy__node = &pxy_[nodeId];
+  double* flatPxy__node = &flatPxy_[nodeId][0];
+  double* flatPyx__node = &flatPyx_[nodeId][0];
+  std::copy(matrices, matrices + nbClasses_ * size, flatPxy__node);
   for (unsigned int c = 0; c < nbClasses_; c++)
   {
     VVdouble* pxy__node_c = &(*pxy__node)[c];
-    RowMatrix<double> Q = model_->getPij_t(l * rateDistribution_->getCategory(c));
+    const double* Q = matrices + c * size;
+    LikelihoodKernels::transposeTransitionMatrix(Q, stride, nbStates_, flatPyx__node + c * size);
+    for (unsigned int x = 0; x < nbStates_; x++)
+    {
+      const double* Q_x = Q + x * stride;
+      std::copy(Q_x, Q_x + nbStates_, (*pxy__node_c)[x].begin());
+    }
+  }
+}
+
+/*******************************************************************************/
 
+void AbstractHomogeneousTreeLikelihood::updateFlatTransitionProbabilities_(int nodeId)
+{
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  size_t size = nbStates_ * stride;
+  const VVVdouble* pxy__node = &pxy_[nodeId];
+  double* flatPxy__node = &flatPxy_[nodeId][0];
+  double* flatPyx__node = &flatPyx_[nodeId][0];
+  for (unsigned int c = 0; c < nbClasses_; c++)
+  {
+    double* Q = flatPxy__node + c * size;
     for (unsigned int x = 0; x < nbStates_; x++)
     {
-      Vdouble* pxy__node_c_x = &(*pxy__node_c)[x];
-      for (unsigned int y = 0; y < nbStates_; y++)
-      {
-        (*pxy__node_c_x)[y] = Q(x, y);
-      }
+      const Vdouble* pxy__node_c_x = &(*pxy__node)[c][x];
+      std::copy(pxy__node_c_x->begin(), pxy__node_c_x->end(), Q + x * stride);
     }
+    LikelihoodKernels::transposeTransitionMatrix(Q, stride, nbStates_, flatPyx__node + c * size);
+  }
+}
+
+/*******************************************************************************/
+
+void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
+{
+  double l = node->getDistanceToFather();
+
+  // Computes all pxy and pyx once for all:
+  vector<double> times(nbClasses_);
+  for (unsigned int c = 0; c < nbClasses_; c++)
+  {
+    times[c] = l * rateDistribution_->getCategory(c);
   }
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  vector<double> matrices(nbClasses_ * nbStates_ * stride);
+  model_->fillPij_t(times, matrices.data(), stride);
+  setTransitionProbabilities_(node->getId(), matrices.data());
 
   if (computeFirstOrderDerivatives_)
   {
@@ -92,6 +92,19 @@ protected:
 
   mutable std::map<int, VVVdouble> d2pxy_;
 
+  /**
+   * @brief Transition probabilities of each node, in the layout of the likelihood kernels.
+   *
+   * For each node, the matrices of all rate classes are stored one after the other,
+   * with rows of ConditionalLikelihoodBuffer::getPaddedSize(nbStates_) values.
+   * flatPxy_ holds the same values as pxy_ (row x contains P(x -> y)), and is used with the father's arrays.
+   * flatPyx_ holds the transposed matrices, and is used with the sons' arrays (see LikelihoodKernels).
+   * Both are kept up to date with pxy_, see setTransitionProbabilities_() and updateFlatTransitionProbabilities_().
+   */
+  mutable std::map<int, std::vector<double> > flatPxy_;
+
+  mutable std::map<int, std::vector<double> > flatPyx_;
+
   std::vector<double> rootFreqs_;
 
   /**
@@ -115,6 +128,14 @@ protected:
   double maximumBrLen_;
   std::shared_ptr<Constraint> brLenConstraint_;
 
+  /**
+   * @brief Tell if computeAllTransitionProbabilities() sends all branches to the model at once.
+   *
+   * In this case computeTransitionProbabilitiesForNode() is not called for each node,
+   * so classes which override it must leave this option disabled (the default).
+   */
+  bool batchTransitionProbabilities_;
+
 public:
   AbstractHomogeneousTreeLikelihood(
     const Tree& tree,
@@ -269,12 +290,48 @@ public:
 protected:
   /**
    * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for all nodes.
+   *
+   * computeTransitionProbabilitiesForNode() is called for each node, unless
+   * batchTransitionProbabilities_ is true, in which case the matrices of all branches
+   * and rate classes are computed by a single call to the model.
    */
   virtual void computeAllTransitionProbabilities();
   /**
    * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for one node.
    */
   virtual void computeTransitionProbabilitiesForNode(const Node* node);
+
+  /**
+   * @brief Set the transition probabilities of one node.
+   *
+   * pxy_, flatPxy_ and flatPyx_ are updated.
+   *
+   * @param nodeId   The id of the node.
+   * @param matrices The matrices of all rate classes, one after the other, in the flat layout
+   * of TransitionModel::fillPij_t() with rows of ConditionalLikelihoodBuffer::getPaddedSize(nbStates_) values.
+   */
+  void setTransitionProbabilities_(int nodeId, const double* matrices);
+
+  /**
+   * @brief Update flatPxy_ and flatPyx_ after pxy_ has been modified for one node.
+   *
+   * Implementations of computeTransitionProbabilitiesForNode() which fill pxy_ themselves must call this method.
+   *
+   * @param nodeId The id of the node.
+   */
+  void updateFlatTransitionProbabilities_(int nodeId);
+
+private:
+  /**
+   * @brief Copy matrices computed for all nodes and rate classes to one of the dpxy_ and d2pxy_ arrays.
+   *
+   * @param matrices The matrices, ordered by node and then rate class, in the flat layout
+   * of TransitionModel::fillPij_t() with rows of stride values.
+   * @param stride   The size of the rows of the matrices.
+   * @param pxy      The array to fill.
+   * @param order    The derivative order (1 or 2), used to account for the rate of each class.
+   */
+  void copyTransitionMatrices_(const std::vector<double>& matrices, size_t stride, std::map<int, VVVdouble>& pxy, unsigned int order) const;
 };
 } // end of namespace bpp.
 
@@ -37,6 +37,7 @@
 */
 
 #include "AbstractNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 //From SeqLib:
@@ -50,6 +51,7 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -67,6 +69,8 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   pxy_(),
   dpxy_(),
   d2pxy_(),
+  flatPxy_(),
+  flatPyx_(),
   rootFreqs_(),
   nodes_(),
   idToNode_(),
@@ -96,6 +100,8 @@ AbstractNonHomogeneousTreeLikelihood::AbstractNonHomogeneousTreeLikelihood(
   pxy_(lik.pxy_),
   dpxy_(lik.dpxy_),
   d2pxy_(lik.d2pxy_),
+  flatPxy_(lik.flatPxy_),
+  flatPyx_(lik.flatPyx_),
   rootFreqs_(lik.rootFreqs_),
   nodes_(),
   idToNode_(),
@@ -133,6 +139,8 @@ AbstractNonHomogeneousTreeLikelihood& AbstractNonHomogeneousTreeLikelihood::oper
   pxy_               = lik.pxy_;
   dpxy_              = lik.dpxy_;
   d2pxy_             = lik.d2pxy_;
+  flatPxy_           = lik.flatPxy_;
+  flatPyx_           = lik.flatPyx_;
   rootFreqs_         = lik.rootFreqs_;
   nodes_             = tree_->getNodes();
   nodes_.pop_back(); //Remove the root node (the last added!).  
@@ -210,11 +218,16 @@ void AbstractNonHomogeneousTreeLikelihood::setSubstitutionModelSet(SubstitutionM
   nbStates_ = modelSet->getNumberOfStates();
 
   //Allocate transition probabilities arrays:
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
   for (unsigned int l = 0; l < nbNodes_; l++)
     {
       //For each son node,i
       Node* son = nodes_[l];
 
+      //Padding values are never written, they remain 0:
+      flatPxy_[son->getId()].assign(nbClasses_ * nbStates_ * stride, 0.);
+      flatPyx_[son->getId()].assign(nbClasses_ * nbStates_ * stride, 0.);
+
       VVVdouble* pxy__son = & pxy_[son->getId()];
       pxy__son->resize(nbClasses_);
       for (unsigned int c = 0; c < nbClasses_; c++)
@@ -404,26 +417,65 @@ void AbstractNonHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
 
 /*******************************************************************************/
 
+void AbstractNonHomogeneousTreeLikelihood::setTransitionProbabilities_(int nodeId, const double* matrices)
+{
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  size_t size = nbStates_ * stride;
+  VVVdouble* pxy__node = & pxy_[nodeId];
+  double* flatPxy__node = & flatPxy_[nodeId][0];
+  double* flatPyx__node = & flatPyx_[nodeId][0];
+  std::copy(matrices, matrices + nbClasses_ * size, flatPxy__node);
+  for(unsigned int c = 0; c < nbClasses_; c++)
+  {
+    VVdouble* pxy__node_c = & (* pxy__node)[c];
+    const double* Q = matrices + c * size;
+    LikelihoodKernels::transposeTransitionMatrix(Q, stride, nbStates_, flatPyx__node + c * size);
+    for(unsigned int x = 0; x < nbStates_; x++)
+    {
+      const double* Q_x = Q + x * stride;
+      std::copy(Q_x, Q_x + nbStates_, (* pxy__node_c)[x].begin());
+    }
+  }
+}
+
+/*******************************************************************************/
+
+void AbstractNonHomogeneousTreeLikelihood::updateFlatTransitionProbabilities_(int nodeId)
+{
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  size_t size = nbStates_ * stride;
+  const VVVdouble* pxy__node = & pxy_[nodeId];
+  double* flatPxy__node = & flatPxy_[nodeId][0];
+  double* flatPyx__node = & flatPyx_[nodeId][0];
+  for(unsigned int c = 0; c < nbClasses_; c++)
+  {
+    double* Q = flatPxy__node + c * size;
+    for(unsigned int x = 0; x < nbStates_; x++)
+    {
+      const Vdouble* pxy__node_c_x = & (* pxy__node)[c][x];
+      std::copy(pxy__node_c_x->begin(), pxy__node_c_x->end(), Q + x * stride);
+    }
+    LikelihoodKernels::transposeTransitionMatrix(Q, stride, nbStates_, flatPyx__node + c * size);
+  }
+}
+
+/*******************************************************************************/
+
 void AbstractNonHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
 {
   const TransitionModel* model = modelSet_->getModelForNode(node->getId());
   double l = node->getDistanceToFather(); 
 
   //Computes all pxy and pyx once for all:
-  VVVdouble * pxy__node = & pxy_[node->getId()];
+  vector<double> times(nbClasses_);
   for(unsigned int c = 0; c < nbClasses_; c++)
   {
-    VVdouble * pxy__node_c = & (* pxy__node)[c];
-    RowMatrix<double> Q = model->getPij_t(l * rateDistribution_->getCategory(c));
-    for(unsigned int x = 0; x < nbStates_; x++)
-    {
-      Vdouble * pxy__node_c_x = & (* pxy__node_c)[x];
-      for(unsigned int y = 0; y < nbStates_; y++)
-      {
-        (* pxy__node_c_x)[y] = Q(x, y);
-      }
-    }
+    times[c] = l * rateDistribution_->getCategory(c);
   }
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  vector<double> matrices(nbClasses_ * nbStates_ * stride);
+  model->fillPij_t(times, matrices.data(), stride);
+  setTransitionProbabilities_(node->getId(), matrices.data());
   
   if(computeFirstOrderDerivatives_)
     {
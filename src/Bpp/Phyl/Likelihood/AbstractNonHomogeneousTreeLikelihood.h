@@ -97,6 +97,19 @@ class AbstractNonHomogeneousTreeLikelihood:
     mutable std::map<int, VVVdouble> dpxy_;
 
     mutable std::map<int, VVVdouble> d2pxy_;
+
+    /**
+     * @brief Transition probabilities of each node, in the layout of the likelihood kernels.
+     *
+     * For each node, the matrices of all rate classes are stored one after the other,
+     * with rows of ConditionalLikelihoodBuffer::getPaddedSize(nbStates_) values.
+     * flatPxy_ holds the same values as pxy_ (row x contains P(x -> y)), and is used with the father's arrays.
+     * flatPyx_ holds the transposed matrices, and is used with the sons' arrays (see LikelihoodKernels).
+     * Both are kept up to date with pxy_, see setTransitionProbabilities_() and updateFlatTransitionProbabilities_().
+     */
+    mutable std::map<int, std::vector<double> > flatPxy_;
+
+    mutable std::map<int, std::vector<double> > flatPyx_;
         
     std::vector<double> rootFreqs_;
         
@@ -286,6 +299,26 @@ class AbstractNonHomogeneousTreeLikelihood:
      */
     virtual void computeTransitionProbabilitiesForNode(const Node * node);
 
+    /**
+     * @brief Set the transition probabilities of one node.
+     *
+     * pxy_, flatPxy_ and flatPyx_ are updated.
+     *
+     * @param nodeId   The id of the node.
+     * @param matrices The matrices of all rate classes, one after the other, in the flat layout
+     * of TransitionModel::fillPij_t() with rows of ConditionalLikelihoodBuffer::getPaddedSize(nbStates_) values.
+     */
+    void setTransitionProbabilities_(int nodeId, const double* matrices);
+
+    /**
+     * @brief Update flatPxy_ and flatPyx_ after pxy_ has been modified for one node.
+     *
+     * Implementations of computeTransitionProbabilitiesForNode() which fill pxy_ themselves must call this method.
+     *
+     * @param nodeId The id of the node.
+     */
+    void updateFlatTransitionProbabilities_(int nodeId);
+
 };
 
 } //end of namespace bpp.
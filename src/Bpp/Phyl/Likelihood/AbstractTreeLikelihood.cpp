@@ -43,6 +43,23 @@ using namespace bpp;
 
 /******************************************************************************/
 
+void AbstractTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  ThreadPool* pool = 0;
+  if (nbThreads != 1)
+  {
+    pool = new ThreadPool(nbThreads);
+    if (pool->getNumberOfThreads() == 1)
+    {
+      delete pool;
+      pool = 0;
+    }
+  }
+  threadPool_.reset(pool);
+}
+
+/******************************************************************************/
+
 Vdouble AbstractTreeLikelihood::getLikelihoodForEachSite() const
 {
 	Vdouble l(getNumberOfSites());
@@ -43,12 +43,16 @@
 #include "TreeLikelihood.h"
 #include "../Tree.h"
 #include "../TreeTemplate.h"
+#include "../ThreadPool.h"
 
 #include <Bpp/Numeric/AbstractParametrizable.h>
 
 //From bpp-seq:
 #include <Bpp/Seq/Container/SiteContainer.h>
 
+//From the STL:
+#include <memory>
+
 namespace bpp
 {
 
@@ -231,6 +235,7 @@ namespace bpp
     bool computeFirstOrderDerivatives_;
     bool computeSecondOrderDerivatives_;
     bool initialized_;
+    std::shared_ptr<ThreadPool> threadPool_;
 
   public:
     AbstractTreeLikelihood():
@@ -239,7 +244,8 @@ namespace bpp
       tree_(0),
       computeFirstOrderDerivatives_(true),
       computeSecondOrderDerivatives_(true),
-      initialized_(false) {}
+      initialized_(false),
+      threadPool_() {}
 
     AbstractTreeLikelihood(const AbstractTreeLikelihood & lik):
       AbstractParametrizable(lik),
@@ -247,7 +253,8 @@ namespace bpp
       tree_(0),
       computeFirstOrderDerivatives_(lik.computeFirstOrderDerivatives_),
       computeSecondOrderDerivatives_(lik.computeSecondOrderDerivatives_),
-      initialized_(lik.initialized_) 
+      initialized_(lik.initialized_),
+      threadPool_(lik.threadPool_ ? new ThreadPool(lik.threadPool_->getNumberOfThreads()) : 0)
     {
       if (lik.data_) data_ = dynamic_cast<SiteContainer*>(lik.data_->clone());
       if (lik.tree_) tree_ = lik.tree_->clone();
@@ -265,6 +272,7 @@ namespace bpp
       computeFirstOrderDerivatives_ = lik.computeFirstOrderDerivatives_;
       computeSecondOrderDerivatives_ = lik.computeSecondOrderDerivatives_;
       initialized_ = lik.initialized_;
+      threadPool_.reset(lik.threadPool_ ? new ThreadPool(lik.threadPool_->getNumberOfThreads()) : 0);
       return *this;
     }
 
@@ -302,6 +310,52 @@ namespace bpp
     void initialize() { initialized_ = true; }
     /** @} */
 
+    /**
+     * @name Multithreading.
+     *
+     * @{
+     */
+
+    /**
+     * @brief Set the number of threads used to compute the likelihood.
+     *
+     * Sites are split in as many chunks as threads, which are processed in parallel.
+     * The likelihood of each site does not depend on the number of threads used,
+     * and sums over sites are always computed sequentially in the same order,
+     * so that results are identical whatever the number of threads, for a given
+     * instruction set. They may differ in the last bits between machines, as the
+     * vectorized kernels do not sum terms in the same order as the scalar ones
+     * (see LikelihoodKernels::getInstructionSet()).
+     *
+     * @param nbThreads The number of threads to use. 1 (the default) disables multithreading,
+     * 0 uses as many threads as available on the machine.
+     */
+    virtual void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used to compute the likelihood.
+     */
+    size_t getNumberOfThreads() const { return threadPool_ ? threadPool_->getNumberOfThreads() : 1; }
+
+    /**
+     * @brief Use a thread pool shared with other objects.
+     *
+     * This is used by likelihood objects made of sub-likelihoods, so that the
+     * total number of threads does not grow with the number of sub-likelihoods.
+     * Copies of this object get their own pool.
+     *
+     * @param pool The pool to use, or a null pointer to disable multithreading.
+     */
+    virtual void setThreadPool(const std::shared_ptr<ThreadPool>& pool) { threadPool_ = pool; }
+
+    /** @} */
+
+  protected:
+    /**
+     * @return A pointer toward the thread pool to use, or 0 if multithreading is disabled.
+     */
+    ThreadPool* getThreadPool_() const { return threadPool_.get(); }
+
   };
 
 } //end of namespace bpp.
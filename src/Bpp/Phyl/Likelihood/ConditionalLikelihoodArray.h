@@ -0,0 +1,379 @@
+//
+// File: ConditionalLikelihoodArray.h
+// Created by: agent
+// Created on: Fri Oct 16 20:13 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _CONDITIONALLIKELIHOODARRAY_H_
+#define _CONDITIONALLIKELIHOODARRAY_H_
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+namespace bpp
+{
+
+/**
+ * @brief A view on a contiguous conditional likelihood array.
+ *
+ * The array is stored as
+ * <pre>
+ * x[i][c][s]
+ *   |---------> Site i
+ *      |------> Rate class c
+ *         |---> Ancestral state s
+ * </pre>
+ * with states innermost. Each (site, class) row is padded to getStride() values, so that
+ * rows start on aligned addresses. Padding values are always 0 and are never part of a computation.
+ *
+ * This class does not own its data, and is cheap to copy.
+ * Use x(i, c) to get a pointer to the first state of row (i, c). For convenience,
+ * x[i][c][s] is also supported, with the same semantic as for VVVdouble arrays.
+ *
+ * @see ConditionalLikelihoodBuffer
+ */
+class ConditionalLikelihoodArray
+{
+  public:
+    class SiteRow
+    {
+      private:
+        double* data_;
+        size_t stride_;
+
+      public:
+        SiteRow(double* data, size_t stride) : data_(data), stride_(stride) {}
+
+      public:
+        double* operator[](size_t c) const { return data_ + c * stride_; }
+    };
+
+  private:
+    double* data_;
+    size_t nbSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    size_t stride_;
+
+  public:
+    ConditionalLikelihoodArray() :
+      data_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0) {}
+
+    ConditionalLikelihoodArray(double* data, size_t nbSites, size_t nbClasses, size_t nbStates, size_t stride) :
+      data_(data), nbSites_(nbSites), nbClasses_(nbClasses), nbStates_(nbStates), stride_(stride) {}
+
+  public:
+    double* operator()(size_t site, size_t c) const { return data_ + (site * nbClasses_ + c) * stride_; }
+
+    SiteRow operator[](size_t site) const { return SiteRow(data_ + site * nbClasses_ * stride_, stride_); }
+
+    double* getData() const { return data_; }
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfClasses() const { return nbClasses_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+    size_t getStride() const { return stride_; }
+    bool isNull() const { return data_ == 0; }
+
+    /**
+     * @brief Set all conditional likelihoods to a given value (padding is left untouched).
+     *
+     * @param value The value to use.
+     */
+    void fill(double value) const
+    {
+      size_t nbRows = nbSites_ * nbClasses_;
+      for (size_t r = 0; r < nbRows; r++)
+      {
+        double* row = data_ + r * stride_;
+        std::fill(row, row + nbStates_, value);
+      }
+    }
+
+    /**
+     * @brief Copy the content of an array with the same dimensions.
+     *
+     * @param array The array to copy.
+     */
+    void copy(const ConditionalLikelihoodArray& array) const
+    {
+      std::copy(array.data_, array.data_ + nbSites_ * nbClasses_ * stride_, data_);
+    }
+
+    /**
+     * @brief Copy a leaf array (site x state), for each rate class.
+     *
+     * @param leafArray The leaf likelihoods.
+     */
+    void copyFromLeaf(const VVdouble& leafArray) const
+    {
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        const Vdouble* leafArray_i = &leafArray[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          std::copy(leafArray_i->begin(), leafArray_i->begin() + static_cast<std::ptrdiff_t>(nbStates_), (*this)(i, c));
+        }
+      }
+    }
+
+    /**
+     * @brief Export the content of this array as a VVVdouble object.
+     *
+     * @param array The array to write to. It will be resized if needed.
+     */
+    void toVVVdouble(VVVdouble& array) const
+    {
+      array.resize(nbSites_);
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        VVdouble* array_i = &array[i];
+        array_i->resize(nbClasses_);
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          const double* row = (*this)(i, c);
+          (*array_i)[c].assign(row, row + nbStates_);
+        }
+      }
+    }
+};
+
+/**
+ * @brief Aligned storage for one or several conditional likelihood arrays of identical dimensions.
+ *
+ * All arrays are stored in a single memory block (a "slab"), aligned on 64 bytes,
+ * with rows padded to a multiple of 4 doubles. Array k is retrieved using getArray(k).
+ * Resizing the buffer invalidates all views previously retrieved.
+ *
+ * @see ConditionalLikelihoodArray
+ */
+class ConditionalLikelihoodBuffer
+{
+  public:
+    static const size_t ALIGNMENT = 64;
+    static const size_t STATE_PADDING = 4;
+
+  private:
+    std::vector<double> storage_;
+    size_t offset_;
+    size_t nbArrays_;
+    size_t nbSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    size_t stride_;
+
+  public:
+    ConditionalLikelihoodBuffer() :
+      storage_(), offset_(0), nbArrays_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0) {}
+
+    ConditionalLikelihoodBuffer(const ConditionalLikelihoodBuffer& buffer) :
+      storage_(), offset_(0), nbArrays_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stride_(0)
+    {
+      resize(buffer.nbArrays_, buffer.nbSites_, buffer.nbClasses_, buffer.nbStates_);
+      std::copy(buffer.begin_(), buffer.begin_() + buffer.getSize(), begin_());
+    }
+
+    ConditionalLikelihoodBuffer& operator=(const ConditionalLikelihoodBuffer& buffer)
+    {
+      resize(buffer.nbArrays_, buffer.nbSites_, buffer.nbClasses_, buffer.nbStates_);
+      std::copy(buffer.begin_(), buffer.begin_() + buffer.getSize(), begin_());
+      return *this;
+    }
+
+    virtual ~ConditionalLikelihoodBuffer() {}
+
+  public:
+    /**
+     * @brief Resize the buffer.
+     *
+     * All values (including padding) are set to 0.
+     *
+     * @param nbArrays  The number of arrays to store.
+     * @param nbSites   The number of sites in each array.
+     * @param nbClasses The number of rate classes in each array.
+     * @param nbStates  The number of states in each array.
+     */
+    void resize(size_t nbArrays, size_t nbSites, size_t nbClasses, size_t nbStates)
+    {
+      nbArrays_  = nbArrays;
+      nbSites_   = nbSites;
+      nbClasses_ = nbClasses;
+      nbStates_  = nbStates;
+      stride_    = getPaddedSize(nbStates);
+      size_t extra = ALIGNMENT / sizeof(double);
+      storage_.assign(getSize() + extra, 0.);
+      uintptr_t address = reinterpret_cast<uintptr_t>(&storage_[0]);
+      offset_ = ((ALIGNMENT - address % ALIGNMENT) % ALIGNMENT) / sizeof(double);
+    }
+
+    ConditionalLikelihoodArray getArray(size_t k = 0) const
+    {
+      return ConditionalLikelihoodArray(
+          const_cast<double*>(begin_()) + k * nbSites_ * nbClasses_ * stride_,
+          nbSites_, nbClasses_, nbStates_, stride_);
+    }
+
+    size_t getNumberOfArrays() const { return nbArrays_; }
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfClasses() const { return nbClasses_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+    size_t getStride() const { return stride_; }
+
+    /**
+     * @return The total number of doubles stored, padding included.
+     */
+    size_t getSize() const { return nbArrays_ * nbSites_ * nbClasses_ * stride_; }
+
+    /**
+     * @return The number of doubles needed to store a row of nbStates states.
+     */
+    static size_t getPaddedSize(size_t nbStates)
+    {
+      return (nbStates + STATE_PADDING - 1) / STATE_PADDING * STATE_PADDING;
+    }
+
+  private:
+    double* begin_() { return storage_.empty() ? 0 : &storage_[offset_]; }
+    const double* begin_() const { return storage_.empty() ? 0 : &storage_[offset_]; }
+};
+
+/**
+ * @brief Numerical scaling of conditional likelihoods.
+ *
+ * When the conditional likelihoods of a site all fall below 2^SCALING_THRESHOLD,
+ * they are multiplied by a power of 2 so that the largest one falls in [0.5, 1),
+ * and the exponent used is returned, to be recorded by the caller.
+ * As only powers of 2 are used, scaling is exact.
+ *
+ * These functions are used by the DRASDRTreeLikelihoodData and DRASRTreeLikelihoodData storage schemes.
+ */
+class ConditionalLikelihoodScaling
+{
+  public:
+    /**
+     * @brief Conditional likelihoods of a site are rescaled when they all fall below 2^SCALING_THRESHOLD.
+     */
+    static const int SCALING_THRESHOLD = -256;
+
+  public:
+    /**
+     * @brief Rescale the conditional likelihoods of a site, if needed.
+     *
+     * @param array The likelihood array.
+     * @param site  The index of the site in the array.
+     * @return The exponent of the power of 2 used (0 if no scaling was performed).
+     */
+    static int scaleLikelihoods(const ConditionalLikelihoodArray& array, size_t site)
+    {
+      size_t nbClasses = array.getNumberOfClasses();
+      size_t nbStates = array.getNumberOfStates();
+      double max = 0;
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        const double* array_i_c = array(site, c);
+        for (size_t s = 0; s < nbStates; s++)
+        {
+          if (array_i_c[s] > max) max = array_i_c[s];
+        }
+      }
+      int e = getScalingExponent(max);
+      if (e == 0)
+        return 0;
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        double* array_i_c = array(site, c);
+        for (size_t s = 0; s < nbStates; s++)
+        {
+          array_i_c[s] = ldexp(array_i_c[s], e);
+        }
+      }
+      return e;
+    }
+
+    /**
+     * @brief Rescale the conditional likelihoods of a site, if needed.
+     *
+     * @param likelihoods_i The likelihood array for a site (class x state).
+     * @return The exponent of the power of 2 used (0 if no scaling was performed).
+     */
+    static int scaleLikelihoods(VVdouble& likelihoods_i)
+    {
+      double max = 0;
+      for (size_t c = 0; c < likelihoods_i.size(); c++)
+      {
+        const Vdouble* likelihoods_i_c = &likelihoods_i[c];
+        for (size_t s = 0; s < likelihoods_i_c->size(); s++)
+        {
+          if ((*likelihoods_i_c)[s] > max) max = (*likelihoods_i_c)[s];
+        }
+      }
+      int e = getScalingExponent(max);
+      if (e == 0)
+        return 0;
+      for (size_t c = 0; c < likelihoods_i.size(); c++)
+      {
+        Vdouble* likelihoods_i_c = &likelihoods_i[c];
+        for (size_t s = 0; s < likelihoods_i_c->size(); s++)
+        {
+          (*likelihoods_i_c)[s] = ldexp((*likelihoods_i_c)[s], e);
+        }
+      }
+      return e;
+    }
+
+    /**
+     * @return The exponent of the power of 2 to apply to a site with the given maximum likelihood
+     * (0 if no scaling is needed).
+     */
+    static int getScalingExponent(double max)
+    {
+      if (max == 0 || max >= ldexp(1., SCALING_THRESHOLD))
+        return 0;
+      // max = m * 2^e, with m in [0.5, 1):
+      int e;
+      frexp(max, &e);
+      return -e;
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_CONDITIONALLIKELIHOODARRAY_H_
+
@@ -40,10 +40,15 @@
 
 #include "DRASDRTreeLikelihoodData.h"
 #include "../PatternTools.h"
+#include "../TreeTemplateTools.h"
 
 // From SeqLib:
 #include <Bpp/Seq/SiteTools.h>
 
+// From the STL:
+#include <algorithm>
+#include <cmath>
+
 using namespace bpp;
 
 /******************************************************************************/
@@ -72,36 +77,30 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const SiteContainer& sites, const
   nbDistinctSites_  = shrunkData_->getNumberOfSites();
 
   // Init data:
+  // All arrays are stored in the likelihood slab, one per oriented branch:
+  likelihoodSlab_.resize(getNumberOfNeighborArrays_(), nbDistinctSites_, nbClasses_, nbStates_);
+  resizeScalingExponents_();
+  nodeData_.clear();
   // Clone data for more efficiency on sequences access:
   const SiteContainer* sequences = new AlignedSequenceContainer(*shrunkData_);
-  initLikelihoods(tree_->getRootNode(), *sequences, model);
+  size_t position = 0;
+  initLikelihoods(tree_->getRootNode(), *sequences, model, position);
   delete sequences;
 
   // Now initialize root likelihoods and derivatives:
-  rootLikelihoods_.resize(nbDistinctSites_);
+  rootLikelihoods_.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  rootLikelihoods_.getArray().fill(1.);
   rootLikelihoodsS_.resize(nbDistinctSites_);
   rootLikelihoodsSR_.resize(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    VVdouble* rootLikelihoods_i_ = &rootLikelihoods_[i];
-    Vdouble* rootLikelihoodsS_i_ = &rootLikelihoodsS_[i];
-    rootLikelihoods_i_->resize(nbClasses_);
-    rootLikelihoodsS_i_->resize(nbClasses_);
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* rootLikelihoods_i_c_ = &(*rootLikelihoods_i_)[c];
-      rootLikelihoods_i_c_->resize(nbStates_);
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        (*rootLikelihoods_i_c_)[x] = 1.;
-      }
-    }
+    rootLikelihoodsS_[i].resize(nbClasses_);
   }
 }
 
 /******************************************************************************/
 
-void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteContainer& sites, const TransitionModel& model)
+void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteContainer& sites, const TransitionModel& model, size_t& position)
 {
   if (node->isLeaf())
   {
@@ -143,58 +142,30 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
   for (size_t l = 0; l < nbSonNodes; l++)
   {
     // For each son node,
-    initLikelihoods(node->getSon(l), sites, model);
+    initLikelihoods(node->getSon(l), sites, model, position);
   }
 
   // Initialize likelihood vector:
   DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
-  std::map<int, VVVdouble>* likelihoods_node_ = &nodeData->getLikelihoodArrays();
   nodeData->setNode(node);
+  nodeData->setSlab(&likelihoodSlab_);
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
     const Node* neighbor = (*node)[n];
-    VVVdouble* likelihoods_node_neighbor_ = &(*likelihoods_node_)[neighbor->getId()];
-
-    likelihoods_node_neighbor_->resize(nbDistinctSites_);
+    nodeData->setLikelihoodArrayPosition(neighbor->getId(), position);
+    ConditionalLikelihoodArray likelihoods_node_neighbor = likelihoodSlab_.getArray(position);
+    position++;
 
     if (neighbor->isLeaf())
     {
-      VVdouble* leavesLikelihoods_leaf_ = &leafData_[neighbor->getId()].getLikelihoodArray();
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        Vdouble* leavesLikelihoods_leaf_i_ = &(*leavesLikelihoods_leaf_)[i];
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
-          for (size_t s = 0; s < nbStates_; s++)
-          {
-            (*likelihoods_node_neighbor_i_c_)[s] = (*leavesLikelihoods_leaf_i_)[s];
-          }
-        }
-      }
+      likelihoods_node_neighbor.copyFromLeaf(leafData_[neighbor->getId()].getLikelihoodArray());
     }
     else
     {
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        VVdouble* likelihoods_node_neighbor_i_ = &(*likelihoods_node_neighbor_)[i];
-        likelihoods_node_neighbor_i_->resize(nbClasses_);
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* likelihoods_node_neighbor_i_c_ = &(*likelihoods_node_neighbor_i_)[c];
-          likelihoods_node_neighbor_i_c_->resize(nbStates_);
-          for (size_t s = 0; s < nbStates_; s++)
-          {
-            (*likelihoods_node_neighbor_i_c_)[s] = 1.; // All likelihoods are initialized to 1.
-          }
-        }
-      }
+      likelihoods_node_neighbor.fill(1.); // All likelihoods are initialized to 1.
     }
   }
 
@@ -209,10 +180,38 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
 
 void DRASDRTreeLikelihoodData::reInit()
 {
-  reInit(tree_->getRootNode());
+  size_t nbArrays = getNumberOfNeighborArrays_();
+  if (likelihoodSlab_.getNumberOfArrays() != nbArrays)
+  {
+    likelihoodSlab_.resize(nbArrays, nbDistinctSites_, nbClasses_, nbStates_);
+    resizeScalingExponents_();
+  }
+  std::vector<size_t> positions(nbArrays);
+  for (size_t k = 0; k < nbArrays; k++)
+  {
+    positions[k] = k;
+  }
+  size_t k = 0;
+  reInit(tree_->getRootNode(), positions, k);
 }
 
 void DRASDRTreeLikelihoodData::reInit(const Node* node)
+{
+  std::vector<size_t> positions;
+  releaseArrays_(node, positions);
+  size_t nbArrays = 2 * (TreeTemplateTools::getNumberOfNodes(*node) - 1) + (node->hasFather() ? 1 : 0);
+  if (positions.size() < nbArrays)
+  {
+    // The subtree has grown, we need to start from scratch:
+    reInit();
+    return;
+  }
+  std::sort(positions.begin(), positions.end());
+  size_t k = 0;
+  reInit(node, positions, k);
+}
+
+void DRASDRTreeLikelihoodData::reInit(const Node* node, std::vector<size_t>& positions, size_t& k)
 {
   if (node->isLeaf())
   {
@@ -220,8 +219,17 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node)
     leafData->setNode(node);
   }
 
+  // We re-initialize each son node:
+  size_t nbSonNodes = node->getNumberOfSons();
+  for (size_t l = 0; l < nbSonNodes; l++)
+  {
+    // For each son node,
+    reInit(node->getSon(l), positions, k);
+  }
+
   DRASDRTreeLikelihoodNodeData* nodeData = &nodeData_[node->getId()];
   nodeData->setNode(node);
+  nodeData->setSlab(&likelihoodSlab_);
   nodeData->eraseNeighborArrays();
 
   int nbSons = static_cast<int>(node->getNumberOfSons());
@@ -229,35 +237,34 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node)
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
   {
     const Node* neighbor = (*node)[n];
-    VVVdouble* array = &nodeData->getLikelihoodArrayForNeighbor(neighbor->getId());
+    nodeData->setLikelihoodArrayPosition(neighbor->getId(), positions[k]);
+    likelihoodSlab_.getArray(positions[k]).fill(1.); // All likelihoods are initialized to 1.
+    std::fill(scalingExponents_[positions[k]].begin(), scalingExponents_[positions[k]].end(), 0);
+    k++;
+  }
 
-    array->resize(nbDistinctSites_);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+  nodeData->getDLikelihoodArray().resize(nbDistinctSites_);
+  nodeData->getD2LikelihoodArray().resize(nbDistinctSites_);
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::releaseArrays_(const Node* node, std::vector<size_t>& positions)
+{
+  std::map<int, DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.find(node->getId());
+  if (it != nodeData_.end())
+  {
+    const std::map<int, size_t>* arrayPositions = &it->second.getLikelihoodArrayPositions();
+    for (std::map<int, size_t>::const_iterator pit = arrayPositions->begin(); pit != arrayPositions->end(); pit++)
     {
-      VVdouble* array_i = &(*array)[i];
-      array_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* array_i_c = &(*array_i)[c];
-        array_i_c->resize(nbStates_);
-        for (size_t s = 0; s < nbStates_; s++)
-        {
-          (*array_i_c)[s] = 1.; // All likelihoods are initialized to 1.
-        }
-      }
+      positions.push_back(pit->second);
     }
+    it->second.eraseNeighborArrays();
   }
-
-  // We re-initialize each son node:
-  size_t nbSonNodes = node->getNumberOfSons();
-  for (size_t l = 0; l < nbSonNodes; l++)
+  for (size_t l = 0; l < node->getNumberOfSons(); l++)
   {
-    // For each son node,
-    reInit(node->getSon(l));
+    releaseArrays_(node->getSon(l), positions);
   }
-
-  nodeData->getDLikelihoodArray().resize(nbDistinctSites_);
-  nodeData->getD2LikelihoodArray().resize(nbDistinctSites_);
 }
 
 /******************************************************************************/
@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _DRASDRHOMOGENEOUSTREELIKELIHOODDATA_H_
 
 #include "AbstractTreeLikelihoodData.h"
+#include "ConditionalLikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 #include "../PatternTools.h"
 #include "../SitePatterns.h"
@@ -49,8 +50,12 @@ knowledge of the CeCILL license and that you accept its terms.
 //From SeqLib:
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
 // From the STL:
 #include <map>
+#include <vector>
 
 namespace bpp
 {
@@ -101,7 +106,8 @@ class DRASDRTreeLikelihoodLeafData :
  * 
  * This class is for use with the DRASDRTreeLikelihoodData class.
  * 
- * Store for each neighbor node an array with conditionnal likelihoods.
+ * Store for each neighbor node the position of the array with conditionnal likelihoods
+ * in the likelihood slab of the DRASDRTreeLikelihoodData instance.
  *
  * @see DRASDRTreeLikelihoodData
  */
@@ -110,7 +116,7 @@ class DRASDRTreeLikelihoodNodeData :
 {
   private:
     /**
-     * @brief This contains all likelihood values used for computation.
+     * @brief This contains the position of all likelihood arrays used for computation.
      *
      * <pre>
      * x[b][i][c][s]
@@ -120,9 +126,17 @@ class DRASDRTreeLikelihoodNodeData :
      *            |---> Ancestral state s
      * </pre>
      * We call this the <i>likelihood array</i> for each node.
+     * The arrays themselves are stored contiguously in the slab, see ConditionalLikelihoodArray.
      */
+    mutable std::map<int, size_t> nodeLikelihoods_;
+
+    const ConditionalLikelihoodBuffer* slab_;
+
+    /**
+     * @brief A view on each likelihood array, kept in sync with nodeLikelihoods_ and slab_.
+     */
+    std::map<int, ConditionalLikelihoodArray> nodeLikelihoodArrays_;
 
-    mutable std::map<int, VVVdouble> nodeLikelihoods_;
     /**
      * @brief This contains all likelihood first order derivatives values used for computation.
      *
@@ -148,10 +162,12 @@ class DRASDRTreeLikelihoodNodeData :
     const Node* node_;
 
   public:
-    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), slab_(0), nodeLikelihoodArrays_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
     
     DRASDRTreeLikelihoodNodeData(const DRASDRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
+      slab_(data.slab_),
+      nodeLikelihoodArrays_(data.nodeLikelihoodArrays_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
       node_(data.node_)
@@ -160,6 +176,8 @@ class DRASDRTreeLikelihoodNodeData :
     DRASDRTreeLikelihoodNodeData& operator=(const DRASDRTreeLikelihoodNodeData& data)
     {
       nodeLikelihoods_   = data.nodeLikelihoods_;
+      slab_              = data.slab_;
+      nodeLikelihoodArrays_ = data.nodeLikelihoodArrays_;
       nodeDLikelihoods_  = data.nodeDLikelihoods_;
       nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
       node_              = data.node_;
@@ -178,18 +196,61 @@ class DRASDRTreeLikelihoodNodeData :
     
     void setNode(const Node* node) { node_ = node; }
 
-    const std::map<int, VVVdouble>& getLikelihoodArrays() const { return nodeLikelihoods_; }
-    
-    std::map<int, VVVdouble>& getLikelihoodArrays() { return nodeLikelihoods_; }
-    
-    VVVdouble& getLikelihoodArrayForNeighbor(int neighborId)
+    /**
+     * @brief Set the slab where the likelihood arrays are stored.
+     *
+     * @param slab A pointer toward the likelihood slab.
+     */
+    void setSlab(const ConditionalLikelihoodBuffer* slab)
     {
-      return nodeLikelihoods_[neighborId];
+      slab_ = slab;
+      nodeLikelihoodArrays_.clear();
+      for (std::map<int, size_t>::const_iterator it = nodeLikelihoods_.begin(); it != nodeLikelihoods_.end(); it++)
+      {
+        nodeLikelihoodArrays_[it->first] = slab_->getArray(it->second);
+      }
     }
+
+    /**
+     * @return A view on each likelihood array, indexed by neighbor id.
+     */
+    const std::map<int, ConditionalLikelihoodArray>& getLikelihoodArrays() const { return nodeLikelihoodArrays_; }
     
-    const VVVdouble& getLikelihoodArrayForNeighbor(int neighborId) const
+    /**
+     * @return The position in the slab of each likelihood array, indexed by neighbor id.
+     */
+    const std::map<int, size_t>& getLikelihoodArrayPositions() const { return nodeLikelihoods_; }
+
+    ConditionalLikelihoodArray getLikelihoodArrayForNeighbor(int neighborId) const
     {
-      return nodeLikelihoods_[neighborId];
+      return slab_->getArray(getLikelihoodArrayPosition(neighborId));
+    }
+
+    /**
+     * @return The position in the slab of the likelihood array for a given neighbor.
+     *
+     * @param neighborId The id of the neighbor node.
+     */
+    size_t getLikelihoodArrayPosition(int neighborId) const
+    {
+      std::map<int, size_t>::const_iterator it = nodeLikelihoods_.find(neighborId);
+      if (it == nodeLikelihoods_.end())
+        throw Exception("DRASDRTreeLikelihoodNodeData::getLikelihoodArrayPosition. Node " + TextTools::toString(neighborId) + " is not a neighbor of node " + TextTools::toString(node_->getId()) + ".");
+      return it->second;
+    }
+
+    /**
+     * @brief Set the position of the likelihood array for a given neighbor in the slab.
+     *
+     * The slab must have been set before.
+     *
+     * @param neighborId The id of the neighbor node.
+     * @param position   The index of the array in the slab.
+     */
+    void setLikelihoodArrayPosition(int neighborId, size_t position)
+    {
+      nodeLikelihoods_[neighborId] = position;
+      nodeLikelihoodArrays_[neighborId] = slab_->getArray(position);
     }
     
     Vdouble& getDLikelihoodArray() { return nodeDLikelihoods_;  }
@@ -208,6 +269,7 @@ class DRASDRTreeLikelihoodNodeData :
     void eraseNeighborArrays()
     {
       nodeLikelihoods_.erase(nodeLikelihoods_.begin(), nodeLikelihoods_.end());
+      nodeLikelihoodArrays_.clear();
       nodeDLikelihoods_.erase(nodeDLikelihoods_.begin(), nodeDLikelihoods_.end());
       nodeD2Likelihoods_.erase(nodeD2Likelihoods_.begin(), nodeD2Likelihoods_.end());
     }
@@ -215,6 +277,15 @@ class DRASDRTreeLikelihoodNodeData :
 
 /**
  * @brief Likelihood data structure for rate across sites models, using a double-recursive algorithm.
+ *
+ * All conditional likelihood arrays are stored in a single aligned memory block (the likelihood slab),
+ * one array per (node, neighbor) pair, in postfix order. Arrays are accessed through
+ * ConditionalLikelihoodArray views, which remain valid until the next call to initLikelihoods() or reInit().
+ *
+ * To prevent numerical underflow on large trees, the conditional likelihoods of a site may be
+ * multiplied by a power of 2. For each array and each site, we store the sum e of all exponents used
+ * to compute the array (the <i>scaling exponent</i>), so that the true conditional likelihoods
+ * for site i are x[i][c][s] * 2^(-e[i]). The root array has its own scaling exponents.
  */
 class DRASDRTreeLikelihoodData :
   public virtual AbstractTreeLikelihoodData
@@ -223,10 +294,18 @@ class DRASDRTreeLikelihoodData :
 
     mutable std::map<int, DRASDRTreeLikelihoodNodeData> nodeData_;
     mutable std::map<int, DRASDRTreeLikelihoodLeafData> leafData_;
-    mutable VVVdouble rootLikelihoods_;
+    ConditionalLikelihoodBuffer likelihoodSlab_;
+    ConditionalLikelihoodBuffer rootLikelihoods_;
     mutable VVdouble  rootLikelihoodsS_;
     mutable Vdouble   rootLikelihoodsSR_;
 
+    /**
+     * @brief The scaling exponents of each array of the likelihood slab, by position.
+     */
+    mutable std::vector< std::vector<int> > scalingExponents_;
+    mutable std::vector<int> rootScalingExponents_;
+    bool useScaling_;
+
     SiteContainer* shrunkData_;
     size_t nbSites_; 
     size_t nbStates_;
@@ -236,22 +315,28 @@ class DRASDRTreeLikelihoodData :
   public:
     DRASDRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses) :
       AbstractTreeLikelihoodData(tree),
-      nodeData_(), leafData_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(),
+      nodeData_(), leafData_(), likelihoodSlab_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(),
+      scalingExponents_(), rootScalingExponents_(), useScaling_(true),
       shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0)
     {}
 
     DRASDRTreeLikelihoodData(const DRASDRTreeLikelihoodData& data):
       AbstractTreeLikelihoodData(data),
       nodeData_(data.nodeData_), leafData_(data.leafData_),
+      likelihoodSlab_(data.likelihoodSlab_),
       rootLikelihoods_(data.rootLikelihoods_),
       rootLikelihoodsS_(data.rootLikelihoodsS_),
       rootLikelihoodsSR_(data.rootLikelihoodsSR_),
+      scalingExponents_(data.scalingExponents_),
+      rootScalingExponents_(data.rootScalingExponents_),
+      useScaling_(data.useScaling_),
       shrunkData_(0),
       nbSites_(data.nbSites_), nbStates_(data.nbStates_),
       nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_)
     {
       if (data.shrunkData_)
         shrunkData_ = dynamic_cast<SiteContainer*>(data.shrunkData_->clone());
+      bindSlab_();
     }
 
     DRASDRTreeLikelihoodData& operator=(const DRASDRTreeLikelihoodData& data)
@@ -259,9 +344,13 @@ class DRASDRTreeLikelihoodData :
       AbstractTreeLikelihoodData::operator=(data);
       nodeData_          = data.nodeData_;
       leafData_          = data.leafData_;
+      likelihoodSlab_    = data.likelihoodSlab_;
       rootLikelihoods_   = data.rootLikelihoods_;
       rootLikelihoodsS_  = data.rootLikelihoodsS_;
       rootLikelihoodsSR_ = data.rootLikelihoodsSR_;
+      scalingExponents_     = data.scalingExponents_;
+      rootScalingExponents_ = data.rootScalingExponents_;
+      useScaling_           = data.useScaling_;
       nbSites_           = data.nbSites_;
       nbStates_          = data.nbStates_;
       nbClasses_         = data.nbClasses_;
@@ -271,6 +360,7 @@ class DRASDRTreeLikelihoodData :
         shrunkData_      = dynamic_cast<SiteContainer *>(data.shrunkData_->clone());
       else
         shrunkData_      = 0;
+      bindSlab_();
       return *this;
     }
 
@@ -308,9 +398,14 @@ class DRASDRTreeLikelihoodData :
       return nodeData_[nodeId];
     }
     
+    /**
+     * @return The likelihood data of a node. Unlike the non-const version, this never modifies the data,
+     * and can be called from several threads.
+     * @throw Exception If there is no data for this node.
+     */
     const DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId) const
     { 
-      return nodeData_[nodeId];
+      return getNodeData_(nodeId);
     }
     
     DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId)
@@ -328,24 +423,33 @@ class DRASDRTreeLikelihoodData :
       return currentPosition;
     }
 
-    const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const 
-    {
-      return nodeData_[nodeId].getLikelihoodArrays();
-    }
-    
-    std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId)
-    {
-      return nodeData_[nodeId].getLikelihoodArrays();
-    }
-
-    VVVdouble& getLikelihoodArray(int parentId, int neighborId)
+    /**
+     * @return A view on each likelihood array of a node, indexed by neighbor id.
+     *
+     * When scaling is enabled, the values stored for site i are the likelihoods multiplied by 2^e[i],
+     * where e is given by getScalingExponents(nodeId, neighborId).
+     *
+     * @param nodeId The id of the node.
+     * @throw Exception If there is no data for this node.
+     */
+    const std::map<int, ConditionalLikelihoodArray>& getLikelihoodArrays(int nodeId) const 
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return getNodeData_(nodeId).getLikelihoodArrays();
     }
     
-    const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const
+    /**
+     * @return A view on the likelihood array of a node toward one of its neighbors.
+     *
+     * When scaling is enabled, the values stored for site i are the likelihoods multiplied by 2^e[i],
+     * where e is given by getScalingExponents(parentId, neighborId).
+     *
+     * @param parentId   The id of the node.
+     * @param neighborId The id of the neighbor node.
+     * @throw Exception If there is no data for this node.
+     */
+    ConditionalLikelihoodArray getLikelihoodArray(int parentId, int neighborId) const
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      return getNodeData_(parentId).getLikelihoodArrayForNeighbor(neighborId);
     }
     
     Vdouble& getDLikelihoodArray(int nodeId)
@@ -378,8 +482,7 @@ class DRASDRTreeLikelihoodData :
       return leafData_[nodeId].getLikelihoodArray();
     }
     
-    VVVdouble& getRootLikelihoodArray() { return rootLikelihoods_; }
-    const VVVdouble & getRootLikelihoodArray() const { return rootLikelihoods_; }
+    ConditionalLikelihoodArray getRootLikelihoodArray() const { return rootLikelihoods_.getArray(); }
     
     VVdouble& getRootSiteLikelihoodArray() { return rootLikelihoodsS_; }
     const VVdouble& getRootSiteLikelihoodArray() const { return rootLikelihoodsS_; }
@@ -396,6 +499,47 @@ class DRASDRTreeLikelihoodData :
     size_t getNumberOfClasses() const { return nbClasses_; }
 
     const SiteContainer* getShrunkData() const { return shrunkData_; }
+
+    /**
+     * @name Numerical scaling.
+     *
+     * When scaling is enabled, the conditional likelihoods of a site are multiplied by a power of 2
+     * each time they fall below the threshold (see ConditionalLikelihoodScaling), and the corresponding
+     * exponents are recorded together with each array. As only powers of 2 are used, scaling is exact
+     * and results are identical to the unscaled ones as long as no underflow occurs.
+     *
+     * Scaling should be disabled if likelihood arrays from several data instances are combined
+     * outside of the standard recursion.
+     *
+     * @{
+     */
+
+    bool isScalingEnabled() const { return useScaling_; }
+
+    void enableScaling(bool yn) { useScaling_ = yn; }
+
+    /**
+     * @return The scaling exponent of each distinct site for the likelihood array of a node toward one of its neighbors.
+     * @param parentId   The id of the node.
+     * @param neighborId The id of the neighbor node.
+     */
+    std::vector<int>& getScalingExponents(int parentId, int neighborId)
+    {
+      return scalingExponents_[getNodeData_(parentId).getLikelihoodArrayPosition(neighborId)];
+    }
+
+    const std::vector<int>& getScalingExponents(int parentId, int neighborId) const
+    {
+      return scalingExponents_[getNodeData_(parentId).getLikelihoodArrayPosition(neighborId)];
+    }
+
+    /**
+     * @return The scaling exponent of each distinct site for the root likelihood array,
+     * and hence for the root site likelihood arrays.
+     */
+    std::vector<int>& getRootScalingExponents() { return rootScalingExponents_; }
+    const std::vector<int>& getRootScalingExponents() const { return rootScalingExponents_; }
+    /** @} */
     
     /**
      * @brief Resize and initialize all likelihood arrays according to the given data set and substitution model.
@@ -415,6 +559,14 @@ class DRASDRTreeLikelihoodData :
      */
     void reInit();
     
+    /**
+     * @brief Rebuild likelihood arrays for a subtree.
+     *
+     * The slab positions previously used by the nodes of the subtree are recycled.
+     * If the subtree now requires more arrays than it previously had, all arrays of the tree are rebuilt.
+     *
+     * @param node The root of the subtree to rebuild.
+     */
     void reInit(const Node* node);
 
   protected:
@@ -434,8 +586,56 @@ class DRASDRTreeLikelihoodData :
      * @param sites The sequence container to use.
      * @param model The model, used for initializing leaves' likelihoods.
      */
-    void initLikelihoods(const Node* node, const SiteContainer& sites, const TransitionModel& model);
-    
+    void initLikelihoods(const Node* node, const SiteContainer& sites, const TransitionModel& model, size_t& position);
+
+    void reInit(const Node* node, std::vector<size_t>& positions, size_t& k);
+
+  private:
+    const DRASDRTreeLikelihoodNodeData& getNodeData_(int nodeId) const
+    {
+      std::map<int, DRASDRTreeLikelihoodNodeData>::const_iterator it = nodeData_.find(nodeId);
+      if (it == nodeData_.end())
+        throw Exception("DRASDRTreeLikelihoodData::getNodeData_. No likelihood data for node " + TextTools::toString(nodeId) + ".");
+      return it->second;
+    }
+
+    /**
+     * @brief Resize the storage of scaling exponents to the size of the likelihood slab.
+     */
+    void resizeScalingExponents_()
+    {
+      scalingExponents_.resize(likelihoodSlab_.getNumberOfArrays());
+      for (size_t k = 0; k < scalingExponents_.size(); k++)
+      {
+        scalingExponents_[k].assign(nbDistinctSites_, 0);
+      }
+      rootScalingExponents_.assign(nbDistinctSites_, 0);
+    }
+
+    /**
+     * @brief Point all node data toward the likelihood slab of this instance.
+     */
+    void bindSlab_()
+    {
+      for (std::map<int, DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+      {
+        it->second.setSlab(&likelihoodSlab_);
+      }
+    }
+
+    /**
+     * @brief Collect the slab positions of all arrays in a subtree, and detach them from their nodes.
+     */
+    void releaseArrays_(const Node* node, std::vector<size_t>& positions);
+
+    /**
+     * @return The number of likelihood arrays to store in the slab,
+     * that is, one per oriented branch of the tree.
+     */
+    size_t getNumberOfNeighborArrays_() const
+    {
+      return 2 * (tree_->getNumberOfNodes() - 1);
+    }
 };
 
 } //end of namespace bpp.
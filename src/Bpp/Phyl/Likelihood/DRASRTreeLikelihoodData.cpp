@@ -47,6 +47,9 @@
 #include <Bpp/Seq/Container/SequenceContainerTools.h>
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <cmath>
+
 using namespace bpp;
 using namespace std;
 
@@ -103,6 +106,8 @@ void DRASRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteContai
   _likelihoods_node->resize(nbDistinctSites_);
   _dLikelihoods_node->resize(nbDistinctSites_);
   _d2Likelihoods_node->resize(nbDistinctSites_);
+  nodeData->getNodeScalingExponents().assign(nbDistinctSites_, 0);
+  nodeData->getSubtreeScalingExponents().assign(nbDistinctSites_, 0);
 
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
@@ -206,6 +211,8 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
   _likelihoods_node->resize(nbSites);
   _dLikelihoods_node->resize(nbSites);
   _d2Likelihoods_node->resize(nbSites);
+  nodeData->getNodeScalingExponents().assign(nbSites, 0);
+  nodeData->getSubtreeScalingExponents().assign(nbSites, 0);
 
   for (size_t i = 0; i < nbSites; i++)
   {
@@ -293,3 +300,24 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
 
 /******************************************************************************/
 
+void DRASRTreeLikelihoodData::applyNodeScaling(int nodeId, VVVdouble& array) const
+{
+  const vector<int>* exponents = &nodeData_[nodeId].getNodeScalingExponents();
+  for (size_t i = 0; i < array.size(); i++)
+  {
+    int e = (*exponents)[i];
+    if (e == 0) continue;
+    VVdouble* array_i = &array[i];
+    for (size_t c = 0; c < array_i->size(); c++)
+    {
+      Vdouble* array_i_c = &(*array_i)[c];
+      for (size_t s = 0; s < array_i_c->size(); s++)
+      {
+        (*array_i_c)[s] = ldexp((*array_i_c)[s], e);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
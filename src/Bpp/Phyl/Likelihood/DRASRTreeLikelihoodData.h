@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _DRASRHOMOGENEOUSTREELIKELIHOODDATA_H_
 
 #include "AbstractTreeLikelihoodData.h"
+#include "ConditionalLikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 #include "../SitePatterns.h"
 
@@ -49,6 +50,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 // From the STL:
 #include <map>
+#include <vector>
 
 namespace bpp
 {
@@ -68,6 +70,14 @@ namespace bpp
  * We call this the <i>likelihood array</i> for each node.
  * In the same way, we store first and second order derivatives.
  *
+ * To prevent numerical underflow on large trees, the likelihood array of a site may be
+ * multiplied by a power of 2. For each site, we store the exponent used at this node
+ * (the <i>node scaling exponent</i>), together with the sum of all exponents used in
+ * the subtree defined by the node (the <i>subtree scaling exponent</i>).
+ * The true conditional likelihoods for site i are hence x[i][c][s] * 2^(-e[i]), where e is
+ * the subtree scaling exponent.
+ * Derivative arrays are scaled using the same exponents.
+ *
  * @see DRASRTreeLikelihoodData
  */
 class DRASRTreeLikelihoodNodeData :
@@ -77,24 +87,32 @@ class DRASRTreeLikelihoodNodeData :
     mutable VVVdouble nodeLikelihoods_;
     mutable VVVdouble nodeDLikelihoods_;
     mutable VVVdouble nodeD2Likelihoods_;
+    mutable std::vector<int> nodeScalingExponents_;
+    mutable std::vector<int> subtreeScalingExponents_;
     const Node* node_;
 
   public:
-    DRASRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASRTreeLikelihoodNodeData() :
+      nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(),
+      nodeScalingExponents_(), subtreeScalingExponents_(), node_(0) {}
     
     DRASRTreeLikelihoodNodeData(const DRASRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
+      nodeScalingExponents_(data.nodeScalingExponents_),
+      subtreeScalingExponents_(data.subtreeScalingExponents_),
       node_(data.node_)
     {}
     
     DRASRTreeLikelihoodNodeData& operator=(const DRASRTreeLikelihoodNodeData& data)
     {
-      nodeLikelihoods_   = data.nodeLikelihoods_;
-      nodeDLikelihoods_  = data.nodeDLikelihoods_;
-      nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
-      node_              = data.node_;
+      nodeLikelihoods_         = data.nodeLikelihoods_;
+      nodeDLikelihoods_        = data.nodeDLikelihoods_;
+      nodeD2Likelihoods_       = data.nodeD2Likelihoods_;
+      nodeScalingExponents_    = data.nodeScalingExponents_;
+      subtreeScalingExponents_ = data.subtreeScalingExponents_;
+      node_                    = data.node_;
       return *this;
     }
  
@@ -115,6 +133,12 @@ class DRASRTreeLikelihoodNodeData :
 
     VVVdouble& getD2LikelihoodArray() { return nodeD2Likelihoods_; }
     const VVVdouble& getD2LikelihoodArray() const { return nodeD2Likelihoods_; }
+
+    std::vector<int>& getNodeScalingExponents() { return nodeScalingExponents_; }
+    const std::vector<int>& getNodeScalingExponents() const { return nodeScalingExponents_; }
+
+    std::vector<int>& getSubtreeScalingExponents() { return subtreeScalingExponents_; }
+    const std::vector<int>& getSubtreeScalingExponents() const { return subtreeScalingExponents_; }
 };
 
 /**
@@ -149,12 +173,13 @@ class DRASRTreeLikelihoodData :
     size_t nbClasses_;
     size_t nbDistinctSites_; 
     bool usePatterns_;
+    bool useScaling_;
 
   public:
     DRASRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses, bool usePatterns = true) :
       AbstractTreeLikelihoodData(tree),
       nodeData_(), patternLinks_(), shrunkData_(0), nbSites_(0), nbStates_(0),
-      nbClasses_(nbClasses), nbDistinctSites_(0), usePatterns_(usePatterns)
+      nbClasses_(nbClasses), nbDistinctSites_(0), usePatterns_(usePatterns), useScaling_(true)
     {}
 
     DRASRTreeLikelihoodData(const DRASRTreeLikelihoodData& data):
@@ -164,7 +189,7 @@ class DRASRTreeLikelihoodData :
       shrunkData_(0),
       nbSites_(data.nbSites_), nbStates_(data.nbStates_),
       nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_),
-      usePatterns_(data.usePatterns_)
+      usePatterns_(data.usePatterns_), useScaling_(data.useScaling_)
     {
       if (data.shrunkData_)
         shrunkData_      = dynamic_cast<SiteContainer *>(data.shrunkData_->clone());
@@ -185,6 +210,7 @@ class DRASRTreeLikelihoodData :
       else
         shrunkData_      = 0;
       usePatterns_       = data.usePatterns_;
+      useScaling_        = data.useScaling_;
       return *this;
     }
 
@@ -260,6 +286,45 @@ class DRASRTreeLikelihoodData :
     size_t getNumberOfSites() const { return nbSites_; }
     size_t getNumberOfStates() const { return nbStates_; }
     size_t getNumberOfClasses() const { return nbClasses_; }
+
+    /**
+     * @name Numerical scaling.
+     *
+     * When scaling is enabled, the conditional likelihoods of a site are multiplied by a power of 2
+     * each time they fall below the threshold (see ConditionalLikelihoodScaling), and the corresponding exponent
+     * is recorded in the node data.
+     * As only powers of 2 are used, scaling is exact and results are identical to the unscaled ones
+     * as long as no underflow occurs.
+     *
+     * Scaling should be disabled if likelihood arrays from several data instances are combined
+     * outside of the standard recursion.
+     *
+     * @{
+     */
+    bool isScalingEnabled() const { return useScaling_; }
+    
+    void enableScaling(bool yn) { useScaling_ = yn; }
+
+    /**
+     * @return The total scaling exponent e for a given site at the root of the tree.
+     * The site likelihood is then equal to the value computed from the root arrays multiplied by 2^(-e).
+     * @param site The index of the site in the original data set.
+     */
+    int getRootScalingExponent(size_t site) const
+    {
+      return nodeData_[tree_->getRootNode()->getId()].getSubtreeScalingExponents()[rootPatternLinks_[site]];
+    }
+
+    /**
+     * @brief Multiply each site of an array by 2 to the power of the corresponding node scaling exponent.
+     *
+     * This is used to scale derivative arrays in the same way as the likelihood array of the node.
+     *
+     * @param nodeId The id of the node.
+     * @param array  The array to scale (site x class x state).
+     */
+    void applyNodeScaling(int nodeId, VVVdouble& array) const;
+    /** @} */
     
     void initLikelihoods(const SiteContainer& sites, const TransitionModel& model);
 
@@ -67,12 +67,15 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(
 
   if ((mixedmodel = dynamic_cast<MixedTransitionModel*>(model_)) == NULL)
     throw Exception("Bad model: DRHomogeneousMixedTreeLikelihood needs a MixedTransitionModel.");
+  likelihoodData_->enableScaling(false);
 
   size_t s = mixedmodel->getNumberOfModels();
   for (size_t i = 0; i < s; i++)
   {
     treeLikelihoodsContainer_.push_back(
       new DRHomogeneousTreeLikelihood(tree, mixedmodel->getNModel(i), rDist, checkRooted, false));
+    // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+    treeLikelihoodsContainer_.back()->getLikelihoodData()->enableScaling(false);
     probas_.push_back(mixedmodel->getNProbability(i));
   }
 }
@@ -94,6 +97,7 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(
 
   if ((mixedmodel = dynamic_cast<MixedTransitionModel*>(model_)) == NULL)
     throw Exception("Bad model: DRHomogeneousMixedTreeLikelihood needs a MixedTransitionModel.");
+  likelihoodData_->enableScaling(false);
 
   size_t s = mixedmodel->getNumberOfModels();
 
@@ -101,6 +105,8 @@ DRHomogeneousMixedTreeLikelihood::DRHomogeneousMixedTreeLikelihood(
   {
     treeLikelihoodsContainer_.push_back(
       new DRHomogeneousTreeLikelihood(tree, mixedmodel->getNModel(i), rDist, checkRooted, false));
+    // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+    treeLikelihoodsContainer_.back()->getLikelihoodData()->enableScaling(false);
     probas_.push_back(mixedmodel->getNProbability(i));
   }
   setData(data);
@@ -168,6 +174,23 @@ void DRHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites)
   }
 }
 
+/******************************************************************************/
+
+void DRHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  DRHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+  setThreadPool(threadPool_);
+}
+
+void DRHomogeneousMixedTreeLikelihood::setThreadPool(const std::shared_ptr<ThreadPool>& pool)
+{
+  DRHomogeneousTreeLikelihood::setThreadPool(pool);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setThreadPool(pool);
+  }
+}
+
 
 void DRHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList& params)
 {
@@ -348,36 +371,30 @@ void DRHomogeneousMixedTreeLikelihood::computeRootLikelihood()
   }
 }
 
-void DRHomogeneousMixedTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode) const
+void DRHomogeneousMixedTreeLikelihood::computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodBuffer, const Node* sonNode, vector<int>* scalingExponents) const
 {
-  likelihoodArray.resize(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++){
-    VVdouble* likelihoodArray_i = &likelihoodArray[i];
-    likelihoodArray_i->resize(nbClasses_);
-    for (size_t c = 0; c < nbClasses_; c++) {
-      Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-      likelihoodArray_i_c->resize(nbStates_);
-      for (size_t x = 0; x < nbStates_; x++)
-        (*likelihoodArray_i_c)[x] = 0;
-    }
-  }
+  // Scaling is disabled:
+  if (scalingExponents)
+    scalingExponents->assign(nbDistinctSites_, 0);
+
+  likelihoodBuffer.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray likelihoodArray = likelihoodBuffer.getArray();
+  likelihoodArray.fill(0.);
 
-  VVVdouble lArray;
+  ConditionalLikelihoodBuffer lBuffer;
   for (size_t nm = 0; nm < treeLikelihoodsContainer_.size(); nm++)
   {
-    treeLikelihoodsContainer_[nm]->computeLikelihoodAtNode_(node, lArray, sonNode);
+    treeLikelihoodsContainer_[nm]->computeLikelihoodAtNode_(node, lBuffer, sonNode);
+    ConditionalLikelihoodArray lArray = lBuffer.getArray();
     
     for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        VVdouble* likelihoodArray_i = &likelihoodArray[i];
-        VVdouble* lArray_i = &lArray[i];
-        
         for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-            Vdouble* lArray_i_c = &(*lArray_i)[c];
+            double* likelihoodArray_i_c = likelihoodArray(i, c);
+            const double* lArray_i_c = lArray(i, c);
             for (size_t x = 0; x < nbStates_; x++)
-              (*likelihoodArray_i_c)[x] += (*lArray_i_c)[x] * probas_[nm];
+              likelihoodArray_i_c[x] += lArray_i_c[x] * probas_[nm];
          }
       }
     
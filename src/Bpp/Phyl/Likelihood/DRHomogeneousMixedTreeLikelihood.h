@@ -141,6 +141,17 @@ public:
   double getLogLikelihood() const;
   
   void setData(const SiteContainer& sites);
+
+  /**
+   * @brief Set the number of threads, for this object and all sub-likelihoods.
+   *
+   * The sub-likelihoods share the thread pool of this object.
+   *
+   * @param nbThreads The number of threads to use.
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  void setThreadPool(const std::shared_ptr<ThreadPool>& pool);
   double getLikelihoodForASite (size_t site) const;
   double getLogLikelihoodForASite(size_t site) const;
   /** @} */
@@ -185,7 +196,7 @@ public:
   virtual void computeTreeDLikelihoods();
 
 protected:
-  virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
+  virtual void computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodArray, const Node* sonNode = 0, std::vector<int>* scalingExponents = 0) const;
 
   /**
    * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
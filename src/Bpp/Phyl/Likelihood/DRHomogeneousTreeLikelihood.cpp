@@ -38,6 +38,7 @@
  */
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 // From SeqLib:
@@ -52,6 +53,8 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <map>
+#include <cmath>
 
 using namespace std;
 
@@ -65,6 +68,7 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
   bool verbose) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(-1.)
 {
   init_();
@@ -81,6 +85,7 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
   bool verbose) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(-1.)
 {
   init_();
@@ -91,6 +96,8 @@ DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(
 
 void DRHomogeneousTreeLikelihood::init_()
 {
+  // computeTransitionProbabilitiesForNode() is not overridden here:
+  batchTransitionProbabilities_ = true;
   likelihoodData_ = new DRASDRTreeLikelihoodData(
     tree_,
     rateDistribution_->getNumberOfCategories());
@@ -101,10 +108,13 @@ void DRHomogeneousTreeLikelihood::init_()
 DRHomogeneousTreeLikelihood::DRHomogeneousTreeLikelihood(const DRHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(-1.)
 {
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  // The copy has its own tree, with its own modification counter:
+  arraysRevision_ = (lik.arraysRevision_ != 0 && lik.arraysRevision_ == lik.tree_->getRevision()) ? tree_->getRevision() : 0;
   minusLogLik_ = lik.minusLogLik_;
 }
 
@@ -117,6 +127,8 @@ DRHomogeneousTreeLikelihood& DRHomogeneousTreeLikelihood::operator=(const DRHomo
     delete likelihoodData_;
   likelihoodData_ = dynamic_cast<DRASDRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  // The copy has its own tree, with its own modification counter:
+  arraysRevision_ = (lik.arraysRevision_ != 0 && lik.arraysRevision_ == lik.tree_->getRevision()) ? tree_->getRevision() : 0;
   minusLogLik_ = lik.minusLogLik_;
   return *this;
 }
@@ -148,6 +160,7 @@ void DRHomogeneousTreeLikelihood::setData(const SiteContainer& sites)
   if (verbose_)
     ApplicationTools::displayResult("Number of distinct sites",
                                     TextTools::toString(nbDistinctSites_));
+  arraysRevision_ = 0;
   initialized_ = false;
 }
 
@@ -157,10 +170,11 @@ double DRHomogeneousTreeLikelihood::getLikelihood() const
 {
   double l = 1.;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* e = &likelihoodData_->getRootScalingExponents();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    l *= std::pow((*lik)[i], (int)(*w)[i]);
+    l *= std::pow(ldexp((*lik)[i], -(*e)[i]), (int)(*w)[i]);
   }
   return l;
 }
@@ -171,11 +185,12 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 {
   double ll = 0;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* e = &likelihoodData_->getRootScalingExponents();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   vector<double> la(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    la[i] = (*w)[i] * log((*lik)[i]);
+    la[i] = (*w)[i] * (log((*lik)[i]) - (*e)[i] * log(2.));
   }
   sort(la.begin(), la.end());
   for (size_t i = nbDistinctSites_; i > 0; i--)
@@ -189,41 +204,47 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 {
-  return likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return ldexp(likelihoodData_->getRootRateSiteLikelihoodArray()[i], -likelihoodData_->getRootScalingExponents()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
-  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[i]) - likelihoodData_->getRootScalingExponents()[i] * log(2.);
 }
 
 /******************************************************************************/
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return ldexp(likelihoodData_->getRootSiteLikelihoodArray()[i][rateClass], -likelihoodData_->getRootScalingExponents()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return log(likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootSiteLikelihoodArray()[i][rateClass]) - likelihoodData_->getRootScalingExponents()[i] * log(2.);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return ldexp(likelihoodData_->getRootLikelihoodArray()[i][rateClass][static_cast<size_t>(state)], -likelihoodData_->getRootScalingExponents()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootLikelihoodArray()[i][rateClass][static_cast<size_t>(state)]) - likelihoodData_->getRootScalingExponents()[i] * log(2.);
 }
 
 /******************************************************************************/
@@ -239,11 +260,15 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
 {
   applyParameters();
 
+  // Arrays can only be partially updated if the topology did not change since they were computed:
+  bool updateAll = (params.size() == 0 || arraysRevision_ == 0 || arraysRevision_ != tree_->getRevision());
+  vector<const Node*> branches;
   if (rateDistribution_->getParameters().getCommonParametersWith(params).size() > 0
       || model_->getParameters().getCommonParametersWith(params).size() > 0)
   {
     // Rate parameter changed, need to recompute all probs:
     computeAllTransitionProbabilities();
+    updateAll = true;
   }
   else if (params.size() > 0)
   {
@@ -254,12 +279,19 @@ void DRHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& para
       if (s.substr(0, 5) == "BrLen")
       {
         // Branch length parameter:
-        computeTransitionProbabilitiesForNode(nodes_[TextTools::to < size_t > (s.substr(5))]);
+        const Node* node = nodes_[TextTools::to < size_t > (s.substr(5))];
+        computeTransitionProbabilitiesForNode(node);
+        branches.push_back(node);
       }
+      else
+        updateAll = true;
     }
   }
 
-  computeTreeLikelihood();
+  if (updateAll)
+    computeTreeLikelihood();
+  else
+    updateTreeLikelihood_(branches);
   if (computeFirstOrderDerivatives_)
   {
     computeTreeDLikelihoods();
@@ -287,42 +319,46 @@ double DRHomogeneousTreeLikelihood::getValue() const
 void DRHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  ConditionalLikelihoodArray likelihoods_father_node = likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble* dpxy_node = &dpxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray, node);
+  const vector<int>* scaling_father_node = &likelihoodData_->getScalingExponents(father->getId(), node->getId());
+  ConditionalLikelihoodBuffer larrayBuffer;
+  vector<int> larrayScaling;
+  computeLikelihoodAtNode_(father, larrayBuffer, node, &larrayScaling);
+  ConditionalLikelihoodArray larray = larrayBuffer.getArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* rootScaling = &likelihoodData_->getRootScalingExponents();
 
-  double dLi, dLic, dLicx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  ThreadPool::parallelFor(getThreadPool_(), nbDistinctSites_, [&] (size_t begin, size_t end)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double dLi, dLic, dLicx;
+    for (size_t i = begin; i < end; i++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* dpxy_node_c = &(*dpxy_node)[c];
-      dLic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      dLi = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* dpxy_node_c_x = &(*dpxy_node_c)[x];
-        dLicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        const double* likelihoods_father_node_i_c = likelihoods_father_node(i, c);
+        const double* larray_i_c = larray(i, c);
+        VVdouble* dpxy_node_c = &(*dpxy_node)[c];
+        dLic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          dLicx += (*dpxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          Vdouble* dpxy_node_c_x = &(*dpxy_node_c)[x];
+          dLicx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            dLicx += (*dpxy_node_c_x)[y] * likelihoods_father_node_i_c[y];
+          }
+          dLicx *= larray_i_c[x];
+          dLic += dLicx;
         }
-        dLicx *= (*larray_i_c)[x];
-        dLic += dLicx;
+        dLi += rateDistribution_->getProbability(c) * dLic;
       }
-      dLi += rateDistribution_->getProbability(c) * dLic;
+      // Both likelihoods may have been scaled differently:
+      (*dLikelihoods_node)[i] = ldexp(dLi / (*rootLikelihoodsSR)[i], (*rootScaling)[i] - (*scaling_father_node)[i] - larrayScaling[i]);
     }
-    (*dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
-    // cout << dLi << "\t" << (*rootLikelihoodsSR)[i] << endl;
-  }
+  });
 }
 
 /******************************************************************************/
@@ -373,41 +409,46 @@ double DRHomogeneousTreeLikelihood::getFirstOrderDerivative(const std::string& v
 void DRHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  ConditionalLikelihoodArray likelihoods_father_node = likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble* d2pxy_node = &d2pxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray, node);
+  const vector<int>* scaling_father_node = &likelihoodData_->getScalingExponents(father->getId(), node->getId());
+  ConditionalLikelihoodBuffer larrayBuffer;
+  vector<int> larrayScaling;
+  computeLikelihoodAtNode_(father, larrayBuffer, node, &larrayScaling);
+  ConditionalLikelihoodArray larray = larrayBuffer.getArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* rootScaling = &likelihoodData_->getRootScalingExponents();
 
-  double d2Li, d2Lic, d2Licx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  ThreadPool::parallelFor(getThreadPool_(), nbDistinctSites_, [&] (size_t begin, size_t end)
   {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double d2Li, d2Lic, d2Licx;
+    for (size_t i = begin; i < end; i++)
     {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
-      d2Lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      d2Li = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* d2pxy_node_c_x = &(*d2pxy_node_c)[x];
-        d2Licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        const double* likelihoods_father_node_i_c = likelihoods_father_node(i, c);
+        const double* larray_i_c = larray(i, c);
+        VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
+        d2Lic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          d2Licx += (*d2pxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
+          Vdouble* d2pxy_node_c_x = &(*d2pxy_node_c)[x];
+          d2Licx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            d2Licx += (*d2pxy_node_c_x)[y] * likelihoods_father_node_i_c[y];
+          }
+          d2Licx *= larray_i_c[x];
+          d2Lic += d2Licx;
         }
-        d2Licx *= (*larray_i_c)[x];
-        d2Lic += d2Licx;
+        d2Li += rateDistribution_->getProbability(c) * d2Lic;
       }
-      d2Li += rateDistribution_->getProbability(c) * d2Lic;
+      // Both likelihoods may have been scaled differently:
+      (*d2Likelihoods_node)[i] = ldexp(d2Li / (*rootLikelihoodsSR)[i], (*rootScaling)[i] - (*scaling_father_node)[i] - larrayScaling[i]);
     }
-    (*d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
-  }
+  });
 }
 
 /******************************************************************************/
@@ -473,14 +514,53 @@ void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
 
 void DRHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
+  unsigned long revision = tree_->getRevision();
   computeSubtreeLikelihoodPostfix(tree_->getRootNode());
   computeSubtreeLikelihoodPrefix(tree_->getRootNode());
   computeRootLikelihood();
+  arraysRevision_ = revision;
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::updateTreeLikelihood_(const vector<const Node*>& branches)
+{
+  // Postfix arrays depend on the branches below the node only,
+  // prefix arrays of a node depend on all branches but the ones below the node and its own one.
+  set<int> postfixNodes;
+  map<int, size_t> nbBranchesBelow;
+  for (size_t i = 0; i < branches.size(); i++)
+  {
+    nbBranchesBelow[branches[i]->getId()]++;
+    for (const Node* n = branches[i]->getFather(); n; n = n->getFather())
+    {
+      postfixNodes.insert(n->getId());
+      nbBranchesBelow[n->getId()]++;
+    }
+  }
+  set<int> prefixNodes;
+  for (map<int, size_t>::const_iterator it = nbBranchesBelow.begin(); it != nbBranchesBelow.end(); it++)
+  {
+    if (it->second == branches.size())
+      prefixNodes.insert(it->first);
+  }
+
+  const Node* root = tree_->getRootNode();
+  computeSubtreeLikelihoodPostfix_(root, &postfixNodes);
+  computeSubtreeLikelihoodPrefix_(root, &prefixNodes);
+  computeRootLikelihood();
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* node)
+{
+  computeSubtreeLikelihoodPostfix_(node, 0);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix_(const Node* node, const set<int>* nodes)
 {
 //  if(node->isLeaf()) return;
 // cout << node->getId() << "\t" << (node->hasName()?node->getName():"") << endl;
@@ -488,52 +568,49 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
     return;
 
   // Set all likelihood arrays to 1 for a start:
-  resetLikelihoodArrays(node);
+  // (when only some arrays are recomputed, they are reset one by one instead)
+  if (!nodes)
+    resetLikelihoodArrays(node);
 
-  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  const DRASDRTreeLikelihoodNodeData* _likelihoods_node = &likelihoodData_->getNodeData(node->getId());
   size_t nbNodes = node->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
   {
     // For each son node...
 
     const Node* son = node->getSon(l);
-    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    if (nodes && nodes->find(son->getId()) == nodes->end())
+      continue; // This array is up to date.
+    ConditionalLikelihoodArray _likelihoods_node_son = _likelihoods_node->getLikelihoodArrayForNeighbor(son->getId());
+    vector<int>* _scaling_node_son = &likelihoodData_->getScalingExponents(node->getId(), son->getId());
 
     if (son->isLeaf())
     {
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(son->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_son_i_c = &(*_likelihoods_node_son_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            // For each initial state,
-            (*_likelihoods_node_son_i_c)[x] = (*_likelihoods_leaf_i)[x];
-          }
-        }
-      }
+      _likelihoods_node_son.copyFromLeaf(likelihoodData_->getLeafLikelihoods(son->getId()));
+      fill(_scaling_node_son->begin(), _scaling_node_son->end(), 0);
     }
     else
     {
-      computeSubtreeLikelihoodPostfix(son); // Recursive method:
+      // Recursive method:
+      if (!nodes)
+        computeSubtreeLikelihoodPostfix(son);
+      else
+        computeSubtreeLikelihoodPostfix_(son, nodes);
       size_t nbSons = son->getNumberOfSons();
-      map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
+      const DRASDRTreeLikelihoodNodeData* _likelihoods_son = &likelihoodData_->getNodeData(son->getId());
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<ConditionalLikelihoodArray> iLik(nbSons);
+      vector<const double*> tProb(nbSons);
+      vector<const vector<int>*> iExp(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* sonSon = son->getSon(n);
-        tProb[n] = &pxy_[sonSon->getId()];
-        iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
+        tProb[n] = &flatPyx_[sonSon->getId()][0];
+        iLik[n] = _likelihoods_son->getLikelihoodArrayForNeighbor(sonSon->getId());
+        iExp[n] = &likelihoodData_->getScalingExponents(son->getId(), sonSon->getId());
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      computeLikelihoodFromArrays(iLik, tProb, _likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, nodes != 0, getThreadPool_());
+      scaleLikelihoodArray_(iExp, _likelihoods_node_son, *_scaling_node_son, getThreadPool_());
     }
   }
 }
@@ -541,6 +618,13 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* node)
+{
+  computeSubtreeLikelihoodPrefix_(node, 0);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix_(const Node* node, const set<int>* upToDateNodes)
 {
   if (!node->hasFather())
   {
@@ -549,41 +633,39 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
     size_t nbSons = node->getNumberOfSons();
     for (size_t n = 0; n < nbSons; n++)
     {
-      computeSubtreeLikelihoodPrefix(node->getSon(n));
+      if (!upToDateNodes)
+        computeSubtreeLikelihoodPrefix(node->getSon(n));
+      else
+        computeSubtreeLikelihoodPrefix_(node->getSon(n), upToDateNodes);
     }
     return;
   }
+  else if (upToDateNodes && upToDateNodes->find(node->getId()) != upToDateNodes->end())
+  {
+    // This array is up to date, but not necessarily the ones of the son nodes:
+    size_t nbNodeSons = node->getNumberOfSons();
+    for (size_t i = 0; i < nbNodeSons; i++)
+    {
+      computeSubtreeLikelihoodPrefix_(node->getSon(i), upToDateNodes);
+    }
+  }
   else
   {
     const Node* father = node->getFather();
-    map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
-    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
-    if (node->isLeaf())
+    const DRASDRTreeLikelihoodNodeData* _likelihoods_father = &likelihoodData_->getNodeData(father->getId());
+    ConditionalLikelihoodArray _likelihoods_node_father = likelihoodData_->getLikelihoodArray(node->getId(), father->getId());
+    vector<int>* _scaling_node_father = &likelihoodData_->getScalingExponents(node->getId(), father->getId());
+    vector<const vector<int>*> iExp;
+    // When only some arrays are recomputed, this one was not reset by the postfix recursion:
+    if (node->isLeaf() || upToDateNodes)
     {
-      resetLikelihoodArray(*_likelihoods_node_father);
+      resetLikelihoodArray(_likelihoods_node_father);
     }
 
     if (father->isLeaf())
     {
       // If the tree is rooted by a leaf
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            // For each initial state,
-            (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
-          }
-        }
-      }
+      _likelihoods_node_father.copyFromLeaf(likelihoodData_->getLeafLikelihoods(father->getId()));
     }
     else
     {
@@ -602,23 +684,25 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
 
       size_t nbSons = nodes.size(); // In case of a bifurcating tree, this is equal to 1, excepted for the root.
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<ConditionalLikelihoodArray> iLik(nbSons);
+      vector<const double*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
+        tProb[n] = &flatPyx_[fatherSon->getId()][0];
+        iLik[n] = _likelihoods_father->getLikelihoodArrayForNeighbor(fatherSon->getId());
+        iExp.push_back(&likelihoodData_->getScalingExponents(father->getId(), fatherSon->getId()));
       }
 
       if (father->hasFather())
       {
         const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        iExp.push_back(&likelihoodData_->getScalingExponents(father->getId(), fatherFather->getId()));
+        computeLikelihoodFromArrays(iLik, tProb, _likelihoods_father->getLikelihoodArrayForNeighbor(fatherFather->getId()), &flatPxy_[father->getId()][0], _likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
       }
       else
       {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArrays(iLik, tProb, _likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
       }
     }
 
@@ -627,23 +711,27 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
       // We have to account for the root frequencies:
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+          double* _likelihoods_node_father_i_c = _likelihoods_node_father(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
-            (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
+            _likelihoods_node_father_i_c[x] *= rootFreqs_[x];
           }
         }
       }
     }
+    scaleLikelihoodArray_(iExp, _likelihoods_node_father, *_scaling_node_father, getThreadPool_());
 
     // Call the method on each son node:
     size_t nbNodeSons = node->getNumberOfSons();
     for (size_t i = 0; i < nbNodeSons; i++)
     {
-      computeSubtreeLikelihoodPrefix(node->getSon(i)); // Recursive method.
+      // Recursive method.
+      if (!upToDateNodes)
+        computeSubtreeLikelihoodPrefix(node->getSon(i));
+      else
+        computeSubtreeLikelihoodPrefix_(node->getSon(i), upToDateNodes);
     }
   }
 }
@@ -653,41 +741,31 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
 void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 {
   const Node* root = tree_->getRootNode();
-  VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
+  ConditionalLikelihoodArray rootLikelihoods = likelihoodData_->getRootLikelihoodArray();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
-    VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
-      Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*rootLikelihoods_i_c)[x] = (*leavesLikelihoods_root_i)[x];
-        }
-      }
-    }
+    rootLikelihoods.copyFromLeaf(likelihoodData_->getLeafLikelihoods(root->getId()));
   }
   else
   {
-    resetLikelihoodArray(*rootLikelihoods);
+    resetLikelihoodArray(rootLikelihoods);
   }
 
-  map<int, VVVdouble>* likelihoods_root = &likelihoodData_->getLikelihoodArrays(root->getId());
+  const DRASDRTreeLikelihoodNodeData* likelihoods_root = &likelihoodData_->getNodeData(root->getId());
   size_t nbNodes = root->getNumberOfSons();
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<ConditionalLikelihoodArray> iLik(nbNodes);
+  vector<const double*> tProb(nbNodes);
+  vector<const vector<int>*> iExp(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = root->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_root)[son->getId()];
+    tProb[n] = &flatPyx_[son->getId()][0];
+    iLik[n] = likelihoods_root->getLikelihoodArrayForNeighbor(son->getId());
+    iExp[n] = &likelihoodData_->getScalingExponents(root->getId(), son->getId());
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+  computeLikelihoodFromArrays(iLik, tProb, rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
+  scaleLikelihoodArray_(iExp, rootLikelihoods, likelihoodData_->getRootScalingExponents(), getThreadPool_());
 
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
@@ -695,19 +773,18 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
     // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
     Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
     (*rootLikelihoodsSR)[i] = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+      const double* rootLikelihoods_i_c = rootLikelihoods(i, c);
       double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
       (*rootLikelihoodsS_i_c) = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
         // For each initial state,
-        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * rootLikelihoods_i_c[x];
       }
       (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
     }
@@ -720,64 +797,39 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 
 /******************************************************************************/
 
-void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode) const
+void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodBuffer, const Node* sonNode, vector<int>* scalingExponents) const
 {
   // const Node * node = tree_->getNode(nodeId);
   int nodeId = node->getId();
-  likelihoodArray.resize(nbDistinctSites_);
-  map<int, VVVdouble>* likelihoods_node = &likelihoodData_->getLikelihoodArrays(nodeId);
+  likelihoodBuffer.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray likelihoodArray = likelihoodBuffer.getArray();
+  const DRASDRTreeLikelihoodNodeData* likelihoods_node = &likelihoodData_->getNodeData(nodeId);
 
   // Initialize likelihood array:
   if (node->isLeaf())
   {
-    VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = (*leavesLikelihoods_node_i)[x];
-        }
-      }
-    }
+    likelihoodArray.copyFromLeaf(likelihoodData_->getLeafLikelihoods(nodeId));
   }
   else
   {
     // Otherwise:
     // Set all likelihoods to 1 for a start:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = 1.;
-        }
-      }
-    }
+    likelihoodArray.fill(1.);
   }
 
   size_t nbNodes = node->getNumberOfSons();
 
-  vector<const VVVdouble*> iLik;
-  vector<const VVVdouble*> tProb;
+  vector<ConditionalLikelihoodArray> iLik;
+  vector<const double*> tProb;
+  vector<const vector<int>*> iExp;
   bool test = false;
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = node->getSon(n);
     if (son != sonNode) {
-      tProb.push_back(&pxy_[son->getId()]);
-      iLik.push_back(&(*likelihoods_node)[son->getId()]);
+      tProb.push_back(&flatPyx_[son->getId()][0]);
+      iLik.push_back(likelihoods_node->getLikelihoodArrayForNeighbor(son->getId()));
+      iExp.push_back(&likelihoodData_->getScalingExponents(nodeId, son->getId()));
     } else {
       test = true;
     }
@@ -792,157 +844,138 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    iExp.push_back(&likelihoodData_->getScalingExponents(nodeId, father->getId()));
+    computeLikelihoodFromArrays(iLik, tProb, likelihoods_node->getLikelihoodArrayForNeighbor(father->getId()), &flatPxy_[nodeId][0], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
 
     // We have to account for the equilibrium frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] *= rootFreqs_[x];
+          likelihoodArray_i_c[x] *= rootFreqs_[x];
         }
       }
     }
   }
+
+  vector<int> exponents;
+  scaleLikelihoodArray_(iExp, likelihoodArray, scalingExponents ? *scalingExponents : exponents, getThreadPool_());
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::scaleLikelihoodArray_(
+  const vector<const vector<int>*>& iExp,
+  const ConditionalLikelihoodArray& oLik,
+  vector<int>& oExp,
+  ThreadPool* pool) const
+{
+  size_t nbSites = oLik.getNumberOfSites();
+  oExp.resize(nbSites);
+  bool useScaling = likelihoodData_->isScalingEnabled();
+  ThreadPool::parallelFor(pool, nbSites, [&] (size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+    {
+      int e = 0;
+      for (size_t n = 0; n < iExp.size(); n++)
+      {
+        e += (*iExp[n])[i];
+      }
+      if (useScaling)
+        e += ConditionalLikelihoodScaling::scaleLikelihoods(oLik, i);
+      oExp[i] = e;
+    }
+  });
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
-  const vector<const VVVdouble*>& tProb,
-  VVVdouble& oLik,
+  const vector<ConditionalLikelihoodArray>& iLik,
+  const vector<const double*>& tProb,
+  const ConditionalLikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  ThreadPool* pool)
 {
   if (reset)
     resetLikelihoodArray(oLik);
 
-  for (size_t n = 0; n < nbNodes; n++)
-  {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
+  if (nbDistinctSites == 0)
+    return;
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates);
+  size_t size = nbStates * stride;
+  size_t oStep = oLik.getNumberOfClasses() * oLik.getStride();
+  ThreadPool::parallelFor(pool, nbDistinctSites, [&] (size_t begin, size_t end)
+  {
+    for (size_t n = 0; n < nbNodes; n++)
     {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
+      const ConditionalLikelihoodArray* iLik_n = &iLik[n];
+      size_t iStep = iLik_n->getNumberOfClasses() * iLik_n->getStride();
       for (size_t c = 0; c < nbClasses; c++)
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
+        // For each rate classe, process all sites of the chunk at once:
+        LikelihoodKernels::multiplyTransitionProducts(
+            tProb[n] + c * size, stride,
+            (*iLik_n)(begin, c), iStep,
+            oLik(begin, c), oStep,
+            end - begin, nbStates);
       }
     }
-  }
+  });
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
-  const vector<const VVVdouble*>& tProb,
-  const VVVdouble* iLikR,
-  const VVVdouble* tProbR,
-  VVVdouble& oLik,
+  const vector<ConditionalLikelihoodArray>& iLik,
+  const vector<const double*>& tProb,
+  const ConditionalLikelihoodArray& iLikR,
+  const double* tProbR,
+  const ConditionalLikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  ThreadPool* pool)
 {
-  if (reset)
-    resetLikelihoodArray(oLik);
+  computeLikelihoodFromArrays(iLik, tProb, oLik, nbNodes, nbDistinctSites, nbClasses, nbStates, reset, pool);
 
-  for (size_t n = 0; n < nbNodes; n++)
-  {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
-
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
+  if (nbDistinctSites == 0)
+    return;
 
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
-  }
+  // Now deal with the subtree containing the root.
+  // Here the father's array is used, so the transition matrix is not transposed:
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates);
+  size_t size = nbStates * stride;
 
-  // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
+  size_t iStep = iLikR.getNumberOfClasses() * iLikR.getStride();
+  size_t oStep = oLik.getNumberOfClasses() * oLik.getStride();
+  ThreadPool::parallelFor(pool, nbDistinctSites, [&] (size_t begin, size_t end)
   {
-    // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
-
     for (size_t c = 0; c < nbClasses; c++)
     {
       // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
-      {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
-        {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
-        }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
-      }
+      LikelihoodKernels::multiplyTransitionProducts(
+          tProbR + c * size, stride,
+          iLikR(begin, c), iStep,
+          oLik(begin, c), oStep,
+          end - begin, nbStates);
     }
-  }
+  });
 }
 
 /******************************************************************************/
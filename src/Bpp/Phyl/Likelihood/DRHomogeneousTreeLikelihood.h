@@ -47,6 +47,10 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <set>
+#include <cmath>
+
 namespace bpp
 {
 
@@ -58,6 +62,10 @@ namespace bpp
  * A non-uniform distribution of rates among the sites is allowed (ASRV models).</p>
  *
  * This class uses an instance of the DRASDRTreeLikelihoodData for conditionnal likelihood storage.
+ * Conditional likelihoods are rescaled when they get too small, so that large trees can be analysed
+ * without numerical underflow (see DRASDRTreeLikelihoodData). Log-likelihoods and their derivatives
+ * are computed from the scaled values, while methods returning likelihoods, including
+ * computeLikelihoodAtNode(), correct for scaling, and may therefore return 0 for very large trees.
  *
  * All nodes share the same site patterns.
  */
@@ -68,6 +76,12 @@ class DRHomogeneousTreeLikelihood:
   private:
     mutable DRASDRTreeLikelihoodData* likelihoodData_;
 
+    /**
+     * @brief The value of TreeTemplate::getRevision() for tree_ when likelihood arrays were last computed for the whole tree,
+     * or 0 if they are not valid.
+     */
+    unsigned long arraysRevision_;
+
   protected:
     double minusLogLik_;
     
@@ -204,13 +218,57 @@ class DRHomogeneousTreeLikelihood:
     DRASDRTreeLikelihoodData* getLikelihoodData() { return likelihoodData_; }
     const DRASDRTreeLikelihoodData* getLikelihoodData() const { return likelihoodData_; }
   
+    /**
+     * @brief Compute the likelihood array at a given node.
+     *
+     * The values are corrected for scaling, and may therefore be 0 for very large trees.
+     */
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const
     {
-      computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
+      ConditionalLikelihoodBuffer buffer;
+      std::vector<int> scalingExponents;
+      computeLikelihoodAtNode_(tree_->getNode(nodeId), buffer, 0, &scalingExponents);
+      buffer.getArray().toVVVdouble(likelihoodArray);
+      for (size_t i = 0; i < likelihoodArray.size(); i++)
+      {
+        if (scalingExponents[i] == 0) continue;
+        for (size_t c = 0; c < likelihoodArray[i].size(); c++)
+        {
+          for (size_t x = 0; x < likelihoodArray[i][c].size(); x++)
+          {
+            likelihoodArray[i][c][x] = ldexp(likelihoodArray[i][c][x], -scalingExponents[i]);
+          }
+        }
+      }
     }
       
   protected:
-    virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
+    /**
+     * @brief Compute the likelihood array at a given node.
+     *
+     * @param node The node to consider.
+     * @param likelihoodArray The buffer where to store the results. It will be resized if needed.
+     * @param sonNode If not null, the subtree defined by this son node is not accounted for.
+     * @param scalingExponents If not null, where to store the scaling exponent of each site of the results.
+     */
+    virtual void computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodArray, const Node* sonNode = 0, std::vector<int>* scalingExponents = 0) const;
+
+    /**
+     * @brief Set the scaling exponents of a computed likelihood array, and rescale it if needed.
+     *
+     * The exponent of each site is the sum of the exponents of the arrays it was computed from,
+     * plus the exponent used to rescale it, if scaling is enabled.
+     *
+     * @param iExp The scaling exponents of the arrays used to compute the array.
+     * @param oLik The computed likelihood array.
+     * @param oExp Where to store the scaling exponents of the array.
+     * @param pool A thread pool used to process sites in parallel, or 0 for a sequential computation.
+     */
+    void scaleLikelihoodArray_(
+        const std::vector<const std::vector<int>*>& iExp,
+        const ConditionalLikelihoodArray& oLik,
+        std::vector<int>& oExp,
+        ThreadPool* pool) const;
   
     /**
      * Initialize the arrays corresponding to each son node for the node passed as argument.
@@ -226,6 +284,30 @@ class DRHomogeneousTreeLikelihood:
 
     virtual void computeRootLikelihood();
 
+    /**
+     * @brief Update likelihood arrays after a change of some branch lengths only.
+     *
+     * Postfix arrays are recomputed for the ancestors of the modified branches only.
+     * Prefix arrays are recomputed for all nodes but the ones which are ancestors of all modified branches
+     * (including the modified nodes themselves), as their value does not depend on these branches.
+     *
+     * @param branches The nodes defining the modified branches.
+     */
+    void updateTreeLikelihood_(const std::vector<const Node*>& branches);
+
+    /**
+     * @name Recursions restricted to some nodes.
+     *
+     * @param node          The root of the subtree.
+     * @param nodes         For the postfix recursion, the ids of the nodes whose arrays must be recomputed.
+     * @param upToDateNodes For the prefix recursion, the ids of the nodes whose arrays must not be recomputed.
+     * In both cases, all arrays are recomputed if 0.
+     * @{
+     */
+    void computeSubtreeLikelihoodPostfix_(const Node* node, const std::set<int>* nodes);
+    void computeSubtreeLikelihoodPrefix_(const Node* node, const std::set<int>* upToDateNodes);
+    /** @} */
+
     virtual void computeTreeDLikelihoodAtNode(const Node* node);
     virtual void computeTreeDLikelihoods();
     
@@ -252,6 +334,7 @@ class DRHomogeneousTreeLikelihood:
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
      * @param tProb A vector of transition probabilities, one for each node.
+     * Each one points toward the matrices of all rate classes, as stored in flatPyx_.
      * @param oLik The likelihood array to store the computed likelihoods.
      * @param nbNodes The number of nodes = the size of the input vectors.
      * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
@@ -259,15 +342,17 @@ class DRHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param pool A thread pool used to process sites in parallel, or 0 for a sequential computation.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
-        const std::vector<const VVVdouble*>& tProb,
-        VVVdouble& oLik, size_t nbNodes,
+        const std::vector<ConditionalLikelihoodArray>& iLik,
+        const std::vector<const double*>& tProb,
+        const ConditionalLikelihoodArray& oLik, size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        ThreadPool* pool = 0);
 
     /**
      * @brief Compute conditional likelihoods.
@@ -279,8 +364,10 @@ class DRHomogeneousTreeLikelihood:
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
      * @param tProb A vector of transition probabilities, one for each node.
+     * Each one points toward the matrices of all rate classes, as stored in flatPyx_.
      * @param iLikR The likelihood array for the subtree containing the root of the tree.
-     * @param tProbR The transition probabilities for thr subtree containing the root of the tree.
+     * @param tProbR The transition probabilities for thr subtree containing the root of the tree,
+     * as stored in flatPxy_.
      * @param oLik The likelihood array to store the computed likelihoods.
      * @param nbNodes The number of nodes = the size of the input vectors.
      * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
@@ -288,18 +375,20 @@ class DRHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param pool A thread pool used to process sites in parallel, or 0 for a sequential computation.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
-        const std::vector<const VVVdouble*>& tProb,
-        const VVVdouble* iLikR,
-        const VVVdouble* tProbR,
-        VVVdouble& oLik,
+        const std::vector<ConditionalLikelihoodArray>& iLik,
+        const std::vector<const double*>& tProb,
+        const ConditionalLikelihoodArray& iLikR,
+        const double* tProbR,
+        const ConditionalLikelihoodArray& oLik,
         size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        ThreadPool* pool = 0);
 
   friend class DRHomogeneousMixedTreeLikelihood;
 };
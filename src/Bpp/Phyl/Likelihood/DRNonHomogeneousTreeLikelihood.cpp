@@ -38,6 +38,7 @@
  */
 
 #include "DRNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -98,6 +99,8 @@ void DRNonHomogeneousTreeLikelihood::init_()
   likelihoodData_ = new DRASDRTreeLikelihoodData(
     tree_,
     rateDistribution_->getNumberOfCategories());
+  // Scaling is only supported by DRHomogeneousTreeLikelihood:
+  likelihoodData_->enableScaling(false);
 }
 
 /******************************************************************************/
@@ -312,46 +315,48 @@ double DRNonHomogeneousTreeLikelihood::getValue() const
 void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* _likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  ConditionalLikelihoodArray _likelihoods_father_node = likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* _dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
   VVVdouble*  pxy__node = &pxy_[node->getId()];
   VVVdouble* dpxy__node = &dpxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray);
+  ConditionalLikelihoodBuffer larrayBuffer;
+  computeLikelihoodAtNode_(father, larrayBuffer);
+  ConditionalLikelihoodArray larray = larrayBuffer.getArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
-  double dLi, dLic, dLicx, numerator, denominator;
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  ThreadPool::parallelFor(getThreadPool_(), nbDistinctSites_, [&] (size_t begin, size_t end)
   {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double dLi, dLic, dLicx, numerator, denominator;
+    for (size_t i = begin; i < end; i++)
     {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble*  pxy__node_c = &(*pxy__node)[c];
-      VVdouble* dpxy__node_c = &(*dpxy__node)[c];
-      dLic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      dLi = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        numerator = 0;
-        denominator = 0;
-        Vdouble*  pxy__node_c_x = &(*pxy__node_c)[x];
-        Vdouble* dpxy__node_c_x = &(*dpxy__node_c)[x];
-        dLicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        const double* _likelihoods_father_node_i_c = _likelihoods_father_node(i, c);
+        const double* larray_i_c = larray(i, c);
+        VVdouble*  pxy__node_c = &(*pxy__node)[c];
+        VVdouble* dpxy__node_c = &(*dpxy__node)[c];
+        dLic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          numerator   += (*dpxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          numerator = 0;
+          denominator = 0;
+          Vdouble*  pxy__node_c_x = &(*pxy__node_c)[x];
+          Vdouble* dpxy__node_c_x = &(*dpxy__node_c)[x];
+          dLicx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            numerator   += (*dpxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+            denominator += (*pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+          }
+          dLicx = denominator == 0. ? 0. : larray_i_c[x] * numerator / denominator;
+          dLic += dLicx;
         }
-        dLicx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
-        dLic += dLicx;
+        dLi += rateDistribution_->getProbability(c) * dLic;
       }
-      dLi += rateDistribution_->getProbability(c) * dLic;
+      (*_dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
     }
-    (*_dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
-  }
+  });
 }
 
 /******************************************************************************/
@@ -439,47 +444,48 @@ double DRNonHomogeneousTreeLikelihood::getFirstOrderDerivative(const string& var
 void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
   const Node* father = node->getFather();
-  VVVdouble* _likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  ConditionalLikelihoodArray _likelihoods_father_node = likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
   Vdouble* _d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
   VVVdouble*   pxy__node = &pxy_[node->getId()];
   VVVdouble* d2pxy__node = &d2pxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray);
+  ConditionalLikelihoodBuffer larrayBuffer;
+  computeLikelihoodAtNode_(father, larrayBuffer);
+  ConditionalLikelihoodArray larray = larrayBuffer.getArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
-  double d2Li, d2Lic, d2Licx, numerator, denominator;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  ThreadPool::parallelFor(getThreadPool_(), nbDistinctSites_, [&] (size_t begin, size_t end)
   {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    double d2Li, d2Lic, d2Licx, numerator, denominator;
+    for (size_t i = begin; i < end; i++)
     {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble*   pxy__node_c = &(*pxy__node)[c];
-      VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
-      d2Lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+      d2Li = 0;
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        numerator = 0;
-        denominator = 0;
-        Vdouble*   pxy__node_c_x = &(*pxy__node_c)[x];
-        Vdouble* d2pxy__node_c_x = &(*d2pxy__node_c)[x];
-        d2Licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        const double* _likelihoods_father_node_i_c = _likelihoods_father_node(i, c);
+        const double* larray_i_c = larray(i, c);
+        VVdouble*   pxy__node_c = &(*pxy__node)[c];
+        VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
+        d2Lic = 0;
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          numerator   += (*d2pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          numerator = 0;
+          denominator = 0;
+          Vdouble*   pxy__node_c_x = &(*pxy__node_c)[x];
+          Vdouble* d2pxy__node_c_x = &(*d2pxy__node_c)[x];
+          d2Licx = 0;
+          for (size_t y = 0; y < nbStates_; y++)
+          {
+            numerator   += (*d2pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+            denominator += (*pxy__node_c_x)[y] * _likelihoods_father_node_i_c[y];
+          }
+          d2Licx = denominator == 0. ? 0. : larray_i_c[x] * numerator / denominator;
+          d2Lic += d2Licx;
         }
-        d2Licx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
-        d2Lic += d2Licx;
+        d2Li += rateDistribution_->getProbability(c) * d2Lic;
       }
-      d2Li += rateDistribution_->getProbability(c) * d2Lic;
+      (*_d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
     }
-    (*_d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
-  }
+  });
 }
 
 /******************************************************************************/
@@ -550,8 +556,8 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
 
       if (son->getId() == root1_)
       {
-        VVVdouble* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodArray(father->getId(), root1_);
-        VVVdouble* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodArray(father->getId(), root2_);
+        ConditionalLikelihoodArray _likelihoodsroot1_ = likelihoodData_->getLikelihoodArray(father->getId(), root1_);
+        ConditionalLikelihoodArray _likelihoodsroot2_ = likelihoodData_->getLikelihoodArray(father->getId(), root2_);
         double pos = getParameterValue("RootPosition");
 
         VVVdouble* d2pxy_root1_ = &d2pxy_[root1_];
@@ -562,14 +568,12 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
         VVVdouble* pxy_root2_   = &pxy_[root2_];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[i];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+            const double* _likelihoodsroot1__i_c = _likelihoodsroot1_(i, c);
+            const double* _likelihoodsroot2__i_c = _likelihoodsroot2_(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
@@ -589,12 +593,12 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
               double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
               for (size_t y = 0; y < nbStates_; y++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                d2l1 += (*d2pxy_root1__c_x)[y] * _likelihoodsroot1__i_c[y];
+                d2l2 += (*d2pxy_root2__c_x)[y] * _likelihoodsroot2__i_c[y];
+                dl1  += (*dpxy_root1__c_x)[y]  * _likelihoodsroot1__i_c[y];
+                dl2  += (*dpxy_root2__c_x)[y]  * _likelihoodsroot2__i_c[y];
+                l1   += (*pxy_root1__c_x)[y]   * _likelihoodsroot1__i_c[y];
+                l2   += (*pxy_root2__c_x)[y]   * _likelihoodsroot2__i_c[y];
               }
               double dl = pos * dl1 * l2 + (1. - pos) * dl2 * l1;
               double d2l = pos * pos * d2l1 * l2 + (1. - pos) * (1. - pos) * d2l2 * l1 + 2 * pos * (1. - pos) * dl1 * dl2;
@@ -611,17 +615,16 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
       else
       {
         // Account for a putative multifurcation:
-        VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
+        ConditionalLikelihoodArray _likelihoods_son = likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            const double* _likelihoods_son_i_c = _likelihoods_son(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* pxy__son_c = &(*pxy__son)[c];
@@ -631,7 +634,7 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
               Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
               for (size_t y = 0; y < nbStates_; y++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                dl += (*pxy__son_c_x)[y] * _likelihoods_son_i_c[y];
               }
               (*dLikelihoods_father_i_c)[x] *= dl;
               (*d2Likelihoods_father_i_c)[x] *= dl;
@@ -696,8 +699,8 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
 
       if (son->getId() == root1_)
       {
-        VVVdouble* _likelihoodsroot1_ = &likelihoodData_->getLikelihoodArray(father->getId(), root1_);
-        VVVdouble* _likelihoodsroot2_ = &likelihoodData_->getLikelihoodArray(father->getId(), root2_);
+        ConditionalLikelihoodArray _likelihoodsroot1_ = likelihoodData_->getLikelihoodArray(father->getId(), root1_);
+        ConditionalLikelihoodArray _likelihoodsroot2_ = likelihoodData_->getLikelihoodArray(father->getId(), root2_);
         double len = getParameterValue("BrLenRoot");
 
         VVVdouble* d2pxy_root1_ = &d2pxy_[root1_];
@@ -708,14 +711,12 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
         VVVdouble* pxy_root2_   = &pxy_[root2_];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[i];
-          VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoodsroot1__i_c = &(*_likelihoodsroot1__i)[c];
-            Vdouble* _likelihoodsroot2__i_c = &(*_likelihoodsroot2__i)[c];
+            const double* _likelihoodsroot1__i_c = _likelihoodsroot1_(i, c);
+            const double* _likelihoodsroot2__i_c = _likelihoodsroot2_(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* d2pxy_root1__c = &(*d2pxy_root1_)[c];
@@ -735,12 +736,12 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
               double d2l1 = 0, d2l2 = 0, dl1 = 0, dl2 = 0, l1 = 0, l2 = 0;
               for (size_t y = 0; y < nbStates_; y++)
               {
-                d2l1 += (*d2pxy_root1__c_x)[y] * (*_likelihoodsroot1__i_c)[y];
-                d2l2 += (*d2pxy_root2__c_x)[y] * (*_likelihoodsroot2__i_c)[y];
-                dl1  += (*dpxy_root1__c_x)[y]  * (*_likelihoodsroot1__i_c)[y];
-                dl2  += (*dpxy_root2__c_x)[y]  * (*_likelihoodsroot2__i_c)[y];
-                l1   += (*pxy_root1__c_x)[y]   * (*_likelihoodsroot1__i_c)[y];
-                l2   += (*pxy_root2__c_x)[y]   * (*_likelihoodsroot2__i_c)[y];
+                d2l1 += (*d2pxy_root1__c_x)[y] * _likelihoodsroot1__i_c[y];
+                d2l2 += (*d2pxy_root2__c_x)[y] * _likelihoodsroot2__i_c[y];
+                dl1  += (*dpxy_root1__c_x)[y]  * _likelihoodsroot1__i_c[y];
+                dl2  += (*dpxy_root2__c_x)[y]  * _likelihoodsroot2__i_c[y];
+                l1   += (*pxy_root1__c_x)[y]   * _likelihoodsroot1__i_c[y];
+                l2   += (*pxy_root2__c_x)[y]   * _likelihoodsroot2__i_c[y];
               }
               double dl = len * (dl1 * l2 - dl2 * l1);
               double d2l = len * len * (d2l1 * l2 + d2l2 * l1 - 2 * dl1 * dl2);
@@ -757,17 +758,16 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
       else
       {
         // Account for a putative multifurcation:
-        VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
+        ConditionalLikelihoodArray _likelihoods_son = likelihoodData_->getLikelihoodArray(father->getId(), son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
         for (size_t i = 0; i < nbDistinctSites_; i++)
         {
-          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[i];
           VVdouble* dLikelihoods_father_i = &dLikelihoods_father[i];
           VVdouble* d2Likelihoods_father_i = &d2Likelihoods_father[i];
           for (size_t c = 0; c < nbClasses_; c++)
           {
-            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            const double* _likelihoods_son_i_c = _likelihoods_son(i, c);
             Vdouble* dLikelihoods_father_i_c = &(*dLikelihoods_father_i)[c];
             Vdouble* d2Likelihoods_father_i_c = &(*d2Likelihoods_father_i)[c];
             VVdouble* pxy__son_c = &(*pxy__son)[c];
@@ -777,7 +777,7 @@ double DRNonHomogeneousTreeLikelihood::getSecondOrderDerivative(const string& va
               Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
               for (size_t y = 0; y < nbStates_; y++)
               {
-                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+                dl += (*pxy__son_c_x)[y] * _likelihoods_son_i_c[y];
               }
               (*dLikelihoods_father_i_c)[x] *= dl;
               (*d2Likelihoods_father_i_c)[x] *= dl;
@@ -862,50 +862,34 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
   // Set all likelihood arrays to 1 for a start:
   resetLikelihoodArrays(node);
 
-  map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  const DRASDRTreeLikelihoodNodeData* _likelihoods_node = &likelihoodData_->getNodeData(node->getId());
   size_t nbNodes = node->getNumberOfSons();
   for (size_t l = 0; l < nbNodes; l++)
   {
     // For each son node...
 
     const Node* son = node->getSon(l);
-    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    ConditionalLikelihoodArray _likelihoods_node_son = _likelihoods_node->getLikelihoodArrayForNeighbor(son->getId());
 
     if (son->isLeaf())
     {
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(son->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_son_i = &(*_likelihoods_node_son)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_son_i_c = &(*_likelihoods_node_son_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            // For each initial state,
-            (*_likelihoods_node_son_i_c)[x] = (*_likelihoods_leaf_i)[x];
-          }
-        }
-      }
+      _likelihoods_node_son.copyFromLeaf(likelihoodData_->getLeafLikelihoods(son->getId()));
     }
     else
     {
       computeSubtreeLikelihoodPostfix(son); // Recursive method:
       size_t nbSons = son->getNumberOfSons();
-      map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
+      const DRASDRTreeLikelihoodNodeData* _likelihoods_son = &likelihoodData_->getNodeData(son->getId());
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<ConditionalLikelihoodArray> iLik(nbSons);
+      vector<const double*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* sonSon = son->getSon(n);
-        tProb[n] = &pxy_[sonSon->getId()];
-        iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
+        tProb[n] = &flatPyx_[sonSon->getId()][0];
+        iLik[n] = _likelihoods_son->getLikelihoodArrayForNeighbor(sonSon->getId());
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      computeLikelihoodFromArrays(iLik, tProb, _likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
     }
   }
 }
@@ -928,34 +912,17 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
   else
   {
     const Node* father = node->getFather();
-    map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
-    map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
+    const DRASDRTreeLikelihoodNodeData* _likelihoods_father = &likelihoodData_->getNodeData(father->getId());
+    ConditionalLikelihoodArray _likelihoods_node_father = likelihoodData_->getLikelihoodArray(node->getId(), father->getId());
     if (node->isLeaf())
     {
-      resetLikelihoodArray(*_likelihoods_node_father);
+      resetLikelihoodArray(_likelihoods_node_father);
     }
 
     if (father->isLeaf())
     {
       // If the tree is rooted by a leaf
-      VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
-      {
-        // For each site in the sequence,
-        Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          // For each rate classe,
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            // For each initial state,
-            (*_likelihoods_node_father_i_c)[x] = (*_likelihoods_leaf_i)[x];
-          }
-        }
-      }
+      _likelihoods_node_father.copyFromLeaf(likelihoodData_->getLeafLikelihoods(father->getId()));
     }
     else
     {
@@ -974,23 +941,23 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
 
       size_t nbSons = nodes.size(); // In case of a bifurcating tree this is equal to 1.
 
-      vector<const VVVdouble*> iLik(nbSons);
-      vector<const VVVdouble*> tProb(nbSons);
+      vector<ConditionalLikelihoodArray> iLik(nbSons);
+      vector<const double*> tProb(nbSons);
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
+        tProb[n] = &flatPyx_[fatherSon->getId()][0];
+        iLik[n] = _likelihoods_father->getLikelihoodArrayForNeighbor(fatherSon->getId());
       }
 
       if (father->hasFather())
       {
         const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArrays(iLik, tProb, _likelihoods_father->getLikelihoodArrayForNeighbor(fatherFather->getId()), &flatPxy_[father->getId()][0], _likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
       }
       else
       {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArrays(iLik, tProb, _likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
       }
     }
 
@@ -999,13 +966,12 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
       // We have to account for the root frequencies:
       for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
         {
-          Vdouble* _likelihoods_node_father_i_c = &(*_likelihoods_node_father_i)[c];
+          double* _likelihoods_node_father_i_c = _likelihoods_node_father(i, c);
           for (size_t x = 0; x < nbStates_; x++)
           {
-            (*_likelihoods_node_father_i_c)[x] *= rootFreqs_[x];
+            _likelihoods_node_father_i_c[x] *= rootFreqs_[x];
           }
         }
       }
@@ -1025,41 +991,28 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
 void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
 {
   const Node* root = tree_->getRootNode();
-  VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
+  ConditionalLikelihoodArray rootLikelihoods = likelihoodData_->getRootLikelihoodArray();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
-    VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
-      Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*rootLikelihoods_i_c)[x] = (*leavesLikelihoods_root_i)[x];
-        }
-      }
-    }
+    rootLikelihoods.copyFromLeaf(likelihoodData_->getLeafLikelihoods(root->getId()));
   }
   else
   {
-    resetLikelihoodArray(*rootLikelihoods);
+    resetLikelihoodArray(rootLikelihoods);
   }
 
-  map<int, VVVdouble>* likelihoods_root = &likelihoodData_->getLikelihoodArrays(root->getId());
+  const DRASDRTreeLikelihoodNodeData* likelihoods_root = &likelihoodData_->getNodeData(root->getId());
   size_t nbNodes = root->getNumberOfSons();
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<ConditionalLikelihoodArray> iLik(nbNodes);
+  vector<const double*> tProb(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = root->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_root)[son->getId()];
+    tProb[n] = &flatPyx_[son->getId()][0];
+    iLik[n] = likelihoods_root->getLikelihoodArrayForNeighbor(son->getId());
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+  computeLikelihoodFromArrays(iLik, tProb, rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
 
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
@@ -1067,19 +1020,18 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
     // For each site in the sequence,
-    VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
     Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
     (*rootLikelihoodsSR)[i] = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       // For each rate classe,
-      Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
+      const double* rootLikelihoods_i_c = rootLikelihoods(i, c);
       double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
       (*rootLikelihoodsS_i_c) = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
         // For each initial state,
-        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * rootLikelihoods_i_c[x];
       }
       (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
     }
@@ -1092,83 +1044,55 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
 
 /******************************************************************************/
 
-void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray) const
+void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodBuffer) const
 {
 //  const Node * node = tree_->getNode(nodeId);
   int nodeId = node->getId();
-  likelihoodArray.resize(nbDistinctSites_);
-  map<int, VVVdouble>* likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
+  likelihoodBuffer.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray likelihoodArray = likelihoodBuffer.getArray();
+  const DRASDRTreeLikelihoodNodeData* likelihoods_node = &likelihoodData_->getNodeData(node->getId());
 
   // Initialize likelihood array:
   if (node->isLeaf())
   {
-    VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = (*leavesLikelihoods_node_i)[x];
-        }
-      }
-    }
+    likelihoodArray.copyFromLeaf(likelihoodData_->getLeafLikelihoods(nodeId));
   }
   else
   {
     // Otherwise:
     // Set all likelihoods to 1 for a start:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
-    {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
-      likelihoodArray_i->resize(nbClasses_);
-      for (size_t c = 0; c < nbClasses_; c++)
-      {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
-        likelihoodArray_i_c->resize(nbStates_);
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          (*likelihoodArray_i_c)[x] = 1.;
-        }
-      }
-    }
+    likelihoodArray.fill(1.);
   }
 
   size_t nbNodes = node->getNumberOfSons();
 
-  vector<const VVVdouble*> iLik(nbNodes);
-  vector<const VVVdouble*> tProb(nbNodes);
+  vector<ConditionalLikelihoodArray> iLik(nbNodes);
+  vector<const double*> tProb(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = node->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_node)[son->getId()];
+    tProb[n] = &flatPyx_[son->getId()][0];
+    iLik[n] = likelihoods_node->getLikelihoodArrayForNeighbor(son->getId());
   }
 
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoods_node->getLikelihoodArrayForNeighbor(father->getId()), &flatPxy_[nodeId][0], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false, getThreadPool_());
 
     // We have to account for the root frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      VVdouble* likelihoodArray_i = &likelihoodArray[i];
       for (size_t c = 0; c < nbClasses_; c++)
       {
-        Vdouble* likelihoodArray_i_c = &(*likelihoodArray_i)[c];
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*likelihoodArray_i_c)[x] *= rootFreqs_[x];
+          likelihoodArray_i_c[x] *= rootFreqs_[x];
         }
       }
     }
@@ -1178,132 +1102,83 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
 /******************************************************************************/
 
 void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
-  const vector<const VVVdouble*>& tProb,
-  VVVdouble& oLik,
+  const vector<ConditionalLikelihoodArray>& iLik,
+  const vector<const double*>& tProb,
+  const ConditionalLikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  ThreadPool* pool)
 {
   if (reset)
     resetLikelihoodArray(oLik);
 
-  for (size_t n = 0; n < nbNodes; n++)
-  {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
+  if (nbDistinctSites == 0)
+    return;
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates);
+  size_t size = nbStates * stride;
+  size_t oStep = oLik.getNumberOfClasses() * oLik.getStride();
+  ThreadPool::parallelFor(pool, nbDistinctSites, [&] (size_t begin, size_t end)
+  {
+    for (size_t n = 0; n < nbNodes; n++)
     {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
-
+      const ConditionalLikelihoodArray* iLik_n = &iLik[n];
+      size_t iStep = iLik_n->getNumberOfClasses() * iLik_n->getStride();
       for (size_t c = 0; c < nbClasses; c++)
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
+        // For each rate classe, process all sites of the chunk at once:
+        LikelihoodKernels::multiplyTransitionProducts(
+            tProb[n] + c * size, stride,
+            (*iLik_n)(begin, c), iStep,
+            oLik(begin, c), oStep,
+            end - begin, nbStates);
       }
     }
-  }
+  });
 }
 
 /******************************************************************************/
 
 void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
-  const vector<const VVVdouble*>& iLik,
-  const vector<const VVVdouble*>& tProb,
-  const VVVdouble* iLikR,
-  const VVVdouble* tProbR,
-  VVVdouble& oLik,
+  const vector<ConditionalLikelihoodArray>& iLik,
+  const vector<const double*>& tProb,
+  const ConditionalLikelihoodArray& iLikR,
+  const double* tProbR,
+  const ConditionalLikelihoodArray& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
-  bool reset)
+  bool reset,
+  ThreadPool* pool)
 {
-  if (reset)
-    resetLikelihoodArray(oLik);
+  computeLikelihoodFromArrays(iLik, tProb, oLik, nbNodes, nbDistinctSites, nbClasses, nbStates, reset, pool);
 
-  for (size_t n = 0; n < nbNodes; n++)
-  {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
+  if (nbDistinctSites == 0)
+    return;
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
+  // Now deal with the subtree containing the root.
+  // Here the father's array is used, so the transition matrix is not transposed:
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates);
+  size_t size = nbStates * stride;
 
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
-      }
-    }
-  }
-
-  // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
+  size_t iStep = iLikR.getNumberOfClasses() * iLikR.getStride();
+  size_t oStep = oLik.getNumberOfClasses() * oLik.getStride();
+  ThreadPool::parallelFor(pool, nbDistinctSites, [&] (size_t begin, size_t end)
   {
-    // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
-
     for (size_t c = 0; c < nbClasses; c++)
     {
       // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
-      {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
-        {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
-        }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
-      }
+      LikelihoodKernels::multiplyTransitionProducts(
+          tProbR + c * size, stride,
+          iLikR(begin, c), iStep,
+          oLik(begin, c), oStep,
+          end - begin, nbStates);
     }
-  }
+  });
 }
 
 /******************************************************************************/
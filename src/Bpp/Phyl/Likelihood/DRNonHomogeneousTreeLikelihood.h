@@ -208,11 +208,19 @@ class DRNonHomogeneousTreeLikelihood:
   
     virtual void computeLikelihoodAtNode(int nodeId, VVVdouble& likelihoodArray) const
     {
-      computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
+      ConditionalLikelihoodBuffer buffer;
+      computeLikelihoodAtNode_(tree_->getNode(nodeId), buffer);
+      buffer.getArray().toVVVdouble(likelihoodArray);
     }
       
   protected:
-    virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray) const;
+    /**
+     * @brief Compute the likelihood array at a given node.
+     *
+     * @param node The node to consider.
+     * @param likelihoodArray The buffer where to store the results. It will be resized if needed.
+     */
+    virtual void computeLikelihoodAtNode_(const Node* node, ConditionalLikelihoodBuffer& likelihoodArray) const;
 
   
     /**
@@ -255,6 +263,7 @@ class DRNonHomogeneousTreeLikelihood:
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
      * @param tProb A vector of transition probabilities, one for each node.
+     * Each one points toward the matrices of all rate classes, as stored in flatPyx_.
      * @param oLik The likelihood array to store the computed likelihoods.
      * @param nbNodes The number of nodes = the size of the input vectors.
      * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
@@ -262,15 +271,17 @@ class DRNonHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param pool A thread pool used to process sites in parallel, or 0 for a sequential computation.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
-        const std::vector<const VVVdouble*>& tProb,
-        VVVdouble& oLik, size_t nbNodes,
+        const std::vector<ConditionalLikelihoodArray>& iLik,
+        const std::vector<const double*>& tProb,
+        const ConditionalLikelihoodArray& oLik, size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        ThreadPool* pool = 0);
 
     /**
      * @brief Compute conditional likelihoods.
@@ -282,8 +293,10 @@ class DRNonHomogeneousTreeLikelihood:
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
      * @param tProb A vector of transition probabilities, one for each node.
+     * Each one points toward the matrices of all rate classes, as stored in flatPyx_.
      * @param iLikR The likelihood array for the subtree containing the root of the tree.
-     * @param tProbR The transition probabilities for thr subtree containing the root of the tree.
+     * @param tProbR The transition probabilities for thr subtree containing the root of the tree,
+     * as stored in flatPxy_.
      * @param oLik The likelihood array to store the computed likelihoods.
      * @param nbNodes The number of nodes = the size of the input vectors.
      * @param nbDistinctSites The number of distinct sites (the first dimension of the likelihood array).
@@ -291,18 +304,20 @@ class DRNonHomogeneousTreeLikelihood:
      * @param nbStates The number of states (the third dimension of the likelihood array).
      * @param reset Tell if the output likelihood array must be initalized prior to computation.
      * If true, the resetLikelihoodArray method will be called.
+     * @param pool A thread pool used to process sites in parallel, or 0 for a sequential computation.
      */
     static void computeLikelihoodFromArrays(
-        const std::vector<const VVVdouble*>& iLik,
-        const std::vector<const VVVdouble*>& tProb,
-        const VVVdouble* iLikR,
-        const VVVdouble* tProbR,
-        VVVdouble& oLik,
+        const std::vector<ConditionalLikelihoodArray>& iLik,
+        const std::vector<const double*>& tProb,
+        const ConditionalLikelihoodArray& iLikR,
+        const double* tProbR,
+        const ConditionalLikelihoodArray& oLik,
         size_t nbNodes,
         size_t nbDistinctSites,
         size_t nbClasses,
         size_t nbStates,
-        bool reset = true);
+        bool reset = true,
+        ThreadPool* pool = 0);
 
   friend class DRNonHomogeneousMixedTreeLikelihood;
 };
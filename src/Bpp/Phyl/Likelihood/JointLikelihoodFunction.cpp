@@ -20,6 +20,7 @@
 #include <Bpp/Phyl/Likelihood/RASTools.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedGraphTreeLikelihood.h>
 #include <Bpp/Phyl/App/PhylogeneticsApplicationTools.h>
 #include <Bpp/Phyl/OptimizationTools.h>
 #include <Bpp/Phyl/Model/SubstitutionModelSetTools.h>
@@ -28,6 +29,7 @@
 #include <Bpp/Phyl/Model/Codon/RELAX.h>
 #include <Bpp/Phyl/Io/Newick.h>
 #include <Bpp/Phyl/Mapping/StochasticMapping.h>
+#include <Bpp/Phyl/ThreadPool.h>
 
 // From bpp-seq:
 #include <Bpp/Seq/Container/SiteContainer.h>
@@ -44,6 +46,9 @@
 #include <algorithm>    // std::min
 #include <limits>       // std::numeric_limits (for -inf setting)
 #include <map>
+#include <memory>
+#include <atomic>
+#include <set>
 
 using namespace bpp;
 using namespace std;
@@ -66,7 +71,8 @@ previousK_(1),
 origTreeLength_(0),
 debugDir_(),
 debug_(false),
-cycleNum_(0)
+cycleNum_(0),
+reuseSequenceLikelihood_(false)
 {
     // get the original total tree length
     const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(tree);
@@ -87,9 +93,8 @@ cycleNum_(0)
     characterTreeLikelihood_ = characterTreeLikelihood;
 
     // create the sequence tree likelihood of the null model as initial data memeber based on the sequence model, sequence data and tree
-    RNonHomogeneousMixedTreeLikelihood* sequenceTreeLikelihood = new RNonHomogeneousMixedTreeLikelihood(*tree, *sequenceData, sequenceModel, rDist, true, true);
-    sequenceTreeLikelihood->initialize();
-    sequenceTreeLikelihood_ = sequenceTreeLikelihood;
+    reuseSequenceLikelihood_ = ApplicationTools::getBooleanParameter("sequence.reuse_likelihood", bppml_->getParams(), false, "", true, 1);
+    sequenceTreeLikelihood_ = createSequenceTreeLikelihood_(*tree, *sequenceData, sequenceModel, rDist, true);
 
     // update the logl_ data member
     logl_ = characterTreeLikelihood_->getValue() + sequenceTreeLikelihood_->getValue();
@@ -219,6 +224,9 @@ void JointLikelihoodFunction::updateStatesInNodesNames(Tree* mapping)
 
 void JointLikelihoodFunction::setPartitionByHistory(Tree* history)
 {
+    // when the sequence likelihood function is reused, the partition is given by the segments of its branches
+    if (reuseSequenceLikelihood_)
+        return;
     sequenceTreeLikelihood_->getSubstitutionModelSet()->resetModelToNodeIds();
     vector<const Node*> nodes = (dynamic_cast<const TreeTemplate<Node>*>(history))->getNodes();
     for (size_t i=0; i<nodes.size(); ++i)
@@ -243,14 +251,20 @@ void JointLikelihoodFunction::setPartitionByHistory(Tree* history)
 
 void JointLikelihoodFunction::updatesequenceTreeLikelihood(const Tree* history)
 {
+    // split the branches of the current sequence likelihood function according to the history
+    if (reuseSequenceLikelihood_)
+    {
+        dynamic_cast<RNonHomogeneousMixedGraphTreeLikelihood*>(sequenceTreeLikelihood_)->setBranchSegments(getBranchSegments_(history));
+        return;
+    }
+
     // extract the input for the next SequenceTreeLikelihood from the previouts one
     const VectorSiteContainer* sequenceData = dynamic_cast<const VectorSiteContainer*>(sequenceTreeLikelihood_->getData());
     MixedSubstitutionModelSet* sequenceModel = dynamic_cast<MixedSubstitutionModelSet*>(sequenceTreeLikelihood_->getSubstitutionModelSet());
     DiscreteDistribution* rDist = sequenceTreeLikelihood_->getRateDistribution();
 
     // create the new sequenceTreeLikelihood
-    RNonHomogeneousMixedTreeLikelihood* sequenceTreeLikelihood = new RNonHomogeneousMixedTreeLikelihood(*history, *sequenceData, sequenceModel, rDist, true, true);
-    sequenceTreeLikelihood->initialize();
+    RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood = createSequenceTreeLikelihood_(*history, *sequenceData, sequenceModel, rDist, true);
 
     // delete the previous SequenceTreeLikelihood instance
     if (sequenceTreeLikelihood_) delete sequenceTreeLikelihood_;
@@ -261,9 +275,70 @@ void JointLikelihoodFunction::updatesequenceTreeLikelihood(const Tree* history)
 
 /******************************************************************************/
 
-double JointLikelihoodFunction::getSequenceScalingFactor(bool verbose)
+RNonHomogeneousTreeLikelihood* JointLikelihoodFunction::createSequenceTreeLikelihood_(const Tree& tree, const SiteContainer& sequenceData, MixedSubstitutionModelSet* sequenceModel, DiscreteDistribution* rDist, bool verbose) const
+{
+    if (!reuseSequenceLikelihood_)
+    {
+        RNonHomogeneousMixedTreeLikelihood* sequenceTreeLikelihood = new RNonHomogeneousMixedTreeLikelihood(tree, sequenceData, sequenceModel, rDist, verbose, true);
+        sequenceTreeLikelihood->initialize();
+        return sequenceTreeLikelihood;
+    }
+
+    RNonHomogeneousMixedGraphTreeLikelihood* sequenceTreeLikelihood = new RNonHomogeneousMixedGraphTreeLikelihood(tree, sequenceData, sequenceModel, rDist, verbose, true);
+    sequenceTreeLikelihood->initialize();
+    // split the branches as in the current sequence likelihood function, if any
+    const RNonHomogeneousMixedGraphTreeLikelihood* current = dynamic_cast<const RNonHomogeneousMixedGraphTreeLikelihood*>(sequenceTreeLikelihood_);
+    if (current)
+    {
+        map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> segments;
+        vector<const Node*> nodes = (dynamic_cast<const TreeTemplate<Node>&>(tree)).getNodes();
+        for (size_t i=0; i<nodes.size(); ++i)
+        {
+            if (nodes[i]->hasFather())
+                segments[nodes[i]->getId()] = current->getBranchSegments(nodes[i]->getId());
+        }
+        sequenceTreeLikelihood->setBranchSegments(segments);
+    }
+    return sequenceTreeLikelihood;
+}
+
+/******************************************************************************/
+
+map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> JointLikelihoodFunction::getBranchSegments_(const Tree* history) const
+{
+    // the nodes of the base tree keep their ids in the histories
+    vector<int> baseIds = sequenceTreeLikelihood_->getTree().getNodesId();
+    set<int> baseNodes(baseIds.begin(), baseIds.end());
+    const SubstitutionModelSet* sequenceModel = sequenceTreeLikelihood_->getSubstitutionModelSet();
+
+    map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> segments;
+    vector<const Node*> nodes = (dynamic_cast<const TreeTemplate<Node>*>(history))->getNodes();
+    for (size_t i=0; i<nodes.size(); ++i)
+    {
+        if (!nodes[i]->hasFather() || baseNodes.find(nodes[i]->getId()) == baseNodes.end())
+            continue;
+        // go up the history until the father of the node in the base tree
+        RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments& branch = segments[nodes[i]->getId()];
+        const Node* node = nodes[i];
+        do
+        {
+            size_t model;
+            if (node->hasNodeProperty("state"))
+                model = (StochasticMapping::getNodeState(node) == 0 ? 0 : 1);
+            else
+                model = sequenceModel->getModelIndexForNode(node->getId());
+            branch.push_back(make_pair(model, node->getDistanceToFather()));
+            node = node->getFather();
+        } while (baseNodes.find(node->getId()) == baseNodes.end());
+        reverse(branch.begin(), branch.end());
+    }
+    return segments;
+}
+
+/******************************************************************************/
+
+double JointLikelihoodFunction::computeSequenceScalingFactor_(const Tree& tree) const
 {
-    const Tree& tree = sequenceTreeLikelihood_->getTree();
     vector <const Node*> nodes = (dynamic_cast<const TreeTemplate<Node>&>(tree)).getNodes();
     double treeSize = 0;
     for (size_t b=0; b<nodes.size(); ++b)
@@ -274,7 +349,14 @@ double JointLikelihoodFunction::getSequenceScalingFactor(bool verbose)
             treeSize = treeSize + nodes[b]->getDistanceToFather();
         }
     }
-    double scalingFactor = treeSize / origTreeLength_;
+    return treeSize / origTreeLength_;
+}
+
+/******************************************************************************/
+
+double JointLikelihoodFunction::getSequenceScalingFactor(bool verbose)
+{
+    double scalingFactor = computeSequenceScalingFactor_(sequenceTreeLikelihood_->getTree());
     if (verbose)
     {
         cout << "The tree has been scaled by a sequence scaling factor of: " << scalingFactor << endl;
@@ -288,6 +370,28 @@ void JointLikelihoodFunction::scaleSequenceTree(double factor)
 {
     // get a new tree and scale it
 	const Tree& origTree = characterTreeLikelihood_->getTree(); // the character tree is taken because it was not affected by any previous scaling
+    if (reuseSequenceLikelihood_)
+    {
+        // keep the segments of each branch, in the same proportions
+        RNonHomogeneousMixedGraphTreeLikelihood* sequenceTreeLikelihood = dynamic_cast<RNonHomogeneousMixedGraphTreeLikelihood*>(sequenceTreeLikelihood_);
+        map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> segments;
+        vector<const Node*> nodes = (dynamic_cast<const TreeTemplate<Node>&>(origTree)).getNodes();
+        for (size_t i=0; i<nodes.size(); ++i)
+        {
+            if (!nodes[i]->hasFather())
+                continue;
+            RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments branch = sequenceTreeLikelihood->getBranchSegments(nodes[i]->getId());
+            double length = 0;
+            for (size_t k=0; k<branch.size(); ++k)
+                length = length + branch[k].second;
+            for (size_t k=0; k<branch.size(); ++k)
+                branch[k].second = (length > 0 ? branch[k].second / length : 1. / static_cast<double>(branch.size())) * factor * nodes[i]->getDistanceToFather();
+            segments[nodes[i]->getId()] = branch;
+        }
+        sequenceTreeLikelihood->setBranchSegments(segments);
+        getSequenceScalingFactor(true); // for debugging
+        return;
+    }
 	Tree* newTree = origTree.clone();
 	(dynamic_cast<TreeTemplate<Node>*>(newTree))->scaleTree(factor);
     // switch the new tree with the ols tree in the sequence likelihood function
@@ -298,12 +402,21 @@ void JointLikelihoodFunction::scaleSequenceTree(double factor)
 /******************************************************************************/
 
 map<string,double> JointLikelihoodFunction::getModelParameters(bool verbose)
+{
+    map<string,double> modelParameters = getModelParameters_(sequenceTreeLikelihood_, verbose);
+    logl_ = modelParameters["Overall Log likelihood"];
+    return modelParameters;
+}
+
+/******************************************************************************/
+
+map<string,double> JointLikelihoodFunction::getModelParameters_(const RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood, bool verbose) const
 {
     map<string,double> modelParameters;
     ParameterList parameters;
 	
 	// character model parameters
-    TransitionModel* characterModel = characterTreeLikelihood_->getModel();
+    const TransitionModel* characterModel = characterTreeLikelihood_->getModel();
     parameters = characterModel->getParameters();
     for (size_t i = 0; i < parameters.size(); i++)
     {
@@ -315,11 +428,11 @@ map<string,double> JointLikelihoodFunction::getModelParameters(bool verbose)
     }
 
   // sequence model parameters
-  MixedSubstitutionModelSet* sequenceModel = dynamic_cast<MixedSubstitutionModelSet*>(sequenceTreeLikelihood_->getSubstitutionModelSet());
+  const MixedSubstitutionModelSet* sequenceModel = dynamic_cast<const MixedSubstitutionModelSet*>(sequenceTreeLikelihood->getSubstitutionModelSet());
   for (size_t m = 0; m < sequenceModel->getNumberOfModels(); ++m) {
     if (verbose)
       ApplicationTools::displayMessage("\nmodel " + TextTools::toString(m+1) + "\n");
-    TransitionModel* model = sequenceModel->getModel(m);
+    const TransitionModel* model = sequenceModel->getModel(m);
     parameters = model->getParameters();
     for (size_t i = 0; i < parameters.size(); i++)
     {
@@ -331,28 +444,169 @@ map<string,double> JointLikelihoodFunction::getModelParameters(bool verbose)
   }
 
   // get the sequence scaling factor
-  modelParameters["sequenceScalingFactor"] = getSequenceScalingFactor(false);
+  modelParameters["sequenceScalingFactor"] = computeSequenceScalingFactor_(sequenceTreeLikelihood->getTree());
   if (verbose)
 	ApplicationTools::displayResult("Sequence scaling factor",  TextTools::toString(modelParameters["sequenceScalingFactor"]));
 
   // get the likelihood
   double characterLogl = characterTreeLikelihood_->getValue();
   modelParameters["Character Log likelihood"] = characterLogl;
-  double sequenceLogl = sequenceTreeLikelihood_->getValue();
+  double sequenceLogl = sequenceTreeLikelihood->getValue();
   modelParameters["Sequence Log likelihood"] = sequenceLogl;
-  logl_ = characterLogl + sequenceLogl;
-  modelParameters["Overall Log likelihood"] = logl_;
+  double logl = characterLogl + sequenceLogl;
+  modelParameters["Overall Log likelihood"] = logl;
 
   // report it regardless of verbose level
   if (verbose)
   {
 	ApplicationTools::displayResult("\nCharacter Log likelihood", TextTools::toString(-characterLogl, 15));
 	ApplicationTools::displayResult("Sequence Log likelihood", TextTools::toString(-sequenceLogl, 15));
-	ApplicationTools::displayResult("Overall Log likelihood", TextTools::toString(-logl_, 15));
+	ApplicationTools::displayResult("Overall Log likelihood", TextTools::toString(-logl, 15));
   }
   return modelParameters;
 }
 
+/******************************************************************************/
+
+map<string,double> JointLikelihoodFunction::optimizeStartingPoint_(RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood, const map<string,double>& startingPoint, map<string,string>& params, bool scaleTree, OutputStream* messenger, bool verbose) const
+{
+    for (map<string, double>::const_iterator it = startingPoint.begin(); it != startingPoint.end(); it++)
+    {
+        if ((it->first.find("RELAX") != std::string::npos))
+        {
+            sequenceTreeLikelihood->setParameterValue(it->first, it->second);
+        }
+    }
+    double prevLogLikelihood = -sequenceTreeLikelihood->getValue();
+    double currLogLikelihood = -sequenceTreeLikelihood->getValue();
+    size_t index = 1;
+    do
+    {
+        if (verbose)
+            cout << "Optimization cycle: " << TextTools::toString(index) << endl;
+        index = index + 1;
+        if (scaleTree)
+        {
+            OptimizationTools::optimizeTreeScale(sequenceTreeLikelihood, 0.000001, 1000000, messenger, messenger, 0);
+            if (verbose)
+                cout << "The tree has been scaled by a sequence scaling factor of: " << computeSequenceScalingFactor_(sequenceTreeLikelihood->getTree()) << endl;
+        }
+        PhylogeneticsApplicationTools::optimizeParameters(sequenceTreeLikelihood, sequenceTreeLikelihood->getParameters(), params, "", true, verbose);
+        if (verbose)
+            ApplicationTools::displayResult("Current log likelihood", TextTools::toString(-sequenceTreeLikelihood->getValue(), 15));
+        prevLogLikelihood = currLogLikelihood;
+        currLogLikelihood = -sequenceTreeLikelihood->getValue();
+        if (verbose)
+            ApplicationTools::displayResult("Current diff", TextTools::toString((currLogLikelihood-prevLogLikelihood), 15));
+    } while (currLogLikelihood - prevLogLikelihood > 0.01);
+    if (verbose)
+    {
+        cout << "iterative optimzation complete" << endl;
+        ApplicationTools::displayResult("Log likelihood", TextTools::toString(-sequenceTreeLikelihood->getValue(), 15));
+    }
+    return getModelParameters_(sequenceTreeLikelihood, verbose);
+}
+
+/******************************************************************************/
+
+void JointLikelihoodFunction::computeStartingPoints_(vector< map<string,double> >& startingPoints, bool optimize, bool scaleTree, bool verbose)
+{
+    size_t nbPoints = startingPoints.size();
+    size_t nbThreads = static_cast<size_t>(ApplicationTools::getIntParameter("optimization.number_of_threads", bppml_->getParams(), 1, "", true, 2));
+    unique_ptr<ThreadPool> pool;
+    if (nbThreads != 1 && nbPoints > 1)
+    {
+        pool.reset(new ThreadPool(nbThreads));
+        if (pool->getNumberOfThreads() == 1)
+            pool.reset();
+    }
+    size_t nbWorkers = pool ? min(nbPoints, pool->getNumberOfThreads()) : 1;
+
+    // The optimization options are read by each starting point from its own copy. Outputs of the
+    // optimizer are disabled when several points are processed at once, as they would share files.
+    map<string,string> params = bppml_->getParams();
+    if (pool)
+    {
+        params["optimization.verbose"] = "0";
+        params["optimization.message_handler"] = "none";
+        params["optimization.profiler"] = "none";
+        params["optimization.backup.file"] = "none";
+    }
+    bool pointVerbose = verbose && !pool;
+    OutputStream* messenger = pool ? 0 : ApplicationTools::message.get();
+
+    // The likelihood function does not own its model set and rate distribution, which are modified
+    // by the optimization: each likelihood function gets its own copies, made before any thread starts.
+    // When optimizing, a new likelihood function is built for each point, which then does not
+    // depend on the points optimized before it. When only computing the likelihood, only the RELAX
+    // parameters change and each worker reuses the same function.
+    // When the sequence likelihood function is reused across histories, the copies split their branches in the same way.
+    const MixedSubstitutionModelSet* sequenceModel = dynamic_cast<const MixedSubstitutionModelSet*>(sequenceTreeLikelihood_->getSubstitutionModelSet());
+    const DiscreteDistribution* rDist = sequenceTreeLikelihood_->getRateDistribution();
+    const Tree& tree = sequenceTreeLikelihood_->getTree();
+    const SiteContainer* sequenceData = sequenceTreeLikelihood_->getData();
+    size_t nbCopies = optimize ? nbPoints : nbWorkers;
+    vector< unique_ptr<MixedSubstitutionModelSet> > modelSets(nbCopies);
+    vector< unique_ptr<DiscreteDistribution> > rDists(nbCopies);
+    for (size_t i = 0; i < nbCopies; ++i)
+    {
+        modelSets[i].reset(sequenceModel->clone());
+        rDists[i].reset(rDist->clone());
+    }
+    // Reading sequences from a container updates its internal cache, so that
+    // each worker also builds its likelihood functions from its own copy of the data.
+    vector< unique_ptr<SiteContainer> > sequenceDataCopies;
+    if (pool)
+    {
+        for (size_t w = 0; w < nbWorkers; ++w)
+            sequenceDataCopies.push_back(unique_ptr<SiteContainer>(sequenceData->clone()));
+    }
+
+    vector< map<string,double> > results(nbPoints);
+    atomic<size_t> nextPoint(0);
+    auto computePoints = [&](size_t w) {
+        unique_ptr<RNonHomogeneousTreeLikelihood> sequenceTreeLikelihood;
+        for (size_t p = nextPoint++; p < nbPoints; p = nextPoint++)
+        {
+            if (optimize || !sequenceTreeLikelihood)
+            {
+                size_t i = optimize ? p : w;
+                const SiteContainer& data = pool ? *sequenceDataCopies[w] : *sequenceData;
+                sequenceTreeLikelihood.reset(createSequenceTreeLikelihood_(tree, data, modelSets[i].get(), rDists[i].get(), false));
+            }
+            if (optimize)
+            {
+                if (pointVerbose)
+                    cout << "Optimizing starting point " << (p+1) << "..." << endl;
+                map<string,string> pointParams = params;
+                results[p] = optimizeStartingPoint_(sequenceTreeLikelihood.get(), startingPoints[p], pointParams, scaleTree, messenger, pointVerbose);
+            }
+            else
+            {
+                for (map<string, double>::const_iterator it = startingPoints[p].begin(); it != startingPoints[p].end(); it++)
+                {
+                    if ((it->first.find("RELAX") != std::string::npos))
+                    {
+                        sequenceTreeLikelihood->setParameterValue(it->first, it->second);
+                    }
+                }
+                results[p] = getModelParameters_(sequenceTreeLikelihood.get(), pointVerbose);
+            }
+        }
+    };
+    if (pool)
+        pool->run(nbWorkers, computePoints);
+    else
+        computePoints(0);
+
+    if (verbose && pool)
+    {
+        for (size_t p = 0; p < nbPoints; ++p)
+            ApplicationTools::displayResult("Starting point " + TextTools::toString(p+1) + " log likelihood", TextTools::toString(-results[p]["Sequence Log likelihood"], 15));
+    }
+    startingPoints = results;
+}
+
 /*****************************************************************************/
 
 void JointLikelihoodFunction::optimizeSequenceModel()
@@ -417,91 +671,38 @@ void JointLikelihoodFunction::optimizeSequenceModel()
         bppml_->getParam("optimization.tolerance") = "0.01";
         if (cycleNum_ == 0)
         {
-            // starting point 1 - results of the null fitting
-			prevLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			index = 1;
-			do
-			{
-				cout << "Optimization cycle: " << TextTools::toString(index) << endl;
-				index = index + 1;
-				if (scaleTree >= 1)
-				{
-					OptimizationTools::optimizeTreeScale(sequenceTreeLikelihood_, 0.000001, 1000000, ApplicationTools::message.get(), ApplicationTools::message.get(), 0);
-					getSequenceScalingFactor(); // debug
-				}
-				PhylogeneticsApplicationTools::optimizeParameters(sequenceTreeLikelihood_, sequenceTreeLikelihood_->getParameters(), bppml_->getParams());
-				ApplicationTools::displayResult("Current log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-				prevLogLikelihood = currLogLikelihood;
-				currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-				ApplicationTools::displayResult("Current diff", TextTools::toString((currLogLikelihood-prevLogLikelihood), 15));
-			} while (currLogLikelihood - prevLogLikelihood > 0.01);
-			if (verbose)
+            // starting point 1 - results of the null fitting, starting point 2 - user initial values
+            vector<map<string,double>> initialStartingPoints(2, getModelParameters_(sequenceTreeLikelihood_, false));
+            for (map<string, double>::iterator it = userInitialValues.begin(); it != userInitialValues.end(); it++)
             {
-                cout << "iterative optimzation complete" << endl;
-                ApplicationTools::displayResult("Log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
+                if ((it->first.find("RELAX") != std::string::npos))
+                {
+                    initialStartingPoints[1][it->first] = it->second;
+                }
             }
-			double sp1Logl = -sequenceTreeLikelihood_->getValue();
+            computeStartingPoints_(initialStartingPoints, true, scaleTree >= 1, verbose);
+            double sp1Logl = -initialStartingPoints[0]["Sequence Log likelihood"];
+            double sp2Logl = -initialStartingPoints[1]["Sequence Log likelihood"];
             if (verbose)
             {
                 cout << "* Statring point: null fitting result *" << endl;
                 ApplicationTools::displayResult("Log likelihood", TextTools::toString(sp1Logl, 15));
-            }
-            map<string, double> sp1Result = getModelParameters(verbose); // debug - print model parameters
-            
-            // starting point 2 - user initial values
-            for (map<string, double>::iterator it = userInitialValues.begin(); it != userInitialValues.end(); it++)
-            {
-				if ((it->first.find("RELAX") != std::string::npos))
-				{
-					sequenceTreeLikelihood_->setParameterValue(it->first, it->second);
-				}
-            }
-						prevLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			index = 1;
-			do
-			{
-				if (verbose)
-                    cout << "Optimization cycle: " << TextTools::toString(index) << endl;
-				index = index + 1;
-				if (scaleTree >= 1)
-				{
-					OptimizationTools::optimizeTreeScale(sequenceTreeLikelihood_, 0.000001, 1000000, ApplicationTools::message.get(), ApplicationTools::message.get(), 0);
-					getSequenceScalingFactor(); // debug
-				}
-				PhylogeneticsApplicationTools::optimizeParameters(sequenceTreeLikelihood_, sequenceTreeLikelihood_->getParameters(), bppml_->getParams());
-				ApplicationTools::displayResult("Current log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-				prevLogLikelihood = currLogLikelihood;
-				currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-				ApplicationTools::displayResult("Current diff", TextTools::toString((currLogLikelihood-prevLogLikelihood), 15));
-			} while (currLogLikelihood - prevLogLikelihood > 0.01);
-			if (verbose)
-            {
-                cout << "iterative optimzation complete" << endl;
-			    ApplicationTools::displayResult("Log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-            }
-            double sp2Logl = -sequenceTreeLikelihood_->getValue();
-            if (verbose)
-            {
                 cout << "* Statring point: user initial values *" << endl;
                 ApplicationTools::displayResult("Log likelihood", TextTools::toString(sp2Logl, 15));
             }
-            map<string, double> sp2Result = getModelParameters(verbose); // debug - print model parameters
-            
+
             // determine the winning starting point
-            map<string, double> chosenInitialValues = sp1Result;
+            map<string, double> chosenInitialValues = initialStartingPoints[0];
             if (sp1Logl < sp2Logl)
             {
-            if (verbose)
-                cout << "Winning starting point: user initial values " << endl;
-            chosenInitialValues = sp2Result;
+                if (verbose)
+                    cout << "Winning starting point: user initial values " << endl;
+                chosenInitialValues = initialStartingPoints[1];
             }
             else
             {
                 if (verbose)
                     cout << "Winning starting point: null fitting result " << endl;
-                chosenInitialValues = sp1Result;
             }
             // set the values of the starting point in the sequence likelihood function
             for (map<string, double>::iterator it = chosenInitialValues.begin(); it != chosenInitialValues.end(); it++)
@@ -527,31 +728,21 @@ void JointLikelihoodFunction::optimizeSequenceModel()
         double bgOmega2 = sequenceTreeLikelihood_->getParameterValue("RELAX.omega2_1");
         double maxSigK = min(min(max(log(0.0001+0.0001)/log(bgOmega0+0.0001),1.0), max(log(999+0.0001)/log(bgOmega2+0.0001),1.0)), 10.0); // compute the maximal k for which the breakwater in RELAX model implementation is not expressed (any k beyond this value will yield the same likelihood)
         double intensificationInterval = (maxSigK-1) / static_cast<double>(numberOfIntensificationPoints);
-        vector<double> startingPoints;
-        startingPoints.clear();
-        startingPoints.resize(startingPointsByCycle[0]);
         // set the starting points with respect to k s.t 1/2 of them represent relaxation and 1/2 represent intensification
+        vector<map<string,double>> startingPointsResults(startingPointsByCycle[0], getModelParameters_(sequenceTreeLikelihood_, false));
         for (size_t r=0; r<startingPointsByCycle[0]; ++r)
         {
             if (r < numberOfRexalationPoints)
             {
-                startingPoints[r] = 0.0001 + static_cast<double>(r)*relaxationInterval;
+                startingPointsResults[r]["RELAX.k_2"] = 0.0001 + static_cast<double>(r)*relaxationInterval;
             }
             else
             {
-                startingPoints[r] = 1 + static_cast<double>(r-numberOfRexalationPoints)*intensificationInterval;
+                startingPointsResults[r]["RELAX.k_2"] = 1 + static_cast<double>(r-numberOfRexalationPoints)*intensificationInterval;
             }
         }
         // compute the likelihood of the starting points
-        vector<map<string,double>> startingPointsResults;
-        startingPointsResults.clear();
-        startingPointsResults.resize(startingPointsByCycle[0]); 
-        for (size_t l=0; l<startingPointsByCycle[0]; ++l)
-        {
-            sequenceTreeLikelihood_->setParameterValue("RELAX.k_2", startingPoints[l]);
-            sequenceTreeLikelihood_->computeTreeLikelihood();
-            startingPointsResults[l] = getModelParameters(verbose);
-        }
+        computeStartingPoints_(startingPointsResults, false, scaleTree >= 1, verbose);
         
         /* step 2: iteratively optimize superficially the best starting points */
         if (verbose)
@@ -563,53 +754,11 @@ void JointLikelihoodFunction::optimizeSequenceModel()
         {
             if(verbose)
                 cout << "* Step 2 Cycle " << c << " *" << endl;
-            size_t numberOfBestStartingPoints = startingPointsByCycle[c];
-            bestStartingPoints.clear();
-            sort(startingPointsResults.begin(), startingPointsResults.end(), JointLikelihoodFunction::sortStartingPointsFunction);
-            // select the best starting points with respect to k
-            for (size_t p=0; p<numberOfBestStartingPoints; ++p)
-            {
-                bestStartingPoints.push_back(startingPointsResults[p]);
-            }
+            // select the best starting points with respect to k, ties being broken by the order of the starting points
+            stable_sort(startingPointsResults.begin(), startingPointsResults.end(), JointLikelihoodFunction::sortStartingPointsFunction);
+            bestStartingPoints.assign(startingPointsResults.begin(), startingPointsResults.begin() + static_cast<ptrdiff_t>(min(startingPointsByCycle[c], startingPointsResults.size())));
             // optimize each point and save the output of its optimization
-            for (size_t p=0; p<bestStartingPoints.size(); ++p)
-            {
-                for (map<string, double>::iterator it = bestStartingPoints[p].begin(); it != bestStartingPoints[p].end(); it++)
-                {
-                    if ((it->first.find("RELAX") != std::string::npos))
-                    {
-                        sequenceTreeLikelihood_->setParameterValue(it->first, it->second);
-                    }
-                }
-                if (verbose)
-                    cout << "Optimizing starting point " << (p+1) << "..." << endl;
-				prevLogLikelihood = -sequenceTreeLikelihood_->getValue();
-				currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-				index = 1;
-				do
-				{
-					if (verbose)
-                        cout << "Optimization cycle: " << TextTools::toString(index) << endl;
-					index = index + 1;
-					if (scaleTree >= 1)
-					{
-						OptimizationTools::optimizeTreeScale(sequenceTreeLikelihood_, 0.000001, 1000000, ApplicationTools::message.get(), ApplicationTools::message.get(), 0);
-						getSequenceScalingFactor(); // debug
-					}
-					PhylogeneticsApplicationTools::optimizeParameters(sequenceTreeLikelihood_, sequenceTreeLikelihood_->getParameters(), bppml_->getParams());
-					if (verbose)
-                        ApplicationTools::displayResult("Current log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-					prevLogLikelihood = currLogLikelihood;
-					currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-					if (verbose)
-                        ApplicationTools::displayResult("Current diff", TextTools::toString((currLogLikelihood-prevLogLikelihood), 15));
-				} while (currLogLikelihood - prevLogLikelihood > 0.01);
-				if (verbose)
-                    cout << "iterative optimzation complete" << endl;
-				ApplicationTools::displayResult("Log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-				bestStartingPoints[p] = getModelParameters(verbose);
-            }
-            startingPointsResults.clear();
+            computeStartingPoints_(bestStartingPoints, true, scaleTree >= 1, verbose);
             startingPointsResults = bestStartingPoints; 
         }
 
@@ -618,54 +767,25 @@ void JointLikelihoodFunction::optimizeSequenceModel()
             cout << "** Step 3: optimizating deeply the optimal starting points **" << endl;
         bppml_->getParam("optimization.max_number_f_eval") = "10000";
         bppml_->getParam("optimization.tolerance") = "0.000001";
-        size_t numberOfBestStartingPoints = startingPointsByCycle[startingPointsByCycle.size()-1];
-        bestStartingPoints.clear();
-        sort(startingPointsResults.begin(), startingPointsResults.end(), JointLikelihoodFunction::sortStartingPointsFunction);
-        // select the best starting points with respect to k
-        for (size_t p=0; p<numberOfBestStartingPoints; ++p)
+        stable_sort(startingPointsResults.begin(), startingPointsResults.end(), JointLikelihoodFunction::sortStartingPointsFunction);
+        bestStartingPoints.assign(startingPointsResults.begin(), startingPointsResults.begin() + static_cast<ptrdiff_t>(min(startingPointsByCycle[numberOfCycles-1], startingPointsResults.size())));
+        computeStartingPoints_(bestStartingPoints, true, scaleTree >= 1, verbose);
+
+        /* step 4: select the best starting point and report its values */ 
+        stable_sort(bestStartingPoints.begin(), bestStartingPoints.end(), sortStartingPointsFunction);
+        inferenceResult = bestStartingPoints[0];
+
+        // the starting points were optimized on copies of the sequence likelihood function: apply the tree scaling of the best one
+        if (scaleTree >= 1)
         {
-            bestStartingPoints.push_back(startingPointsResults[p]);
-            // optimize deeply each of the chosen starting points
-            for (map<string, double>::iterator it = startingPointsResults[p].begin(); it != startingPointsResults[p].end(); it++)
+            double ratio = inferenceResult["sequenceScalingFactor"] / getSequenceScalingFactor(false);
+            ParameterList brLens = sequenceTreeLikelihood_->getBranchLengthsParameters();
+            for (size_t i = 0; i < brLens.size(); ++i)
             {
-                if ((it->first.find("RELAX") != std::string::npos))
-                {
-                    sequenceTreeLikelihood_->setParameterValue(it->first, it->second);
-                }
-            }
-            if (verbose)
-                cout << "Optimizing starting point " << (p+1) << endl;
-			prevLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-			index = 1;
-			do
-			{
-				if (verbose)
-                    cout << "Optimization cycle: " << TextTools::toString(index) << endl;
-				index = index + 1;
-				if (scaleTree >= 1)
-				{
-					OptimizationTools::optimizeTreeScale(sequenceTreeLikelihood_, 0.000001, 1000000, ApplicationTools::message.get(), ApplicationTools::message.get(), 0);
-					getSequenceScalingFactor(); // debug
-				}
-				PhylogeneticsApplicationTools::optimizeParameters(sequenceTreeLikelihood_, sequenceTreeLikelihood_->getParameters(), bppml_->getParams());
-				if (verbose)
-                    ApplicationTools::displayResult("Current log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));
-				prevLogLikelihood = currLogLikelihood;
-				currLogLikelihood = -sequenceTreeLikelihood_->getValue();
-				if (verbose)
-                    ApplicationTools::displayResult("Current diff", TextTools::toString((currLogLikelihood-prevLogLikelihood), 15));
-			} while (currLogLikelihood - prevLogLikelihood > 0.01);
-			if (verbose)
-            {
-                cout << "iterative optimzation complete" << endl;
-			    ApplicationTools::displayResult("Log likelihood", TextTools::toString(-sequenceTreeLikelihood_->getValue(), 15));bestStartingPoints[p] = getModelParameters(verbose);
+                brLens[i].setValue(brLens[i].getValue() * ratio);
             }
+            sequenceTreeLikelihood_->matchParametersValues(brLens);
         }
-
-        /* step 4: select the best starting point and report its values */ 
-        sort(bestStartingPoints.begin(), bestStartingPoints.end(), sortStartingPointsFunction);
-        inferenceResult = bestStartingPoints[0];
     }
 	else
     {
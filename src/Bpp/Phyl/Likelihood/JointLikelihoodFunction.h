@@ -41,11 +41,13 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/Function/Functions.h>
 #include <Bpp/Numeric/AbstractParametrizable.h>
 #include <Bpp/App/BppApplication.h>
+#include <Bpp/Io/OutputStream.h>
 
 // From bpp-phyl:
 #include <Bpp/Phyl/Tree.h>
 #include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
 #include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedGraphTreeLikelihood.h>
 #include <Bpp/Phyl/Model/MixedSubstitutionModelSet.h>
 #include <Bpp/Phyl/Mapping/StochasticMapping.h>
 #include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
@@ -83,7 +85,7 @@ class JointLikelihoodFunction:
     Hypothesis hypothesis_;
     BppApplication* bppml_;
     RHomogeneousTreeLikelihood* characterTreeLikelihood_; 
-    RNonHomogeneousMixedTreeLikelihood* sequenceTreeLikelihood_; 
+    RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood_; 
     map<string, double> previousParametersValues_;
     StochasticMapping* stocMapping_;
     OptimizationScope optimizationScope_;
@@ -95,6 +97,7 @@ class JointLikelihoodFunction:
     string debugDir_;
     bool debug_;
     unsigned int cycleNum_;
+    bool reuseSequenceLikelihood_; // if reuseSequenceLikelihood_ == true -> the sequence likelihood function is kept on the base tree, and its branches are split according to each history
   
   protected:
 
@@ -103,6 +106,65 @@ class JointLikelihoodFunction:
      */
     static bool sortStartingPointsFunction(map<string,double> i,map<string,double> j) { return (i["Overall Log likelihood"]<j["Overall Log likelihood"]); }
 
+    /**
+     * @brief Computes the sequence scaling factor of a tree with respect to the original tree length
+     */
+    double computeSequenceScalingFactor_(const Tree& tree) const;
+
+    /**
+     * @brief Returns a map of the names and values of the model parameters, computed with a given sequence likelihood function
+     *
+     * Unlike getModelParameters, the log likelihood of the joint model is not updated, so that this function can be called concurrently on different sequence likelihood functions.
+     */
+    map<string,double> getModelParameters_(const RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood, bool verbose) const;
+
+    /**
+     * @brief Optimizes a sequence likelihood function from a given starting point, until an optimization round improves the log likelihood by less than 0.01
+     *
+     * @param sequenceTreeLikelihood  The sequence likelihood function to optimize
+     * @param startingPoint           The values of the RELAX parameters to start from
+     * @param params                  The optimization options
+     * @param scaleTree               Whether the tree should be scaled before each optimization round
+     * @param messenger               Where to write the messages of the tree scaling, possibly null
+     * @param verbose                 Whether the progress should be reported to stdout
+     * @return The optimized model parameters, as returned by getModelParameters_
+     */
+    map<string,double> optimizeStartingPoint_(RNonHomogeneousTreeLikelihood* sequenceTreeLikelihood, const map<string,double>& startingPoint, map<string,string>& params, bool scaleTree, OutputStream* messenger, bool verbose) const;
+
+    /**
+     * @brief Computes or optimizes the likelihood of the sequence model at several starting points
+     *
+     * The starting points are processed concurrently if optimization.number_of_threads is not 1. Each one is computed with its own copy of the sequence likelihood function, model set and rate distribution, so that the results do not depend on the number of threads (for a given instruction set, see LikelihoodKernels).
+     *
+     * @param startingPoints  [in, out] The values of the RELAX parameters at each starting point, replaced by the resulting model parameters
+     * @param optimize        Whether the starting points should be optimized or their likelihood only computed
+     * @param scaleTree       Whether the tree should be scaled before each optimization round
+     * @param verbose         Whether the progress should be reported to stdout
+     */
+    void computeStartingPoints_(vector< map<string,double> >& startingPoints, bool optimize, bool scaleTree, bool verbose);
+
+    /**
+     * @brief Creates and initializes a new sequence likelihood function
+     *
+     * If sequence.reuse_likelihood is set, the new function splits its branches in the same way as the current one.
+     *
+     * @param tree           The tree of the new function
+     * @param sequenceData   The sequence data
+     * @param sequenceModel  The sequence model, which is not copied
+     * @param rDist          The rate distribution, which is not copied
+     * @param verbose        Whether the construction should be reported to stdout
+     */
+    RNonHomogeneousTreeLikelihood* createSequenceTreeLikelihood_(const Tree& tree, const SiteContainer& sequenceData, MixedSubstitutionModelSet* sequenceModel, DiscreteDistribution* rDist, bool verbose) const;
+
+    /**
+     * @brief Converts a history into the segments of the branches of the base tree, from the top to the bottom of each branch
+     *
+     * The model of each segment is given by the state of the node below it: 0 for the background model and 1 for the foreground one. Nodes with no state use the model they are assigned to in the sequence model.
+     *
+     * @param history  A tree made of the base tree, with additional nodes with a single son along its branches
+     */
+    map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> getBranchSegments_(const Tree* history) const;
+
 
   public:
 
@@ -117,7 +179,7 @@ class JointLikelihoodFunction:
       hypothesis_(jlf.hypothesis_),
       bppml_(jlf.bppml_),
       characterTreeLikelihood_(jlf.characterTreeLikelihood_->clone()),
-      sequenceTreeLikelihood_(dynamic_cast<RNonHomogeneousMixedTreeLikelihood*>(jlf.sequenceTreeLikelihood_->clone())),
+      sequenceTreeLikelihood_(jlf.sequenceTreeLikelihood_->clone()),
       previousParametersValues_(jlf.previousParametersValues_),
       stocMapping_(jlf.stocMapping_->clone()),
       optimizationScope_(jlf.optimizationScope_),
@@ -128,7 +190,8 @@ class JointLikelihoodFunction:
       origTreeLength_(jlf.origTreeLength_),
       debugDir_(jlf.debugDir_),
       debug_(jlf.debug_),
-      cycleNum_(jlf.cycleNum_)
+      cycleNum_(jlf.cycleNum_),
+      reuseSequenceLikelihood_(jlf.reuseSequenceLikelihood_)
     {   
     }
 
@@ -138,7 +201,7 @@ class JointLikelihoodFunction:
       hypothesis_ = jlf.hypothesis_;
       bppml_ = jlf.bppml_;
       characterTreeLikelihood_ = jlf.characterTreeLikelihood_->clone(); 
-      sequenceTreeLikelihood_ = dynamic_cast<RNonHomogeneousMixedTreeLikelihood*>(jlf.sequenceTreeLikelihood_->clone()); 
+      sequenceTreeLikelihood_ = jlf.sequenceTreeLikelihood_->clone(); 
       previousParametersValues_ = jlf.previousParametersValues_;
       stocMapping_ = jlf.stocMapping_->clone();
       optimizationScope_ = jlf.optimizationScope_;
@@ -150,6 +213,7 @@ class JointLikelihoodFunction:
       debugDir_ = jlf.debugDir_;
       debug_ = jlf.debug_;
       cycleNum_ = jlf.cycleNum_;
+      reuseSequenceLikelihood_ = jlf.reuseSequenceLikelihood_;
       return *this;
     }
 
@@ -184,7 +248,7 @@ class JointLikelihoodFunction:
     /**
      * @brief Return the pointer to the sequence likelihood function
      */
-    RNonHomogeneousMixedTreeLikelihood* getSequenceLikelihoodFunction() const { return sequenceTreeLikelihood_; }
+    RNonHomogeneousTreeLikelihood* getSequenceLikelihoodFunction() const { return sequenceTreeLikelihood_; }
  
     /**
      * @brief Computes the value of the joint likelihood function depending on hypothesis - calls either computeNullJointLikelihood or computeAlternativeJointLikelihood
@@ -214,6 +278,8 @@ class JointLikelihoodFunction:
 
     /**
      * @brief Defines the tree partition into the two sub-models of the sequence model according to a given history
+     *
+     * If sequence.reuse_likelihood is set, the partition is only defined by updatesequenceTreeLikelihood, on the branches of the base tree.
      * 
      * @param history  A tree in which each node has a state propetly assinged to it, corresponding to its binary character state
      */
@@ -221,6 +287,8 @@ class JointLikelihoodFunction:
 
     /**
      * @brief replaced the instnace of sequwnce tree likelihood so that the updated instance will consider the new character history
+     *
+     * If sequence.reuse_likelihood is set, the instance is kept and only the arrays above the branches whose segments changed are recomputed.
      * 
      * @param history  A tree in which each node has a state propetly assinged to it, corresponding to its binary character state
      */
@@ -0,0 +1,330 @@
+//
+// File: LikelihoodKernels.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:15 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "LikelihoodKernels.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BPP_LIKELIHOOD_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::instructionSet_ = LikelihoodKernels::detectInstructionSet_();
+
+/******************************************************************************/
+
+namespace
+{
+
+/*
+ * Temporary row storage is allocated on the stack up to this number of states,
+ * so that calling the kernels on a single row remains cheap.
+ */
+const size_t MAX_STACK_STATES = 64;
+
+/*
+ * Scalar version. If N is 0, the number of states is only known at runtime.
+ * Terms are summed in the same order as in the original recursions.
+ */
+template<size_t N>
+void multiplyScalar_(
+    const double* matrix, size_t stride,
+    const double* in, size_t inStep,
+    double* out, size_t outStep,
+    size_t nbRows, size_t nbStates)
+{
+  const size_t n = (N == 0 ? nbStates : N);
+  double tmpFixed[MAX_STACK_STATES];
+  vector<double> tmpDynamic(n > MAX_STACK_STATES ? n : 0);
+  double* tmp = (n > MAX_STACK_STATES ? tmpDynamic.data() : tmpFixed);
+  for (size_t r = 0; r < nbRows; r++)
+  {
+    const double* in_r = in + r * inStep;
+    double* out_r = out + r * outStep;
+    fill(tmp, tmp + n, 0.);
+    for (size_t y = 0; y < n; y++)
+    {
+      const double* matrix_y = matrix + y * stride;
+      double in_r_y = in_r[y];
+      for (size_t x = 0; x < n; x++)
+      {
+        tmp[x] += matrix_y[x] * in_r_y;
+      }
+    }
+    for (size_t x = 0; x < n; x++)
+    {
+      out_r[x] *= tmp[x];
+    }
+  }
+}
+
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+
+/*
+ * AVX2 version for a block of ROWS rows and N states known at compile time.
+ * States are processed by packs of 4, the remaining ones (if N is not a multiple of 4) in scalar mode.
+ * Several rows are processed together when N is small, in order to hide the latency of the FMA chain.
+ */
+template<size_t N, size_t ROWS>
+__attribute__((target("avx2,fma")))
+inline void multiplyAvx2Block_(
+    const double* matrix, size_t stride,
+    const double* in, size_t inStep,
+    double* out, size_t outStep)
+{
+  const size_t NV = N / 4;
+  const size_t NT = N % 4;
+  __m256d acc[ROWS][NV];
+  double tail[ROWS][NT > 0 ? NT : 1];
+  for (size_t r = 0; r < ROWS; r++)
+  {
+    for (size_t v = 0; v < NV; v++)
+      acc[r][v] = _mm256_setzero_pd();
+    for (size_t t = 0; t < NT; t++)
+      tail[r][t] = 0.;
+  }
+  for (size_t y = 0; y < N; y++)
+  {
+    const double* matrix_y = matrix + y * stride;
+    for (size_t r = 0; r < ROWS; r++)
+    {
+      double in_r_y = in[r * inStep + y];
+      __m256d b = _mm256_set1_pd(in_r_y);
+      for (size_t v = 0; v < NV; v++)
+        acc[r][v] = _mm256_fmadd_pd(_mm256_loadu_pd(matrix_y + 4 * v), b, acc[r][v]);
+      for (size_t t = 0; t < NT; t++)
+        tail[r][t] += matrix_y[4 * NV + t] * in_r_y;
+    }
+  }
+  for (size_t r = 0; r < ROWS; r++)
+  {
+    double* out_r = out + r * outStep;
+    for (size_t v = 0; v < NV; v++)
+      _mm256_storeu_pd(out_r + 4 * v, _mm256_mul_pd(_mm256_loadu_pd(out_r + 4 * v), acc[r][v]));
+    for (size_t t = 0; t < NT; t++)
+      out_r[4 * NV + t] *= tail[r][t];
+  }
+}
+
+template<size_t N>
+__attribute__((target("avx2,fma")))
+void multiplyAvx2_(
+    const double* matrix, size_t stride,
+    const double* in, size_t inStep,
+    double* out, size_t outStep,
+    size_t nbRows)
+{
+  const size_t ROWS = (N / 4 >= 4 ? 1 : 4 / (N / 4));
+  size_t r = 0;
+  for ( ; r + ROWS <= nbRows; r += ROWS)
+    multiplyAvx2Block_<N, ROWS>(matrix, stride, in + r * inStep, inStep, out + r * outStep, outStep);
+  for ( ; r < nbRows; r++)
+    multiplyAvx2Block_<N, 1>(matrix, stride, in + r * inStep, inStep, out + r * outStep, outStep);
+}
+
+/*
+ * AVX2 version for an arbitrary number of states.
+ */
+__attribute__((target("avx2,fma")))
+void multiplyAvx2Generic_(
+    const double* matrix, size_t stride,
+    const double* in, size_t inStep,
+    double* out, size_t outStep,
+    size_t nbRows, size_t nbStates)
+{
+  const size_t nv = nbStates / 4 * 4;
+  double tmpFixed[MAX_STACK_STATES];
+  vector<double> tmpDynamic(nbStates > MAX_STACK_STATES ? nbStates : 0);
+  double* tmp = (nbStates > MAX_STACK_STATES ? tmpDynamic.data() : tmpFixed);
+  for (size_t r = 0; r < nbRows; r++)
+  {
+    const double* in_r = in + r * inStep;
+    double* out_r = out + r * outStep;
+    fill(tmp, tmp + nbStates, 0.);
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      const double* matrix_y = matrix + y * stride;
+      double in_r_y = in_r[y];
+      __m256d b = _mm256_set1_pd(in_r_y);
+      size_t x = 0;
+      for ( ; x < nv; x += 4)
+        _mm256_storeu_pd(tmp + x, _mm256_fmadd_pd(_mm256_loadu_pd(matrix_y + x), b, _mm256_loadu_pd(tmp + x)));
+      for ( ; x < nbStates; x++)
+        tmp[x] += matrix_y[x] * in_r_y;
+    }
+    size_t x = 0;
+    for ( ; x < nv; x += 4)
+      _mm256_storeu_pd(out_r + x, _mm256_mul_pd(_mm256_loadu_pd(out_r + x), _mm256_loadu_pd(tmp + x)));
+    for ( ; x < nbStates; x++)
+      out_r[x] *= tmp[x];
+  }
+}
+
+#endif //BPP_LIKELIHOOD_KERNELS_X86
+
+} //end of anonymous namespace.
+
+/******************************************************************************/
+
+void LikelihoodKernels::flattenTransitionMatrix(const VVdouble& pxy, bool transpose, size_t stride, std::vector<double>& matrix)
+{
+  size_t nbStates = pxy.size();
+  if (stride < nbStates)
+    throw Exception("LikelihoodKernels::flattenTransitionMatrix. Stride must be at least the number of states.");
+  matrix.assign(nbStates * stride, 0.);
+  for (size_t x = 0; x < nbStates; x++)
+  {
+    const Vdouble* pxy_x = &pxy[x];
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      if (transpose)
+        matrix[y * stride + x] = (*pxy_x)[y];
+      else
+        matrix[x * stride + y] = (*pxy_x)[y];
+    }
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::transposeTransitionMatrix(const double* pxy, size_t stride, size_t nbStates, double* matrix)
+{
+  for (size_t x = 0; x < nbStates; x++)
+  {
+    const double* pxy_x = pxy + x * stride;
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      matrix[y * stride + x] = pxy_x[y];
+    }
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::multiplyTransitionProducts(
+    const double* matrix, size_t stride,
+    const double* in, size_t inStep,
+    double* out, size_t outStep,
+    size_t nbRows, size_t nbStates)
+{
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+  if (instructionSet_ == AVX2)
+  {
+    switch (nbStates)
+    {
+    case 4:
+      multiplyAvx2_<4>(matrix, stride, in, inStep, out, outStep, nbRows);
+      return;
+    case 20:
+      multiplyAvx2_<20>(matrix, stride, in, inStep, out, outStep, nbRows);
+      return;
+    case 61:
+      multiplyAvx2_<61>(matrix, stride, in, inStep, out, outStep, nbRows);
+      return;
+    default:
+      multiplyAvx2Generic_(matrix, stride, in, inStep, out, outStep, nbRows, nbStates);
+      return;
+    }
+  }
+#endif
+  switch (nbStates)
+  {
+  case 4:
+    multiplyScalar_<4>(matrix, stride, in, inStep, out, outStep, nbRows, nbStates);
+    return;
+  case 20:
+    multiplyScalar_<20>(matrix, stride, in, inStep, out, outStep, nbRows, nbStates);
+    return;
+  case 61:
+    multiplyScalar_<61>(matrix, stride, in, inStep, out, outStep, nbRows, nbStates);
+    return;
+  default:
+    multiplyScalar_<0>(matrix, stride, in, inStep, out, outStep, nbRows, nbStates);
+    return;
+  }
+}
+
+/******************************************************************************/
+
+bool LikelihoodKernels::isSupported(InstructionSet instructionSet)
+{
+  switch (instructionSet)
+  {
+  case SCALAR:
+    return true;
+  case AVX2:
+#ifdef BPP_LIKELIHOOD_KERNELS_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::setInstructionSet(InstructionSet instructionSet)
+{
+  if (!isSupported(instructionSet))
+    throw Exception("LikelihoodKernels::setInstructionSet. Instruction set not supported by this processor.");
+  instructionSet_ = instructionSet;
+}
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::detectInstructionSet_()
+{
+  if (isSupported(AVX2))
+    return AVX2;
+  return SCALAR;
+}
+
+/******************************************************************************/
+
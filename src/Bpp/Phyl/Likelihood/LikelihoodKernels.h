@@ -0,0 +1,157 @@
+//
+// File: LikelihoodKernels.h
+// Created by: agent
+// Created on: Fri Oct 16 20:15 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _LIKELIHOODKERNELS_H_
+#define _LIKELIHOODKERNELS_H_
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Low-level routines for the computation of conditional likelihoods.
+ *
+ * The central operation of all likelihood recursions is, for each site and rate class,
+ * @f[
+ * L_{out}(x) \leftarrow L_{out}(x) \times \sum_y M(y, x) L_{in}(y).
+ * @f]
+ * This class provides an implementation of this product working on flat arrays.
+ * Vectorized versions are used when the processor supports them (currently AVX2 with FMA,
+ * on x86 processors compiled with GCC or Clang), the choice being made at runtime.
+ * Kernels specialized for 4 (nucleotides), 20 (proteins) and 61 (codons) states are provided,
+ * other alphabet sizes use a generic version.
+ *
+ * Matrices are stored as flat arrays with padded rows, see flattenTransitionMatrix().
+ * Note that vectorized kernels do not sum terms in the same order as the scalar one,
+ * results may therefore differ in the last bits.
+ */
+class LikelihoodKernels
+{
+  public:
+    enum InstructionSet {
+      SCALAR = 0,
+      AVX2 = 1
+    };
+
+  private:
+    static InstructionSet instructionSet_;
+
+  public:
+    /**
+     * @brief Store a transition matrix as a flat array.
+     *
+     * @param pxy       The transition matrix, as pxy[x][y] = P(x -> y).
+     * @param transpose If true, the flat matrix M will be such that M(y, x) = pxy[x][y],
+     *                  which is what is needed to compute likelihoods from the son's arrays.
+     *                  Otherwise, M(y, x) = pxy[y][x], which is needed when computing from the father's array.
+     * @param stride    The size of the rows of the flat matrix (at least the number of states).
+     *                  Padding values are set to 0.
+     * @param matrix    [out] The flat matrix, with M(y, x) = matrix[y * stride + x]. It will be resized if needed.
+     */
+    static void flattenTransitionMatrix(const VVdouble& pxy, bool transpose, size_t stride, std::vector<double>& matrix);
+
+    /**
+     * @brief Transpose a flat transition matrix.
+     *
+     * Matrices written by TransitionModel::fillPij_t() with padded rows can be used directly
+     * to compute likelihoods from the father's array. This method gives the matrix needed
+     * to compute likelihoods from the son's arrays.
+     *
+     * @param pxy        The transition matrix, as pxy[x * stride + y] = P(x -> y).
+     * @param stride     The size of the rows of both matrices (at least the number of states).
+     * @param nbStates   The number of states.
+     * @param matrix     [out] The flat matrix, with M(y, x) = matrix[y * stride + x] = P(x -> y).
+     *                   Padding values are left unchanged.
+     */
+    static void transposeTransitionMatrix(const double* pxy, size_t stride, size_t nbStates, double* matrix);
+
+    /**
+     * @brief Multiply conditional likelihood rows by the products of a transition matrix and another set of rows.
+     *
+     * For each row r < nbRows, compute out_r[x] *= sum_y M(y, x) in_r[y] for all x, y < nbStates.
+     * Row r of the input (resp. output) starts at in + r * inStep (resp. out + r * outStep).
+     *
+     * @param matrix   The flat matrix, as returned by flattenTransitionMatrix.
+     * @param stride   The size of the rows of the matrix.
+     * @param in       A pointer toward the first input row.
+     * @param inStep   The distance between two consecutive input rows.
+     * @param out      A pointer toward the first output row.
+     * @param outStep  The distance between two consecutive output rows.
+     * @param nbRows   The number of rows to process.
+     * @param nbStates The number of states.
+     */
+    static void multiplyTransitionProducts(
+        const double* matrix, size_t stride,
+        const double* in, size_t inStep,
+        double* out, size_t outStep,
+        size_t nbRows, size_t nbStates);
+
+    /**
+     * @return The instruction set currently used.
+     */
+    static InstructionSet getInstructionSet() { return instructionSet_; }
+
+    /**
+     * @brief Set the instruction set to use.
+     *
+     * This is mostly useful to force the scalar version, for instance for testing purposes.
+     *
+     * @param instructionSet The instruction set to use.
+     * @throw Exception If the instruction set is not supported by the processor.
+     */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+    /**
+     * @return True if the given instruction set is supported by the processor.
+     * @param instructionSet The instruction set to check.
+     */
+    static bool isSupported(InstructionSet instructionSet);
+
+  private:
+    static InstructionSet detectInstructionSet_();
+};
+
+} //end of namespace bpp.
+
+#endif //_LIKELIHOODKERNELS_H_
+
@@ -72,14 +72,20 @@ vector<size_t> MarginalAncestralStateReconstruction::getAncestralStatesForNode(i
       VVdouble* larray_i = &larray[i];
       Vdouble* probs_i = &probs[i];
       probs_i->resize(nbStates_);
+      double li = 0.;
       for (size_t c = 0; c < nbClasses_; c++)
       {
         Vdouble* larray_i_c = &(*larray_i)[c];
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*probs_i)[x] += (*larray_i_c)[x] * r_[c] / l_[i];
+          (*probs_i)[x] += (*larray_i_c)[x] * r_[c];
         }
       }
+      // Normalize with the sum, which is the site likelihood:
+      for (size_t x = 0; x < nbStates_; x++)
+        li += (*probs_i)[x];
+      for (size_t x = 0; x < nbStates_; x++)
+        (*probs_i)[x] /= li;
       if (sample)
       {
         cumProb = 0;
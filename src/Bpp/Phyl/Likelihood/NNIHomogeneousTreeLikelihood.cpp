@@ -47,6 +47,9 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <memory>
+#include <atomic>
+#include <algorithm>
 
 using namespace std;
 
@@ -94,26 +97,29 @@ void BranchLikelihood::computeLogLikelihood()
 {
   lnL_ = 0;
 
-  vector<double> la(array1_->size());
-  for (size_t i = 0; i < array1_->size(); i++)
+  size_t nbSites = array1_.getNumberOfSites();
+  vector<double> la(nbSites);
+  for (size_t i = 0; i < nbSites; i++)
   {
     double Li = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       double rc = rDist_->getProbability(c);
+      const double* array1_i_c = array1_(i, c);
+      const double* array2_i_c = array2_(i, c);
       for (size_t x = 0; x < nbStates_; x++)
       {
         for (size_t y = 0; y < nbStates_; y++)
         {
-          Li += rc * (*array1_)[i][c][x] * pxy_[c][x][y] * (*array2_)[i][c][y];
+          Li += rc * array1_i_c[x] * pxy_[c][x][y] * array2_i_c[y];
         }
       }
     }
-    la[i] = weights_[i] * log(Li);
+    la[i] = weights_[i] * (log(Li) - (scalingExponents_.empty() ? 0 : scalingExponents_[i]) * log(2.));
   }
 
   sort(la.begin(), la.end());
-  for (size_t i = array1_->size(); i > 0; i--)
+  for (size_t i = nbSites; i > 0; i--)
   {
     lnL_ -= la[i - 1];
   }
@@ -203,6 +209,63 @@ NNIHomogeneousTreeLikelihood::~NNIHomogeneousTreeLikelihood()
 
 /******************************************************************************/
 double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
+{
+  double brLen;
+  double diff = testNNI_(nodeId, *brLikFunction_, *brentOptimizer_, model_, getThreadPool_(), brLen);
+  brLenNNIValues_[nodeId] = brLen;
+  return diff;
+}
+
+/*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::testNNIs(const vector<int>& nodeIds, vector<double>& diffs) const
+{
+  size_t nbNNIs = nodeIds.size();
+  diffs.resize(nbNNIs);
+  ThreadPool* pool = getThreadPool_();
+  if (!pool || pool->getNumberOfThreads() < 2 || nbNNIs < 2)
+  {
+    for (size_t i = 0; i < nbNNIs; i++)
+    {
+      diffs[i] = testNNI(nodeIds[i]);
+    }
+    return;
+  }
+
+  // The model, function and optimizer store intermediate results, each thread needs its own copy:
+  size_t nbWorkers = min(nbNNIs, pool->getNumberOfThreads());
+  vector< unique_ptr<TransitionModel> > models(nbWorkers);
+  vector< unique_ptr<BranchLikelihood> > brLikFunctions(nbWorkers);
+  vector< unique_ptr<BrentOneDimension> > optimizers(nbWorkers);
+  for (size_t w = 0; w < nbWorkers; w++)
+  {
+    models[w].reset(model_->clone());
+    brLikFunctions[w].reset(brLikFunction_->clone());
+    optimizers[w].reset(dynamic_cast<BrentOneDimension*>(brentOptimizer_->clone()));
+  }
+
+  // NNIs are distributed dynamically, as the number of optimizer iterations varies:
+  vector<double> brLens(nbNNIs);
+  atomic<size_t> nextNNI(0);
+  pool->run(nbWorkers, [&](size_t w) {
+      for (size_t i = nextNNI++; i < nbNNIs; i = nextNNI++)
+      {
+        diffs[i] = testNNI_(nodeIds[i], *brLikFunctions[w], *optimizers[w], models[w].get(), 0, brLens[i]);
+      }
+    });
+  for (size_t i = 0; i < nbNNIs; i++)
+  {
+    brLenNNIValues_[nodeIds[i]] = brLens[i];
+  }
+}
+
+/*******************************************************************************/
+double NNIHomogeneousTreeLikelihood::testNNI_(
+  int nodeId,
+  BranchLikelihood& brLikFunction,
+  BrentOneDimension& optimizer,
+  const TransitionModel* model,
+  ThreadPool* pool,
+  double& brLen) const
 {
   const Node* son    = tree_->getNode(nodeId);
   if (!son->hasFather()) throw NodePException("DRHomogeneousTreeLikelihood::testNNI(). Node 'son' must not be the root node.", son);
@@ -216,96 +279,120 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const
   // const Node * uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
   const Node* uncle = grandFather->getSon(parentPosition > 1 ? 0 : 1 - parentPosition);
 
-  // Retrieving arrays of interest:
-  const DRASDRTreeLikelihoodNodeData* parentData = &getLikelihoodData()->getNodeData(parent->getId());
-  const VVVdouble* sonArray   = &parentData->getLikelihoodArrayForNeighbor(son->getId());
+  // Retrieving arrays of interest.
+  // This function may be called from several threads: maps are only accessed through find() or at(), which never insert.
+  const DRASDRTreeLikelihoodData* data = getLikelihoodData();
+  const map<int, vector<double> >& pxy = flatPxy_;
+  const map<int, vector<double> >& pyx = flatPyx_;
+  const DRASDRTreeLikelihoodNodeData* parentData = &data->getNodeData(parent->getId());
+  ConditionalLikelihoodArray sonArray = parentData->getLikelihoodArrayForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector<const VVVdouble*> parentArrays(nbParentNeighbors);
-  vector<const VVVdouble*> parentTProbs(nbParentNeighbors);
+  vector<ConditionalLikelihoodArray> parentArrays(nbParentNeighbors);
+  vector<const double*> parentTProbs(nbParentNeighbors);
+  vector<const vector<int>*> parentScalings(nbParentNeighbors);
   for (size_t k = 0; k < nbParentNeighbors; k++)
   {
     const Node* n = parentNeighbors[k]; // This neighbor
-    parentArrays[k] = &parentData->getLikelihoodArrayForNeighbor(n->getId());
+    parentArrays[k] = parentData->getLikelihoodArrayForNeighbor(n->getId());
+    parentScalings[k] = &data->getScalingExponents(parent->getId(), n->getId());
     // if(n != grandFather) parentTProbs[k] = & pxy_[n->getId()];
     // else                 parentTProbs[k] = & pxy_[parent->getId()];
-    parentTProbs[k] = &pxy_[n->getId()];
+    parentTProbs[k] = &pyx.at(n->getId())[0];
   }
 
-  const DRASDRTreeLikelihoodNodeData* grandFatherData = &getLikelihoodData()->getNodeData(grandFather->getId());
-  const VVVdouble* uncleArray      = &grandFatherData->getLikelihoodArrayForNeighbor(uncle->getId());
+  const DRASDRTreeLikelihoodNodeData* grandFatherData = &data->getNodeData(grandFather->getId());
+  ConditionalLikelihoodArray uncleArray = grandFatherData->getLikelihoodArrayForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector<const VVVdouble*> grandFatherArrays;
-  vector<const VVVdouble*> grandFatherTProbs;
+  vector<ConditionalLikelihoodArray> grandFatherArrays;
+  vector<const double*> grandFatherTProbs;
+  vector<const vector<int>*> grandFatherScalings;
   for (size_t k = 0; k < nbGrandFatherNeighbors; k++)
   {
     const Node* n = grandFatherNeighbors[k]; // This neighbor
     if (grandFather->getFather() == NULL || n != grandFather->getFather())
     {
-      grandFatherArrays.push_back(&grandFatherData->getLikelihoodArrayForNeighbor(n->getId()));
-      grandFatherTProbs.push_back(&pxy_[n->getId()]);
+      grandFatherArrays.push_back(grandFatherData->getLikelihoodArrayForNeighbor(n->getId()));
+      grandFatherTProbs.push_back(&pyx.at(n->getId())[0]);
     }
+    // The array toward the grand grand father, if any, is also used:
+    grandFatherScalings.push_back(&data->getScalingExponents(grandFather->getId(), n->getId()));
   }
 
   // Compute array 1: grand father array
-  VVVdouble array1 = *sonArray;
+  ConditionalLikelihoodBuffer array1Buffer;
+  array1Buffer.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray array1 = array1Buffer.getArray();
   resetLikelihoodArray(array1);
   grandFatherArrays.push_back(sonArray);
-  grandFatherTProbs.push_back(&pxy_[son->getId()]);
+  grandFatherTProbs.push_back(&pyx.at(son->getId())[0]);
+  grandFatherScalings.push_back(&data->getScalingExponents(parent->getId(), son->getId()));
   if (grandFather->hasFather())
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &grandFatherData->getLikelihoodArrayForNeighbor(grandFather->getFather()->getId()), &pxy_[grandFather->getId()], array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, grandFatherData->getLikelihoodArrayForNeighbor(grandFather->getFather()->getId()), &pxy.at(grandFather->getId())[0], array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false, pool);
   }
   else
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, array1, nbGrandFatherNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, array1, nbGrandFatherNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false, pool);
 
     // This is the root node, we have to account for the ancestral frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       for (size_t j = 0; j < nbClasses_; j++)
       {
+        double* array1_i_j = array1(i, j);
         for (size_t x = 0; x < nbStates_; x++)
         {
-          array1[i][j][x] *= rootFreqs_[x];
+          array1_i_j[x] *= rootFreqs_[x];
         }
       }
     }
   }
+  vector<int> array1Scaling;
+  scaleLikelihoodArray_(grandFatherScalings, array1, array1Scaling, pool);
 
   // Compute array 2: parent array
-  VVVdouble array2 = *uncleArray;
+  ConditionalLikelihoodBuffer array2Buffer;
+  array2Buffer.resize(1, nbDistinctSites_, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray array2 = array2Buffer.getArray();
   resetLikelihoodArray(array2);
   parentArrays.push_back(uncleArray);
-  parentTProbs.push_back(&pxy_[uncle->getId()]);
-  computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
+  parentTProbs.push_back(&pyx.at(uncle->getId())[0]);
+  parentScalings.push_back(&data->getScalingExponents(grandFather->getId(), uncle->getId()));
+  computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false, pool);
+  vector<int> array2Scaling;
+  scaleLikelihoodArray_(parentScalings, array2, array2Scaling, pool);
 
   // Initialize BranchLikelihood:
-  brLikFunction_->initModel(model_, rateDistribution_);
-  brLikFunction_->initLikelihoods(&array1, &array2);
+  brLikFunction.initModel(model, rateDistribution_);
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    array1Scaling[i] += array2Scaling[i];
+  }
+  brLikFunction.initLikelihoods(array1, array2, array1Scaling);
   ParameterList parameters;
   size_t pos = 0;
   while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
   if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::testNNI. Unvalid node id.");
-  Parameter brLen = getParameter("BrLen" + TextTools::toString(pos));
-  brLen.setName("BrLen");
-  parameters.addParameter(brLen);
-  brLikFunction_->setParameters(parameters);
+  Parameter brLenParameter = getParameter("BrLen" + TextTools::toString(pos));
+  brLenParameter.setName("BrLen");
+  parameters.addParameter(brLenParameter);
+  brLikFunction.setParameters(parameters);
 
   // Re-estimate branch length:
-  brentOptimizer_->setFunction(brLikFunction_);
-  brentOptimizer_->getStopCondition()->setTolerance(0.1);
-  brentOptimizer_->setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
-  brentOptimizer_->init(parameters);
-  brentOptimizer_->optimize();
-  // brLenNNIValues_[nodeId] = brLikFunction_->getParameterValue("BrLen");
-  brLenNNIValues_[nodeId] = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
-  brLikFunction_->resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
-                                      // We should not keep pointers towards them...
+  optimizer.setFunction(&brLikFunction);
+  optimizer.getStopCondition()->setTolerance(0.1);
+  optimizer.setInitialInterval(brLenParameter.getValue(), brLenParameter.getValue() + 0.01);
+  optimizer.init(parameters);
+  optimizer.optimize();
+  // brLen = brLikFunction.getParameterValue("BrLen");
+  brLen = optimizer.getParameters().getParameter("BrLen").getValue();
+  brLikFunction.resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
+                                    // We should not keep pointers towards them...
 
   // Return the resulting likelihood:
-  return brLikFunction_->getValue() - getValue();
+  return brLikFunction.getValue() - getValue();
 }
 
 /*******************************************************************************/
@@ -64,26 +64,28 @@ class BranchLikelihood :
   public AbstractParametrizable
 {
 protected:
-  const VVVdouble* array1_, * array2_;
+  ConditionalLikelihoodArray array1_, array2_;
   const TransitionModel* model_;
   const DiscreteDistribution* rDist_;
   size_t nbStates_, nbClasses_;
   VVVdouble pxy_;
   double lnL_;
   std::vector<unsigned int> weights_;
+  std::vector<int> scalingExponents_;
 
 public:
   BranchLikelihood(const std::vector<unsigned int>& weights) :
     AbstractParametrizable(""),
-    array1_(0),
-    array2_(0),
+    array1_(),
+    array2_(),
     model_(0),
     rDist_(0),
     nbStates_(0),
     nbClasses_(0),
     pxy_(),
     lnL_(log(0.)),
-    weights_(weights)
+    weights_(weights),
+    scalingExponents_()
   {
     addParameter_(new Parameter("BrLen", 1, 0));
   }
@@ -98,7 +100,8 @@ public:
     nbClasses_(bl.nbClasses_),
     pxy_(bl.pxy_),
     lnL_(bl.lnL_),
-    weights_(bl.weights_)
+    weights_(bl.weights_),
+    scalingExponents_(bl.scalingExponents_)
   {}
 
   BranchLikelihood& operator=(const BranchLikelihood& bl)
@@ -113,6 +116,7 @@ public:
     pxy_ = bl.pxy_;
     lnL_ = bl.lnL_;
     weights_ = bl.weights_;
+    scalingExponents_ = bl.scalingExponents_;
     return *this;
   }
 
@@ -127,16 +131,32 @@ public:
    * @warning No checking on alphabet size or number of rate classes is performed,
    * use with care!
    */
-  void initLikelihoods(const VVVdouble* array1, const VVVdouble* array2)
+  void initLikelihoods(const ConditionalLikelihoodArray& array1, const ConditionalLikelihoodArray& array2)
   {
     array1_ = array1;
     array2_ = array2;
+    scalingExponents_.clear();
+  }
+
+  /**
+   * @brief Set the arrays, scaled by 2 to the power of the given exponents.
+   *
+   * @param array1 The first array.
+   * @param array2 The second array.
+   * @param scalingExponents For each site, the sum of the scaling exponents of both arrays.
+   */
+  void initLikelihoods(const ConditionalLikelihoodArray& array1, const ConditionalLikelihoodArray& array2, const std::vector<int>& scalingExponents)
+  {
+    array1_ = array1;
+    array2_ = array2;
+    scalingExponents_ = scalingExponents;
   }
 
   void resetLikelihoods()
   {
-    array1_ = 0;
-    array2_ = 0;
+    array1_ = ConditionalLikelihoodArray();
+    array2_ = ConditionalLikelihoodArray();
+    scalingExponents_.clear();
   }
 
   void setParameters(const ParameterList& parameters)
@@ -254,6 +274,13 @@ public:
 
   double testNNI(int nodeId) const;
 
+  /**
+   * If several threads are used (see setNumberOfThreads()), NNIs are tested in parallel,
+   * each thread using its own copy of the substitution model, branch likelihood function and optimizer.
+   * Results are identical to the ones of successive calls to testNNI().
+   */
+  void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const;
+
   void doNNI(int nodeId);
 
   void topologyChangeTested(const TopologyChangeEvent& event)
@@ -269,6 +296,26 @@ public:
     brLenNNIValues_.clear();
   }
   /** @} */
+
+protected:
+  /**
+   * @brief Test a NNI using the given objects.
+   *
+   * @param nodeId        The id of the node defining the NNI movement.
+   * @param brLikFunction The function used to compute the likelihood of the new topology.
+   * @param optimizer     The optimizer used to estimate the length of the modified branch.
+   * @param model         The substitution model to use (a copy of the model of this instance, or this model itself).
+   * @param pool          The thread pool to use to compute conditional likelihoods, possibly null.
+   * @param brLen         [out] The estimated branch length.
+   * @return The score variation of the NNI.
+   */
+  double testNNI_(
+    int nodeId,
+    BranchLikelihood& brLikFunction,
+    BrentOneDimension& optimizer,
+    const TransitionModel* model,
+    ThreadPool* pool,
+    double& brLen) const;
 };
 } // end of namespace bpp.
 
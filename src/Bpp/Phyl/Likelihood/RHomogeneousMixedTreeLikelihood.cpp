@@ -128,6 +128,7 @@ RHomogeneousMixedTreeLikelihood::RHomogeneousMixedTreeLikelihood(const RHomogene
     treeLikelihoodsContainer_[i] = lik.treeLikelihoodsContainer_[i]->clone();
     probas_.push_back(lik.probas_[i]);
   }
+  setThreadPool(threadPool_);
 }
 
 RHomogeneousMixedTreeLikelihood::~RHomogeneousMixedTreeLikelihood()
@@ -159,6 +160,23 @@ void RHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites)
   }
 }
 
+/******************************************************************************/
+
+void RHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  RHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+  setThreadPool(threadPool_);
+}
+
+void RHomogeneousMixedTreeLikelihood::setThreadPool(const std::shared_ptr<ThreadPool>& pool)
+{
+  RHomogeneousTreeLikelihood::setThreadPool(pool);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setThreadPool(pool);
+  }
+}
+
 
 void RHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList& params)
 {
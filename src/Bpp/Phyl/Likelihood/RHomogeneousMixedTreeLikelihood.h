@@ -132,6 +132,17 @@ public:
    */
   void setData(const SiteContainer& sites);
 
+  /**
+   * @brief Set the number of threads, for this object and all sub-likelihoods.
+   *
+   * The sub-likelihoods share the thread pool of this object.
+   *
+   * @param nbThreads The number of threads to use.
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  void setThreadPool(const std::shared_ptr<ThreadPool>& pool);
+
   /** @} */
 
 
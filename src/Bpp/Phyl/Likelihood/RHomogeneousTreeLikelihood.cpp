@@ -38,6 +38,7 @@
  */
 
 #include "RHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -47,6 +48,8 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -61,6 +64,7 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   bool usePatterns) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(-1.)
 {
   init_(usePatterns);
@@ -78,6 +82,7 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   bool usePatterns) :
   AbstractHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(-1.)
 {
   init_(usePatterns);
@@ -88,6 +93,8 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
 
 void RHomogeneousTreeLikelihood::init_(bool usePatterns)
 {
+  // computeTransitionProbabilitiesForNode() is not overridden here:
+  batchTransitionProbabilities_ = true;
   likelihoodData_ = new DRASRTreeLikelihoodData(
     tree_,
     rateDistribution_->getNumberOfCategories(),
@@ -100,10 +107,13 @@ RHomogeneousTreeLikelihood::RHomogeneousTreeLikelihood(
   const RHomogeneousTreeLikelihood& lik) :
   AbstractHomogeneousTreeLikelihood(lik),
   likelihoodData_(0),
+  arraysRevision_(0),
   minusLogLik_(lik.minusLogLik_)
 {
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  // The copy has its own tree, with its own modification counter:
+  arraysRevision_ = (lik.arraysRevision_ != 0 && lik.arraysRevision_ == lik.tree_->getRevision()) ? tree_->getRevision() : 0;
 }
 
 /******************************************************************************/
@@ -115,6 +125,8 @@ RHomogeneousTreeLikelihood& RHomogeneousTreeLikelihood::operator=(
   if (likelihoodData_) delete likelihoodData_;
   likelihoodData_ = dynamic_cast<DRASRTreeLikelihoodData*>(lik.likelihoodData_->clone());
   likelihoodData_->setTree(tree_);
+  // The copy has its own tree, with its own modification counter:
+  arraysRevision_ = (lik.arraysRevision_ != 0 && lik.arraysRevision_ == lik.tree_->getRevision()) ? tree_->getRevision() : 0;
   minusLogLik_ = lik.minusLogLik_;
   return *this;
 }
@@ -142,6 +154,7 @@ void RHomogeneousTreeLikelihood::setData(const SiteContainer& sites)
 
   if (verbose_) ApplicationTools::displayResult("Number of distinct sites",
                                                 TextTools::toString(nbDistinctSites_));
+  arraysRevision_ = 0;
   initialized_ = false;
 }
 
@@ -179,36 +192,56 @@ double RHomogeneousTreeLikelihood::getLogLikelihood() const
 
 double RHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 {
-  double l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    l += getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return l;
+  return ldexp(getScaledLikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
-  double l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    double li = getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-    if (li > 0) l+= li; //Corrects for numerical instabilities leading to slightly negative likelihoods
-  }
-  return log(l);
+  double l = getScaledLikelihoodForASite_(site);
+  if (l < 0) l = 0; //May happen because of numerical errors.
+  return log(l) - likelihoodData_->getRootScalingExponent(site) * log(2.);
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return ldexp(getScaledLikelihoodForASiteForARateClass_(site, rateClass), -likelihoodData_->getRootScalingExponent(site));
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return log(getScaledLikelihoodForASiteForARateClass_(site, rateClass)) - likelihoodData_->getRootScalingExponent(site) * log(2.);
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+{
+  double l = likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return ldexp(l, -likelihoodData_->getRootScalingExponent(site));
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+{
+  double l = likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return log(l) - likelihoodData_->getRootScalingExponent(site) * log(2.);
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const
 {
   double l = 0;
   Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
   for (size_t i = 0; i < nbStates_; i++)
   {
-    //cout << (*la)[i] << "\t" << rootFreqs_[i] << endl;
     double li = (*la)[i] * rootFreqs_[i];
     if (li > 0) l+= li; //Corrects for numerical instabilities leading to slightly negative likelihoods
   }
@@ -217,30 +250,52 @@ double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t sit
 
 /******************************************************************************/
 
-double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+double RHomogeneousTreeLikelihood::getScaledLikelihoodForASite_(size_t site) const
 {
   double l = 0;
-  Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
-  for (size_t i = 0; i < nbStates_; i++)
+  for (size_t i = 0; i < nbClasses_; i++)
   {
-    l += (*la)[i] * rootFreqs_[i];
+    l += getScaledLikelihoodForASiteForARateClass_(site, i) * rateDistribution_->getProbability(i);
   }
-  //if(l <= 0.) cerr << "WARNING!!! Negative likelihood." << endl;
-  return log(l);
+  return l;
 }
 
 /******************************************************************************/
 
-double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+double RHomogeneousTreeLikelihood::getScaledDLikelihoodForASite_(size_t site) const
 {
-  return likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  // Derivative of the sum is the sum of derivatives:
+  double dl = 0;
+  VVdouble* dla = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    double dlc = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      dlc += (*dla)[c][i] * rootFreqs_[i];
+    }
+    dl += dlc * rateDistribution_->getProbability(c);
+  }
+  return dl;
 }
 
 /******************************************************************************/
 
-double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+double RHomogeneousTreeLikelihood::getScaledD2LikelihoodForASite_(size_t site) const
 {
-  return log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  // Derivative of the sum is the sum of derivatives:
+  double d2l = 0;
+  VVdouble* d2la = &likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    double d2lc = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      d2lc += (*d2la)[c][i] * rootFreqs_[i];
+    }
+    d2l += d2lc * rateDistribution_->getProbability(c);
+  }
+  return d2l;
 }
 
 /******************************************************************************/
@@ -256,11 +311,15 @@ void RHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& param
 {
   applyParameters();
 
+  //Nodes whose likelihood arrays must be recomputed, if not all of them:
+  bool updateAll = (params.size() == 0 || arraysRevision_ == 0 || arraysRevision_ != tree_->getRevision());
+  set<int> dirtyNodes;
   if (rateDistribution_->getParameters().getCommonParametersWith(params).size() > 0
       || model_->getParameters().getCommonParametersWith(params).size() > 0)
   {
     //Rate parameter changed, need to recompute all probs:
     computeAllTransitionProbabilities();
+    updateAll = true;
   }
   else if (params.size() > 0)
   {
@@ -271,13 +330,21 @@ void RHomogeneousTreeLikelihood::fireParameterChanged(const ParameterList& param
       if (s.substr(0, 5) == "BrLen")
       {
         //Branch length parameter:
-        computeTransitionProbabilitiesForNode(nodes_[TextTools::to<size_t>(s.substr(5))]);
+        const Node* node = nodes_[TextTools::to<size_t>(s.substr(5))];
+        computeTransitionProbabilitiesForNode(node);
+        //All ancestors of the branch are affected:
+        for (const Node* n = node->getFather(); n && dirtyNodes.insert(n->getId()).second; n = n->getFather()) {}
       }
+      else
+        updateAll = true;
     }
     rootFreqs_ = model_->getFrequencies();
   }
 
-  computeTreeLikelihood();
+  if (updateAll)
+    computeTreeLikelihood();
+  else
+    computeSubtreeLikelihood_(tree_->getRootNode(), &dirtyNodes);
 
   minusLogLik_ = -getLogLikelihood();
 }
@@ -304,28 +371,23 @@ double RHomogeneousTreeLikelihood::getDLikelihoodForASiteForARateClass(
   {
     dl += (*dla)[i] * rootFreqs_[i];
   }
-  return dl;
+  return ldexp(dl, -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getDLikelihoodForASite(size_t site) const
 {
-  // Derivative of the sum is the sum of derivatives:
-  double dl = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    dl += getDLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return dl;
+  return ldexp(getScaledDLikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getDLogLikelihoodForASite(size_t site) const
 {
-  // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg :
-  return getDLikelihoodForASite(site) / getLikelihoodForASite(site);
+  // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg
+  // Scaling factors cancel out:
+  return getScaledDLikelihoodForASite_(site) / getScaledLikelihoodForASite_(site);
 }
 
 /******************************************************************************/
@@ -397,55 +459,63 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
     if (son == branch)
     {
       VVVdouble* dpxy__son = &dpxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* dpxy__son_c = &(*dpxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* dpxy__son_c = &(*dpxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeDLikelihood(father);
 }
@@ -487,55 +557,63 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
     if (son == node)
     {
       VVVdouble* _dLikelihoods_son = &likelihoodData_->getDLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_dLikelihoods_father_i_c)[x] *= dl;
             }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeDLikelihood(father);
 }
@@ -554,28 +632,24 @@ double RHomogeneousTreeLikelihood::getD2LikelihoodForASiteForARateClass(
   {
     d2l += (*d2la)[i] * rootFreqs_[i];
   }
-  return d2l;
+  return ldexp(d2l, -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getD2LikelihoodForASite(size_t site) const
 {
-  // Derivative of the sum is the sum of derivatives:
-  double d2l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    d2l += getD2LikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return d2l;
+  return ldexp(getScaledD2LikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getD2LogLikelihoodForASite(size_t site) const
 {
-  return getD2LikelihoodForASite(site) / getLikelihoodForASite(site)
-         - pow( getDLikelihoodForASite(site) / getLikelihoodForASite(site), 2);
+  // Scaling factors cancel out:
+  double l = getScaledLikelihoodForASite_(site);
+  return getScaledD2LikelihoodForASite_(site) / l
+         - pow( getScaledDLikelihoodForASite_(site) / l, 2);
 }
 
 /******************************************************************************/
@@ -647,55 +721,63 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
     if (son == branch)
     {
       VVVdouble* d2pxy__son = &d2pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeD2Likelihood(father);
 }
@@ -737,55 +819,63 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
     if (son == node)
     {
       VVVdouble* _d2Likelihoods_son = &likelihoodData_->getD2LikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              double d2l = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= d2l;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
           }
         }
-      }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
       {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t i = begin; i < end; i++)
         {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
+          VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
+          VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
+            Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
+            Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
+            VVdouble* pxy__son_c = &(*pxy__son)[c];
+            for (size_t x = 0; x < nbStates_; x++)
             {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              double dl = 0;
+              Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
+              }
+              (*_d2Likelihoods_father_i_c)[x] *= dl;
             }
-            (*_d2Likelihoods_father_i_c)[x] *= dl;
           }
         }
-      }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeD2Likelihood(father);
 }
@@ -794,72 +884,110 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
 
 void RHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
+  unsigned long revision = tree_->getRevision();
   computeSubtreeLikelihood(tree_->getRootNode());
+  arraysRevision_ = revision;
 }
 
 /******************************************************************************/
 
 void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
+{
+  computeSubtreeLikelihood_(node, 0);
+}
+
+/******************************************************************************/
+
+void RHomogeneousTreeLikelihood::computeSubtreeLikelihood_(const Node* node, const set<int>* dirtyNodes)
 {
   if (node->isLeaf()) return;
 
   size_t nbSites = likelihoodData_->getLikelihoodArray(node->getId()).size();
   size_t nbNodes = node->getNumberOfSons();
 
-  // Must reset the likelihood array first (i.e. set all of them to 1):
-  VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
-  for (size_t i = 0; i < nbSites; i++)
-  {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
-      }
-    }
-  }
+  DRASRTreeLikelihoodNodeData* _data_node = &likelihoodData_->getNodeData(node->getId());
+  vector<int>* _scaling_node = &_data_node->getSubtreeScalingExponents();
+  vector<int>* _nodeScaling_node = &_data_node->getNodeScalingExponents();
+  fill(_scaling_node->begin(), _scaling_node->end(), 0);
+  fill(_nodeScaling_node->begin(), _nodeScaling_node->end(), 0);
 
   for (size_t l = 0; l < nbNodes; l++)
   {
     //For each son node,
-
     const Node* son = node->getSon(l);
 
-    computeSubtreeLikelihood(son); //Recursive method:
+    //Recursive method:
+    if (!dirtyNodes)
+      computeSubtreeLikelihood(son);
+    else if (dirtyNodes->find(son->getId()) != dirtyNodes->end())
+      computeSubtreeLikelihood_(son, dirtyNodes);
+  }
 
-    VVVdouble* pxy__son = &pxy_[son->getId()];
+  // Products are computed in contiguous arrays, so that the kernel processes all sites
+  // of a chunk at once for each rate class. The likelihoods of each son are gathered
+  // in the second array, following the pattern links:
+  ConditionalLikelihoodBuffer buffer;
+  buffer.resize(2, nbSites, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray products = buffer.getArray(0);
+  ConditionalLikelihoodArray sonLikelihoods = buffer.getArray(1);
+  resetLikelihoodArray(products);
+  size_t stride = buffer.getStride();
+  size_t size = nbStates_ * stride;
+  size_t step = nbClasses_ * stride;
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    const Node* son = node->getSon(l);
+    const double* pyx__son = &flatPyx_[son->getId()][0];
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
+    vector<int>* _scaling_son = &likelihoodData_->getNodeData(son->getId()).getSubtreeScalingExponents();
 
-    for (size_t i = 0; i < nbSites; i++)
+    ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
     {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+      for (size_t i = begin; i < end; i++)
       {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
+        //For each site in the sequence,
+        size_t j = (*_patternLinks_node_son)[i];
+        VVdouble* _likelihoods_son_j = &(*_likelihoods_son)[j];
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-          
-          (*_likelihoods_node_i_c)[x] *= likelihood;
+          std::copy((*_likelihoods_son_j)[c].begin(), (*_likelihoods_son_j)[c].end(), sonLikelihoods(i, c));
         }
+        (*_scaling_node)[i] += (*_scaling_son)[j];
       }
-    }
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        //For each rate classe,
+        LikelihoodKernels::multiplyTransitionProducts(
+            pyx__son + c * size, stride,
+            sonLikelihoods(begin, c), step,
+            products(begin, c), step,
+            end - begin, nbStates_);
+      }
+    });
   }
+
+  // Rescale sites with too small likelihoods, and copy the result:
+  VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
+  bool scaling = likelihoodData_->isScalingEnabled();
+  ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+    {
+      if (scaling)
+      {
+        int e = ConditionalLikelihoodScaling::scaleLikelihoods(products, i);
+        (*_nodeScaling_node)[i] = e;
+        (*_scaling_node)[i] += e;
+      }
+      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const double* products_i_c = products(i, c);
+        std::copy(products_i_c, products_i_c + nbStates_, (*_likelihoods_node_i)[c].begin());
+      }
+    }
+  });
 }
 
 /******************************************************************************/
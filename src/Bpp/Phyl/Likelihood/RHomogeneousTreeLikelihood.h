@@ -47,6 +47,9 @@
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 
+// From the STL:
+#include <set>
+
 namespace bpp
 {
 
@@ -57,6 +60,10 @@ namespace bpp
    * A non uniform distribution of rates among the sites is allowed (ASRV models).</p>
    *
    * This class uses an instance of the DRASRTreeLikelihoodData for conditionnal likelihood storage.
+   * Conditional likelihoods are rescaled when they get too small, so that large trees can be analysed
+   * without numerical underflow (see DRASRTreeLikelihoodData). Log-likelihoods and their derivatives
+   * are computed from the scaled values, while methods returning likelihoods correct for scaling,
+   * and may therefore return 0 for very large trees.
    *
    * This class can also use a simple or recursive site compression.
    * In the simple case, computations for identical sites are not duplicated.
@@ -86,6 +93,12 @@ namespace bpp
 
     mutable DRASRTreeLikelihoodData* likelihoodData_;
 
+    /**
+     * @brief The value of TreeTemplate::getRevision() for tree_ when likelihood arrays were last computed for the whole tree,
+     * or 0 if they are not valid.
+     */
+    unsigned long arraysRevision_;
+
   protected:
     double minusLogLik_;
 
@@ -244,6 +257,20 @@ namespace bpp
 
 	
   protected:
+
+    /**
+     * @name Scaled likelihoods.
+     *
+     * These methods return likelihoods as computed from the root arrays, that is, multiplied by 2^e,
+     * e being the root scaling exponent of the site (see DRASRTreeLikelihoodData::getRootScalingExponent()).
+     *
+     * @{
+     */
+    double getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const;
+    double getScaledLikelihoodForASite_(size_t site) const;
+    double getScaledDLikelihoodForASite_(size_t site) const;
+    double getScaledD2LikelihoodForASite_(size_t site) const;
+    /** @} */
 			
     /**
      * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
@@ -251,10 +278,29 @@ namespace bpp
      * @param node The root of the subtree.
      */
     virtual void computeSubtreeLikelihood(const Node* node); //Recursive method.			
+
+    /**
+     * @brief Compute the likelihood for the nodes of a subtree whose arrays are not up to date.
+     *
+     * @param node       The root of the subtree, which is always recomputed.
+     * @param dirtyNodes The ids of the nodes to recompute, or 0 to recompute all nodes.
+     * Arrays of other nodes are used as they are.
+     */
+    void computeSubtreeLikelihood_(const Node* node, const std::set<int>* dirtyNodes); //Recursive method.
+
     virtual void computeDownSubtreeDLikelihood(const Node*);
 		
     virtual void computeDownSubtreeD2Likelihood(const Node*);
 	
+    /**
+     * @brief Update the likelihood after a parameter change.
+     *
+     * If only branch lengths changed, and the topology of the tree was not modified since
+     * the last full computation, only the nodes on the paths from the modified branches to
+     * the root are recomputed.
+     *
+     * @param params The parameters that changed.
+     */
     void fireParameterChanged(const ParameterList& params);
 	
     /**
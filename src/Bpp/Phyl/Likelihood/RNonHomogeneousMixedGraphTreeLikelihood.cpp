@@ -0,0 +1,824 @@
+//
+// File: RNonHomogeneousMixedGraphTreeLikelihood.cpp
+// Created by: agent
+// Created on: Fri Oct 16 22:25 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#include "RNonHomogeneousMixedGraphTreeLikelihood.h"
+#include "LikelihoodKernels.h"
+#include "../Model/MixedTransitionModel.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+/******************************************************************************/
+
+RNonHomogeneousMixedGraphTreeLikelihood::RNonHomogeneousMixedGraphTreeLikelihood(
+  const Tree& tree,
+  MixedSubstitutionModelSet* modelSet,
+  DiscreteDistribution* rDist,
+  bool verbose,
+  bool usePatterns) :
+  RNonHomogeneousTreeLikelihood(tree, modelSet, rDist, verbose, usePatterns),
+  nodeArrays_(3),
+  subtreeModels_(),
+  summedModels_(),
+  transitionMatrices_(),
+  dTransitionMatrices_(),
+  segments_()
+{
+  // Arrays of several submodels combinations are summed, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+  initModelsStructure_();
+}
+
+/******************************************************************************/
+
+RNonHomogeneousMixedGraphTreeLikelihood::RNonHomogeneousMixedGraphTreeLikelihood(
+  const Tree& tree,
+  const SiteContainer& data,
+  MixedSubstitutionModelSet* modelSet,
+  DiscreteDistribution* rDist,
+  bool verbose,
+  bool usePatterns) :
+  RNonHomogeneousTreeLikelihood(tree, data, modelSet, rDist, verbose, usePatterns),
+  nodeArrays_(3),
+  subtreeModels_(),
+  summedModels_(),
+  transitionMatrices_(),
+  dTransitionMatrices_(),
+  segments_()
+{
+  // Arrays of several submodels combinations are summed, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+  initModelsStructure_();
+  initArrays_();
+}
+
+/******************************************************************************/
+
+RNonHomogeneousMixedGraphTreeLikelihood::RNonHomogeneousMixedGraphTreeLikelihood(
+  const RNonHomogeneousMixedGraphTreeLikelihood& lik) :
+  RNonHomogeneousTreeLikelihood(lik),
+  nodeArrays_(lik.nodeArrays_),
+  subtreeModels_(lik.subtreeModels_),
+  summedModels_(lik.summedModels_),
+  transitionMatrices_(lik.transitionMatrices_),
+  dTransitionMatrices_(lik.dTransitionMatrices_),
+  segments_(lik.segments_)
+{}
+
+/******************************************************************************/
+
+RNonHomogeneousMixedGraphTreeLikelihood& RNonHomogeneousMixedGraphTreeLikelihood::operator=(
+  const RNonHomogeneousMixedGraphTreeLikelihood& lik)
+{
+  RNonHomogeneousTreeLikelihood::operator=(lik);
+  nodeArrays_          = lik.nodeArrays_;
+  subtreeModels_       = lik.subtreeModels_;
+  summedModels_        = lik.summedModels_;
+  transitionMatrices_  = lik.transitionMatrices_;
+  dTransitionMatrices_ = lik.dTransitionMatrices_;
+  segments_            = lik.segments_;
+  return *this;
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::initModelsStructure_()
+{
+  subtreeModels_.clear();
+  summedModels_.clear();
+  // First pass to get the total number of branches of each model:
+  vector<size_t> nbBranches = countModels_(tree_->getRootNode(), vector<size_t>());
+  // Second pass to find where the shared mixed models are summed:
+  subtreeModels_.clear();
+  countModels_(tree_->getRootNode(), nbBranches);
+}
+
+/******************************************************************************/
+
+vector<size_t> RNonHomogeneousMixedGraphTreeLikelihood::countModels_(const Node* node, const vector<size_t>& nbBranches)
+{
+  size_t nbModels = modelSet_->getNumberOfModels();
+  vector<size_t> counts(nbModels, 0);
+  vector< vector<size_t> > sonsCounts;
+  for (size_t l = 0; l < node->getNumberOfSons(); l++)
+  {
+    const Node* son = node->getSon(l);
+    vector<size_t> sonCounts = countModels_(son, nbBranches);
+    for (size_t m = 0; m < nbModels; m++)
+    {
+      counts[m] += sonCounts[m];
+    }
+    vector<size_t> branchModels = getBranchModels_(son->getId());
+    for (size_t j = 0; j < branchModels.size(); j++)
+    {
+      counts[branchModels[j]]++;
+    }
+    sonsCounts.push_back(sonCounts);
+  }
+
+  int id = node->getId();
+  vector<size_t>* subtreeModels = &subtreeModels_[id];
+  for (size_t m = 0; m < nbModels; m++)
+  {
+    if (counts[m] == 0 || !dynamic_cast<const MixedTransitionModel*>(modelSet_->getModel(m)))
+      continue;
+    subtreeModels->push_back(m);
+    if (nbBranches.size() == 0 || nbBranches[m] < 2 || counts[m] < nbBranches[m])
+      continue;
+    // All the branches of the model are below this node, it is summed here
+    // unless they are all strictly below one of the sons:
+    bool below = false;
+    for (size_t l = 0; l < sonsCounts.size() && !below; l++)
+    {
+      below = (sonsCounts[l][m] == nbBranches[m]);
+    }
+    if (!below)
+      summedModels_[id].push_back(m);
+  }
+  return counts;
+}
+
+/******************************************************************************/
+
+vector<size_t> RNonHomogeneousMixedGraphTreeLikelihood::getBranchModels_(int nodeId) const
+{
+  map<int, BranchSegments>::const_iterator it = segments_.find(nodeId);
+  if (it == segments_.end())
+    return vector<size_t>(1, modelSet_->getModelIndexForNode(nodeId));
+  vector<size_t> models;
+  for (size_t k = 0; k < it->second.size(); k++)
+  {
+    models.push_back(it->second[k].first);
+  }
+  sort(models.begin(), models.end());
+  models.erase(unique(models.begin(), models.end()), models.end());
+  return models;
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::setData(const SiteContainer& sites)
+{
+  RNonHomogeneousTreeLikelihood::setData(sites);
+  initArrays_();
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::initArrays_()
+{
+  for (size_t order = 0; order < nodeArrays_.size(); order++)
+  {
+    nodeArrays_[order].clear();
+  }
+  transitionMatrices_.clear();
+  dTransitionMatrices_.clear();
+
+  vector<Node*> leaves = tree_->getLeaves();
+  for (size_t k = 0; k < leaves.size(); k++)
+  {
+    int id = leaves[k]->getId();
+    const VVVdouble* leafArray = &getLikelihoodData()->getLikelihoodArray(id);
+    NodeArrays_* arrays = &nodeArrays_[0][id];
+    arrays->arrays.push_back(ConditionalLikelihoodBuffer());
+    arrays->arrays.back().resize(1, leafArray->size(), nbClasses_, nbStates_);
+    arrays->computed.push_back(true);
+    ConditionalLikelihoodArray array = arrays->arrays.back().getArray();
+    for (size_t i = 0; i < leafArray->size(); i++)
+    {
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const Vdouble* leafArray_i_c = &(*leafArray)[i][c];
+        copy(leafArray_i_c->begin(), leafArray_i_c->begin() + static_cast<ptrdiff_t>(nbStates_), array(i, c));
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+size_t RNonHomogeneousMixedGraphTreeLikelihood::getNumberOfArrays(int nodeId) const
+{
+  map<int, NodeArrays_>::const_iterator it = nodeArrays_[0].find(nodeId);
+  return it == nodeArrays_[0].end() ? 0 : it->second.arrays.size();
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::computeTransitionProbabilitiesForNode(const Node* node)
+{
+  // Keep the averaged probabilities available to the TreeLikelihood interface:
+  AbstractNonHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(node);
+  invalidateBranch_(node);
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::invalidateBranch_(const Node* node)
+{
+  transitionMatrices_.erase(node->getId());
+  for (const Node* father = node->getFather(); father; father = father->getFather())
+  {
+    map<int, NodeArrays_>::iterator it = nodeArrays_[0].find(father->getId());
+    if (it != nodeArrays_[0].end())
+      fill(it->second.computed.begin(), it->second.computed.end(), false);
+  }
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::fireParameterChanged(const ParameterList& params)
+{
+  // Split branches may use other models than the one of their node:
+  if (segments_.size() > 0 && params.getCommonParametersWith(modelSet_->getNodeParameters()).size() > 0)
+  {
+    for (map<int, BranchSegments>::const_iterator it = segments_.begin(); it != segments_.end(); it++)
+    {
+      invalidateBranch_(tree_->getNode(it->first));
+    }
+  }
+  RNonHomogeneousTreeLikelihood::fireParameterChanged(params);
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments(const map<int, BranchSegments>& segments)
+{
+  if (!isInitialized())
+    throw Exception("RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments. Object is not initialized.");
+
+  ParameterList brLens;
+  bool structureChanged = false;
+  for (map<int, BranchSegments>::const_iterator it = segments.begin(); it != segments.end(); it++)
+  {
+    const Node* node = tree_->getNode(it->first);
+    if (!node->hasFather())
+      throw Exception("RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments. Node " + TextTools::toString(it->first) + " has no branch above it.");
+    if (it->second.size() == 0)
+      throw Exception("RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments. No segment for the branch of node " + TextTools::toString(it->first) + ".");
+
+    double length = 0;
+    for (size_t k = 0; k < it->second.size(); k++)
+    {
+      if (it->second[k].first >= modelSet_->getNumberOfModels())
+        throw IndexOutOfBoundsException("RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments. Bad model index.", it->second[k].first, 0, modelSet_->getNumberOfModels() - 1);
+      if (it->second[k].second < 0)
+        throw Exception("RNonHomogeneousMixedGraphTreeLikelihood::setBranchSegments. Negative segment length for the branch of node " + TextTools::toString(it->first) + ".");
+      length += it->second[k].second;
+    }
+
+    // Segments are stored with relative lengths, so that the branch length remains a parameter:
+    BranchSegments relative = it->second;
+    for (size_t k = 0; k < relative.size(); k++)
+    {
+      relative[k].second = (length > 0 ? relative[k].second / length : 1. / static_cast<double>(relative.size()));
+    }
+
+    map<int, BranchSegments>::const_iterator itOld = segments_.find(it->first);
+    if (itOld == segments_.end() || itOld->second != relative)
+    {
+      segments_[it->first] = relative;
+      invalidateBranch_(node);
+      structureChanged = true;
+    }
+
+    size_t index = static_cast<size_t>(find(nodes_.begin(), nodes_.end(), node) - nodes_.begin());
+    string name = "BrLen" + TextTools::toString(index);
+    if (hasParameter(name))
+    {
+      Parameter brLen(getParameter(name));
+      brLen.setValue(max(minimumBrLen_, min(maximumBrLen_, length)));
+      brLens.addParameter(brLen);
+    }
+  }
+
+  if (structureChanged)
+  {
+    // The mixed models may now be shared at other nodes, arrays are indexed differently:
+    initModelsStructure_();
+    for (map<int, BranchSegments>::const_iterator it = segments.begin(); it != segments.end(); it++)
+    {
+      for (const Node* father = tree_->getNode(it->first)->getFather(); father; father = father->getFather())
+      {
+        for (size_t order = 0; order < nodeArrays_.size(); order++)
+        {
+          nodeArrays_[order].erase(father->getId());
+        }
+      }
+    }
+  }
+
+  // Only the arrays above the modified branches are recomputed:
+  if (!matchParametersValues(brLens))
+    fireParameterChanged(ParameterList());
+}
+
+/******************************************************************************/
+
+RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments RNonHomogeneousMixedGraphTreeLikelihood::getBranchSegments(int nodeId) const
+{
+  double length = tree_->getNode(nodeId)->getDistanceToFather();
+  map<int, BranchSegments>::const_iterator it = segments_.find(nodeId);
+  if (it == segments_.end())
+    return BranchSegments(1, make_pair(modelSet_->getModelIndexForNode(nodeId), length));
+  BranchSegments segments = it->second;
+  for (size_t k = 0; k < segments.size(); k++)
+  {
+    segments[k].second *= length;
+  }
+  return segments;
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::computeTreeLikelihood()
+{
+  computeRootArray_(0, 0, getLikelihoodData()->getLikelihoodArray(tree_->getRootNode()->getId()));
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::computeTreeDLikelihood(const string& variable)
+{
+  size_t brI = TextTools::to<size_t>(variable.substr(5));
+  const Node* branch = nodes_[brI];
+
+  map<int, NodeArrays_>::iterator it;
+  for (it = nodeArrays_[1].begin(); it != nodeArrays_[1].end(); it++)
+  {
+    fill(it->second.computed.begin(), it->second.computed.end(), false);
+  }
+  dTransitionMatrices_.clear();
+  computeRootArray_(1, branch, getLikelihoodData()->getDLikelihoodArray(tree_->getRootNode()->getId()));
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::computeTreeD2Likelihood(const string& variable)
+{
+  size_t brI = TextTools::to<size_t>(variable.substr(5));
+  const Node* branch = nodes_[brI];
+
+  map<int, NodeArrays_>::iterator it;
+  for (it = nodeArrays_[2].begin(); it != nodeArrays_[2].end(); it++)
+  {
+    fill(it->second.computed.begin(), it->second.computed.end(), false);
+  }
+  dTransitionMatrices_.clear();
+  computeRootArray_(2, branch, getLikelihoodData()->getD2LikelihoodArray(tree_->getRootNode()->getId()));
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::computeRootArray_(size_t order, const Node* branch, VVVdouble& rootArray)
+{
+  size_t nbSites = rootArray.size();
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      fill(rootArray[i][c].begin(), rootArray[i][c].end(), 0.);
+    }
+  }
+
+  const MixedSubstitutionModelSet* modelSet = dynamic_cast<const MixedSubstitutionModelSet*>(modelSet_);
+  size_t nbModels = modelSet->getNumberOfModels();
+
+  // With no HyperNode, all combinations of submodels are allowed:
+  vector<MixedSubstitutionModelSet::HyperNode> hyperNodes;
+  if (modelSet->getNumberOfHyperNodes() == 0)
+  {
+    MixedSubstitutionModelSet::HyperNode hn(modelSet);
+    for (size_t m = 0; m < nbModels; m++)
+    {
+      const MixedTransitionModel* model = dynamic_cast<const MixedTransitionModel*>(modelSet->getModel(m));
+      if (model)
+      {
+        Vint submodels(model->getNumberOfModels());
+        for (size_t s = 0; s < submodels.size(); s++)
+        {
+          submodels[s] = static_cast<int>(s);
+        }
+        hn.setModel(m, submodels);
+      }
+    }
+    hyperNodes.push_back(hn);
+  }
+  else
+  {
+    for (size_t h = 0; h < modelSet->getNumberOfHyperNodes(); h++)
+    {
+      hyperNodes.push_back(modelSet->getHyperNode(h));
+    }
+  }
+
+  vector<Vint> assignment(nbModels);
+  for (size_t h = 0; h < hyperNodes.size(); h++)
+  {
+    double p = modelSet->getHyperNodeProbability(hyperNodes[h]);
+    if (p == 0)
+      continue;
+    for (size_t m = 0; m < nbModels; m++)
+    {
+      const MixedSubstitutionModelSet::HyperNode::Node& nd = hyperNodes[h].getNode(m);
+      assignment[m].resize(nd.size());
+      for (size_t s = 0; s < nd.size(); s++)
+      {
+        assignment[m][s] = nd[s];
+      }
+    }
+
+    ConditionalLikelihoodArray array = computeArray_(tree_->getRootNode(), assignment, order, branch).getArray();
+    ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          Vdouble* rootArray_i_c = &rootArray[i][c];
+          const double* array_i_c = array(i, c);
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            (*rootArray_i_c)[x] += p * array_i_c[x];
+          }
+        }
+      }
+    });
+  }
+}
+
+/******************************************************************************/
+
+const ConditionalLikelihoodBuffer& RNonHomogeneousMixedGraphTreeLikelihood::computeArray_(
+  const Node* node,
+  vector<Vint>& assignment,
+  size_t order,
+  const Node* branch)
+{
+  int id = node->getId();
+  NodeArrays_* arrays = &nodeArrays_[order][id];
+  if (node->isLeaf())
+    return arrays->arrays[0];
+
+  // The index of the array is made of the allowed submodels of all the mixed models below:
+  const vector<size_t>* subtreeModels = &subtreeModels_[id];
+  Vint key;
+  for (size_t j = 0; j < subtreeModels->size(); j++)
+  {
+    const Vint* submodels = &assignment[(*subtreeModels)[j]];
+    key.push_back(static_cast<int>(submodels->size()));
+    key.insert(key.end(), submodels->begin(), submodels->end());
+  }
+
+  size_t k;
+  map<Vint, size_t>::iterator it = arrays->index.find(key);
+  if (it == arrays->index.end())
+  {
+    k = arrays->arrays.size();
+    arrays->index[key] = k;
+    arrays->arrays.push_back(ConditionalLikelihoodBuffer());
+    arrays->arrays.back().resize(1, getLikelihoodData()->getLikelihoodArray(id).size(), nbClasses_, nbStates_);
+    arrays->computed.push_back(false);
+  }
+  else
+  {
+    k = it->second;
+    if (arrays->computed[k])
+      return arrays->arrays[k];
+  }
+
+  ConditionalLikelihoodArray array = arrays->arrays[k].getArray();
+  map<int, vector<size_t> >::const_iterator itSummed = summedModels_.find(id);
+  if (itSummed == summedModels_.end())
+  {
+    array.fill(1.);
+    multiplySons_(node, assignment, order, branch, array);
+  }
+  else
+  {
+    // Sum over all combinations of the submodels of the models shared by several sons:
+    const vector<size_t>* summedModels = &itSummed->second;
+    size_t nbSummed = summedModels->size();
+    vector<Vint> allowed(nbSummed);
+    vector<Vdouble> probabilities(nbSummed);
+    size_t nbCombinations = 1;
+    for (size_t j = 0; j < nbSummed; j++)
+    {
+      size_t m = (*summedModels)[j];
+      const MixedTransitionModel* model = dynamic_cast<const MixedTransitionModel*>(modelSet_->getModel(m));
+      allowed[j] = assignment[m];
+      double x = 0;
+      for (size_t s = 0; s < allowed[j].size(); s++)
+      {
+        probabilities[j].push_back(model->getNProbability(static_cast<size_t>(allowed[j][s])));
+        x += probabilities[j][s];
+      }
+      if (x != 0)
+        for (size_t s = 0; s < allowed[j].size(); s++)
+        {
+          probabilities[j][s] /= x;
+        }
+      nbCombinations *= allowed[j].size();
+    }
+
+    if (arrays->product.getSize() != arrays->arrays[k].getSize())
+      arrays->product.resize(1, array.getNumberOfSites(), nbClasses_, nbStates_);
+    ConditionalLikelihoodArray product = arrays->product.getArray();
+    size_t nbSites = array.getNumberOfSites();
+    array.fill(0.);
+    for (size_t t = 0; t < nbCombinations; t++)
+    {
+      size_t r = t;
+      double weight = 1.;
+      for (size_t j = 0; j < nbSummed; j++)
+      {
+        size_t s = r % allowed[j].size();
+        r /= allowed[j].size();
+        assignment[(*summedModels)[j]] = Vint(1, allowed[j][s]);
+        weight *= probabilities[j][s];
+      }
+      if (weight == 0)
+        continue;
+
+      product.fill(1.);
+      multiplySons_(node, assignment, order, branch, product);
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
+      {
+        for (size_t i = begin; i < end; i++)
+        {
+          for (size_t c = 0; c < nbClasses_; c++)
+          {
+            double* array_i_c = array(i, c);
+            const double* product_i_c = product(i, c);
+            for (size_t x = 0; x < nbStates_; x++)
+            {
+              array_i_c[x] += weight * product_i_c[x];
+            }
+          }
+        }
+      });
+    }
+    for (size_t j = 0; j < nbSummed; j++)
+    {
+      assignment[(*summedModels)[j]] = allowed[j];
+    }
+  }
+
+  arrays->computed[k] = true;
+  return arrays->arrays[k];
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedGraphTreeLikelihood::multiplySons_(
+  const Node* node,
+  vector<Vint>& assignment,
+  size_t order,
+  const Node* branch,
+  const ConditionalLikelihoodArray& array)
+{
+  int id = node->getId();
+  size_t nbSites = array.getNumberOfSites();
+  for (size_t l = 0; l < node->getNumberOfSons(); l++)
+  {
+    const Node* son = node->getSon(l);
+
+    // Only one son carries the derivative, either on its branch or below it:
+    size_t arrayOrder = 0, matrixOrder = 0;
+    if (order > 0)
+    {
+      if (son == branch)
+        matrixOrder = order;
+      else if (isAbove_(son, branch))
+        arrayOrder = order;
+    }
+
+    ConditionalLikelihoodArray sonArray = computeArray_(son, assignment, arrayOrder, branch).getArray();
+    const vector<Vdouble>* matrices = &getTransitionMatrices_(son, assignment, matrixOrder);
+    const vector<size_t>* patternLinks = &getLikelihoodData()->getArrayPositions(id, son->getId());
+    size_t stride = sonArray.getStride();
+
+    ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+        size_t pos = (*patternLinks)[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          LikelihoodKernels::multiplyTransitionProducts(
+              &(*matrices)[c][0], stride,
+              sonArray(pos, c), 0,
+              array(i, c), 0,
+              1, nbStates_);
+        }
+      }
+    });
+  }
+}
+
+/******************************************************************************/
+
+const vector<Vdouble>& RNonHomogeneousMixedGraphTreeLikelihood::getTransitionMatrices_(
+  const Node* node,
+  const vector<Vint>& assignment,
+  size_t order)
+{
+  // The matrices only depend on the allowed submodels of the models of the branch:
+  int id = node->getId();
+  vector<size_t> models = getBranchModels_(id);
+  Vint key;
+  for (size_t j = 0; j < models.size(); j++)
+  {
+    const Vint* submodels = &assignment[models[j]];
+    key.push_back(static_cast<int>(submodels->size()));
+    key.insert(key.end(), submodels->begin(), submodels->end());
+  }
+
+  map<Vint, vector<Vdouble> >* cache = (order == 0 ? &transitionMatrices_[id] : &dTransitionMatrices_);
+  map<Vint, vector<Vdouble> >::iterator it = cache->find(key);
+  if (it != cache->end())
+    return it->second;
+
+  // A mixed model follows the same submodel on all the segments of the branch,
+  // so that the combinations of submodels are averaged over the whole branch:
+  size_t nbModels = models.size();
+  vector< vector<const TransitionModel*> > vModels(nbModels);
+  vector<Vdouble> vProbas(nbModels);
+  size_t nbCombinations = 1;
+  for (size_t j = 0; j < nbModels; j++)
+  {
+    const TransitionModel* model = modelSet_->getModel(models[j]);
+    const Vint* submodels = &assignment[models[j]];
+    if (submodels->size() == 0)
+    {
+      vModels[j].push_back(model);
+      vProbas[j].push_back(1.);
+    }
+    else
+    {
+      const MixedTransitionModel* mmodel = dynamic_cast<const MixedTransitionModel*>(model);
+      double x = 0;
+      for (size_t i = 0; i < submodels->size(); i++)
+      {
+        vModels[j].push_back(mmodel->getNModel(static_cast<size_t>((*submodels)[i])));
+        vProbas[j].push_back(mmodel->getNProbability(static_cast<size_t>((*submodels)[i])));
+        x += vProbas[j][i];
+      }
+      if (x != 0)
+        for (size_t i = 0; i < submodels->size(); i++)
+        {
+          vProbas[j][i] /= x;
+        }
+    }
+    nbCombinations *= vModels[j].size();
+  }
+
+  map<int, BranchSegments>::const_iterator itSegments = segments_.find(id);
+  BranchSegments segments = (itSegments == segments_.end() ?
+                             BranchSegments(1, make_pair(modelSet_->getModelIndexForNode(id), 1.)) :
+                             itSegments->second);
+  vector<size_t> segmentModels(segments.size());
+  for (size_t k = 0; k < segments.size(); k++)
+  {
+    segmentModels[k] = static_cast<size_t>(lower_bound(models.begin(), models.end(), segments[k].first) - models.begin());
+  }
+
+  double l = node->getDistanceToFather();
+  size_t stride = ConditionalLikelihoodBuffer::getPaddedSize(nbStates_);
+  vector<Vdouble>* matrices = &(*cache)[key];
+  matrices->resize(nbClasses_);
+  VVdouble pxy(nbStates_, Vdouble(nbStates_));
+  vector<size_t> choice(nbModels);
+  // Products of the segments matrices and of their derivatives, and the ones of the current segment:
+  vector< RowMatrix<double> > P(order + 1), B(order + 1);
+  RowMatrix<double> prod;
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    double rc = rateDistribution_->getCategory(c);
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      fill(pxy[x].begin(), pxy[x].end(), 0.);
+    }
+    for (size_t t = 0; t < nbCombinations; t++)
+    {
+      size_t r = t;
+      double weight = 1.;
+      for (size_t j = 0; j < nbModels; j++)
+      {
+        choice[j] = r % vModels[j].size();
+        r /= vModels[j].size();
+        weight *= vProbas[j][choice[j]];
+      }
+      if (weight == 0)
+        continue;
+
+      for (size_t k = 0; k < segments.size(); k++)
+      {
+        const TransitionModel* model = vModels[segmentModels[k]][choice[segmentModels[k]]];
+        double f = segments[k].second;
+        double len = f * l * rc;
+        B[0] = model->getPij_t(len);
+        if (order >= 1)
+        {
+          B[1] = model->getdPij_dt(len);
+          MatrixTools::scale(B[1], f * rc);
+        }
+        if (order >= 2)
+        {
+          B[2] = model->getd2Pij_dt2(len);
+          MatrixTools::scale(B[2], f * rc * f * rc);
+        }
+        if (k == 0)
+        {
+          P = B;
+          continue;
+        }
+        // Leibniz rule, from the highest order as it uses the lower ones of the previous segments:
+        for (size_t o = order + 1; o-- > 0; )
+        {
+          RowMatrix<double> sum(nbStates_, nbStates_);
+          for (size_t d = 0; d <= o; d++)
+          {
+            MatrixTools::mult(P[o - d], B[d], prod);
+            double binomial = (o == 2 && d == 1 ? 2. : 1.);
+            for (size_t x = 0; x < nbStates_; x++)
+            {
+              for (size_t y = 0; y < nbStates_; y++)
+              {
+                sum(x, y) += binomial * prod(x, y);
+              }
+            }
+          }
+          P[o] = sum;
+        }
+      }
+
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        for (size_t y = 0; y < nbStates_; y++)
+        {
+          pxy[x][y] += weight * P[order](x, y);
+        }
+      }
+    }
+    LikelihoodKernels::flattenTransitionMatrix(pxy, true, stride, (*matrices)[c]);
+  }
+  return *matrices;
+}
+
+/******************************************************************************/
+
+bool RNonHomogeneousMixedGraphTreeLikelihood::isAbove_(const Node* node, const Node* branch)
+{
+  for (const Node* father = branch->getFather(); father; father = father->getFather())
+  {
+    if (father == node)
+      return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
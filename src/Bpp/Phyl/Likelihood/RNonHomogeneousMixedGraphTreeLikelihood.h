@@ -0,0 +1,325 @@
+//
+// File: RNonHomogeneousMixedGraphTreeLikelihood.h
+// Created by: agent
+// Created on: Fri Oct 16 22:25 2026
+//
+
+/*
+   Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+   This software is a computer program whose purpose is to provide classes
+   for phylogenetic data analysis.
+
+   This software is governed by the CeCILL  license under French law and
+   abiding by the rules of distribution of free software.  You can  use,
+   modify and/ or redistribute the software under the terms of the CeCILL
+   license as circulated by CEA, CNRS and INRIA at the following URL
+   "http://www.cecill.info".
+
+   As a counterpart to the access to the source code and  rights to copy,
+   modify and redistribute granted by the license, users are provided only
+   with a limited warranty  and the software's author,  the holder of the
+   economic rights,  and the successive licensors  have only  limited
+   liability.
+
+   In this respect, the user's attention is drawn to the risks associated
+   with loading,  using,  modifying and/or developing or reproducing the
+   software by the user in light of its specific status of free software,
+   that may mean  that it is complicated to manipulate,  and  that  also
+   therefore means  that it is reserved for developers  and  experienced
+   professionals having in-depth computer knowledge. Users are therefore
+   encouraged to load and test the software's suitability as regards their
+   requirements in conditions enabling the security of their systems and/or
+   data to be ensured and,  more generally, to use and operate it in the
+   same conditions as regards security.
+
+   The fact that you are presently reading this means that you have had
+   knowledge of the CeCILL license and that you accept its terms.
+ */
+
+#ifndef _RNONHOMOGENEOUSMIXEDGRAPHTREELIKELIHOOD_H_
+#define _RNONHOMOGENEOUSMIXEDGRAPHTREELIKELIHOOD_H_
+
+#include "RNonHomogeneousTreeLikelihood.h"
+#include "ConditionalLikelihoodArray.h"
+#include "../Model/MixedSubstitutionModelSet.h"
+
+#include <Bpp/Numeric/VectorTools.h>
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+
+// From the STL:
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace bpp
+{
+/**
+ * @brief Likelihood of a tree under a MixedSubstitutionModelSet, computed
+ * on a graph of conditional likelihood arrays.
+ *
+ * This class computes the same likelihood as RNonHomogeneousMixedTreeLikelihood:
+ * for each HyperNode, a site follows, for each mixed model, one submodel among
+ * the ones allowed by the HyperNode, the same on all the branches sharing this
+ * mixed model. Instead of building one sub-likelihood object for each
+ * combination of submodels, the conditional likelihood arrays of each node are
+ * indexed by the assignment of the mixed models found in the subtree below it:
+ * - a mixed model that is also used above the node must have been fixed to one
+ *   submodel by an ancestor, which is part of the index;
+ * - a mixed model only used below the node is summed over at the lowest node
+ *   having all its branches in its subtree, and only the set of allowed
+ *   submodels is part of the index;
+ * - a mixed model used on a single branch is averaged in the transition
+ *   probabilities of this branch.
+ *
+ * Each subtree is thus computed once for each distinct assignment, whatever
+ * the number of HyperNodes or of combinations of submodels elsewhere in the
+ * tree sharing it. The arrays of a node are only recomputed when a
+ * transition probability below it changes.
+ *
+ * Derivatives with respect to branch lengths are computed in the same way,
+ * only along the path from the derivated branch to the root.
+ *
+ * Branches can also be split in segments with their own models, as when a
+ * character history adds nodes with a single son along the branches (see
+ * setBranchSegments()). The tree, data and site patterns are then left
+ * unchanged, and only the arrays above the modified branches are recomputed.
+ * The transition probabilities of the TreeLikelihood interface are still the
+ * ones of the model of the node.
+ *
+ * As for RNonHomogeneousMixedTreeLikelihood, arrays of several submodels
+ * combinations are summed, so that scaling is disabled. Only the arrays of
+ * the root and of the leaves are stored in the likelihood data.
+ */
+class RNonHomogeneousMixedGraphTreeLikelihood :
+  public RNonHomogeneousTreeLikelihood
+{
+public:
+  /**
+   * @brief The segments of a branch, from its top to its bottom: for each one,
+   * the index of its model in the model set and its length.
+   */
+  typedef std::vector< std::pair<size_t, double> > BranchSegments;
+
+private:
+  /**
+   * @brief The conditional likelihood arrays of a node, one per assignment
+   * of the mixed models of its subtree.
+   */
+  struct NodeArrays_
+  {
+    std::map<Vint, size_t> index;
+    std::deque<ConditionalLikelihoodBuffer> arrays;
+    std::vector<bool> computed;
+    ConditionalLikelihoodBuffer product;
+
+    NodeArrays_() : index(), arrays(), computed(), product() {}
+  };
+
+  /**
+   * @brief The arrays of each node, for the likelihood and its first and
+   * second order derivatives.
+   */
+  std::vector< std::map<int, NodeArrays_> > nodeArrays_;
+
+  /**
+   * @brief For each node, the mixed models used on at least one branch of its subtree.
+   */
+  std::map<int, std::vector<size_t> > subtreeModels_;
+
+  /**
+   * @brief For each node, the mixed models used on several branches
+   * that are summed over at this node.
+   */
+  std::map<int, std::vector<size_t> > summedModels_;
+
+  /**
+   * @brief Transposed and flattened transition matrices of each branch, for each class,
+   * by set of allowed submodels.
+   */
+  std::map<int, std::map<Vint, std::vector<Vdouble> > > transitionMatrices_;
+
+  /**
+   * @brief Same as transitionMatrices_, for the derivatives of the branch
+   * currently derivated.
+   */
+  std::map<Vint, std::vector<Vdouble> > dTransitionMatrices_;
+
+  /**
+   * @brief The branches split in segments, with lengths relative to the one of the branch.
+   */
+  std::map<int, BranchSegments> segments_;
+
+public:
+  /**
+   * @brief Build a new RNonHomogeneousMixedGraphTreeLikelihood object without data.
+   *
+   * This constructor only initialize the parameters. To compute a
+   * likelihood, you will need to call the setData() and the
+   * computeTreeLikelihood() methods.
+   *
+   * @param tree The tree to use.
+   * @param modelSet The set of substitution models to use.
+   * @param rDist The rate across sites distribution to use.
+   * @param verbose Should I display some info?
+   * @param usePatterns Tell if recursive site compression should be performed.
+   * @throw Exception in an error occured.
+   */
+  RNonHomogeneousMixedGraphTreeLikelihood(
+    const Tree& tree,
+    MixedSubstitutionModelSet* modelSet,
+    DiscreteDistribution* rDist,
+    bool verbose = true,
+    bool usePatterns = true);
+
+  /**
+   * @brief Build a new RNonHomogeneousMixedGraphTreeLikelihood object
+   * and compute the corresponding likelihood.
+   *
+   * @param tree The tree to use.
+   * @param data Sequences to use.
+   * @param modelSet The set of substitution models to use.
+   * @param rDist The rate across sites distribution to use.
+   * @param verbose Should I display some info?
+   * @param usePatterns Tell if recursive site compression should be performed.
+   * @throw Exception in an error occured.
+   */
+  RNonHomogeneousMixedGraphTreeLikelihood(
+    const Tree& tree,
+    const SiteContainer& data,
+    MixedSubstitutionModelSet* modelSet,
+    DiscreteDistribution* rDist,
+    bool verbose = true,
+    bool usePatterns = true);
+
+  RNonHomogeneousMixedGraphTreeLikelihood(const RNonHomogeneousMixedGraphTreeLikelihood& lik);
+
+  RNonHomogeneousMixedGraphTreeLikelihood& operator=(const RNonHomogeneousMixedGraphTreeLikelihood& lik);
+
+  virtual ~RNonHomogeneousMixedGraphTreeLikelihood() {}
+
+  RNonHomogeneousMixedGraphTreeLikelihood* clone() const { return new RNonHomogeneousMixedGraphTreeLikelihood(*this); }
+
+public:
+  void setData(const SiteContainer& sites);
+
+  void computeTreeLikelihood();
+
+  void computeTreeDLikelihood(const std::string& variable);
+
+  void computeTreeD2Likelihood(const std::string& variable);
+
+  /**
+   * @return The number of conditional likelihood arrays currently stored for the
+   * likelihood at the given node, i.e. the number of distinct assignments of the
+   * mixed models of its subtree met so far.
+   *
+   * @param nodeId The id of the node.
+   */
+  size_t getNumberOfArrays(int nodeId) const;
+
+  /**
+   * @brief Split branches in segments with their own models.
+   *
+   * This is equivalent to adding nodes with a single son along the branches,
+   * with the models of the segments above them. A mixed model uses the same
+   * submodel on all its segments and branches. The length of each branch is set
+   * to the sum of the lengths of its segments, and the likelihood is recomputed.
+   *
+   * @param segments The segments of each modified branch, by id of the node below it.
+   * The models of the segments are used instead of the one of the node, even if there is
+   * a single segment.
+   * @throw Exception If the object is not initialized, or if a branch has no segment.
+   */
+  void setBranchSegments(const std::map<int, BranchSegments>& segments);
+
+  /**
+   * @return The segments of a branch, with their absolute lengths. A branch which was never
+   * split has a single segment, with the model of its node.
+   *
+   * @param nodeId The id of the node below the branch.
+   */
+  BranchSegments getBranchSegments(int nodeId) const;
+
+protected:
+  void computeTransitionProbabilitiesForNode(const Node* node);
+
+  void fireParameterChanged(const ParameterList& params);
+
+private:
+  /**
+   * @brief Find the mixed models of each subtree, and where the shared ones are summed.
+   */
+  void initModelsStructure_();
+
+  /**
+   * @brief Reset all arrays, and copy the ones of the leaves from the likelihood data.
+   */
+  void initArrays_();
+
+  /**
+   * @brief Count the branches of each model below a node, and fill subtreeModels_ and summedModels_.
+   *
+   * @param node The root of the subtree.
+   * @param nbBranches The total number of branches of each model, or an empty vector
+   * if they are not known yet (first pass).
+   * @return The number of branches of each model strictly below the node.
+   */
+  std::vector<size_t> countModels_(const Node* node, const std::vector<size_t>& nbBranches);
+
+  /**
+   * @return The indices of the models used on a branch, sorted and without duplicates.
+   *
+   * @param nodeId The id of the node below the branch.
+   */
+  std::vector<size_t> getBranchModels_(int nodeId) const;
+
+  /**
+   * @brief Remove the transition matrices of a branch, and mark the arrays above it as not computed.
+   */
+  void invalidateBranch_(const Node* node);
+
+  /**
+   * @brief Sum the arrays of the root over all HyperNodes.
+   *
+   * @param order 0 for the likelihood, 1 or 2 for its derivatives.
+   * @param branch The derivated branch, if order > 0.
+   * @param rootArray [out] The array where to store the result.
+   */
+  void computeRootArray_(size_t order, const Node* branch, VVVdouble& rootArray);
+
+  /**
+   * @brief Get the array of a node for a given assignment of the mixed models, computing it if needed.
+   *
+   * @param node The node.
+   * @param assignment For each model, the allowed submodels.
+   * It is modified during the computation, and restored afterwards.
+   * @param order 0 for the likelihood, 1 or 2 for its derivatives, in which case
+   * the derivated branch must be below the node.
+   * @param branch The derivated branch, if order > 0.
+   */
+  const ConditionalLikelihoodBuffer& computeArray_(const Node* node, std::vector<Vint>& assignment, size_t order, const Node* branch);
+
+  /**
+   * @brief Multiply an array by the contributions of all sons of a node.
+   */
+  void multiplySons_(const Node* node, std::vector<Vint>& assignment, size_t order, const Node* branch, const ConditionalLikelihoodArray& array);
+
+  /**
+   * @brief Get the flattened transition matrices (or their derivatives) of a branch.
+   *
+   * @param node The node at the bottom of the branch.
+   * @param assignment For each model, the allowed submodels, empty if it is not mixed.
+   * @param order The order of the derivative.
+   */
+  const std::vector<Vdouble>& getTransitionMatrices_(const Node* node, const std::vector<Vint>& assignment, size_t order);
+
+  /**
+   * @return True if node is a strict ancestor of branch.
+   */
+  static bool isAbove_(const Node* node, const Node* branch);
+};
+} // end of namespace bpp.
+
+#endif  // _RNONHOMOGENEOUSMIXEDGRAPHTREELIKELIHOOD_H_
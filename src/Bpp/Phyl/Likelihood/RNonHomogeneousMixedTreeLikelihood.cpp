@@ -69,6 +69,9 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
 
+  // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+
   for (size_t i=0;i<modelSet->getNumberOfHyperNodes();i++){
     mvTreeLikelihoods_[tree.getRootId()].push_back(new RNonHomogeneousMixedTreeLikelihood(tree, modelSet, modelSet->getHyperNode(i), upperNode_, rDist, false, usePatterns));
   }
@@ -92,6 +95,9 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
 
+  // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+
   for (size_t i=0;i<modelSet->getNumberOfHyperNodes();i++)
     mvTreeLikelihoods_[tree.getRootId()].push_back(new RNonHomogeneousMixedTreeLikelihood(tree, data, modelSet, modelSet->getHyperNode(i), upperNode_, rDist, false, usePatterns));
 }
@@ -114,6 +120,9 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
 
+  // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+
   init(usePatterns);
 }
 
@@ -136,6 +145,9 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(const Tre
   if (!modelSet->isFullySetUpFor(tree))
     throw Exception("RNonHomogeneousMixedTreeLikelihood(constructor). Model set is not fully specified.");
 
+  // Arrays of the sub-likelihoods are averaged, they must share the same scaling:
+  getLikelihoodData()->enableScaling(false);
+
   init(usePatterns);
 }
 
@@ -266,6 +278,7 @@ RNonHomogeneousMixedTreeLikelihood::RNonHomogeneousMixedTreeLikelihood(
       mvTreeLikelihoods_[it->first].push_back(new RNonHomogeneousMixedTreeLikelihood(*it->second[i]));
     }
   }
+  setThreadPool(threadPool_);
 }
 
 /******************************************************************************/
@@ -290,6 +303,7 @@ RNonHomogeneousMixedTreeLikelihood& RNonHomogeneousMixedTreeLikelihood::operator
   }
 
   hyperNode_=lik.hyperNode_;
+  setThreadPool(threadPool_);
 
   return *this;
 }
@@ -445,6 +459,29 @@ void RNonHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites)
   }
 }
 
+/******************************************************************************/
+
+void RNonHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  RNonHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+  setThreadPool(threadPool_);
+}
+
+/******************************************************************************/
+
+void RNonHomogeneousMixedTreeLikelihood::setThreadPool(const std::shared_ptr<ThreadPool>& pool)
+{
+  RNonHomogeneousTreeLikelihood::setThreadPool(pool);
+  map<int, vector<RNonHomogeneousMixedTreeLikelihood*> >::iterator it;
+  for (it = mvTreeLikelihoods_.begin(); it != mvTreeLikelihoods_.end(); it++)
+  {
+    for (size_t i = 0; i < it->second.size(); i++)
+    {
+      it->second[i]->setThreadPool(pool);
+    }
+  }
+}
+
 
 /******************************************************************************/
 double RNonHomogeneousMixedTreeLikelihood::getProbability() const
@@ -766,6 +803,7 @@ void RNonHomogeneousMixedTreeLikelihood::computeTransitionProbabilitiesForNode(c
       }
     }
   }
+  updateFlatTransitionProbabilities_(node->getId());
   
   if (computeFirstOrderDerivatives_) {
     // Computes all dpxy/dt once for all:
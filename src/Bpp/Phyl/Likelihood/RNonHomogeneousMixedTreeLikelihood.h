@@ -62,8 +62,10 @@ namespace bpp
  * with all the submodels combinations.
  *
  * Note that this approach is not the most efficient, since a graph
- * based one would avoid some computations, but it seems much more
- * difficult to do it in the extant hierarchy.
+ * based one would avoid some computations: see
+ * RNonHomogeneousMixedGraphTreeLikelihood, which computes the same
+ * likelihood with each subtree computed once per distinct assignment
+ * of its submodels.
  **/
 
 class RNonHomogeneousMixedTreeLikelihood :
@@ -239,6 +241,17 @@ public:
    */
   void setData(const SiteContainer& sites);
 
+  /**
+   * @brief Set the number of threads, for this object and all sub-likelihoods.
+   *
+   * The sub-likelihoods share the thread pool of this object.
+   *
+   * @param nbThreads The number of threads to use.
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  void setThreadPool(const std::shared_ptr<ThreadPool>& pool);
+
 public:
   // Specific methods:
   void initialize();
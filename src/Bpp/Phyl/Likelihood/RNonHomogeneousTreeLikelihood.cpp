@@ -39,6 +39,7 @@
  */
 
 #include "RNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -48,6 +49,8 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -185,31 +188,51 @@ double RNonHomogeneousTreeLikelihood::getLogLikelihood() const
 
 double RNonHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 {
-  double l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    l += getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return l;
+  return ldexp(getScaledLikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
-  double l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    l += getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  //if(l <= 0.) cerr << "WARNING!!! Negative likelihood." << endl;
+  double l = getScaledLikelihoodForASite_(site);
   if (l < 0) l = 0; //May happen because of numerical errors.
-  return log(l);
+  return log(l) - likelihoodData_->getRootScalingExponent(site) * log(2.);
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return ldexp(getScaledLikelihoodForASiteForARateClass_(site, rateClass), -likelihoodData_->getRootScalingExponent(site));
+}
+
+/******************************************************************************/
+
+double RNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return log(getScaledLikelihoodForASiteForARateClass_(site, rateClass)) - likelihoodData_->getRootScalingExponent(site) * log(2.);
+}
+
+/******************************************************************************/
+
+double RNonHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+{
+  double l = likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return ldexp(l, -likelihoodData_->getRootScalingExponent(site));
+}
+
+/******************************************************************************/
+
+double RNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+{
+  double l = likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return log(l) - likelihoodData_->getRootScalingExponent(site) * log(2.);
+}
+
+/******************************************************************************/
+
+double RNonHomogeneousTreeLikelihood::getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const
 {
   double l = 0;
   Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
@@ -222,29 +245,52 @@ double RNonHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t
 
 /******************************************************************************/
 
-double RNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+double RNonHomogeneousTreeLikelihood::getScaledLikelihoodForASite_(size_t site) const
 {
   double l = 0;
-  Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
-  for (size_t i = 0; i < nbStates_; i++)
+  for (size_t i = 0; i < nbClasses_; i++)
   {
-    l += (*la)[i] * rootFreqs_[i];
+    l += getScaledLikelihoodForASiteForARateClass_(site, i) * rateDistribution_->getProbability(i);
   }
-  return log(l);
+  return l;
 }
 
 /******************************************************************************/
 
-double RNonHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+double RNonHomogeneousTreeLikelihood::getScaledDLikelihoodForASite_(size_t site) const
 {
-  return likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  // Derivative of the sum is the sum of derivatives:
+  double dl = 0;
+  VVdouble* dla = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    double dlc = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      dlc += (*dla)[c][i] * rootFreqs_[i];
+    }
+    dl += dlc * rateDistribution_->getProbability(c);
+  }
+  return dl;
 }
 
 /******************************************************************************/
 
-double RNonHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
+double RNonHomogeneousTreeLikelihood::getScaledD2LikelihoodForASite_(size_t site) const
 {
-  return log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  // Derivative of the sum is the sum of derivatives:
+  double d2l = 0;
+  VVdouble* d2la = &likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    double d2lc = 0;
+    for (size_t i = 0; i < nbStates_; i++)
+    {
+      d2lc += (*d2la)[c][i] * rootFreqs_[i];
+    }
+    d2l += d2lc * rateDistribution_->getProbability(c);
+  }
+  return d2l;
 }
 
 /******************************************************************************/
@@ -330,28 +376,23 @@ double RNonHomogeneousTreeLikelihood::getDLikelihoodForASiteForARateClass(
   {
     dl += (*dla)[i] * rootFreqs_[i];
   }
-  return dl;
+  return ldexp(dl, -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getDLikelihoodForASite(size_t site) const
 {
-  // Derivative of the sum is the sum of derivatives:
-  double dl = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    dl += getDLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return dl;
+  return ldexp(getScaledDLikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getDLogLikelihoodForASite(size_t site) const
 {
-  // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg :
-  return getDLikelihoodForASite(site) / getLikelihoodForASite(site);
+  // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg
+  // Scaling factors cancel out:
+  return getScaledDLikelihoodForASite_(site) / getScaledLikelihoodForASite_(site);
 }
 
 /******************************************************************************/
@@ -430,7 +471,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
           VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
@@ -463,6 +505,7 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
             }
           }
         }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -475,7 +518,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
           VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -496,8 +540,10 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
             }
           }
         }
+        });
       }
     }
+    likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
     return;
   }
   else if (variable == "RootPosition")
@@ -540,7 +586,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
           VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
@@ -573,6 +620,7 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
             }
           }
         }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -585,7 +633,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
           VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -606,8 +655,10 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
             }
           }
         }
+        });
       }
     }
+    likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
     return;
   }
 
@@ -644,7 +695,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
     if (son == branch)
     {
       VVVdouble* dpxy__son = &dpxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -665,11 +717,13 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
           }
         }
       }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -690,9 +744,12 @@ void RNonHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variabl
           }
         }
       }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeDLikelihood(father);
 }
@@ -734,7 +791,8 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* no
     if (son == node)
     {
       VVVdouble* _dLikelihoods_son = &likelihoodData_->getDLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -755,11 +813,13 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* no
           }
         }
       }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
@@ -780,9 +840,12 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* no
           }
         }
       }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_dLikelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeDLikelihood(father);
 }
@@ -801,28 +864,24 @@ double RNonHomogeneousTreeLikelihood::getD2LikelihoodForASiteForARateClass(
   {
     d2l += (*d2la)[i] * rootFreqs_[i];
   }
-  return d2l;
+  return ldexp(d2l, -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getD2LikelihoodForASite(size_t site) const
 {
-  // Derivative of the sum is the sum of derivatives:
-  double d2l = 0;
-  for (size_t i = 0; i < nbClasses_; i++)
-  {
-    d2l += getD2LikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
-  }
-  return d2l;
+  return ldexp(getScaledD2LikelihoodForASite_(site), -likelihoodData_->getRootScalingExponent(site));
 }
 
 /******************************************************************************/
 
 double RNonHomogeneousTreeLikelihood::getD2LogLikelihoodForASite(size_t site) const
 {
-  return getD2LikelihoodForASite(site) / getLikelihoodForASite(site)
-         - pow( getDLikelihoodForASite(site) / getLikelihoodForASite(site), 2);
+  // Scaling factors cancel out:
+  double l = getScaledLikelihoodForASite_(site);
+  return getScaledD2LikelihoodForASite_(site) / l
+         - pow( getScaledDLikelihoodForASite_(site) / l, 2);
 }
 
 /******************************************************************************/
@@ -903,7 +962,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
           VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
@@ -942,6 +1002,7 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
             }
           }
         }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -954,7 +1015,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
           VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -975,8 +1037,10 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
             }
           }
         }
+        });
       }
     }
+    likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
     return;
   }
   else if (variable == "RootPosition")
@@ -1021,7 +1085,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* dpxy_root2_  = &dpxy_[root2_];
         VVVdouble* pxy_root1_   = &pxy_[root1_];
         VVVdouble* pxy_root2_   = &pxy_[root2_];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoodsroot1__i = &(*_likelihoodsroot1_)[(*_patternLinks_fatherroot1_)[i]];
           VVdouble* _likelihoodsroot2__i = &(*_likelihoodsroot2_)[(*_patternLinks_fatherroot2_)[i]];
@@ -1060,6 +1125,7 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
             }
           }
         }
+        });
       }
       else if (son->getId() == root2_)
       {
@@ -1072,7 +1138,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
         VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
         VVVdouble* pxy__son = &pxy_[son->getId()];
-        for (size_t i = 0; i < nbSites; i++)
+        ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
           VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
           VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -1093,8 +1160,10 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
             }
           }
         }
+        });
       }
     }
+    likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
     return;
   }
 
@@ -1131,7 +1200,8 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
     if (son == branch)
     {
       VVVdouble* d2pxy__son = &d2pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -1152,11 +1222,13 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
           }
         }
       }
+      });
     }
     else
     {
       VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -1177,9 +1249,12 @@ void RNonHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variab
           }
         }
       }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
+
   // Now we go down the tree toward the root node:
   computeDownSubtreeD2Likelihood(father);
 }
@@ -1221,7 +1296,8 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* n
     if (son == node)
     {
       VVVdouble* _d2Likelihoods_son = &likelihoodData_->getD2LikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -1242,11 +1318,13 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* n
           }
         }
       }
+      });
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
+      ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
       {
         VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
         VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
@@ -1267,9 +1345,12 @@ void RNonHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* n
           }
         }
       }
+      });
     }
   }
 
+  likelihoodData_->applyNodeScaling(father->getId(), *_d2Likelihoods_father);
+
   //Next step: move toward grand father...
   computeDownSubtreeD2Likelihood(father);
 }
@@ -1290,62 +1371,85 @@ void RNonHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
   size_t nbSites  = likelihoodData_->getLikelihoodArray(node->getId()).size();
   size_t nbNodes  = node->getNumberOfSons();
 
-  // Must reset the likelihood array first (i.e. set all of them to 1):
-  VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
-  for (size_t i = 0; i < nbSites; i++)
-  {
-    //For each site in the sequence,
-    VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      //For each rate classe,
-      Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        //For each initial state,
-        (*_likelihoods_node_i_c)[x] = 1.;
-      }
-    }
-  }
+  DRASRTreeLikelihoodNodeData* _data_node = &likelihoodData_->getNodeData(node->getId());
+  vector<int>* _scaling_node = &_data_node->getSubtreeScalingExponents();
+  vector<int>* _nodeScaling_node = &_data_node->getNodeScalingExponents();
+  fill(_scaling_node->begin(), _scaling_node->end(), 0);
+  fill(_nodeScaling_node->begin(), _nodeScaling_node->end(), 0);
 
   for (size_t l = 0; l < nbNodes; l++)
   {
     //For each son node,
-
     const Node* son = node->getSon(l);
 
     computeSubtreeLikelihood(son); //Recursive method:
+  }
 
-    VVVdouble* pxy__son = &pxy_[son->getId()];
+  // Products are computed in contiguous arrays, so that the kernel processes all sites
+  // of a chunk at once for each rate class. The likelihoods of each son are gathered
+  // in the second array, following the pattern links:
+  ConditionalLikelihoodBuffer buffer;
+  buffer.resize(2, nbSites, nbClasses_, nbStates_);
+  ConditionalLikelihoodArray products = buffer.getArray(0);
+  ConditionalLikelihoodArray sonLikelihoods = buffer.getArray(1);
+  resetLikelihoodArray(products);
+  size_t stride = buffer.getStride();
+  size_t size = nbStates_ * stride;
+  size_t step = nbClasses_ * stride;
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    const Node* son = node->getSon(l);
+    const double* pyx__son = &flatPyx_[son->getId()][0];
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
+    vector<int>* _scaling_son = &likelihoodData_->getNodeData(son->getId()).getSubtreeScalingExponents();
 
-    for (size_t i = 0; i < nbSites; i++)
+    ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
     {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+      for (size_t i = begin; i < end; i++)
+      {
+        //For each site in the sequence,
+        size_t j = (*_patternLinks_node_son)[i];
+        VVdouble* _likelihoods_son_j = &(*_likelihoods_son)[j];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          std::copy((*_likelihoods_son_j)[c].begin(), (*_likelihoods_son_j)[c].end(), sonLikelihoods(i, c));
+        }
+        (*_scaling_node)[i] += (*_scaling_son)[j];
+      }
       for (size_t c = 0; c < nbClasses_; c++)
       {
         //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
+        LikelihoodKernels::multiplyTransitionProducts(
+            pyx__son + c * size, stride,
+            sonLikelihoods(begin, c), step,
+            products(begin, c), step,
+            end - begin, nbStates_);
+      }
+    });
+  }
 
-        for (size_t x = 0; x < nbStates_; x++)
-        {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-          {
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-          }
-          (*_likelihoods_node_i_c)[x] *= likelihood;
-        }
+  // Rescale sites with too small likelihoods, and copy the result:
+  VVVdouble* _likelihoods_node = &likelihoodData_->getLikelihoodArray(node->getId());
+  bool scaling = likelihoodData_->isScalingEnabled();
+  ThreadPool::parallelFor(getThreadPool_(), nbSites, [&] (size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+    {
+      if (scaling)
+      {
+        int e = ConditionalLikelihoodScaling::scaleLikelihoods(products, i);
+        (*_nodeScaling_node)[i] = e;
+        (*_scaling_node)[i] += e;
+      }
+      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
+      for (size_t c = 0; c < nbClasses_; c++)
+      {
+        const double* products_i_c = products(i, c);
+        std::copy(products_i_c, products_i_c + nbStates_, (*_likelihoods_node_i)[c].begin());
       }
     }
-  }
+  });
 }
 
 
@@ -57,6 +57,10 @@ namespace bpp
    * A non uniform distribution of rates among the sites is allowed (ASRV models).</p>
    *
    * This class uses an instance of the DRASRTreeLikelihoodData for conditionnal likelihood storage.
+   * Conditional likelihoods are rescaled when they get too small, so that large trees can be analysed
+   * without numerical underflow (see DRASRTreeLikelihoodData). Log-likelihoods and their derivatives
+   * are computed from the scaled values, while methods returning likelihoods correct for scaling,
+   * and may therefore return 0 for very large trees.
    *
    * This class can also use a simple or recursive site compression.
    * In the simple case, computations for identical sites are not duplicated.
@@ -244,6 +248,20 @@ namespace bpp
 
 	
   protected:
+
+    /**
+     * @name Scaled likelihoods.
+     *
+     * These methods return likelihoods as computed from the root arrays, that is, multiplied by 2^e,
+     * e being the root scaling exponent of the site (see DRASRTreeLikelihoodData::getRootScalingExponent()).
+     *
+     * @{
+     */
+    double getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const;
+    double getScaledLikelihoodForASite_(size_t site) const;
+    double getScaledDLikelihoodForASite_(size_t site) const;
+    double getScaledD2LikelihoodForASite_(size_t site) const;
+    /** @} */
 			
     /**
      * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
@@ -84,25 +84,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   // We create a new ProbabilisticRewardMapping object:
   ProbabilisticRewardMapping* rewards = new ProbabilisticRewardMapping(tree, &reward, nbSites);
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
   Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
 
   // Compute the reward for each class and each branch in the tree:
   if (verbose)
@@ -122,6 +104,8 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
     if (verbose)
       ApplicationTools::displayGauge(l, nbNodes - 1);
     Vdouble rewardsForCurrentNode(nbDistinctSites);
+    // The likelihood of each site, computed from the same (possibly scaled) arrays:
+    Vdouble Lr(nbDistinctSites, 0.);
 
     // Now we've got to compute likelihoods in a smart manner... ;)
     VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
@@ -150,7 +134,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -170,11 +154,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; c++)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; x++)
@@ -183,7 +166,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; y++)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -195,7 +178,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -214,11 +197,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; c++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; x++)
@@ -227,7 +209,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
               for (size_t y = 0; y < nbStates; y++)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -258,7 +240,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
+    ConditionalLikelihoodArray likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -298,11 +280,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVdouble* nxy_c = &nxy[c];
@@ -314,7 +295,8 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
+              Lr[i] += likelihood_cxy;
 
               // Now the vector computation:
               rewardsForCurrentNode[i] += likelihood_cxy * (*nxy_c)[x][y];
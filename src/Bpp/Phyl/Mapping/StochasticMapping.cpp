@@ -17,6 +17,7 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/Number.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 #include <Bpp/Numeric/Prob/ConstantDistribution.h>
 #include <Bpp/Seq/AlphabetIndex/UserAlphabetIndex1.h>
@@ -26,6 +27,7 @@
 #include <fstream>
 #include <algorithm>
 #include <numeric> // to sum over items in a vector
+#include <cmath>
 
 using namespace bpp;
 using namespace std;
@@ -42,7 +44,10 @@ StochasticMapping::StochasticMapping(const TreeLikelihood* tl, size_t numOfMappi
   ConditionalProbabilities_(),
   nodesCounter_(0),
   numOfMappings_(numOfMappings),
-  nodeIdToIndex_()
+  nodeIdToIndex_(),
+  samplingMethod_(REJECTION),
+  uniformizationRate_(0),
+  uniformizedPowers_()
 {
 
   tl_ = tl;
@@ -72,6 +77,8 @@ StochasticMapping::~StochasticMapping()
 
 void StochasticMapping::generateStochasticMapping(vector<Tree*>& mappings)
 {
+  if (samplingMethod_ == UNIFORMIZATION)
+    initUniformization(); // the model parameters may have changed since the last call
   for (size_t i = 0; i < numOfMappings_; ++i)
   {
     // clone the base tree to acheive the skeleton in which the mapping will be represented
@@ -642,7 +649,10 @@ void StochasticMapping::sampleMutationsGivenAncestrals(Tree* mapping)
     Node* son = nodes[i];
     if (son->hasFather())
     {
-      sampleMutationsGivenAncestralsPerBranch(son);
+      if (samplingMethod_ == UNIFORMIZATION)
+        sampleMutationsGivenAncestralsPerBranchByUniformization(son);
+      else
+        sampleMutationsGivenAncestralsPerBranch(son);
     }
   }
 }
@@ -740,6 +750,137 @@ void StochasticMapping::sampleMutationsGivenAncestralsPerBranch(Node* son, size_
 
 /******************************************************************************/
 
+void StochasticMapping::initUniformization()
+{
+  const Matrix<double>& generator = mappingParameters_->getSubstitutionModel()->getGenerator();
+  size_t statesNum = generator.getNumberOfRows();
+  uniformizationRate_ = 0;
+  for (size_t i = 0; i < statesNum; ++i)
+  {
+    uniformizationRate_ = max(uniformizationRate_, -generator(i, i));
+  }
+  uniformizedPowers_.clear();
+  RowMatrix<double> identity;
+  MatrixTools::getId(statesNum, identity);
+  uniformizedPowers_.push_back(identity);
+  RowMatrix<double> uniformized(identity);
+  if (uniformizationRate_ > 0)
+  {
+    for (size_t i = 0; i < statesNum; ++i)
+    {
+      for (size_t j = 0; j < statesNum; ++j)
+      {
+        uniformized(i, j) += generator(i, j) / uniformizationRate_;
+      }
+    }
+  }
+  uniformizedPowers_.push_back(uniformized);
+}
+
+/******************************************************************************/
+
+const RowMatrix<double>& StochasticMapping::getUniformizedPower(size_t n)
+{
+  if (uniformizedPowers_.empty())
+    initUniformization();
+  while (uniformizedPowers_.size() <= n)
+  {
+    RowMatrix<double> power;
+    MatrixTools::mult(uniformizedPowers_.back(), uniformizedPowers_[1], power);
+    uniformizedPowers_.push_back(power);
+  }
+  return uniformizedPowers_[n];
+}
+
+/******************************************************************************/
+
+void StochasticMapping::sampleMutationsGivenAncestralsPerBranchByUniformization(Node* son)
+{
+  Node* father = son->getFather();
+  double branchLength = son->getDistanceToFather();
+  size_t fatherState = getNodeState(father);
+  size_t sonState = getNodeState(son);
+  const SubstitutionModel* model = mappingParameters_->getSubstitutionModel();
+  size_t statesNum = model->getNumberOfStates();
+  if (uniformizedPowers_.empty())
+    initUniformization();
+  double muT = uniformizationRate_ * branchLength;
+  if (muT <= 0)
+  {
+    if (fatherState == sonState) // no time for any transition
+      return;
+    throw Exception("could not produce simulations with father = " + TextTools::toString(fatherState) + " son " + TextTools::toString(sonState) + " branch length = " + TextTools::toString(branchLength));
+  }
+
+  /* step 1: sample the number of jumps of the uniformized process (including virtual ones), given the states at both ends:
+   * P(n | father, son) = Poisson(n; mu * t) * R^n(father, son) / P(father, son; t) */
+  double transitionProb = model->Pij_t(fatherState, sonState, branchLength);
+  double u = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0) * transitionProb;
+  double cumProb = 0, cumPoisson = 0;
+  size_t jumpsNum = 0;
+  const size_t maxJumpsNum = 100000;
+  for ( ; ; ++jumpsNum)
+  {
+    double poisson = exp(-muT + static_cast<double>(jumpsNum) * log(muT) - lgamma(static_cast<double>(jumpsNum) + 1.));
+    double powerProb = getUniformizedPower(jumpsNum)(fatherState, sonState);
+    cumPoisson += poisson;
+    cumProb += poisson * powerProb;
+    if (u < cumProb)
+      break;
+    // the remaining terms are negligible, u only exceeds the sum because of rounding errors
+    if (powerProb > 0 && static_cast<double>(jumpsNum) > muT && 1. - cumPoisson < 1e-12 * transitionProb)
+      break;
+    if (jumpsNum == maxJumpsNum)
+      throw Exception("could not produce simulations with father = " + TextTools::toString(fatherState) + " son " + TextTools::toString(sonState) + " branch length = " + TextTools::toString(branchLength));
+  }
+
+  /* step 2: the times of the jumps are uniformly distributed along the branch */
+  VDouble jumpTimes(jumpsNum);
+  for (size_t i = 0; i < jumpsNum; ++i)
+  {
+    jumpTimes[i] = RandomTools::giveRandomNumberBetweenZeroAndEntry(branchLength);
+  }
+  sort(jumpTimes.begin(), jumpTimes.end());
+
+  /* step 3: sample the state after each jump, given the previous state and the son's state:
+   * P(x_i = c | x_{i-1}) = R(x_{i-1}, c) * R^{n-i}(c, son) / R^{n-i+1}(x_{i-1}, son)
+   * virtual jumps (to the same state) are not recorded in the mapping */
+  const RowMatrix<double>& uniformized = uniformizedPowers_[1];
+  MutationPath branchMapping(model->getAlphabet(), fatherState, branchLength);
+  size_t curState = fatherState;
+  double lastChangeTime = 0;
+  VDouble weights(statesNum);
+  for (size_t i = 1; i <= jumpsNum; ++i)
+  {
+    size_t nextState = sonState;
+    if (i < jumpsNum)
+    {
+      const RowMatrix<double>& power = uniformizedPowers_[jumpsNum - i];
+      double sum = 0;
+      for (size_t c = 0; c < statesNum; ++c)
+      {
+        weights[c] = uniformized(curState, c) * power(c, sonState);
+        sum += weights[c];
+      }
+      for (size_t c = 0; c < statesNum; ++c)
+      {
+        weights[c] /= sum;
+      }
+      nextState = sampleState(weights);
+    }
+    if (nextState != curState)
+    {
+      branchMapping.addEvent(curState, jumpTimes[i - 1] - lastChangeTime); // same convention as in sampleMutationsGivenAncestralsPerBranch: the state held and the time spent in it
+      lastChangeTime = jumpTimes[i - 1];
+      curState = nextState;
+    }
+  }
+  son->setDistanceToFather(branchLength - lastChangeTime);
+  updateBranchMapping(son, branchMapping);
+}
+
+/******************************************************************************/
+
 void StochasticMapping::updateBranchByDwellingTimes(Node* node, VDouble& dwellingTimes, VVDouble& ancestralStatesFrequencies, size_t divMethod)
 {
   
@@ -43,6 +43,8 @@
 #include "../Likelihood/TreeLikelihood.h"
 #include "../Simulation/MutationProcess.h"
 
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
 // From the STL:
 #include <iostream>
 #include <iomanip>
@@ -62,6 +64,16 @@ namespace bpp
 {
 class StochasticMapping
 {
+public:
+  /* methods to sample the history of a branch given the states at its ends
+   * REJECTION:       simulate histories until one ends in the son's state, the first transition being conditioned to occur on the branch when the states differ (Nielsen 2002)
+   * UNIFORMIZATION:  sample directly from the endpoint-conditioned distribution, using the uniformized process (Hobolth and Stone, "Simulation from endpoint-conditioned, continuous-time Markov chains on a finite state space, with applications to molecular evolution." The annals of applied statistics 3.3 (2009): 1204-1231) */
+  enum SamplingMethod
+  {
+    REJECTION = 0,
+    UNIFORMIZATION = 1
+  };
+
 protected:
   const SimpleMutationProcess* mappingParameters_; // this instance will hold the parameters required for the sotchastic mapping procedure, and be used to generate stochastic mappings
   Tree* baseTree_;                                 // this is the base tree, which will act as the skeleton of each induced mapping in the procedure
@@ -71,6 +83,9 @@ protected:
   size_t nodesCounter_;                            // counter of nodes hat allows adding unique names to the generated nodes while breaking branching in a mapping
   size_t numOfMappings_;                           // the number of stochastic mappings to generate
   map<int,size_t> nodeIdToIndex_;
+  SamplingMethod samplingMethod_;                  // the method used to sample the history of each branch
+  double uniformizationRate_;                      // the rate mu of the uniformized process, i.e. the largest rate of leaving a state
+  vector<RowMatrix<double>> uniformizedPowers_;    // powers of the transition matrix of the uniformized process R = I + Q / mu, computed on demand (entry n holds R^n)
 
 public:
   /* constructors and destructors */
@@ -80,7 +95,7 @@ public:
   ~StochasticMapping();
 
   StochasticMapping(const StochasticMapping& sm) : // must pass sm by repference to avoid infinitie recusion in the copy construcor
-    mappingParameters_(sm.mappingParameters_), baseTree_(0), tl_(sm.tl_), fractionalProbabilities_(sm.fractionalProbabilities_), ConditionalProbabilities_(sm.ConditionalProbabilities_), nodesCounter_(0), numOfMappings_(sm.numOfMappings_), nodeIdToIndex_(sm.nodeIdToIndex_)
+    mappingParameters_(sm.mappingParameters_), baseTree_(0), tl_(sm.tl_), fractionalProbabilities_(sm.fractionalProbabilities_), ConditionalProbabilities_(sm.ConditionalProbabilities_), nodesCounter_(0), numOfMappings_(sm.numOfMappings_), nodeIdToIndex_(sm.nodeIdToIndex_), samplingMethod_(sm.samplingMethod_), uniformizationRate_(sm.uniformizationRate_), uniformizedPowers_(sm.uniformizedPowers_)
   { baseTree_ = sm.baseTree_->clone(); } // the tree must be cloned so that instead of copying the pointer to the tree, a new tree with a new pointer will be created
 
   /**
@@ -95,6 +110,9 @@ public:
     ConditionalProbabilities_ = sm.ConditionalProbabilities_;
     numOfMappings_ = sm.numOfMappings_;
     nodeIdToIndex_ = sm.nodeIdToIndex_;
+    samplingMethod_ = sm.samplingMethod_;
+    uniformizationRate_ = sm.uniformizationRate_;
+    uniformizedPowers_ = sm.uniformizedPowers_;
     return *this;
   }
 
@@ -103,6 +121,13 @@ public:
    */
   StochasticMapping* clone() const { return new StochasticMapping(*this); }
 
+  /* sets the method used to sample the history of each branch given the states at its ends (REJECTION by default)
+   * @param method            The sampling method
+   */
+  void setSamplingMethod(SamplingMethod method) { samplingMethod_ = method; }
+
+  SamplingMethod getSamplingMethod() const { return samplingMethod_; }
+
 
   /* generates a stochastic mappings based on the sampling parameters
    * @param     Number of histories to sample
@@ -203,6 +228,20 @@ private:
    */
   void sampleMutationsGivenAncestralsPerBranch(Node* son, size_t maxIterNum = 10000);
 
+  /* sample mutations along a branch directly from their distribution given the source and destination states, using uniformization, and updates the simulated history along the branch in the input tree
+   * the number of jumps of the uniformized process is drawn first, then their times and the states between them
+   * @param son                   Node of interest
+   */
+  void sampleMutationsGivenAncestralsPerBranchByUniformization(Node* son);
+
+  /* computes the transition matrix of the uniformized process from the current generator of the model, and discards its previously computed powers */
+  void initUniformization();
+
+  /* returns the n'th power of the transition matrix of the uniformized process, computing it if needed
+   * @param n                     The exponent
+   */
+  const RowMatrix<double>& getUniformizedPower(size_t n);
+
   /* converts a vector of dwelling times to a mutation path and then updates the bracnh stemming from the given node */
   /* @param node                      The node at the bottom of the branch
    * @param dwellingTimes             A vector of dwelling times where the value at each entry i corresponds to the dwelling time under the i'th state
@@ -45,6 +45,8 @@
 #include "../Likelihood/DRTreeLikelihoodTools.h"
 #include "../Likelihood/MarginalAncestralStateReconstruction.h"
 
+#include "../ThreadPool.h"
+
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/Matrix/MatrixTools.h>
@@ -55,6 +57,10 @@ using namespace bpp;
 
 // From the STL:
 #include <iomanip>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
 
 using namespace std;
 
@@ -64,7 +70,8 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   const DRTreeLikelihood& drtl,
   const vector<int>& nodeIds,
   SubstitutionCount& substitutionCount,
-  bool verbose)
+  bool verbose,
+  size_t nbThreads)
 {
   // Preamble:
   if (!drtl.isInitialized())
@@ -74,140 +81,198 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 
   const TreeTemplate<Node> tree(drtl.getTree());
   const SiteContainer*    sequences = drtl.getData();
-  const DiscreteDistribution* rDist = drtl.getRateDistribution();
 
   size_t nbSites         = sequences->getNumberOfSites();
-  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
-  size_t nbStates        = sequences->getAlphabet()->getSize();
-  size_t nbClasses       = rDist->getNumberOfCategories();
-  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
   vector<const Node*> nodes    = tree.getNodes();
-  const vector<size_t>* rootPatternLinks
-    = &drtl.getLikelihoodData()->getRootArrayPositions();
   nodes.pop_back(); // Remove root node.
   size_t nbNodes         = nodes.size();
 
   // We create a new ProbabilisticSubstitutionMapping object:
   ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
-  Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
-
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
     ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
 
+  vector<size_t> nodeIndices;
   for (size_t l = 0; l < nbNodes; ++l)
   {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
-      continue;
-
-    const Node* father = currentNode->getFather();
+    if (nodeIds.size() == 0 || VectorTools::contains(nodeIds, nodes[l]->getId()))
+      nodeIndices.push_back(l);
+  }
 
-    double d = currentNode->getDistanceToFather();
+  unique_ptr<ThreadPool> pool;
+  if (nbThreads != 1 && nodeIndices.size() > 1)
+  {
+    pool.reset(new ThreadPool(nbThreads));
+    if (pool->getNumberOfThreads() == 1)
+      pool.reset();
+  }
 
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    VVdouble substitutionsForCurrentNode(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
+  if (!pool)
+  {
+    for (size_t k = 0; k < nodeIndices.size(); ++k)
     {
-      substitutionsForCurrentNode[i].resize(nbTypes);
+      size_t l = nodeIndices[k];
+      if (verbose)
+        ApplicationTools::displayGauge(l, nbNodes - 1);
+      vector<VVVVdouble> nxy = computeSubstitutionNumbersForBranch_(drtl, nodes[l], substitutionCount);
+      computeSubstitutionVectorsForBranch_(drtl, nodes[l], l, nxy, *substitutions);
     }
+  }
+  else
+  {
+    // The substitution count and the substitution models it uses store intermediate results,
+    // so the count matrices of all branches are computed here, before entering the parallel section:
+    vector< vector<VVVVdouble> > nxys(nodeIndices.size());
+    for (size_t k = 0; k < nodeIndices.size(); ++k)
+    {
+      nxys[k] = computeSubstitutionNumbersForBranch_(drtl, nodes[nodeIndices[k]], substitutionCount);
+    }
+
+    // Branches are distributed dynamically. Each branch writes its own entries of the mapping,
+    // which is therefore not locked.
+    size_t nbWorkers = min(nodeIndices.size(), pool->getNumberOfThreads());
+    atomic<size_t> nextBranch(0);
+    size_t nbBranchesDone = 0;
+    mutex gaugeMutex;
+    pool->run(nbWorkers, [&](size_t) {
+        for (size_t k = nextBranch++; k < nodeIndices.size(); k = nextBranch++)
+        {
+          size_t l = nodeIndices[k];
+          computeSubstitutionVectorsForBranch_(drtl, nodes[l], l, nxys[k], *substitutions);
+          nxys[k].clear();
+          if (verbose)
+          {
+            lock_guard<mutex> lock(gaugeMutex);
+            ApplicationTools::displayGauge(nbBranchesDone++, nodeIndices.size() - 1);
+          }
+        }
+      });
+  }
+  if (verbose)
+  {
+    if (ApplicationTools::message)
+      *ApplicationTools::message << " ";
+    ApplicationTools::displayTaskDone();
+  }
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; i++)
-    {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
+  return substitutions;
+}
+
+/******************************************************************************/
+
+vector<VVVVdouble> SubstitutionMappingTools::computeSubstitutionNumbersForBranch_(
+  const DRTreeLikelihood& drtl,
+  const Node* currentNode,
+  SubstitutionCount& substitutionCount)
+{
+  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+
+  size_t nbStates        = drtl.getData()->getAlphabet()->getSize();
+  size_t nbClasses       = rDist->getNumberOfCategories();
+  size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
+  Vdouble rcRates = rDist->getCategories();
+
+  double d = currentNode->getDistanceToFather();
+
+  vector<VVVVdouble> nxys;
+  unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
+  while (mit->hasNext())
+  {
+    TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+    substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
+    nxys.push_back(VVVVdouble(nbClasses));
+    VVVVdouble* nxy = &nxys.back();
+    for (size_t c = 0; c < nbClasses; ++c)
+    {
+      VVVdouble* nxy_c = &(*nxy)[c];
+      double rc = rcRates[c];
+      nxy_c->resize(nbTypes);
+      for (size_t t = 0; t < nbTypes; ++t)
       {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
+        VVdouble* nxy_c_t = &(*nxy_c)[t];
+        Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
+         
+        nxy_c_t->resize(nbStates);
+        for (size_t x = 0; x < nbStates; ++x)
         {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
+          Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
+          nxy_c_t_x->resize(nbStates);
+          for (size_t y = 0; y < nbStates; ++y)
+          {
+            (*nxy_c_t_x)[y] = (*nijt)(x, y);
+          }
         }
+        delete nijt;
       }
     }
+  }
+  return nxys;
+}
 
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
+/******************************************************************************/
+
+void SubstitutionMappingTools::computeSubstitutionVectorsForBranch_(
+  const DRTreeLikelihood& drtl,
+  const Node* currentNode,
+  size_t nodeIndex,
+  const vector<VVVVdouble>& nxys,
+  ProbabilisticSubstitutionMapping& substitutions)
+{
+  // A few variables we'll need:
+  const SiteContainer*    sequences = drtl.getData();
+  const DiscreteDistribution* rDist = drtl.getRateDistribution();
+
+  size_t nbSites         = sequences->getNumberOfSites();
+  size_t nbDistinctSites = drtl.getLikelihoodData()->getNumberOfDistinctSites();
+  size_t nbStates        = sequences->getAlphabet()->getSize();
+  size_t nbClasses       = rDist->getNumberOfCategories();
+  size_t nbTypes         = substitutions.getNumberOfSubstitutionTypes();
+  const vector<size_t>* rootPatternLinks
+    = &drtl.getLikelihoodData()->getRootArrayPositions();
+
+  const Node* father = currentNode->getFather();
+
+  VVdouble substitutionsForCurrentNode(nbDistinctSites);
+  for (size_t i = 0; i < nbDistinctSites; ++i)
+  {
+    substitutionsForCurrentNode[i].resize(nbTypes);
+  }
+  // The likelihood of each site, computed from the same (possibly scaled) arrays:
+  Vdouble Lr(nbDistinctSites, 0.);
+
+  // Now we've got to compute likelihoods in a smart manner... ;)
+  VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
+  for (size_t i = 0; i < nbDistinctSites; i++)
+  {
+    VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+    likelihoodsFatherConstantPart_i->resize(nbClasses);
+    for (size_t c = 0; c < nbClasses; c++)
     {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
+      Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+      likelihoodsFatherConstantPart_i_c->resize(nbStates);
+      double rc = rDist->getProbability(c);
+      for (size_t s = 0; s < nbStates; s++)
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
-        {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
-          {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
-            {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
-            }
-          }
-        }
+        // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
+        // freq is already accounted in the array
+        (*likelihoodsFatherConstantPart_i_c)[s] = rc;
       }
     }
-    if (father->hasFather())
+  }
+
+  // First, what will remain constant:
+  size_t nbSons =  father->getNumberOfSons();
+  for (size_t n = 0; n < nbSons; n++)
+  {
+    const Node* currentSon = father->getSon(n);
+    if (currentSon->getId() != currentNode->getId())
     {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+
       // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
+      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
       VVVdouble pxy;
       bool first;
       while (mit->hasNext())
@@ -221,23 +286,22 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
           // We retrieve the transition probabilities for this site partition:
           if (first)
           {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
+            pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; c++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; x++)
             {
+              Vdouble* pxy_c_x = &(*pxy_c)[x];
               double likelihood = 0.;
               for (size_t y = 0; y < nbStates; y++)
               {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -245,129 +309,139 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         }
       }
     }
-    else
-    {
-      // Account for root frequencies:
-      for (size_t i = 0; i < nbDistinctSites; i++)
-      {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; c++)
-        {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          for (size_t x = 0; x < nbStates; x++)
-          {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
-          }
-        }
-      }
-    }
-
-
-    // Then, we deal with the node of interest.
-    // We first average upon 'y' to save computations, and then upon 'x'.
-    // ('y' is the state at 'node' and 'x' the state at 'father'.)
-
-    // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
+  }
+  if (father->hasFather())
+  {
+    const Node* currentSon = father->getFather();
+    ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+    // Now iterate over all site partitions:
+    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
     VVVdouble pxy;
     bool first;
     while (mit->hasNext())
     {
       TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getSubstitutionModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
-      {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-           
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
-      }
-
-      // Now loop over sites:
       unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
       first = true;
       while (sit->hasNext())
       {
         size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
+        // We retrieve the transition probabilities for this site partition:
         if (first)
         {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
+          pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-        for (size_t c = 0; c < nbClasses; ++c)
+        for (size_t c = 0; c < nbClasses; c++)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
-          for (size_t x = 0; x < nbStates; ++x)
+          VVdouble* pxy_c = &pxy[c];
+          for (size_t x = 0; x < nbStates; x++)
           {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
-            const Vdouble* pxy_c_x = &(*pxy_c)[x];
-            for (size_t y = 0; y < nbStates; ++y)
+            double likelihood = 0.;
+            for (size_t y = 0; y < nbStates; y++)
             {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
-                                      * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
-              for (size_t t = 0; t < nbTypes; ++t)
-              {
-                // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
-              }
+              Vdouble* pxy_c_x = &(*pxy_c)[y];
+              likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
             }
+            (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
           }
-          
         }
       }
     }
-
-    // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+  }
+  else
+  {
+    // Account for root frequencies:
+    for (size_t i = 0; i < nbDistinctSites; i++)
     {
-      for (size_t t = 0; t < nbTypes; ++t)
+      vector<double> freqs = drtl.getRootFrequencies(i);
+      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+      for (size_t c = 0; c < nbClasses; c++)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
+        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+        for (size_t x = 0; x < nbStates; x++)
+        {
+          (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
+        }
       }
     }
   }
-  if (verbose)
+
+
+  // Then, we deal with the node of interest.
+  // We first average upon 'y' to save computations, and then upon 'x'.
+  // ('y' is the state at 'node' and 'x' the state at 'father'.)
+
+  // Iterate over all site partitions:
+  ConditionalLikelihoodArray likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
+  unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
+  VVVdouble pxy;
+  bool first;
+  for (size_t m = 0; mit->hasNext(); ++m)
   {
-    if (ApplicationTools::message)
-      *ApplicationTools::message << " ";
-    ApplicationTools::displayTaskDone();
+    TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+    // The substitution numbers were computed beforehand, in the same order:
+    const VVVVdouble& nxy = nxys[m];
+
+    // Now loop over sites:
+    unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
+    first = true;
+    while (sit->hasNext())
+    {
+      size_t i = sit->next();
+      // We retrieve the transition probabilities and substitution counts for this site partition:
+      if (first)
+      {
+        pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
+        first = false;
+      }
+      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+      for (size_t c = 0; c < nbClasses; ++c)
+      {
+        const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
+        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+        const VVdouble* pxy_c = &pxy[c];
+        const VVVdouble* nxy_c = &nxy[c];
+        for (size_t x = 0; x < nbStates; ++x)
+        {
+          double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
+          const Vdouble* pxy_c_x = &(*pxy_c)[x];
+          for (size_t y = 0; y < nbStates; ++y)
+          {
+            double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
+                                    * (*pxy_c_x)[y]
+                                    * likelihoodsFather_node_i_c[y];
+            Lr[i] += likelihood_cxy;
+
+            for (size_t t = 0; t < nbTypes; ++t)
+            {
+              // Now the vector computation:
+              substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
+              //                                   <------------>   <--------------->
+              // Posterior probability                   |                 |
+              // for site i and rate class c *           |                 |
+              // likelihood for this site----------------+                 |
+              //                                                           |
+              // Substitution function for site i and rate class c----------+
+            }
+          }
+        }
+        
+      }
+    }
   }
 
-  return substitutions;
+  // Now we just have to copy the substitutions into the result vector:
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    for (size_t t = 0; t < nbTypes; ++t)
+    {
+      substitutions(nodeIndex, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
+    }
+  }
 }
 
 /******************************************************************************/
@@ -403,25 +477,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   // We create a new ProbabilisticSubstitutionMapping object:
   ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
 
-  // Store likelihood for each rate for each site:
-  VVVdouble lik;
-  drtl.computeLikelihoodAtNode(tree.getRootId(), lik);
-  Vdouble Lr(nbDistinctSites, 0);
-  Vdouble rcProbs = rDist->getProbabilities();
   Vdouble rcRates = rDist->getCategories();
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    VVdouble* lik_i = &lik[i];
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      Vdouble* lik_i_c = &(*lik_i)[c];
-      double rc = rDist->getProbability(c);
-      for (size_t s = 0; s < nbStates; s++)
-      {
-        Lr[i] += (*lik_i_c)[s] * rc;
-      }
-    }
-  }
 
   // Compute the number of substitutions for each class and each branch in the tree:
   if (verbose)
@@ -445,6 +501,8 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     {
       substitutionsForCurrentNode[i].resize(nbTypes);
     }
+    // The likelihood of each site, computed from the same (possibly scaled) arrays:
+    Vdouble Lr(nbDistinctSites, 0.);
 
     // Now we've got to compute likelihoods in a smart manner... ;)
     VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
@@ -473,7 +531,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -493,11 +551,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; c++)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; x++)
@@ -506,7 +563,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; y++)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -518,7 +575,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -537,11 +594,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; c++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; x++)
@@ -550,7 +606,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               for (size_t y = 0; y < nbStates; y++)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -582,7 +638,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
+    ConditionalLikelihoodArray likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -628,11 +684,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVVdouble* nxy_c = &nxy[c];
@@ -644,7 +699,8 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
+              Lr[i] += likelihood_cxy;
 
               for (size_t t = 0; t < nbTypes; ++t)
               {
@@ -762,7 +818,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -782,11 +838,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; ++c)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; ++x)
@@ -795,7 +850,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; ++y)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -807,7 +862,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConditionalLikelihoodArray likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -826,11 +881,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; ++c)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; ++x)
@@ -839,7 +893,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               for (size_t y = 0; y < nbStates; ++y)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -870,7 +924,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
+    ConditionalLikelihoodArray likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -915,7 +969,6 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         RowMatrix<double> pairProbabilities(nbStates, nbStates);
         MatrixTools::fill(pairProbabilities, 0.);
@@ -930,7 +983,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         }
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVVdouble* nxy_c = &nxy[c];
@@ -942,7 +995,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
               pairProbabilities(x, y) += likelihood_cxy; // Sum over all rate classes.
               for (size_t t = 0; t < nbTypes; ++t)
               {
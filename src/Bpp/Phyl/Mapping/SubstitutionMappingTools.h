@@ -74,16 +74,18 @@ namespace bpp
      * @param drtl              A DRTreeLikelihood object.
      * @param substitutionCount The SubstitutionCount to use.
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads to use (0 means the number of hardware threads).
      * @return A vector of substitutions vectors (one for each site).
      * @throw Exception If the likelihood object is not initialized.
      */
     static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
       const DRTreeLikelihood& drtl,
       SubstitutionCount& substitutionCount,
-      bool verbose = true)
+      bool verbose = true,
+      size_t nbThreads = 1)
     {
       std::vector<int> nodeIds;
-      return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose);
+      return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose, nbThreads);
     }
 
     /**
@@ -96,6 +98,11 @@ namespace bpp
      *                          on all nodes.
      * @param substitutionCount The SubstitutionCount to use.
      * @param verbose           Print info to screen.
+     * @param nbThreads         The number of threads to use (0 means the number of hardware threads).
+     *                          The numbers of substitutions are first computed for all branches on the calling thread,
+     *                          as the SubstitutionCount object and the models are not thread-safe. The per-site
+     *                          accumulation is then done for several branches in parallel, which requires memory for
+     *                          the substitution numbers of all the branches at once. Results do not depend on the number of threads.
      * @return A vector of substitutions vectors (one for each site).
      * @throw Exception If the likelihood object is not initialized.
      */
@@ -103,7 +110,8 @@ namespace bpp
       const DRTreeLikelihood& drtl,
       const std::vector<int>& nodeIds,
       SubstitutionCount& substitutionCount,
-      bool verbose = true);
+      bool verbose = true,
+      size_t nbThreads = 1);
 
     static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
       const DRTreeLikelihood& drtl,
@@ -774,6 +782,40 @@ namespace bpp
      *
      */
 
+  private:
+    /**
+     * @brief Compute the numbers of substitutions of a single branch, for each rate class and substitution type.
+     *
+     * This modifies the substitution count and calls the branch models,
+     * it must therefore not be run concurrently for the same objects.
+     *
+     * @param drtl              A DRTreeLikelihood object.
+     * @param node              The node at the bottom of the branch.
+     * @param substitutionCount The SubstitutionCount to use.
+     * @return One [class][type][x][y] array for each branch model description, in the order of the branch model iterator.
+     */
+    static std::vector<VVVVdouble> computeSubstitutionNumbersForBranch_(
+      const DRTreeLikelihood& drtl,
+      const Node* node,
+      SubstitutionCount& substitutionCount);
+
+    /**
+     * @brief Compute the substitutions vectors of a single branch, and store them in the mapping.
+     *
+     * Only reads the likelihood object, so that several branches can be processed in parallel.
+     *
+     * @param drtl          A DRTreeLikelihood object.
+     * @param node          The node at the bottom of the branch.
+     * @param nodeIndex     The index of the node in the mapping.
+     * @param nxys          The numbers of substitutions, as returned by computeSubstitutionNumbersForBranch_.
+     * @param substitutions The mapping to fill.
+     */
+    static void computeSubstitutionVectorsForBranch_(
+      const DRTreeLikelihood& drtl,
+      const Node* node,
+      size_t nodeIndex,
+      const std::vector<VVVVdouble>& nxys,
+      ProbabilisticSubstitutionMapping& substitutions);
   };
 } // end of namespace bpp.
 
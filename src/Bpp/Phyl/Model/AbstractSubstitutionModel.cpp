@@ -165,7 +165,8 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, std:
   isNonSingular_(false),
   leftEigenVectors_(size_, size_),
   vPowGen_(),
-  tmpMat_(size_, size_)
+  tmpMat_(size_, size_),
+  pijCache_()
 {
 }
 
@@ -174,6 +175,7 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, std:
 
 void AbstractSubstitutionModel::updateMatrices()
 {
+  invalidateTransitionMatrices_();
 
   // Compute eigen values and vectors:
   if (enableEigenDecomposition())
@@ -183,6 +185,11 @@ void AbstractSubstitutionModel::updateMatrices()
 
     size_t nbStop=0;
     size_t salph = getNumberOfStates();
+
+    // Generators of reversible models with given frequencies are diagonalized through their
+    // symmetrized form, which gives the left eigen vectors without inverting the right ones:
+    bool reversible = !computeFrequencies() && dynamic_cast<ReversibleSubstitutionModel*>(this);
+    bool leftComputed = false;
     vector<bool> vnull(salph); // vector of the indices of lines with
                                // only zeros
 
@@ -212,12 +219,14 @@ void AbstractSubstitutionModel::updateMatrices()
       size_t salphok=salph - nbStop;
       
       RowMatrix<double> gk(salphok, salphok);
+      Vdouble fk;
       size_t gi = 0, gj = 0;
 
       for (size_t i = 0; i < salph; i++)
       {
         if (!vnull[i])
         {
+          fk.push_back(freq_[i]);
           gj = 0;
           for (size_t j = 0; j < salph; j++)
           {
@@ -233,9 +242,19 @@ void AbstractSubstitutionModel::updateMatrices()
           gi++;
       }
 
-      EigenValue<double> ev(gk);
-      eigenValues_ = ev.getRealEigenValues();
-      iEigenValues_ = ev.getImagEigenValues();
+      RowMatrix<double> rev, lev;
+      if (reversible && symmetricEigenDecomposition_(gk, fk, eigenValues_, rev, lev))
+      {
+        iEigenValues_.assign(salphok, 0);
+        leftComputed = true;
+      }
+      else
+      {
+        EigenValue<double> ev(gk);
+        eigenValues_ = ev.getRealEigenValues();
+        iEigenValues_ = ev.getImagEigenValues();
+        rev = ev.getV();
+      }
 
       for (size_t i = 0; i < nbStop; i++)
       {
@@ -243,8 +262,9 @@ void AbstractSubstitutionModel::updateMatrices()
         iEigenValues_.push_back(0);
       }
 
-      RowMatrix<double> rev = ev.getV();
       rightEigenVectors_.resize(salph, salph);
+      if (leftComputed)
+        leftEigenVectors_.resize(salph, salph);
       gi = 0;
       for (size_t i = 0; i < salph; i++)
       {
@@ -257,6 +277,14 @@ void AbstractSubstitutionModel::updateMatrices()
           }
 
           rightEigenVectors_(i, salphok + gi - 1) = 1;
+          if (leftComputed)
+          {
+            for (size_t j = 0; j < salph; j++)
+            {
+              leftEigenVectors_(j, i) = 0;
+            }
+            leftEigenVectors_(salphok + gi - 1, i) = 1;
+          }
         }
         else
         {
@@ -269,22 +297,44 @@ void AbstractSubstitutionModel::updateMatrices()
           {
             rightEigenVectors_(i, j) = 0;
           }
+
+          if (leftComputed)
+          {
+            for (size_t j = 0; j < salphok; j++)
+            {
+              leftEigenVectors_(j, i) = lev(j, i - gi);
+            }
+
+            for (size_t j = salphok; j < salph; j++)
+            {
+              leftEigenVectors_(j, i) = 0;
+            }
+          }
         }
       }
     }
     else
     {
-      EigenValue<double> ev(generator_);
-      rightEigenVectors_ = ev.getV();
-      eigenValues_ = ev.getRealEigenValues();
-      iEigenValues_ = ev.getImagEigenValues();
+      if (reversible && symmetricEigenDecomposition_(generator_, freq_, eigenValues_, rightEigenVectors_, leftEigenVectors_))
+      {
+        iEigenValues_.assign(salph, 0);
+        leftComputed = true;
+      }
+      else
+      {
+        EigenValue<double> ev(generator_);
+        rightEigenVectors_ = ev.getV();
+        eigenValues_ = ev.getRealEigenValues();
+        iEigenValues_ = ev.getImagEigenValues();
+      }
       nbStop = 0;
     }
 
     /// Now check inversion and diagonalization
     try
     {
-      MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
+      if (!leftComputed)
+        MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
 
       // is it diagonalizable ?
       isDiagonalizable_ = true;
@@ -421,10 +471,64 @@ void AbstractSubstitutionModel::updateMatrices()
 }
 
 
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::symmetricEigenDecomposition_(
+  const Matrix<double>& generator,
+  const Vdouble& freq,
+  Vdouble& eigenValues,
+  RowMatrix<double>& rightEigenVectors,
+  RowMatrix<double>& leftEigenVectors)
+{
+  size_t n = freq.size();
+  Vdouble sqrtFreq(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    if (freq[i] <= 0)
+      return false;
+    sqrtFreq[i] = sqrt(freq[i]);
+  }
+
+  // S = Pi^1/2 Q Pi^-1/2 is symmetric when pi_i Q_ij = pi_j Q_ji.
+  // It is made exactly symmetric, so that the symmetric eigen solver is used:
+  RowMatrix<double> sym(n, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    sym(i, i) = generator(i, i);
+    for (size_t j = 0; j < i; j++)
+    {
+      double a = freq[i] * generator(i, j);
+      double b = freq[j] * generator(j, i);
+      if (abs(a - b) > NumConstants::TINY() * (abs(a) + abs(b)))
+        return false;
+      sym(i, j) = (a + b) / (2. * sqrtFreq[i] * sqrtFreq[j]);
+      sym(j, i) = sym(i, j);
+    }
+  }
+
+  // With S = U D U^T and U orthogonal, Q = (Pi^-1/2 U) D (U^T Pi^1/2):
+  EigenValue<double> ev(sym);
+  eigenValues = ev.getRealEigenValues();
+  const Matrix<double>& u = ev.getV();
+  rightEigenVectors.resize(n, n);
+  leftEigenVectors.resize(n, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      rightEigenVectors(i, j) = u(i, j) / sqrtFreq[i];
+      leftEigenVectors(j, i) = u(i, j) * sqrtFreq[i];
+    }
+  }
+  return true;
+}
+
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
 {
+  if (t != 0 && pijCache_.get(TransitionMatrixCache::PIJ, rate_, t, pijt_))
+    return pijt_;
   if (t == 0)
   {
     MatrixTools::getId(size_, pijt_);
@@ -491,6 +595,8 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
     }
   }
 //  MatrixTools::print(pijt_);
+  if (t != 0)
+    pijCache_.put(TransitionMatrixCache::PIJ, rate_, t, pijt_);
   return pijt_;
 }
 
@@ -498,6 +604,8 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
 
 const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 {
+  if (pijCache_.get(TransitionMatrixCache::DPIJ, rate_, t, dpijt_))
+    return dpijt_;
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
@@ -562,6 +670,7 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
     MatrixTools::mult(vPowGen_[1], dpijt_, tmpMat_);
     MatrixTools::copy(tmpMat_, dpijt_);
   }
+  pijCache_.put(TransitionMatrixCache::DPIJ, rate_, t, dpijt_);
   return dpijt_;
 }
 
@@ -569,6 +678,8 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 
 const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 {
+  if (pijCache_.get(TransitionMatrixCache::D2PIJ, rate_, t, d2pijt_))
+    return d2pijt_;
   if (isNonSingular_)
   {
     if (isDiagonalizable_)
@@ -637,11 +748,123 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
     MatrixTools::mult(vPowGen_[2], d2pijt_, tmpMat_);
     MatrixTools::copy(tmpMat_, d2pijt_);
   }
+  pijCache_.put(TransitionMatrixCache::D2PIJ, rate_, t, d2pijt_);
   return d2pijt_;
 }
 
 /******************************************************************************/
 
+void AbstractSubstitutionModel::computeMatrices_(const vector<double>& times, TransitionMatrixCache::MatrixType type, vector< RowMatrix<double> >& matrices) const
+{
+  // Matrices are computed in a flat buffer, then copied:
+  size_t n = size_;
+  size_t nbTimes = times.size();
+  vector<double> buffer(nbTimes * n * n);
+  fillMatrices_(times, type, buffer.data(), n);
+  matrices.resize(nbTimes);
+  for (size_t k = 0; k < nbTimes; k++)
+  {
+    RowMatrix<double>& m = matrices[k];
+    m.resize(n, n);
+    const double* in = &buffer[k * n * n];
+    for (size_t x = 0; x < n; x++)
+    {
+      std::copy(in + x * n, in + (x + 1) * n, m.getRow(x).begin());
+    }
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::fillMatrices_(const vector<double>& times, TransitionMatrixCache::MatrixType type, double* matrices, size_t stride) const
+{
+  size_t n = size_;
+  size_t nbTimes = times.size();
+  if (hasOwnTransitionMatrices_() || !isNonSingular_ || !isDiagonalizable_)
+  {
+    for (size_t k = 0; k < nbTimes; k++)
+    {
+      double* out = matrices + k * n * stride;
+      switch (type)
+      {
+      case TransitionMatrixCache::PIJ:
+        TransitionKernels::copy(getPij_t(times[k]), out, stride, n);
+        break;
+      case TransitionMatrixCache::DPIJ:
+        TransitionKernels::copy(getdPij_dt(times[k]), out, stride, n);
+        break;
+      case TransitionMatrixCache::D2PIJ:
+        TransitionKernels::copy(getd2Pij_dt2(times[k]), out, stride, n);
+        break;
+      }
+    }
+    return;
+  }
+
+  // Eigen vectors are stored in flat arrays, they are used for all products:
+  vector<double> right(n * n);
+  vector<double> left(n * n);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      right[i * n + j] = rightEigenVectors_(i, j);
+      left[i * n + j] = leftEigenVectors_(i, j);
+    }
+  }
+
+  Vdouble factors(n, 1.);
+  if (type == TransitionMatrixCache::DPIJ)
+    factors = rate_ * eigenValues_;
+  else if (type == TransitionMatrixCache::D2PIJ)
+    factors = VectorTools::sqr(rate_ * eigenValues_);
+
+  // The cache works on matrices, which are only used if it is enabled:
+  bool useCache = pijCache_.getCapacity() > 0;
+  RowMatrix<double> m;
+  vector<double> diag(n);
+  for (size_t k = 0; k < nbTimes; k++)
+  {
+    double t = times[k];
+    double* out = matrices + k * n * stride;
+    if (type == TransitionMatrixCache::PIJ && t == 0)
+    {
+      for (size_t x = 0; x < n; x++)
+      {
+        for (size_t y = 0; y < n; y++)
+        {
+          out[x * stride + y] = (x == y ? 1. : 0.);
+        }
+      }
+      continue;
+    }
+    if (useCache && pijCache_.get(type, rate_, t, m))
+    {
+      TransitionKernels::copy(m, out, stride, n);
+      continue;
+    }
+    for (size_t j = 0; j < n; j++)
+    {
+      diag[j] = factors[j] * std::exp(eigenValues_[j] * (rate_ * t));
+    }
+    TransitionKernels::exponential(&right[0], &diag[0], &left[0], out, stride, n);
+    if (useCache)
+    {
+      m.resize(n, n);
+      for (size_t x = 0; x < n; x++)
+      {
+        for (size_t y = 0; y < n; y++)
+        {
+          m(x, y) = out[x * stride + y];
+        }
+      }
+      pijCache_.put(type, rate_, t, m);
+    }
+  }
+}
+
+/******************************************************************************/
+
 double AbstractSubstitutionModel::getScale() const
 {
   vector<double> v;
@@ -655,6 +878,7 @@ void AbstractSubstitutionModel::setScale(double scale)
 {
   if (isScalable_)
   {
+    invalidateTransitionMatrices_();
     MatrixTools::scale(generator_, scale);
     eigenValues_ *= scale;
     iEigenValues_ *= scale;
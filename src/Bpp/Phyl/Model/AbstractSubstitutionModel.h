@@ -41,6 +41,7 @@
 #define _ABSTRACTSUBSTITUTIONMODEL_H_
 
 #include "SubstitutionModel.h"
+#include "TransitionMatrixCache.h"
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -333,6 +334,11 @@ namespace bpp
      * @brief For computational issues
      */
     mutable RowMatrix<double> tmpMat_;
+
+    /**
+     * @brief Previously computed transition matrices, see setTransitionMatrixCacheSize().
+     */
+    mutable TransitionMatrixCache pijCache_;
   
   public:
     AbstractSubstitutionModel(const Alphabet* alpha, std::shared_ptr<const StateMap> stateMap, const std::string& prefix);
@@ -352,7 +358,8 @@ namespace bpp
       isNonSingular_(model.isNonSingular_),
       leftEigenVectors_(model.leftEigenVectors_),
       vPowGen_(model.vPowGen_),
-      tmpMat_(model.tmpMat_)
+      tmpMat_(model.tmpMat_),
+      pijCache_(model.pijCache_)
     {}
 
     AbstractSubstitutionModel& operator=(const AbstractSubstitutionModel& model)
@@ -371,6 +378,7 @@ namespace bpp
       leftEigenVectors_  = model.leftEigenVectors_;
       vPowGen_           = model.vPowGen_;
       tmpMat_            = model.tmpMat_;
+      pijCache_          = model.pijCache_;
       return *this;
     }
   
@@ -391,6 +399,57 @@ namespace bpp
     const Matrix<double>& getdPij_dt(double t) const;
     const Matrix<double>& getd2Pij_dt2(double t) const;
 
+    /**
+     * @name Transition matrices for several branch lengths.
+     *
+     * When the generator is diagonalizable in R, the eigen vectors are reused for all lengths,
+     * and the matrices are computed as one product of the stacked, scaled, right eigen vectors
+     * by the left eigen vectors, which stay in cache during the whole computation.
+     * Other cases, and models which provide their own formulas, fall back to one computation per length.
+     * Matrices are taken from, and added to, the cache of transition matrices if it is enabled.
+     * These methods copy the result of fillPij_t() and its derivatives, which should be preferred
+     * when a flat layout is convenient.
+     * @{
+     */
+    void computePij_t(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      computeMatrices_(times, TransitionMatrixCache::PIJ, matrices);
+    }
+
+    void computedPij_dt(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      computeMatrices_(times, TransitionMatrixCache::DPIJ, matrices);
+    }
+
+    void computed2Pij_dt2(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      computeMatrices_(times, TransitionMatrixCache::D2PIJ, matrices);
+    }
+    /** @} */
+
+    /**
+     * @name Transition matrices for several branch lengths, in a flat buffer.
+     *
+     * Same as above, with the products of the eigen vectors written directly in the
+     * buffer by the kernel specialized for the number of states.
+     * @{
+     */
+    void fillPij_t(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      fillMatrices_(times, TransitionMatrixCache::PIJ, matrices, stride);
+    }
+
+    void filldPij_dt(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      fillMatrices_(times, TransitionMatrixCache::DPIJ, matrices, stride);
+    }
+
+    void filld2Pij_dt2(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      fillMatrices_(times, TransitionMatrixCache::D2PIJ, matrices, stride);
+    }
+    /** @} */
+
     double Sij(size_t i, size_t j) const { return exchangeability_(i, j); }
 
     const Vdouble& getEigenValues() const { return eigenValues_; }
@@ -411,7 +470,41 @@ namespace bpp
 
     bool enableEigenDecomposition() { return eigenDecompose_; }
 
+    /**
+     * @brief Set the number of matrices kept by getPij_t, getdPij_dt and getd2Pij_dt2.
+     *
+     * Matrices are kept together with the rate of the model and the branch length used
+     * to compute them, so that they are not recomputed when requested again,
+     * typically for other branches or rate classes with the same length, or when
+     * a likelihood function goes back to a previous branch length during optimization.
+     * Cached matrices are discarded each time the generator is updated.
+     * The cache is disabled by default (size 0).
+     *
+     * @param size The maximum number of matrices to keep (all kinds together).
+     */
+    void setTransitionMatrixCacheSize(size_t size) { pijCache_.setCapacity(size); }
+
+    /**
+     * @return The cache of transition matrices, which gives access to the number of hits and misses.
+     */
+    const TransitionMatrixCache& getTransitionMatrixCache() const { return pijCache_; }
+
   protected:
+    /**
+     * @brief Discard all cached transition matrices.
+     *
+     * This is called by updateMatrices() and setScale(). Derived classes which modify the
+     * generator or its decomposition without calling these methods must call it explicitly.
+     */
+    void invalidateTransitionMatrices_() { pijCache_.invalidate(); }
+
+    /**
+     * @return True if the model computes its transition matrices with its own formulas,
+     * rather than from the generic ones of this class. In that case, the eigen decomposition
+     * is not used to compute matrices for several branch lengths at once.
+     */
+    virtual bool hasOwnTransitionMatrices_() const { return false; }
+
     /**
      * @brief Diagonalize the \f$Q\f$ matrix, and fill the eigenValues_, iEigenValues_, 
      * leftEigenVectors_ and rightEigenVectors_ matrices.
@@ -432,6 +525,33 @@ namespace bpp
      */
     virtual void updateMatrices();
 
+  private:
+    void computeMatrices_(const std::vector<double>& times, TransitionMatrixCache::MatrixType type, std::vector< RowMatrix<double> >& matrices) const;
+
+    void fillMatrices_(const std::vector<double>& times, TransitionMatrixCache::MatrixType type, double* matrices, size_t stride) const;
+
+    /**
+     * @brief Diagonalize a generator which is reversible with respect to the given frequencies.
+     *
+     * The generator is symmetrized with the square roots of the frequencies, so that its
+     * eigen vectors are computed with a symmetric solver, and the left ones are obtained by
+     * transposition instead of inversion.
+     *
+     * @param generator The generator.
+     * @param freq The equilibrium frequencies.
+     * @param eigenValues [out] The eigen values.
+     * @param rightEigenVectors [out] The right eigen vectors, in columns.
+     * @param leftEigenVectors [out] The left eigen vectors, in rows.
+     * @return False, with no output computed, if a frequency is not positive or if the generator
+     * is not reversible with respect to the frequencies.
+     */
+    static bool symmetricEigenDecomposition_(
+      const Matrix<double>& generator,
+      const Vdouble& freq,
+      Vdouble& eigenValues,
+      RowMatrix<double>& rightEigenVectors,
+      RowMatrix<double>& leftEigenVectors);
+
   public:
 
     /**
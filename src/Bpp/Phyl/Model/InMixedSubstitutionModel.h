@@ -172,6 +172,18 @@ namespace bpp
 
     const Matrix<double>& getd2Pij_dt2(double t) const { return getModel().getd2Pij_dt2(t); }
 
+    void computePij_t(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const { getModel().computePij_t(times, matrices); }
+
+    void computedPij_dt(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const { getModel().computedPij_dt(times, matrices); }
+
+    void computed2Pij_dt2(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const { getModel().computed2Pij_dt2(times, matrices); }
+
+    void fillPij_t(const std::vector<double>& times, double* matrices, size_t stride) const { getModel().fillPij_t(times, matrices, stride); }
+
+    void filldPij_dt(const std::vector<double>& times, double* matrices, size_t stride) const { getModel().filldPij_dt(times, matrices, stride); }
+
+    void filld2Pij_dt2(const std::vector<double>& times, double* matrices, size_t stride) const { getModel().filld2Pij_dt2(times, matrices, stride); }
+
     double getInitValue(size_t i, int state) const
     {
       return getModel().getInitValue(i,state);
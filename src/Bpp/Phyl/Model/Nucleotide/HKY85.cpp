@@ -334,7 +334,8 @@ double HKY85::d2Pij_dt2(size_t i, size_t j, double d) const
 
 /******************************************************************************/
 
-const Matrix<double> & HKY85::getPij_t(double d) const
+template<class M>
+void HKY85::writePij_t_(double d, M& p) const
 {
   l_ = rate_ * r_ * d;
   exp1_ = exp(-l_);
@@ -342,33 +343,47 @@ const Matrix<double> & HKY85::getPij_t(double d) const
   exp21_ = exp(-k1_ * l_);
 
   //A
-  p_(0, 0) = piA_ * (1. + (piY_/piR_) * exp1_) + (piG_/piR_) * exp22_; //A
-  p_(0, 1) = piC_ * (1. -               exp1_);                        //C
-  p_(0, 2) = piG_ * (1. + (piY_/piR_) * exp1_) - (piG_/piR_) * exp22_; //G
-  p_(0, 3) = piT_ * (1. -               exp1_);                        //T, U
+  p(0, 0) = piA_ * (1. + (piY_/piR_) * exp1_) + (piG_/piR_) * exp22_; //A
+  p(0, 1) = piC_ * (1. -               exp1_);                        //C
+  p(0, 2) = piG_ * (1. + (piY_/piR_) * exp1_) - (piG_/piR_) * exp22_; //G
+  p(0, 3) = piT_ * (1. -               exp1_);                        //T, U
 
   //C
-  p_(1, 0) = piA_ * (1. -               exp1_);                        //A
-  p_(1, 1) = piC_ * (1. + (piR_/piY_) * exp1_) + (piT_/piY_) * exp21_; //C
-  p_(1, 2) = piG_ * (1. -               exp1_);                        //G
-  p_(1, 3) = piT_ * (1. + (piR_/piY_) * exp1_) - (piT_/piY_) * exp21_; //T, U
+  p(1, 0) = piA_ * (1. -               exp1_);                        //A
+  p(1, 1) = piC_ * (1. + (piR_/piY_) * exp1_) + (piT_/piY_) * exp21_; //C
+  p(1, 2) = piG_ * (1. -               exp1_);                        //G
+  p(1, 3) = piT_ * (1. + (piR_/piY_) * exp1_) - (piT_/piY_) * exp21_; //T, U
 
   //G
-  p_(2, 0) = piA_ * (1. + (piY_/piR_) * exp1_) - (piA_/piR_) * exp22_; //A
-  p_(2, 1) = piC_ * (1. -               exp1_);                        //C
-  p_(2, 2) = piG_ * (1. + (piY_/piR_) * exp1_) + (piA_/piR_) * exp22_; //G
-  p_(2, 3) = piT_ * (1. -               exp1_);                        //T, U
+  p(2, 0) = piA_ * (1. + (piY_/piR_) * exp1_) - (piA_/piR_) * exp22_; //A
+  p(2, 1) = piC_ * (1. -               exp1_);                        //C
+  p(2, 2) = piG_ * (1. + (piY_/piR_) * exp1_) + (piA_/piR_) * exp22_; //G
+  p(2, 3) = piT_ * (1. -               exp1_);                        //T, U
 
   //T, U
-  p_(3, 0) = piA_ * (1. -               exp1_);                        //A
-  p_(3, 1) = piC_ * (1. + (piR_/piY_) * exp1_) - (piC_/piY_) * exp21_; //C
-  p_(3, 2) = piG_ * (1. -               exp1_);                        //G
-  p_(3, 3) = piT_ * (1. + (piR_/piY_) * exp1_) + (piC_/piY_) * exp21_; //T, U
+  p(3, 0) = piA_ * (1. -               exp1_);                        //A
+  p(3, 1) = piC_ * (1. + (piR_/piY_) * exp1_) - (piC_/piY_) * exp21_; //C
+  p(3, 2) = piG_ * (1. -               exp1_);                        //G
+  p(3, 3) = piT_ * (1. + (piR_/piY_) * exp1_) + (piC_/piY_) * exp21_; //T, U
+}
 
+const Matrix<double> & HKY85::getPij_t(double d) const
+{
+  writePij_t_(d, p_);
   return p_;
 }
 
-const Matrix<double> & HKY85::getdPij_dt(double d) const
+void HKY85::fillPij_t(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writePij_t_(times[k], p);
+  }
+}
+
+template<class M>
+void HKY85::writedPij_dt_(double d, M& p) const
 {
   l_ = rate_ * r_ * d;
   exp1_ = exp(-l_);
@@ -376,33 +391,47 @@ const Matrix<double> & HKY85::getdPij_dt(double d) const
   exp21_ = exp(-k1_ * l_);
 
   //A
-  p_(0, 0) = rate_ * r_ * (piA_ * -(piY_/piR_) * exp1_ - (piG_/piR_) * k2_ * exp22_); //A
-  p_(0, 1) = rate_ * r_ * (piC_ *                exp1_);                              //C
-  p_(0, 2) = rate_ * r_ * (piG_ * -(piY_/piR_) * exp1_ + (piG_/piR_) * k2_ * exp22_); //G
-  p_(0, 3) = rate_ * r_ * (piT_ *                exp1_);                              //T, U
+  p(0, 0) = rate_ * r_ * (piA_ * -(piY_/piR_) * exp1_ - (piG_/piR_) * k2_ * exp22_); //A
+  p(0, 1) = rate_ * r_ * (piC_ *                exp1_);                              //C
+  p(0, 2) = rate_ * r_ * (piG_ * -(piY_/piR_) * exp1_ + (piG_/piR_) * k2_ * exp22_); //G
+  p(0, 3) = rate_ * r_ * (piT_ *                exp1_);                              //T, U
 
   //C
-  p_(1, 0) = rate_ * r_ * (piA_ *                exp1_);                              //A
-  p_(1, 1) = rate_ * r_ * (piC_ * -(piR_/piY_) * exp1_ - (piT_/piY_) * k1_ * exp21_); //C
-  p_(1, 2) = rate_ * r_ * (piG_ *                exp1_);                              //G
-  p_(1, 3) = rate_ * r_ * (piT_ * -(piR_/piY_) * exp1_ + (piT_/piY_) * k1_ * exp21_); //T, U
+  p(1, 0) = rate_ * r_ * (piA_ *                exp1_);                              //A
+  p(1, 1) = rate_ * r_ * (piC_ * -(piR_/piY_) * exp1_ - (piT_/piY_) * k1_ * exp21_); //C
+  p(1, 2) = rate_ * r_ * (piG_ *                exp1_);                              //G
+  p(1, 3) = rate_ * r_ * (piT_ * -(piR_/piY_) * exp1_ + (piT_/piY_) * k1_ * exp21_); //T, U
 
   //G
-  p_(2, 0) = rate_ * r_ * (piA_ * -(piY_/piR_) * exp1_ + (piA_/piR_) * k2_ * exp22_); //A
-  p_(2, 1) = rate_ * r_ * (piC_ *                exp1_);                              //C
-  p_(2, 2) = rate_ * r_ * (piG_ * -(piY_/piR_) * exp1_ - (piA_/piR_) * k2_ * exp22_); //G
-  p_(2, 3) = rate_ * r_ * (piT_ *                exp1_);                              //T, U
+  p(2, 0) = rate_ * r_ * (piA_ * -(piY_/piR_) * exp1_ + (piA_/piR_) * k2_ * exp22_); //A
+  p(2, 1) = rate_ * r_ * (piC_ *                exp1_);                              //C
+  p(2, 2) = rate_ * r_ * (piG_ * -(piY_/piR_) * exp1_ - (piA_/piR_) * k2_ * exp22_); //G
+  p(2, 3) = rate_ * r_ * (piT_ *                exp1_);                              //T, U
 
   //T, U
-  p_(3, 0) = rate_ * r_ * (piA_ *                exp1_);                              //A
-  p_(3, 1) = rate_ * r_ * (piC_ * -(piR_/piY_) * exp1_ + (piC_/piY_) * k1_ * exp21_); //C
-  p_(3, 2) = rate_ * r_ * (piG_ *                exp1_);                              //G
-  p_(3, 3) = rate_ * r_ * (piT_ * -(piR_/piY_) * exp1_ - (piC_/piY_) * k1_ * exp21_); //T, U
+  p(3, 0) = rate_ * r_ * (piA_ *                exp1_);                              //A
+  p(3, 1) = rate_ * r_ * (piC_ * -(piR_/piY_) * exp1_ + (piC_/piY_) * k1_ * exp21_); //C
+  p(3, 2) = rate_ * r_ * (piG_ *                exp1_);                              //G
+  p(3, 3) = rate_ * r_ * (piT_ * -(piR_/piY_) * exp1_ - (piC_/piY_) * k1_ * exp21_); //T, U
+}
 
+const Matrix<double> & HKY85::getdPij_dt(double d) const
+{
+  writedPij_dt_(d, p_);
   return p_;
 }
 
-const Matrix<double> & HKY85::getd2Pij_dt2(double d) const
+void HKY85::filldPij_dt(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writedPij_dt_(times[k], p);
+  }
+}
+
+template<class M>
+void HKY85::writed2Pij_dt2_(double d, M& p) const
 {
   double r_2 = rate_ * rate_ * r_ * r_;
   l_ = rate_ * r_ * d;
@@ -413,32 +442,45 @@ const Matrix<double> & HKY85::getd2Pij_dt2(double d) const
   exp21_ = exp(-k1_ * l_);
 
   //A
-  p_(0, 0) = r_2 * (piA_ * (piY_/piR_) * exp1_ + (piG_/piR_) * k2_2 * exp22_); //A
-  p_(0, 1) = r_2 * (piC_ *             - exp1_);                               //C
-  p_(0, 2) = r_2 * (piG_ * (piY_/piR_) * exp1_ - (piG_/piR_) * k2_2 * exp22_); //G
-  p_(0, 3) = r_2 * (piT_ *             - exp1_);                               //T, U
+  p(0, 0) = r_2 * (piA_ * (piY_/piR_) * exp1_ + (piG_/piR_) * k2_2 * exp22_); //A
+  p(0, 1) = r_2 * (piC_ *             - exp1_);                               //C
+  p(0, 2) = r_2 * (piG_ * (piY_/piR_) * exp1_ - (piG_/piR_) * k2_2 * exp22_); //G
+  p(0, 3) = r_2 * (piT_ *             - exp1_);                               //T, U
 
   //C
-  p_(1, 0) = r_2 * (piA_ *             - exp1_);                               //A
-  p_(1, 1) = r_2 * (piC_ * (piR_/piY_) * exp1_ + (piT_/piY_) * k1_2 * exp21_); //C
-  p_(1, 2) = r_2 * (piG_ *             - exp1_);                               //G
-  p_(1, 3) = r_2 * (piT_ * (piR_/piY_) * exp1_ - (piT_/piY_) * k1_2 * exp21_); //T, U
+  p(1, 0) = r_2 * (piA_ *             - exp1_);                               //A
+  p(1, 1) = r_2 * (piC_ * (piR_/piY_) * exp1_ + (piT_/piY_) * k1_2 * exp21_); //C
+  p(1, 2) = r_2 * (piG_ *             - exp1_);                               //G
+  p(1, 3) = r_2 * (piT_ * (piR_/piY_) * exp1_ - (piT_/piY_) * k1_2 * exp21_); //T, U
 
   //G
-  p_(2, 0) = r_2 * (piA_ * (piY_/piR_) * exp1_ - (piA_/piR_) * k2_2 * exp22_); //A
-  p_(2, 1) = r_2 * (piC_ *             - exp1_);                               //C
-  p_(2, 2) = r_2 * (piG_ * (piY_/piR_) * exp1_ + (piA_/piR_) * k2_2 * exp22_); //G
-  p_(2, 3) = r_2 * (piT_ *             - exp1_);                               //T, U
+  p(2, 0) = r_2 * (piA_ * (piY_/piR_) * exp1_ - (piA_/piR_) * k2_2 * exp22_); //A
+  p(2, 1) = r_2 * (piC_ *             - exp1_);                               //C
+  p(2, 2) = r_2 * (piG_ * (piY_/piR_) * exp1_ + (piA_/piR_) * k2_2 * exp22_); //G
+  p(2, 3) = r_2 * (piT_ *             - exp1_);                               //T, U
 
   //T, U
-  p_(3, 0) = r_2 * (piA_ *             - exp1_);                               //A
-  p_(3, 1) = r_2 * (piC_ * (piR_/piY_) * exp1_ - (piC_/piY_) * k1_2 * exp21_); //C
-  p_(3, 2) = r_2 * (piG_ *             - exp1_);                               //G
-  p_(3, 3) = r_2 * (piT_ * (piR_/piY_) * exp1_ + (piC_/piY_) * k1_2 * exp21_); //T, U
+  p(3, 0) = r_2 * (piA_ *             - exp1_);                               //A
+  p(3, 1) = r_2 * (piC_ * (piR_/piY_) * exp1_ - (piC_/piY_) * k1_2 * exp21_); //C
+  p(3, 2) = r_2 * (piG_ *             - exp1_);                               //G
+  p(3, 3) = r_2 * (piT_ * (piR_/piY_) * exp1_ + (piC_/piY_) * k1_2 * exp21_); //T, U
+}
 
+const Matrix<double> & HKY85::getd2Pij_dt2(double d) const
+{
+  writed2Pij_dt2_(d, p_);
   return p_;
 }
 
+void HKY85::filld2Pij_dt2(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writed2Pij_dt2_(times[k], p);
+  }
+}
+
 /******************************************************************************/
 
 void HKY85::setFreq(std::map<int, double>& freqs)
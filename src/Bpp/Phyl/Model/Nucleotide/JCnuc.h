@@ -148,6 +148,10 @@ public:
   const Matrix<double>& getdPij_dt  (double d) const;
   const Matrix<double>& getd2Pij_dt2(double d) const;
 
+protected:
+  bool hasOwnTransitionMatrices_() const { return true; }
+
+public:
   std::string getName() const { return "JC69"; }
 
   /**
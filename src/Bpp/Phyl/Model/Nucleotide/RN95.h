@@ -163,6 +163,11 @@ public:
   const Matrix<double>& getPij_t    (double d) const;
   const Matrix<double>& getdPij_dt  (double d) const;
   const Matrix<double>& getd2Pij_dt2(double d) const;
+
+protected:
+  bool hasOwnTransitionMatrices_() const { return true; }
+
+public:
   std::string getName() const { return "RN95"; }
 
   void updateMatrices();
@@ -325,73 +325,102 @@ double T92::d2Pij_dt2(size_t i, size_t j, double d) const
 
 /******************************************************************************/
 
-const Matrix<double>& T92::getPij_t(double d) const
+template<class M>
+void T92::writePij_t_(double d, M& p) const
 {
   l_ = rate_ * r_ * d;
   exp1_ = exp(-l_);
   exp2_ = exp(-k_ * l_);
 
   // A
-  p_(0, 0) = piA_ * (1. + exp1_) + theta_ * exp2_; // A
-  p_(0, 1) = piC_ * (1. - exp1_);                  // C
-  p_(0, 2) = piG_ * (1. + exp1_) - theta_ * exp2_; // G
-  p_(0, 3) = piT_ * (1. - exp1_);                  // T, U
+  p(0, 0) = piA_ * (1. + exp1_) + theta_ * exp2_; // A
+  p(0, 1) = piC_ * (1. - exp1_);                  // C
+  p(0, 2) = piG_ * (1. + exp1_) - theta_ * exp2_; // G
+  p(0, 3) = piT_ * (1. - exp1_);                  // T, U
 
   // C
-  p_(1, 0) = piA_ * (1. - exp1_);                         // A
-  p_(1, 1) = piC_ * (1. + exp1_) + (1. - theta_) * exp2_; // C
-  p_(1, 2) = piG_ * (1. - exp1_);                         // G
-  p_(1, 3) = piT_ * (1. + exp1_) - (1. - theta_) * exp2_; // T, U
+  p(1, 0) = piA_ * (1. - exp1_);                         // A
+  p(1, 1) = piC_ * (1. + exp1_) + (1. - theta_) * exp2_; // C
+  p(1, 2) = piG_ * (1. - exp1_);                         // G
+  p(1, 3) = piT_ * (1. + exp1_) - (1. - theta_) * exp2_; // T, U
 
   // G
-  p_(2, 0) = piA_ * (1. + exp1_) - (1. - theta_) * exp2_; // A
-  p_(2, 1) = piC_ * (1. - exp1_);                         // C
-  p_(2, 2) = piG_ * (1. + exp1_) + (1. - theta_) * exp2_; // G
-  p_(2, 3) = piT_ * (1. - exp1_);                         // T, U
+  p(2, 0) = piA_ * (1. + exp1_) - (1. - theta_) * exp2_; // A
+  p(2, 1) = piC_ * (1. - exp1_);                         // C
+  p(2, 2) = piG_ * (1. + exp1_) + (1. - theta_) * exp2_; // G
+  p(2, 3) = piT_ * (1. - exp1_);                         // T, U
 
   // T, U
-  p_(3, 0) = piA_ * (1. - exp1_);                  // A
-  p_(3, 1) = piC_ * (1. + exp1_) - theta_ * exp2_; // C
-  p_(3, 2) = piG_ * (1. - exp1_);                  // G
-  p_(3, 3) = piT_ * (1. + exp1_) + theta_ * exp2_; // T, U
+  p(3, 0) = piA_ * (1. - exp1_);                  // A
+  p(3, 1) = piC_ * (1. + exp1_) - theta_ * exp2_; // C
+  p(3, 2) = piG_ * (1. - exp1_);                  // G
+  p(3, 3) = piT_ * (1. + exp1_) + theta_ * exp2_; // T, U
+}
 
+const Matrix<double>& T92::getPij_t(double d) const
+{
+  writePij_t_(d, p_);
   return p_;
 }
 
-const Matrix<double>& T92::getdPij_dt(double d) const
+void T92::fillPij_t(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writePij_t_(times[k], p);
+  }
+}
+
+template<class M>
+void T92::writedPij_dt_(double d, M& p) const
 {
   l_ = rate_ * r_ * d;
   exp1_ = exp(-l_);
   exp2_ = exp(-k_ * l_);
 
   // A
-  p_(0, 0) = rate_ * r_ * (piA_ * -exp1_ + theta_ * -k_ * exp2_); // A
-  p_(0, 1) = rate_ * r_ * (piC_ *   exp1_);                        // C
-  p_(0, 2) = rate_ * r_ * (piG_ * -exp1_ - theta_ * -k_ * exp2_); // G
-  p_(0, 3) = rate_ * r_ * (piT_ *   exp1_);                        // T, U
+  p(0, 0) = rate_ * r_ * (piA_ * -exp1_ + theta_ * -k_ * exp2_); // A
+  p(0, 1) = rate_ * r_ * (piC_ *   exp1_);                        // C
+  p(0, 2) = rate_ * r_ * (piG_ * -exp1_ - theta_ * -k_ * exp2_); // G
+  p(0, 3) = rate_ * r_ * (piT_ *   exp1_);                        // T, U
 
   // C
-  p_(1, 0) = rate_ * r_ * (piA_ *   exp1_);                               // A
-  p_(1, 1) = rate_ * r_ * (piC_ * -exp1_ + (1. - theta_) * -k_ * exp2_); // C
-  p_(1, 2) = rate_ * r_ * (piG_ *   exp1_);                               // G
-  p_(1, 3) = rate_ * r_ * (piT_ * -exp1_ - (1. - theta_) * -k_ * exp2_); // T, U
+  p(1, 0) = rate_ * r_ * (piA_ *   exp1_);                               // A
+  p(1, 1) = rate_ * r_ * (piC_ * -exp1_ + (1. - theta_) * -k_ * exp2_); // C
+  p(1, 2) = rate_ * r_ * (piG_ *   exp1_);                               // G
+  p(1, 3) = rate_ * r_ * (piT_ * -exp1_ - (1. - theta_) * -k_ * exp2_); // T, U
 
   // G
-  p_(2, 0) = rate_ * r_ * (piA_ * -exp1_ - (1. - theta_) * -k_ * exp2_); // A
-  p_(2, 1) = rate_ * r_ * (piC_ *   exp1_);                               // C
-  p_(2, 2) = rate_ * r_ * (piG_ * -exp1_ + (1. - theta_) * -k_ * exp2_); // G
-  p_(2, 3) = rate_ * r_ * (piT_ *   exp1_);                               // T, U
+  p(2, 0) = rate_ * r_ * (piA_ * -exp1_ - (1. - theta_) * -k_ * exp2_); // A
+  p(2, 1) = rate_ * r_ * (piC_ *   exp1_);                               // C
+  p(2, 2) = rate_ * r_ * (piG_ * -exp1_ + (1. - theta_) * -k_ * exp2_); // G
+  p(2, 3) = rate_ * r_ * (piT_ *   exp1_);                               // T, U
 
   // T, U
-  p_(3, 0) = rate_ * r_ * (piA_ *   exp1_);                        // A
-  p_(3, 1) = rate_ * r_ * (piC_ * -exp1_ - theta_ * -k_ * exp2_); // C
-  p_(3, 2) = rate_ * r_ * (piG_ *   exp1_);                        // G
-  p_(3, 3) = rate_ * r_ * (piT_ * -exp1_ + theta_ * -k_ * exp2_); // T, U
+  p(3, 0) = rate_ * r_ * (piA_ *   exp1_);                        // A
+  p(3, 1) = rate_ * r_ * (piC_ * -exp1_ - theta_ * -k_ * exp2_); // C
+  p(3, 2) = rate_ * r_ * (piG_ *   exp1_);                        // G
+  p(3, 3) = rate_ * r_ * (piT_ * -exp1_ + theta_ * -k_ * exp2_); // T, U
+}
 
+const Matrix<double>& T92::getdPij_dt(double d) const
+{
+  writedPij_dt_(d, p_);
   return p_;
 }
 
-const Matrix<double>& T92::getd2Pij_dt2(double d) const
+void T92::filldPij_dt(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writedPij_dt_(times[k], p);
+  }
+}
+
+template<class M>
+void T92::writed2Pij_dt2_(double d, M& p) const
 {
   double k2 = k_ * k_;
   l_ = rate_ * r_ * d;
@@ -400,32 +429,45 @@ const Matrix<double>& T92::getd2Pij_dt2(double d) const
   exp2_ = exp(-k_ * l_);
 
   // A
-  p_(0, 0) = r2 * (piA_ *   exp1_ + theta_ * k2 * exp2_); // A
-  p_(0, 1) = r2 * (piC_ * -exp1_);                      // C
-  p_(0, 2) = r2 * (piG_ *   exp1_ - theta_ * k2 * exp2_); // G
-  p_(0, 3) = r2 * (piT_ * -exp1_);                      // T, U
+  p(0, 0) = r2 * (piA_ *   exp1_ + theta_ * k2 * exp2_); // A
+  p(0, 1) = r2 * (piC_ * -exp1_);                      // C
+  p(0, 2) = r2 * (piG_ *   exp1_ - theta_ * k2 * exp2_); // G
+  p(0, 3) = r2 * (piT_ * -exp1_);                      // T, U
 
   // C
-  p_(1, 0) = r2 * (piA_ * -exp1_);                             // A
-  p_(1, 1) = r2 * (piC_ *   exp1_ + (1. - theta_) * k2 * exp2_); // C
-  p_(1, 2) = r2 * (piG_ * -exp1_);                             // G
-  p_(1, 3) = r2 * (piT_ *   exp1_ - (1. - theta_) * k2 * exp2_); // T, U
+  p(1, 0) = r2 * (piA_ * -exp1_);                             // A
+  p(1, 1) = r2 * (piC_ *   exp1_ + (1. - theta_) * k2 * exp2_); // C
+  p(1, 2) = r2 * (piG_ * -exp1_);                             // G
+  p(1, 3) = r2 * (piT_ *   exp1_ - (1. - theta_) * k2 * exp2_); // T, U
 
   // G
-  p_(2, 0) = r2 * (piA_ *   exp1_ - (1. - theta_) * k2 * exp2_); // A
-  p_(2, 1) = r2 * (piC_ * -exp1_);                             // C
-  p_(2, 2) = r2 * (piG_ *   exp1_ + (1. - theta_) * k2 * exp2_); // G
-  p_(2, 3) = r2 * (piT_ * -exp1_);                             // T, U
+  p(2, 0) = r2 * (piA_ *   exp1_ - (1. - theta_) * k2 * exp2_); // A
+  p(2, 1) = r2 * (piC_ * -exp1_);                             // C
+  p(2, 2) = r2 * (piG_ *   exp1_ + (1. - theta_) * k2 * exp2_); // G
+  p(2, 3) = r2 * (piT_ * -exp1_);                             // T, U
 
   // T, U
-  p_(3, 0) = r2 * (piA_ * -exp1_);                      // A
-  p_(3, 1) = r2 * (piC_ *   exp1_ - theta_ * k2 * exp2_); // C
-  p_(3, 2) = r2 * (piG_ * -exp1_);                      // G
-  p_(3, 3) = r2 * (piT_ *   exp1_ + theta_ * k2 * exp2_); // T, U
+  p(3, 0) = r2 * (piA_ * -exp1_);                      // A
+  p(3, 1) = r2 * (piC_ *   exp1_ - theta_ * k2 * exp2_); // C
+  p(3, 2) = r2 * (piG_ * -exp1_);                      // G
+  p(3, 3) = r2 * (piT_ *   exp1_ + theta_ * k2 * exp2_); // T, U
+}
 
+const Matrix<double>& T92::getd2Pij_dt2(double d) const
+{
+  writed2Pij_dt2_(d, p_);
   return p_;
 }
 
+void T92::filld2Pij_dt2(const vector<double>& times, double* matrices, size_t stride) const
+{
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    FlatMatrixView p(matrices + k * 4 * stride, stride);
+    writed2Pij_dt2_(times[k], p);
+  }
+}
+
 /******************************************************************************/
 
 void T92::setFreq(std::map<int, double>& freqs)
@@ -158,6 +158,22 @@ class TN93 :
     const Matrix<double>& getdPij_dt  (double d) const;
     const Matrix<double>& getd2Pij_dt2(double d) const;
 
+    void fillPij_t(const std::vector<double>& times, double* matrices, size_t stride) const;
+    void filldPij_dt(const std::vector<double>& times, double* matrices, size_t stride) const;
+    void filld2Pij_dt2(const std::vector<double>& times, double* matrices, size_t stride) const;
+
+  private:
+    /**
+     * @brief Write the transition probabilities, or their derivatives, in p_ or in a FlatMatrixView.
+     */
+    template<class M> void writePij_t_(double d, M& p) const;
+    template<class M> void writedPij_dt_(double d, M& p) const;
+    template<class M> void writed2Pij_dt2_(double d, M& p) const;
+
+  protected:
+    bool hasOwnTransitionMatrices_() const { return true; }
+
+  public:
     std::string getName() const { return "TN93"; }
   
   /**
@@ -93,6 +93,7 @@ void YpR::updateMatrices(double CgT, double cGA,
                          double CaT, double cAG,
                          double TaC, double tAC)
 {
+  invalidateTransitionMatrices_();
   //  check_model(pmodel_);
 
   // Generator:
@@ -94,6 +94,7 @@ void gBGC::fireParameterChanged(const ParameterList& parameters)
 
 void gBGC::updateMatrices()
 {
+  invalidateTransitionMatrices_();
   B_ = getParameterValue("B");
   unsigned int i, j;
   // Generator:
@@ -191,6 +191,10 @@ namespace bpp
     const Matrix<double>& getdPij_dt  (double d) const;
     const Matrix<double>& getd2Pij_dt2(double d) const;
 
+  protected:
+    bool hasOwnTransitionMatrices_() const { return true; }
+
+  public:
     std::string getName() const 
     { 
       return (withFreq_?"JC69+F":"JC69");
@@ -42,6 +42,7 @@
 
 #include "FrequencySet/FrequencySet.h"
 #include "StateMap.h"
+#include "TransitionKernels.h"
 
 // From bpp-core:
 #include <Bpp/Exceptions.h>
@@ -50,6 +51,7 @@
 #include <Bpp/Numeric/ParameterAliasable.h>
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
 
 // From bpp-seq:
 #include <Bpp/Seq/Alphabet/Alphabet.h>
@@ -246,6 +248,76 @@ namespace bpp
      */
     virtual const Matrix<double>& getd2Pij_dt2(double t) const = 0;
 
+    /**
+     * @name Transition matrices for several branch lengths.
+     *
+     * These methods are equivalent to calling getPij_t(), getdPij_dt() or getd2Pij_dt2()
+     * for each branch length, but implementations may share computations between lengths,
+     * which is what the default implementations do not.
+     *
+     * @param times    The branch lengths.
+     * @param matrices [out] The matrices, one for each branch length. The vector is resized if needed.
+     * @{
+     */
+    virtual void computePij_t(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      matrices.resize(times.size());
+      for (size_t k = 0; k < times.size(); k++)
+        MatrixTools::copy(getPij_t(times[k]), matrices[k]);
+    }
+
+    virtual void computedPij_dt(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      matrices.resize(times.size());
+      for (size_t k = 0; k < times.size(); k++)
+        MatrixTools::copy(getdPij_dt(times[k]), matrices[k]);
+    }
+
+    virtual void computed2Pij_dt2(const std::vector<double>& times, std::vector< RowMatrix<double> >& matrices) const
+    {
+      matrices.resize(times.size());
+      for (size_t k = 0; k < times.size(); k++)
+        MatrixTools::copy(getd2Pij_dt2(times[k]), matrices[k]);
+    }
+    /** @} */
+
+    /**
+     * @name Transition matrices for several branch lengths, in a flat buffer.
+     *
+     * Same as computePij_t(), computedPij_dt() and computed2Pij_dt2(), but the matrices
+     * are written in a buffer provided by the caller, so that no matrix is allocated:
+     * matrix k starts at matrices + k * n * stride, where n is the number of states,
+     * and its element (x, y) is at x * stride + y. The values of the rows beyond n are
+     * left unchanged, so that stride can be the padded size of aligned arrays.
+     *
+     * @param times    The branch lengths.
+     * @param matrices [out] The buffer, of size at least times.size() * n * stride.
+     * @param stride   The size of the rows in the buffer, at least n.
+     * @see TransitionKernels
+     * @{
+     */
+    virtual void fillPij_t(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      size_t n = getNumberOfStates();
+      for (size_t k = 0; k < times.size(); k++)
+        TransitionKernels::copy(getPij_t(times[k]), matrices + k * n * stride, stride, n);
+    }
+
+    virtual void filldPij_dt(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      size_t n = getNumberOfStates();
+      for (size_t k = 0; k < times.size(); k++)
+        TransitionKernels::copy(getdPij_dt(times[k]), matrices + k * n * stride, stride, n);
+    }
+
+    virtual void filld2Pij_dt2(const std::vector<double>& times, double* matrices, size_t stride) const
+    {
+      size_t n = getNumberOfStates();
+      for (size_t k = 0; k < times.size(); k++)
+        TransitionKernels::copy(getd2Pij_dt2(times[k]), matrices + k * n * stride, stride, n);
+    }
+    /** @} */
+
     /**
      * @return Get the alphabet associated to this model.
      */
@@ -0,0 +1,188 @@
+//
+// File: TransitionKernels.h
+// Created by: agent
+// Created on: Fri Oct 16 22:48 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _TRANSITIONKERNELS_H_
+#define _TRANSITIONKERNELS_H_
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+// From the STL:
+#include <cstddef>
+
+namespace bpp
+{
+
+/**
+ * @brief A square matrix stored in a flat buffer, with rows of a given size.
+ *
+ * Element (x, y) is found at data[x * stride + y]. This is the layout used by
+ * TransitionModel::fillPij_t() and its derivatives.
+ */
+class FlatMatrixView
+{
+  private:
+    double* data_;
+    size_t stride_;
+
+  public:
+    FlatMatrixView(double* data, size_t stride) : data_(data), stride_(stride) {}
+
+    double& operator()(size_t x, size_t y) { return data_[x * stride_ + y]; }
+    const double& operator()(size_t x, size_t y) const { return data_[x * stride_ + y]; }
+};
+
+/**
+ * @brief Routines writing transition matrices into flat buffers.
+ *
+ * The number of states is a template parameter, so that the loops are fully known at
+ * compile time for the usual alphabet sizes. A value of 0 means that the number of
+ * states is only known at run time. The dispatching functions of TransitionKernels
+ * choose the right version, with specialized kernels for 4 (nucleotides), 20 (proteins)
+ * and 61 (codons) states.
+ *
+ * Padding values of the rows are left unchanged.
+ */
+template<size_t N>
+struct TransitionKernel
+{
+  /**
+   * @brief Copy a matrix into a flat buffer.
+   *
+   * @param matrix   The matrix to copy.
+   * @param out      The first row of the output.
+   * @param stride   The size of the rows of the output.
+   * @param nbStates The number of states, only used if N is 0.
+   */
+  static void copy(const Matrix<double>& matrix, double* out, size_t stride, size_t nbStates)
+  {
+    const size_t n = (N == 0 ? nbStates : N);
+    for (size_t x = 0; x < n; x++)
+    {
+      double* out_x = out + x * stride;
+      for (size_t y = 0; y < n; y++)
+      {
+        out_x[y] = matrix(x, y);
+      }
+    }
+  }
+
+  /**
+   * @brief Compute U diag(d) V into a flat buffer.
+   *
+   * Row x of the result is the combination of the rows of V, weighted by the scaled row x of U,
+   * so that all accesses are contiguous.
+   *
+   * @param right    U, the right eigen vectors, as a flat n x n array.
+   * @param diag     d, the factors of the eigen values.
+   * @param left     V, the left eigen vectors, as a flat n x n array.
+   * @param out      The first row of the output.
+   * @param stride   The size of the rows of the output.
+   * @param nbStates The number of states, only used if N is 0.
+   */
+  static void exponential(const double* right, const double* diag, const double* left, double* out, size_t stride, size_t nbStates)
+  {
+    const size_t n = (N == 0 ? nbStates : N);
+    for (size_t x = 0; x < n; x++)
+    {
+      double* out_x = out + x * stride;
+      for (size_t y = 0; y < n; y++)
+      {
+        out_x[y] = 0.;
+      }
+      const double* right_x = right + x * n;
+      for (size_t j = 0; j < n; j++)
+      {
+        double a = right_x[j] * diag[j];
+        const double* left_j = left + j * n;
+        for (size_t y = 0; y < n; y++)
+        {
+          out_x[y] += a * left_j[y];
+        }
+      }
+    }
+  }
+};
+
+/**
+ * @brief Run time dispatch of the TransitionKernel routines on the number of states.
+ */
+class TransitionKernels
+{
+  public:
+    static void copy(const Matrix<double>& matrix, double* out, size_t stride, size_t nbStates)
+    {
+      switch (nbStates)
+      {
+      case 4:
+        TransitionKernel<4>::copy(matrix, out, stride, nbStates);
+        break;
+      case 20:
+        TransitionKernel<20>::copy(matrix, out, stride, nbStates);
+        break;
+      case 61:
+        TransitionKernel<61>::copy(matrix, out, stride, nbStates);
+        break;
+      default:
+        TransitionKernel<0>::copy(matrix, out, stride, nbStates);
+      }
+    }
+
+    static void exponential(const double* right, const double* diag, const double* left, double* out, size_t stride, size_t nbStates)
+    {
+      switch (nbStates)
+      {
+      case 4:
+        TransitionKernel<4>::exponential(right, diag, left, out, stride, nbStates);
+        break;
+      case 20:
+        TransitionKernel<20>::exponential(right, diag, left, out, stride, nbStates);
+        break;
+      case 61:
+        TransitionKernel<61>::exponential(right, diag, left, out, stride, nbStates);
+        break;
+      default:
+        TransitionKernel<0>::exponential(right, diag, left, out, stride, nbStates);
+      }
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_TRANSITIONKERNELS_H_
+
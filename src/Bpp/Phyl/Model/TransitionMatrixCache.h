@@ -0,0 +1,231 @@
+//
+// File: TransitionMatrixCache.h
+// Created by: agent
+// Created on: Fri Oct 16 20:29 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _TRANSITIONMATRIXCACHE_H_
+#define _TRANSITIONMATRIXCACHE_H_
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+
+// From the STL:
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <iterator>
+
+namespace bpp
+{
+
+/**
+ * @brief A least-recently-used cache of transition probability matrices.
+ *
+ * Matrices are stored together with the kind of matrix (probabilities, first or second
+ * order derivatives), the rate of the model, the branch length and a version number.
+ * The version number is incremented by invalidate(), which has to be called each time
+ * the generator or its decomposition change: matrices computed with a previous version
+ * are never returned, and are recycled when new matrices are added.
+ *
+ * The cache has a capacity of 0 by default, in which case nothing is stored.
+ * The number of hits and misses is recorded, in order to check whether caching is worth it.
+ *
+ * Cached matrices are not copied together with the cache, only its capacity is.
+ */
+class TransitionMatrixCache
+{
+  public:
+    enum MatrixType {
+      PIJ = 0,
+      DPIJ = 1,
+      D2PIJ = 2
+    };
+
+  private:
+    struct Key_
+    {
+      size_t version;
+      MatrixType type;
+      double rate;
+      double t;
+
+      bool operator==(const Key_& key) const
+      {
+        return version == key.version && type == key.type && rate == key.rate && t == key.t;
+      }
+    };
+
+    struct KeyHash_
+    {
+      size_t operator()(const Key_& key) const
+      {
+        size_t h = std::hash<double>()(key.t);
+        h ^= std::hash<double>()(key.rate) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= key.version * 3 + static_cast<size_t>(key.type) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+      }
+    };
+
+    typedef std::list< std::pair<Key_, RowMatrix<double> > > EntryList_;
+
+    size_t capacity_;
+    size_t version_;
+    EntryList_ entries_;
+    std::unordered_map<Key_, EntryList_::iterator, KeyHash_> index_;
+    size_t nbHits_;
+    size_t nbMisses_;
+
+  public:
+    TransitionMatrixCache(size_t capacity = 0) :
+      capacity_(capacity), version_(0), entries_(), index_(), nbHits_(0), nbMisses_(0) {}
+
+    TransitionMatrixCache(const TransitionMatrixCache& cache) :
+      capacity_(cache.capacity_), version_(0), entries_(), index_(), nbHits_(0), nbMisses_(0) {}
+
+    TransitionMatrixCache& operator=(const TransitionMatrixCache& cache)
+    {
+      capacity_ = cache.capacity_;
+      clear();
+      resetStatistics();
+      return *this;
+    }
+
+    virtual ~TransitionMatrixCache() {}
+
+  public:
+    /**
+     * @brief Look for a matrix in the cache.
+     *
+     * @param type   The kind of matrix.
+     * @param rate   The rate of the model.
+     * @param t      The branch length.
+     * @param matrix [out] The matrix to fill, if found.
+     * @return True if the matrix was found.
+     */
+    bool get(MatrixType type, double rate, double t, RowMatrix<double>& matrix)
+    {
+      if (capacity_ == 0)
+        return false;
+      Key_ key = { version_, type, rate, t };
+      auto it = index_.find(key);
+      if (it == index_.end())
+      {
+        nbMisses_++;
+        return false;
+      }
+      nbHits_++;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      MatrixTools::copy(it->second->second, matrix);
+      return true;
+    }
+
+    /**
+     * @brief Store a matrix in the cache.
+     *
+     * If the cache is full, the least recently used matrix is replaced.
+     *
+     * @param type   The kind of matrix.
+     * @param rate   The rate of the model.
+     * @param t      The branch length.
+     * @param matrix The matrix to store.
+     */
+    void put(MatrixType type, double rate, double t, const Matrix<double>& matrix)
+    {
+      if (capacity_ == 0)
+        return;
+      Key_ key = { version_, type, rate, t };
+      if (index_.find(key) != index_.end())
+        return;
+      if (entries_.size() < capacity_)
+      {
+        entries_.push_front(std::make_pair(key, RowMatrix<double>()));
+      }
+      else
+      {
+        // Recycle the least recently used entry:
+        entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+        index_.erase(entries_.front().first);
+        entries_.front().first = key;
+      }
+      MatrixTools::copy(matrix, entries_.front().second);
+      index_[key] = entries_.begin();
+    }
+
+    /**
+     * @brief Make all stored matrices obsolete.
+     */
+    void invalidate() { version_++; }
+
+    /**
+     * @brief Remove all stored matrices.
+     */
+    void clear()
+    {
+      entries_.clear();
+      index_.clear();
+    }
+
+    /**
+     * @param capacity The maximum number of matrices to store. 0 disables the cache.
+     */
+    void setCapacity(size_t capacity)
+    {
+      capacity_ = capacity;
+      while (entries_.size() > capacity_)
+      {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+      }
+    }
+
+    size_t getCapacity() const { return capacity_; }
+
+    size_t getNumberOfHits() const { return nbHits_; }
+
+    size_t getNumberOfMisses() const { return nbMisses_; }
+
+    void resetStatistics()
+    {
+      nbHits_ = 0;
+      nbMisses_ = 0;
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_TRANSITIONMATRIXCACHE_H_
+
@@ -124,6 +124,10 @@ public:
 
   virtual const RowMatrix<double>& getd2Pij_dt2(double d) const;
 
+protected:
+  bool hasOwnTransitionMatrices_() const { return true; }
+
+public:
   virtual std::string getName() const;
 };
 } // end of namespace bpp.
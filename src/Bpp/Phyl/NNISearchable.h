@@ -45,6 +45,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "TreeTemplate.h"
 #include "TopologySearch.h"
 
+// From the STL:
+#include <vector>
+
 namespace bpp
 {
 
@@ -119,6 +122,24 @@ class NNISearchable:
 		 */
 		virtual double testNNI(int nodeId) const = 0;
 
+		/**
+		 * @brief Send the scores of several NNI movements, without performing them.
+		 *
+		 * This is equivalent to calling testNNI() for each node, which is what the default
+		 * implementation does. Implementations may test the movements in parallel.
+		 *
+		 * @param nodeIds The ids of the nodes defining the NNI movements.
+		 * @param diffs   [out] The score variations of the NNIs, in the same order as nodeIds.
+		 * The vector is resized if needed.
+		 * @throw NodeException If a node does not define a valid NNI.
+		 */
+		virtual void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const
+		{
+			diffs.resize(nodeIds.size());
+			for (size_t i = 0; i < nodeIds.size(); i++)
+				diffs[i] = testNNI(nodeIds[i]);
+		}
+
 		/**
 		 * @brief Perform a NNI movement.
 		 *
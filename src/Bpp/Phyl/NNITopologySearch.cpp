@@ -82,6 +82,16 @@ void NNITopologySearch::notifyAllSuccessful(const TopologyChangeEvent& event)
   }
 }
 
+vector<int> NNITopologySearch::getNodesIds_(const vector<Node*>& nodes)
+{
+  vector<int> ids(nodes.size());
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    ids[i] = nodes[i]->getId();
+  }
+  return ids;
+}
+
 void NNITopologySearch::search()
 {
   if (algorithm_ == FAST)
@@ -171,10 +181,12 @@ void NNITopologySearch::searchBetter()
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    vector<double> diffs;
+    searchableTree_->testNNIs(getNodesIds_(nodesSub), diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -236,10 +248,12 @@ void NNITopologySearch::searchPhyML()
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    vector<double> diffs;
+    searchableTree_->testNNIs(getNodesIds_(nodesSub), diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
       Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
         ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
@@ -57,6 +57,9 @@ namespace bpp
  *   Then re-loop over all nodes.
  * - PhyML algorithm (not fully tested, use with care): as the previous one, but perform all NNI improving the score at the same time.
  *   Leads to faster convergence.
+ *
+ * With the Better and PhyML algorithms, all NNIs are tested in one call to NNISearchable::testNNIs(),
+ * so that they can be evaluated in parallel (see for instance NNIHomogeneousTreeLikelihood::setNumberOfThreads()).
  */
 class NNITopologySearch :
   public virtual TopologySearch
@@ -163,6 +166,9 @@ class NNITopologySearch :
      * @brief Process a TopologyChangeEvent to all listeners.
      */
     void notifyAllSuccessful(const TopologyChangeEvent& event);
+
+  private:
+    static std::vector<int> getNodesIds_(const std::vector<Node*>& nodes);
 		
 };
 
@@ -57,7 +57,7 @@ Node::Node(const Node& node):
   id_(node.id_), name_(0),
   sons_(), father_(0),
   //, sons_(node.sons_), father_(node.father_),
-  distanceToFather_(0), nodeProperties_(), branchProperties_()
+  distanceToFather_(0), nodeProperties_(), branchProperties_(), revision_()
 {
   name_             = node.hasName() ? new string(* node.name_) : 0;
   distanceToFather_ = node.hasDistanceToFather() ? new double(* node.distanceToFather_) : 0;
@@ -72,6 +72,7 @@ Node::Node(const Node& node):
 Node& Node::operator=(const Node & node)
 {
   id_               = node.id_;
+  incrementRevision_();
   if(name_) delete name_;
   name_             = node.hasName() ? new string(* node.name_) : 0;
   //father_           = node.father_;
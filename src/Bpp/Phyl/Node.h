@@ -54,9 +54,13 @@
 #include <iostream>
 #include <algorithm>
 #include <cstddef>
+#include <atomic>
+#include <memory>
 
 namespace bpp
 {
+template<class N> class TreeTemplate;
+
 /**
  * @brief The phylogenetic node class.
  *
@@ -85,6 +89,11 @@ namespace bpp
  * It is also possible to build a tree starting from the leaves using the setFather method.
  * Changing the parent node will automatically append the current node to the son nodes of the new father.
  *
+ * A node indexed by a TreeTemplate holds the modification counter of this tree, which is incremented
+ * each time the id, the father or the sons of the node are modified, or when the node is deleted.
+ * This allows the tree to know when its index has to be rebuilt, without being affected by
+ * modifications of the nodes of other trees (see TreeTemplate::getRevision()).
+ *
  * @see Tree, TreeTemplate
  */
 class Node
@@ -99,6 +108,20 @@ protected:
   mutable std::map<std::string, Clonable*> nodeProperties_;
   mutable std::map<std::string, Clonable*> branchProperties_;
 
+private:
+  /**
+   * @brief The modification counter of the tree which last indexed this node, if any.
+   */
+  mutable std::shared_ptr< std::atomic<unsigned long> > revision_;
+
+  template<class N> friend class TreeTemplate;
+
+protected:
+  /**
+   * @brief Signal that the id or the neighborhood of this node changed, to the tree indexing it.
+   */
+  void incrementRevision_() const { if (revision_) (*revision_)++; }
+
 public:
   /**
    * @brief Build a new void Node object.
@@ -110,7 +133,8 @@ public:
     father_(0),
     distanceToFather_(0),
     nodeProperties_(),
-    branchProperties_()
+    branchProperties_(),
+    revision_()
   {}
 
   /**
@@ -123,7 +147,8 @@ public:
     father_(0),
     distanceToFather_(0),
     nodeProperties_(),
-    branchProperties_()
+    branchProperties_(),
+    revision_()
   {}
 
   /**
@@ -136,7 +161,8 @@ public:
     father_(0),
     distanceToFather_(0),
     nodeProperties_(),
-    branchProperties_()
+    branchProperties_(),
+    revision_()
   {}
 
   /**
@@ -149,7 +175,8 @@ public:
     father_(0),
     distanceToFather_(0),
     nodeProperties_(),
-    branchProperties_()
+    branchProperties_(),
+    revision_()
   {}
 
   /**
@@ -176,6 +203,7 @@ public:
 public:
   virtual ~Node()
   {
+    incrementRevision_();
     if (name_) delete name_;
     if (distanceToFather_) delete distanceToFather_;
     for (std::map<std::string, Clonable*>::iterator i = nodeProperties_.begin(); i != nodeProperties_.end(); i++)
@@ -207,7 +235,7 @@ public:
    *
    * @param id The new identity tag.
    */
-  virtual void setId(int id) { id_ = id; }
+  virtual void setId(int id) { id_ = id; incrementRevision_(); }
 
   virtual std::vector<int> getSonsId() const
   {
@@ -357,6 +385,8 @@ public:
     if (!node)
       throw NullPointerException("Node::setFather(). Empty node given as input.");
     father_ = node;
+    incrementRevision_();
+    node->incrementRevision_();
     if (find(node->sons_.begin(), node->sons_.end(), this) == node->sons_.end())
       node->sons_.push_back(this);
     else // Otherwise node is already present.
@@ -370,6 +400,8 @@ public:
   {
     Node* f = father_;
     father_ = 0;
+    incrementRevision_();
+    if (f) f->incrementRevision_();
     return f;
   }
 
@@ -387,10 +419,13 @@ public:
    */
   virtual size_t getNumberOfSons() const { return sons_.size(); }
 
-  virtual std::vector<Node*>& getSons()
-  {
-    return sons_;
-  }
+  /**
+   * @return A reference toward the sons of this node.
+   *
+   * Modifications of the returned vector are not signaled to the tree indexing this node:
+   * use addSon(), setSon() or removeSon() to change the sons of a node.
+   */
+  virtual std::vector<Node*>& getSons() { return sons_; }
 
   virtual const Node* getSon(size_t pos) const
   {
@@ -414,6 +449,8 @@ public:
       std::cerr << "DEVEL warning: Node::addSon. Son node already registered! No pb here, but could be a bug in your implementation..." << std::endl;
 
     node->father_ = this;
+    incrementRevision_();
+    node->incrementRevision_();
   }
 
   virtual void addSon(Node* node)
@@ -425,6 +462,8 @@ public:
     else // Otherwise node is already present.
       throw NodePException("Node::addSon. Trying to add a node which is already present.");
     node->father_ = this;
+    incrementRevision_();
+    node->incrementRevision_();
   }
 
   virtual void setSon(size_t pos, Node* node)
@@ -439,6 +478,8 @@ public:
     else
       throw NodePException("Node::setSon. Trying to set a node which is already present.");
     node->father_ = this;
+    incrementRevision_();
+    node->incrementRevision_();
   }
 
   virtual Node* removeSon(size_t pos)
@@ -447,6 +488,7 @@ public:
       throw IndexOutOfBoundsException("Node::removeSon(). Invalid node position.", pos, 0, sons_.size() - 1);
     Node* node = sons_[pos];
     sons_.erase(sons_.begin() + static_cast<ptrdiff_t>(pos));
+    incrementRevision_();
     node->removeFather();
     return node;
   }
@@ -460,6 +502,7 @@ public:
       if (sons_[i] == node)
       {
         sons_.erase(sons_.begin() + static_cast<ptrdiff_t>(i));
+        incrementRevision_();
         node->removeFather();
         return;
       }
@@ -142,7 +142,7 @@ class NodeTemplate :
  
 		NodeTemplate<NodeInfos>* getFather() { return dynamic_cast<NodeTemplate<NodeInfos> *>(father_); }
 				
-		NodeTemplate<NodeInfos>* removeFather() { NodeTemplate<NodeInfos>* f = dynamic_cast<NodeTemplate<NodeInfos> *>(father_); father_ = 0; return f; }
+		NodeTemplate<NodeInfos>* removeFather() { return dynamic_cast<NodeTemplate<NodeInfos> *>(Node::removeFather()); }
 
 		const NodeTemplate<NodeInfos>* getSon(size_t i) const { return dynamic_cast<NodeTemplate<NodeInfos> *>(sons_[i]); }
 				
@@ -53,8 +53,10 @@ DRTreeParsimonyData::DRTreeParsimonyData(const DRTreeParsimonyData& data) :
   AbstractTreeParsimonyData(data),
   nodeData_(data.nodeData_),
   leafData_(data.leafData_),
-  rootBitsets_(data.rootBitsets_),
+  rootStateSets_(data.rootStateSets_),
   rootScores_(data.rootScores_),
+  rootScore_(data.rootScore_),
+  siteWeights_(data.siteWeights_),
   shrunkData_(0),
   nbSites_(data.nbSites_),
   nbStates_(data.nbStates_),
@@ -73,8 +75,10 @@ DRTreeParsimonyData& DRTreeParsimonyData::operator=(const DRTreeParsimonyData& d
   AbstractTreeParsimonyData::operator=(data);
   nodeData_        = data.nodeData_;
   leafData_        = data.leafData_;
-  rootBitsets_     = data.rootBitsets_;
+  rootStateSets_   = data.rootStateSets_;
   rootScores_      = data.rootScores_;
+  rootScore_       = data.rootScore_;
+  siteWeights_     = data.siteWeights_;
   if (shrunkData_) delete shrunkData_;
   if (data.shrunkData_)
     shrunkData_ = dynamic_cast<SiteContainer*>(data.shrunkData_->clone());
@@ -96,6 +100,7 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   rootWeights_      = pattern.getWeights();
   rootPatternLinks_ = pattern.getIndices();
   nbDistinctSites_  = shrunkData_->getNumberOfSites();
+  siteWeights_.setWeights(rootWeights_);
 
   // Init data:
   // Clone data for more efficiency on sequences access:
@@ -104,8 +109,9 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   delete sequences;
 
   // Now initialize root arrays:
-  rootBitsets_.resize(nbDistinctSites_);
+  rootStateSets_.resize(nbDistinctSites_, nbStates_);
   rootScores_.resize(nbDistinctSites_);
+  rootScore_ = 0;
 }
 
 /******************************************************************************/
@@ -124,24 +130,26 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
       throw SequenceNotFoundException("DRTreeParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
     }
     DRTreeParsimonyLeafData* leafData    = &leafData_[node->getId()];
-    vector<Bitset>* leafData_bitsets     = &leafData->getBitsetsArray();
+    PackedStateSets* leafData_stateSets  = &leafData->getStateSets();
     leafData->setNode(node);
 
-    leafData_bitsets->resize(nbDistinctSites_);
+    leafData_stateSets->resize(nbDistinctSites_, nbStates_);
 
-    for (unsigned int i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = 0; i < nbDistinctSites_; i++)
     {
-      Bitset* leafData_bitsets_i = &(*leafData_bitsets)[i];
-      for (unsigned int s = 0; s < nbStates_; s++)
+      // A state belongs to the set if it corresponds to the char in the sequence,
+      // or to one of its resolutions in case of a generic char:
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
+      for (size_t s = 0; s < nbStates_; s++)
       {
-        // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
-        // otherwise value set to 0:
-        int state = seq->getValue(i);
-        vector<int> states = alphabet->getAlias(state);
         for (size_t j = 0; j < states.size(); j++)
         {
           if (stateMap.getAlphabetStateAsInt(s) == states[j])
-            (*leafData_bitsets_i)[s].flip();
+          {
+            leafData_stateSets->addState(i, s);
+            break;
+          }
         }
       }
     }
@@ -157,11 +165,8 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
-
-      neighborData_bitsets->resize(nbDistinctSites_);
-      neighborData_scores->resize(nbDistinctSites_);
+      nodeData->getStateSetsForNeighbor(neighbor->getId()).resize(nbDistinctSites_, nbStates_);
+      nodeData->getScoreForNeighbor(neighbor->getId()) = 0;
     }
   }
 
@@ -174,6 +179,40 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
   }
 }
 
+/******************************************************************************/
+vector<unsigned int> DRTreeParsimonyData::getScoresArray(int nodeId, int neighborId) const
+{
+  vector<unsigned int> scores(nbDistinctSites_, 0);
+  addSiteScores_(getTreeP_()->getNode(nodeId), getTreeP_()->getNode(neighborId), scores);
+  return scores;
+}
+
+/******************************************************************************/
+void DRTreeParsimonyData::addSiteScores_(const Node* node, const Node* neighbor, vector<unsigned int>& scores) const
+{
+  if (neighbor->isLeaf() || scores.empty())
+    return;
+  // Combine the arrays of the neighbor in the same order as DRTreeParsimonyScore does:
+  const DRTreeParsimonyNodeData* neighborData = &nodeData_[neighbor->getId()];
+  vector<const Node*> neighbors = neighbor->getNeighbors();
+  const PackedStateSets* previous = 0;
+  PackedStateSets stateSets;
+  for (size_t k = 0; k < neighbors.size(); k++)
+  {
+    const Node* n = neighbors[k];
+    if (n == node) continue;
+    addSiteScores_(neighbor, n, scores);
+    const PackedStateSets* current = &neighborData->getStateSetsForNeighbor(n->getId());
+    if (previous)
+    {
+      ParsimonyKernels::fitch(*previous, *current, siteWeights_, stateSets, &scores[0]);
+      previous = &stateSets;
+    }
+    else
+      previous = current;
+  }
+}
+
 /******************************************************************************/
 void DRTreeParsimonyData::reInit()
 {
@@ -198,11 +237,8 @@ void DRTreeParsimonyData::reInit(const Node* node)
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
-      vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
-
-      neighborData_bitsets->resize(nbDistinctSites_);
-      neighborData_scores->resize(nbDistinctSites_);
+      nodeData->getStateSetsForNeighbor(neighbor->getId()).resize(nbDistinctSites_, nbStates_);
+      nodeData->getScoreForNeighbor(neighbor->getId()) = 0;
     }
   }
 
@@ -42,8 +42,11 @@
 #define _DRTREEPARSIMONYDATA_H_
 
 #include "AbstractTreeParsimonyData.h"
+#include "ParsimonyKernels.h"
 #include "../Model/StateMap.h"
 
+#include <Bpp/Exceptions.h>
+
 // From SeqLib
 #include <Bpp/Seq/Container/SiteContainer.h>
 
@@ -52,16 +55,48 @@
 
 namespace bpp
 {
+/**
+ * @deprecated Sets of possible states are now stored as PackedStateSets objects,
+ * which have no limit on the number of states. This type is only used by the deprecated
+ * accessors, which build Bitset arrays from the packed sets.
+ */
 typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
 
+/**
+ * @brief Build an array of Bitset objects from sets of possible states.
+ *
+ * @deprecated Only meant for the deprecated accessors returning Bitset arrays.
+ *
+ * @param stateSets The sets of possible states.
+ * @return One bitset for each site.
+ * @throw Exception If there are more states than bits in a Bitset.
+ */
+inline std::vector<Bitset> getBitsetsFromStateSets(const PackedStateSets& stateSets)
+{
+  size_t nbSites = stateSets.getNumberOfSites();
+  size_t nbStates = stateSets.getNumberOfStates();
+  if (nbStates > Bitset().size())
+    throw Exception("getBitsetsFromStateSets(). Too many states for a Bitset.");
+  std::vector<Bitset> bitsets(nbSites);
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      if (stateSets.hasState(i, s))
+        bitsets[i].set(s);
+    }
+  }
+  return bitsets;
+}
+
 /**
  * @brief Parsimony data structure for a node.
  *
  * This class is for use with the DRTreeParsimonyData class.
  *
  * Store for each neighbor node
- * - a vector of bitsets,
- * - a vector of score for the corresponding subtree.
+ * - the sets of possible states for all sites,
+ * - the (weighted) score of the corresponding subtree.
  *
  * @see DRTreeParsimonyData
  */
@@ -69,28 +104,28 @@ class DRTreeParsimonyNodeData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::map<int, std::vector<Bitset> > nodeBitsets_;
-  mutable std::map<int, std::vector<unsigned int> > nodeScores_;
+  mutable std::map<int, PackedStateSets> nodeStateSets_;
+  mutable std::map<int, unsigned int> nodeScores_;
   const Node* node_;
 
 public:
   DRTreeParsimonyNodeData() :
-    nodeBitsets_(),
+    nodeStateSets_(),
     nodeScores_(),
     node_(0)
   {}
 
   DRTreeParsimonyNodeData(const DRTreeParsimonyNodeData& tpnd) :
-    nodeBitsets_(tpnd.nodeBitsets_),
+    nodeStateSets_(tpnd.nodeStateSets_),
     nodeScores_(tpnd.nodeScores_),
     node_(tpnd.node_)
   {}
 
   DRTreeParsimonyNodeData& operator=(const DRTreeParsimonyNodeData& tpnd)
   {
-    nodeBitsets_ = tpnd.nodeBitsets_;
-    nodeScores_  = tpnd.nodeScores_;
-    node_        = tpnd.node_;
+    nodeStateSets_ = tpnd.nodeStateSets_;
+    nodeScores_    = tpnd.nodeScores_;
+    node_          = tpnd.node_;
     return *this;
   }
 
@@ -101,31 +136,42 @@ public:
 
   void setNode(const Node* node) { node_ = node; }
 
-  std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId)
+  PackedStateSets& getStateSetsForNeighbor(int neighborId)
   {
-    return nodeBitsets_[neighborId];
+    return nodeStateSets_[neighborId];
   }
-  const std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId) const
+  const PackedStateSets& getStateSetsForNeighbor(int neighborId) const
   {
-    return nodeBitsets_[neighborId];
+    return nodeStateSets_[neighborId];
   }
-  std::vector<unsigned int>& getScoresArrayForNeighbor(int neighborId)
+
+  /**
+   * @return A copy of the sets of possible states for a neighbor, as bitsets.
+   *
+   * @deprecated Use getStateSetsForNeighbor() instead. Modifying the returned array has no effect.
+   * Per-site scores of subtrees are no longer stored, see DRTreeParsimonyData::getScoresArray().
+   */
+  std::vector<Bitset> getBitsetsArrayForNeighbor(int neighborId) const
+  {
+    return getBitsetsFromStateSets(getStateSetsForNeighbor(neighborId));
+  }
+  unsigned int& getScoreForNeighbor(int neighborId)
   {
     return nodeScores_[neighborId];
   }
-  const std::vector<unsigned int>& getScoresArrayForNeighbor(int neighborId) const
+  unsigned int getScoreForNeighbor(int neighborId) const
   {
     return nodeScores_[neighborId];
   }
 
   bool isNeighbor(int neighborId) const
   {
-    return nodeBitsets_.find(neighborId) != nodeBitsets_.end();
+    return nodeStateSets_.find(neighborId) != nodeStateSets_.end();
   }
 
   void eraseNeighborArrays()
   {
-    nodeBitsets_.erase(nodeBitsets_.begin(), nodeBitsets_.end());
+    nodeStateSets_.erase(nodeStateSets_.begin(), nodeStateSets_.end());
     nodeScores_.erase(nodeScores_.begin(), nodeScores_.end());
   }
 };
@@ -135,7 +181,7 @@ public:
  *
  * This class is for use with the DRTreeParsimonyData class.
  *
- * Store the vector of bitsets associated to a leaf.
+ * Store the sets of possible states associated to a leaf.
  *
  * @see DRTreeParsimonyData
  */
@@ -143,24 +189,24 @@ class DRTreeParsimonyLeafData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::vector<Bitset> leafBitsets_;
+  mutable PackedStateSets leafStateSets_;
   const Node* leaf_;
 
 public:
   DRTreeParsimonyLeafData() :
-    leafBitsets_(),
+    leafStateSets_(),
     leaf_(0)
   {}
 
   DRTreeParsimonyLeafData(const DRTreeParsimonyLeafData& tpld) :
-    leafBitsets_(tpld.leafBitsets_),
+    leafStateSets_(tpld.leafStateSets_),
     leaf_(tpld.leaf_)
   {}
 
   DRTreeParsimonyLeafData& operator=(const DRTreeParsimonyLeafData& tpld)
   {
-    leafBitsets_ = tpld.leafBitsets_;
-    leaf_        = tpld.leaf_;
+    leafStateSets_ = tpld.leafStateSets_;
+    leaf_          = tpld.leaf_;
     return *this;
   }
 
@@ -171,26 +217,38 @@ public:
   const Node* getNode() const { return leaf_; }
   void setNode(const Node* node) { leaf_ = node; }
 
-  std::vector<Bitset>& getBitsetsArray()
+  PackedStateSets& getStateSets()
   {
-    return leafBitsets_;
+    return leafStateSets_;
   }
-  const std::vector<Bitset>& getBitsetsArray() const
+  const PackedStateSets& getStateSets() const
   {
-    return leafBitsets_;
+    return leafStateSets_;
+  }
+
+  /**
+   * @return A copy of the sets of possible states of the leaf, as bitsets.
+   *
+   * @deprecated Use getStateSets() instead. Modifying the returned array has no effect.
+   */
+  std::vector<Bitset> getBitsetsArray() const
+  {
+    return getBitsetsFromStateSets(leafStateSets_);
   }
 };
 
 /**
  * @brief Parsimony data structure for double-recursive (DR) algorithm.
  *
- * States are coded using bitsets for faster computing (@see AbstractTreeParsimonyData).
+ * Sets of possible states are stored as bit planes, 64 sites per word (see PackedStateSets),
+ * so that the Fitch algorithm can process many sites at once (see ParsimonyKernels).
  * For each inner node in the tree, we store a DRTreeParsimonyNodeData object in nodeData_.
  * For each leaf node in the tree, we store a DRTreeParsimonyLeafData object in leafData_.
  *
  * The dataset is first compressed, removing all identical sites.
  * The resulting dataset is stored in shrunkData_.
  * The corresponding positions are stored in rootPatternLinks_, inherited from AbstractTreeParsimonyData.
+ * The weights of the distinct sites are also stored as bit planes in siteWeights_.
  */
 class DRTreeParsimonyData :
   public AbstractTreeParsimonyData
@@ -198,8 +256,10 @@ class DRTreeParsimonyData :
 private:
   mutable std::map<int, DRTreeParsimonyNodeData> nodeData_;
   mutable std::map<int, DRTreeParsimonyLeafData> leafData_;
-  mutable std::vector<Bitset> rootBitsets_;
+  mutable PackedStateSets rootStateSets_;
   mutable std::vector<unsigned int> rootScores_;
+  unsigned int rootScore_;
+  PackedSiteWeights siteWeights_;
   SiteContainer* shrunkData_;
   size_t nbSites_;
   size_t nbStates_;
@@ -210,8 +270,10 @@ public:
     AbstractTreeParsimonyData(tree),
     nodeData_(),
     leafData_(),
-    rootBitsets_(),
+    rootStateSets_(),
     rootScores_(),
+    rootScore_(0),
+    siteWeights_(),
     shrunkData_(0),
     nbSites_(0),
     nbStates_(0),
@@ -269,37 +331,75 @@ public:
     return leafData_[nodeId];
   }
 
-  std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId)
+  PackedStateSets& getStateSets(int nodeId, int neighborId)
   {
-    return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getStateSetsForNeighbor(neighborId);
   }
-  const std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId) const
+  const PackedStateSets& getStateSets(int nodeId, int neighborId) const
   {
-    return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getStateSetsForNeighbor(neighborId);
   }
 
-  std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId)
+  unsigned int& getScore(int nodeId, int neighborId)
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getScoreForNeighbor(neighborId);
   }
-  const std::vector<unsigned int>& getScoresArray(int nodeId, int neighborId) const
+  unsigned int getScore(int nodeId, int neighborId) const
   {
-    return nodeData_[nodeId].getScoresArrayForNeighbor(neighborId);
+    return nodeData_[nodeId].getScoreForNeighbor(neighborId);
   }
 
+  /**
+   * @return A copy of the sets of possible states of a node for a neighbor, as bitsets.
+   *
+   * @deprecated Use getStateSets() instead. Modifying the returned array has no effect.
+   */
+  std::vector<Bitset> getBitsetsArray(int nodeId, int neighborId) const
+  {
+    return getBitsetsFromStateSets(getStateSets(nodeId, neighborId));
+  }
+
+  /**
+   * @return The score of each distinct site for the subtree defined by a neighbor of a node, not weighted.
+   *
+   * @deprecated Only the total score of each subtree is stored now, see getScore().
+   * Per-site scores are recomputed from the stored state sets by this method, which traverses the subtree.
+   */
+  std::vector<unsigned int> getScoresArray(int nodeId, int neighborId) const;
+
   size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
   {
     return currentPosition;
   }
 
-  std::vector<Bitset>& getRootBitsets() { return rootBitsets_; }
-  const std::vector<Bitset>& getRootBitsets() const { return rootBitsets_; }
-  const Bitset& getRootBitset(size_t i) const { return rootBitsets_[i]; }
+  PackedStateSets& getRootStateSets() { return rootStateSets_; }
+  const PackedStateSets& getRootStateSets() const { return rootStateSets_; }
+
+  /**
+   * @deprecated Use getRootStateSets() instead. Modifying the returned array has no effect.
+   */
+  std::vector<Bitset> getRootBitsets() const { return getBitsetsFromStateSets(rootStateSets_); }
 
+  /**
+   * @deprecated Use getRootStateSets() instead.
+   */
+  Bitset getRootBitset(size_t i) const { return getBitsetsFromStateSets(rootStateSets_)[i]; }
+
+  /**
+   * @return The score of each distinct site, not weighted.
+   */
   std::vector<unsigned int>& getRootScores() { return rootScores_; }
   const std::vector<unsigned int>& getRootScores() const { return rootScores_; }
   unsigned int getRootScore(size_t i) const { return rootScores_[i]; }
 
+  /**
+   * @return The total score of the tree, that is the sum of the scores of all distinct sites, weighted.
+   */
+  unsigned int& getRootTotalScore() { return rootScore_; }
+  unsigned int getRootTotalScore() const { return rootScore_; }
+
+  const PackedSiteWeights& getSiteWeights() const { return siteWeights_; }
+
   size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
   size_t getNumberOfSites() const { return nbSites_; }
   size_t getNumberOfStates() const { return nbStates_; }
@@ -310,6 +410,12 @@ public:
 protected:
   void init(const Node* node, const SiteContainer& sites, const StateMap& stateMap);
   void reInit(const Node* node);
+
+private:
+  /**
+   * @brief Add the per-site scores of the subtree defined by a neighbor of a node.
+   */
+  void addSiteScores_(const Node* node, const Node* neighbor, std::vector<unsigned int>& scores) const;
 };
 } // end of namespace bpp.
 
@@ -45,6 +45,9 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -121,64 +124,68 @@ DRTreeParsimonyScore::~DRTreeParsimonyScore()
 /******************************************************************************/
 void DRTreeParsimonyScore::computeScores()
 {
+  // Per-site scores are accumulated during the postorder traversal:
+  vector<unsigned int>* rootScores = &parsimonyData_->getRootScores();
+  fill(rootScores->begin(), rootScores->end(), 0);
   computeScoresPostorder(getTreeP_()->getRootNode());
   computeScoresPreorder(getTreeP_()->getRootNode());
   computeScoresForNode(
     parsimonyData_->getNodeData(getTree().getRootId()),
-    parsimonyData_->getRootBitsets(),
-    parsimonyData_->getRootScores());
+    parsimonyData_->getSiteWeights(),
+    parsimonyData_->getRootStateSets(),
+    parsimonyData_->getRootTotalScore(),
+    rootScores->empty() ? 0 : &(*rootScores)[0]);
 }
 
 void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
 {
   if (node->isLeaf()) return;
   DRTreeParsimonyNodeData* pData = &parsimonyData_->getNodeData(node->getId());
+  vector<unsigned int>* rootScores = &parsimonyData_->getRootScores();
   for (unsigned int k = 0; k < node->getNumberOfSons(); k++)
   {
     const Node* son = node->getSon(k);
     computeScoresPostorder(son);
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(son->getId());
+    PackedStateSets* stateSets = &pData->getStateSetsForNeighbor(son->getId());
+    unsigned int* score        = &pData->getScoreForNeighbor(son->getId());
     if (son->isLeaf())
     {
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *stateSets = parsimonyData_->getLeafData(son->getId()).getStateSets();
+      *score     = 0;
     }
     else
     {
       computeScoresPostorderForNode(
         parsimonyData_->getNodeData(son->getId()),
-        *bitsets,
-        *scores);
+        parsimonyData_->getSiteWeights(),
+        *stateSets,
+        *score,
+        rootScores->empty() ? 0 : &(*rootScores)[0]);
     }
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<Bitset>& rBitsets, vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, const PackedSiteWeights& weights, PackedStateSets& rStateSets, unsigned int& rScore, unsigned int* siteScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   const Node* source = node->getFather();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
-  vector< const vector<unsigned int>*> iScores;
+  vector<const PackedStateSets*> iStateSets;
+  vector<unsigned int> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
     if (n != source)
     {
-      iBitsets.push_back(&pData.getBitsetsArrayForNeighbor(n->getId()));
-      iScores.push_back(&pData.getScoresArrayForNeighbor(n->getId()));
+      iStateSets.push_back(&pData.getStateSetsForNeighbor(n->getId()));
+      iScores.push_back(pData.getScoreForNeighbor(n->getId()));
     }
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iStateSets, iScores, weights, rStateSets, rScore, siteScores);
 }
 
 void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
@@ -188,25 +195,22 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
-    vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(father->getId());
+    PackedStateSets* stateSets = &pData->getStateSetsForNeighbor(father->getId());
+    unsigned int* score        = &pData->getScoreForNeighbor(father->getId());
     if (father->isLeaf())
     { // Means that the tree is rooted by a leaf... dunno if we must allow that! Let it be for now.
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *stateSets = parsimonyData_->getLeafData(father->getId()).getStateSets();
+      *score     = 0;
     }
     else
     {
       computeScoresPreorderForNode(
         parsimonyData_->getNodeData(father->getId()),
         node,
-        *bitsets,
-        *scores);
+        parsimonyData_->getSiteWeights(),
+        *stateSets,
+        *score);
     }
   }
   // Recurse call:
@@ -216,54 +220,49 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, const PackedSiteWeights& weights, PackedStateSets& rStateSets, unsigned int& rScore)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
-  vector< const vector<unsigned int>*> iScores;
+  vector<const PackedStateSets*> iStateSets;
+  vector<unsigned int> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
     if (n != source)
     {
-      iBitsets.push_back(&pData.getBitsetsArrayForNeighbor(n->getId()));
-      iScores.push_back(&pData.getScoresArrayForNeighbor(n->getId()));
+      iStateSets.push_back(&pData.getStateSetsForNeighbor(n->getId()));
+      iScores.push_back(pData.getScoreForNeighbor(n->getId()));
     }
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iStateSets, iScores, weights, rStateSets, rScore);
 }
 
-void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, const PackedSiteWeights& weights, PackedStateSets& rStateSets, unsigned int& rScore, unsigned int* siteScores)
 {
   const Node* node = pData.getNode();
   size_t nbNeighbors = node->degree();
   vector<const Node*> neighbors = node->getNeighbors();
   // First initialize the vectors fro input:
-  vector< const vector<Bitset>*> iBitsets(nbNeighbors);
-  vector< const vector<unsigned int>*> iScores(nbNeighbors);
+  vector<const PackedStateSets*> iStateSets(nbNeighbors);
+  vector<unsigned int> iScores(nbNeighbors);
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
     const Node* n = neighbors[k];
-    iBitsets[k] =  &pData.getBitsetsArrayForNeighbor(n->getId());
-    iScores [k] =  &pData.getScoresArrayForNeighbor(n->getId());
+    iStateSets[k] = &pData.getStateSetsForNeighbor(n->getId());
+    iScores[k]    = pData.getScoreForNeighbor(n->getId());
   }
   // Then call the general method on these arrays:
-  computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
+  computeScoresFromArrays(iStateSets, iScores, weights, rStateSets, rScore, siteScores);
 }
 
 /******************************************************************************/
 unsigned int DRTreeParsimonyScore::getScore() const
 {
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += parsimonyData_->getRootScore(i) * parsimonyData_->getWeight(i);
-  }
-  return score;
+  return parsimonyData_->getRootTotalScore();
 }
 
 /******************************************************************************/
@@ -272,6 +271,37 @@ unsigned int DRTreeParsimonyScore::getScoreForSite(size_t site) const
   return parsimonyData_->getRootScore(parsimonyData_->getRootArrayPosition(site));
 }
 
+/******************************************************************************/
+void DRTreeParsimonyScore::computeScoresFromArrays(
+  const vector<const PackedStateSets*>& iStateSets,
+  const vector<unsigned int>& iScores,
+  const PackedSiteWeights& weights,
+  PackedStateSets& oStateSets,
+  unsigned int& oScore,
+  unsigned int* siteScores)
+{
+  size_t nbNodes = iStateSets.size();
+  if (iScores.size() != nbNodes)
+    throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have the same length.");
+  if (nbNodes < 1)
+    throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
+  oScore = iScores[0];
+  if (nbNodes == 1)
+  {
+    oStateSets = *iStateSets[0];
+    return;
+  }
+  // Sites are combined 64 at a time, the first combination reads from the first input array
+  // and the next ones update the output array in place:
+  const PackedStateSets* previous = iStateSets[0];
+  for (size_t k = 1; k < nbNodes; k++)
+  {
+    oScore += iScores[k];
+    oScore += ParsimonyKernels::fitch(*previous, *iStateSets[k], weights, oStateSets, siteScores);
+    previous = &oStateSets;
+  }
+}
+
 /******************************************************************************/
 void DRTreeParsimonyScore::computeScoresFromArrays(
   const vector< const vector<Bitset>*>& iBitsets,
@@ -326,59 +356,52 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const
 
   // Retrieving arrays of interest:
   const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
-  const vector<Bitset>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
-  const vector<unsigned int>* sonScores  = &parentData->getScoresArrayForNeighbor(son->getId());
+  const PackedStateSets* sonStateSets = &parentData->getStateSetsForNeighbor(son->getId());
+  unsigned int sonScore = parentData->getScoreForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector< const vector<Bitset>*> parentBitsets(nbParentNeighbors);
-  vector< const vector<unsigned int>*> parentScores(nbParentNeighbors);
+  vector<const PackedStateSets*> parentStateSets(nbParentNeighbors);
+  vector<unsigned int> parentScores(nbParentNeighbors);
   for (unsigned int k = 0; k < nbParentNeighbors; k++)
   {
     const Node* n = parentNeighbors[k]; // This neighbor
-    parentBitsets[k] = &parentData->getBitsetsArrayForNeighbor(n->getId());
-    parentScores[k] = &parentData->getScoresArrayForNeighbor(n->getId());
+    parentStateSets[k] = &parentData->getStateSetsForNeighbor(n->getId());
+    parentScores[k] = parentData->getScoreForNeighbor(n->getId());
   }
 
   const DRTreeParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
-  const vector<Bitset>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
-  const vector<unsigned int>* uncleScores  = &grandFatherData->getScoresArrayForNeighbor(uncle->getId());
+  const PackedStateSets* uncleStateSets = &grandFatherData->getStateSetsForNeighbor(uncle->getId());
+  unsigned int uncleScore = grandFatherData->getScoreForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector< const vector<Bitset>*> grandFatherBitsets(nbGrandFatherNeighbors);
-  vector< const vector<unsigned int>*> grandFatherScores(nbGrandFatherNeighbors);
+  vector<const PackedStateSets*> grandFatherStateSets(nbGrandFatherNeighbors);
+  vector<unsigned int> grandFatherScores(nbGrandFatherNeighbors);
   for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
   {
     const Node* n = grandFatherNeighbors[k]; // This neighbor
-    grandFatherBitsets[k] = &grandFatherData->getBitsetsArrayForNeighbor(n->getId());
-    grandFatherScores[k] = &grandFatherData->getScoresArrayForNeighbor(n->getId());
+    grandFatherStateSets[k] = &grandFatherData->getStateSetsForNeighbor(n->getId());
+    grandFatherScores[k] = grandFatherData->getScoreForNeighbor(n->getId());
   }
 
+  const PackedSiteWeights& weights = parsimonyData_->getSiteWeights();
+
   // Compute arrays and scores for grand-father node:
-  grandFatherBitsets.push_back(sonBitsets);
-  grandFatherScores.push_back(sonScores);
-  // Init arrays:
-  vector<Bitset> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> gfScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores);
-
-  // Now computes arrays and scores for parent node:
-  parentBitsets.push_back(uncleBitsets);
-  parentScores.push_back(uncleScores);
-  parentBitsets.push_back(&gfBitsets);
-  parentScores.push_back(&gfScores);
-  // Init arrays:
-  vector<Bitset> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> pScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores);
+  grandFatherStateSets.push_back(sonStateSets);
+  grandFatherScores.push_back(sonScore);
+  PackedStateSets gfStateSets;
+  unsigned int gfScore;
+  computeScoresFromArrays(grandFatherStateSets, grandFatherScores, weights, gfStateSets, gfScore);
+
+  // Now computes arrays and scores for parent node.
+  // The state sets resulting from the last combination are not needed, only its score is computed:
+  parentStateSets.push_back(uncleStateSets);
+  parentScores.push_back(uncleScore);
+  PackedStateSets pStateSets;
+  unsigned int pScore;
+  computeScoresFromArrays(parentStateSets, parentScores, weights, pStateSets, pScore);
 
   // Final computation:
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += pScores[i] * parsimonyData_->getWeight(i);
-  }
+  unsigned int score = pScore + gfScore + ParsimonyKernels::fitchScore(pStateSets, gfStateSets, weights);
   return (double)score - (double)getScore();
 }
 
@@ -428,17 +451,17 @@ void DRTreeParsimonyScore::computeSolution()
   map< int, vector<size_t> > nodeToPossibleStates;
   TreeTemplate<Node>* tree = getTreeP_();
   vector<Node*> nodes = tree->getNodes();
-  vector<Bitset> nodeBitsets;
+  const PackedStateSets* nodeStateSets = 0;
   for (size_t n = 0; n < nodes.size(); ++n)
   {
     // extract the node's bisets (i.e, possible states assignments)
     if (nodes[n]->isLeaf())
     {
-      nodeBitsets = (&parsimonyData_->getLeafData(nodes[n]->getId()))->getBitsetsArray();
+      nodeStateSets = &parsimonyData_->getLeafData(nodes[n]->getId()).getStateSets();
     }
     else if (nodes[n]->hasFather())
     {
-      nodeBitsets = (&parsimonyData_->getNodeData(nodes[n]->getFather()->getId()))->getBitsetsArrayForNeighbor(nodes[n]->getId());  // extract the bitset corresponding to the son from its father's bitSet array
+      nodeStateSets = &parsimonyData_->getNodeData(nodes[n]->getFather()->getId()).getStateSetsForNeighbor(nodes[n]->getId());  // extract the state sets corresponding to the son from its father's arrays
     }
     else // get the node's possible states from its first internal neighbor
     {
@@ -452,13 +475,13 @@ void DRTreeParsimonyScore::computeSolution()
           break;
         }
       }
-       nodeBitsets = (&parsimonyData_->getNodeData(neighborId))->getBitsetsArrayForNeighbor(nodes[n]->getId());
+       nodeStateSets = &parsimonyData_->getNodeData(neighborId).getStateSetsForNeighbor(nodes[n]->getId());
     }
     // map the node id to its possible states
     vector <size_t> possibleStates;
     for (size_t s = 0; s < getStateMap().getNumberOfModelStates(); ++s)
     {
-      if (nodeBitsets[0].test(s))
+      if (nodeStateSets->hasState(0, s))
       {
         possibleStates.push_back(s);
       }
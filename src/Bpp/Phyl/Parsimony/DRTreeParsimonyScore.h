@@ -88,7 +88,7 @@ protected:
   /**
    * @brief Compute all scores.
    *
-   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize rootBitsets_ and rootScores_.
+   * Call the computeScoresPreorder and computeScoresPostorder methods, and then initialize the root state sets and scores.
    */
   virtual void computeScores();
   /**
@@ -105,49 +105,81 @@ public:
   unsigned int getScoreForSite(size_t site) const;
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in postorder.
+   * @brief Compute state sets and score for a node, in postorder.
    *
-   * @param pData    The node data to use.
-   * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param pData      The node data to use.
+   * @param weights    The weights of sites.
+   * @param rStateSets The array where to store the resulting state sets.
+   * @param rScore     [out] The resulting score of the subtree.
+   * @param siteScores If not null, the per-site scores are increased by the number of unions needed at this node.
    */
   static void computeScoresPostorderForNode(
     const DRTreeParsimonyNodeData& pData,
-    std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+    const PackedSiteWeights& weights,
+    PackedStateSets& rStateSets,
+    unsigned int& rScore,
+    unsigned int* siteScores = 0);
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in preorder.
+   * @brief Compute state sets and score for a node, in preorder.
    *
-   * @param pData    The node data to use.
-   * @param source   The node where we are coming from.
-   * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param pData      The node data to use.
+   * @param source     The node where we are coming from.
+   * @param weights    The weights of sites.
+   * @param rStateSets The array where to store the resulting state sets.
+   * @param rScore     [out] The resulting score of the subtree.
    */
   static void computeScoresPreorderForNode(
     const DRTreeParsimonyNodeData& pData,
     const Node* source,
-    std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+    const PackedSiteWeights& weights,
+    PackedStateSets& rStateSets,
+    unsigned int& rScore);
 
   /**
-   * @brief Compute bitsets and scores for each site for a node, in all directions.
+   * @brief Compute state sets and score for a node, in all directions.
    *
-   * @param pData    The node data to use.
-   * @param rBitsets The bitset array where to store the resulting bitsets.
-   * @param rScores  The score array where to write the resulting scores.
+   * @param pData      The node data to use.
+   * @param weights    The weights of sites.
+   * @param rStateSets The array where to store the resulting state sets.
+   * @param rScore     [out] The resulting score of the tree.
+   * @param siteScores If not null, the per-site scores are increased by the number of unions needed at this node.
    */
   static void computeScoresForNode(
-    const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets,
-    std::vector<unsigned int>& rScores);
+    const DRTreeParsimonyNodeData& pData,
+    const PackedSiteWeights& weights,
+    PackedStateSets& rStateSets,
+    unsigned int& rScore,
+    unsigned int* siteScores = 0);
 
   /**
-   * @brief Compute bitsets and scores from an array of arrays.
+   * @brief Compute state sets and score from an array of arrays.
    *
    * This method is the more general score computation.
-   * Depending on what is passed as input, it may computes scroes fo a subtree
+   * Depending on what is passed as input, it may computes scores for a subtree
    * or the whole tree.
    *
+   * @param iStateSets The vector of state set arrays to use.
+   * @param iScores    The vector of subtree scores to use.
+   * @param weights    The weights of sites.
+   * @param oStateSets The array where to store the resulting state sets.
+   * @param oScore     [out] The resulting score.
+   * @param siteScores If not null, the per-site scores are increased by the number of unions needed.
+   */
+  static void computeScoresFromArrays(
+    const std::vector<const PackedStateSets*>& iStateSets,
+    const std::vector<unsigned int>& iScores,
+    const PackedSiteWeights& weights,
+    PackedStateSets& oStateSets,
+    unsigned int& oScore,
+    unsigned int* siteScores = 0);
+
+  /**
+   * @brief Compute bitsets and scores from an array of arrays.
+   *
+   * @deprecated Use the version working on PackedStateSets objects, which processes 64 sites at once
+   * and has no limit on the number of states.
+   *
    * @param iBitsets The vector of bitset arrays to use.
    * @param iScores  The vector of score arrays to use.
    * @param oBitsets The bitset array where to store the resulting bitsets.
@@ -0,0 +1,337 @@
+//
+// File: ParsimonyKernels.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:47 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "ParsimonyKernels.h"
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BPP_PARSIMONY_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+ParsimonyKernels::InstructionSet ParsimonyKernels::instructionSet_ = ParsimonyKernels::detectInstructionSet_();
+
+/******************************************************************************/
+
+void PackedSiteWeights::setWeights(const std::vector<unsigned int>& weights)
+{
+  nbSites_ = weights.size();
+  nbWords_ = PackedStateSets::getNumberOfWords(nbSites_);
+  unsigned int maxWeight = 0;
+  for (size_t i = 0; i < nbSites_; i++)
+    maxWeight = max(maxWeight, weights[i]);
+  nbPlanes_ = 0;
+  while (nbPlanes_ < 32 && (maxWeight >> nbPlanes_) > 0)
+    nbPlanes_++;
+  mask_.assign(nbWords_, 0);
+  planes_.assign(nbPlanes_ * nbWords_, 0);
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    uint64_t bit = static_cast<uint64_t>(1) << (i % 64);
+    mask_[i / 64] |= bit;
+    for (size_t j = 0; j < nbPlanes_; j++)
+    {
+      if ((weights[i] >> j) & 1)
+        planes_[j * nbWords_ + i / 64] |= bit;
+    }
+  }
+}
+
+/******************************************************************************/
+
+namespace
+{
+
+/*
+ * Sites are processed by blocks of this number of words, so that the intersection
+ * flags of a block remain in the L1 cache while looping over states.
+ * Must be a multiple of PackedStateSets::getWordPadding().
+ */
+const size_t BLOCK_WORDS = 16;
+
+inline unsigned int popCount_(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned int>(__builtin_popcountll(x));
+#else
+  unsigned int n = 0;
+  for ( ; x; x &= x - 1)
+    n++;
+  return n;
+#endif
+}
+
+inline unsigned int countTrailingZeros_(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned int>(__builtin_ctzll(x));
+#else
+  unsigned int n = 0;
+  for ( ; !(x & 1); x >>= 1)
+    n++;
+  return n;
+#endif
+}
+
+/*
+ * Given the words flagging the sites where a union is needed,
+ * return their total weight and update the per-site scores if requested.
+ */
+inline unsigned int countUnions_(
+    const uint64_t* unions, size_t nbWords, size_t firstWord,
+    const PackedSiteWeights& weights,
+    unsigned int* siteScores)
+{
+  unsigned int score = 0;
+  for (size_t j = 0; j < weights.getNumberOfPlanes(); j++)
+  {
+    const uint64_t* plane = weights.getPlane(j) + firstWord;
+    unsigned int n = 0;
+    for (size_t w = 0; w < nbWords; w++)
+      n += popCount_(unions[w] & plane[w]);
+    score += n << j;
+  }
+  if (siteScores)
+  {
+    for (size_t w = 0; w < nbWords; w++)
+    {
+      for (uint64_t bits = unions[w]; bits; bits &= bits - 1)
+        siteScores[(firstWord + w) * 64 + countTrailingZeros_(bits)]++;
+    }
+  }
+  return score;
+}
+
+/*
+ * Scalar version. If STORE is false, resulting sets are not computed.
+ */
+template<bool STORE>
+unsigned int fitchScalar_(
+    const uint64_t* a, const uint64_t* b, uint64_t* out,
+    size_t nbStates, size_t nbWords,
+    const PackedSiteWeights& weights,
+    unsigned int* siteScores)
+{
+  const uint64_t* mask = weights.getMask();
+  uint64_t unions[BLOCK_WORDS];
+  unsigned int score = 0;
+  for (size_t w0 = 0; w0 < nbWords; w0 += BLOCK_WORDS)
+  {
+    size_t n = min(BLOCK_WORDS, nbWords - w0);
+    fill(unions, unions + n, 0);
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      const uint64_t* a_s = a + s * nbWords + w0;
+      const uint64_t* b_s = b + s * nbWords + w0;
+      for (size_t w = 0; w < n; w++)
+        unions[w] |= a_s[w] & b_s[w];
+    }
+    for (size_t w = 0; w < n; w++)
+      unions[w] = ~unions[w] & mask[w0 + w];
+    score += countUnions_(unions, n, w0, weights, siteScores);
+    if (STORE)
+    {
+      for (size_t s = 0; s < nbStates; s++)
+      {
+        const uint64_t* a_s = a + s * nbWords + w0;
+        const uint64_t* b_s = b + s * nbWords + w0;
+        uint64_t* out_s = out + s * nbWords + w0;
+        for (size_t w = 0; w < n; w++)
+          out_s[w] = (a_s[w] & b_s[w]) | (unions[w] & (a_s[w] | b_s[w]));
+      }
+    }
+  }
+  return score;
+}
+
+#ifdef BPP_PARSIMONY_KERNELS_X86
+
+/*
+ * AVX2 version: 256 sites are processed at once.
+ * The number of words is always a multiple of 4 (see PackedStateSets::getWordPadding()).
+ */
+template<bool STORE>
+__attribute__((target("avx2,popcnt")))
+unsigned int fitchAvx2_(
+    const uint64_t* a, const uint64_t* b, uint64_t* out,
+    size_t nbStates, size_t nbWords,
+    const PackedSiteWeights& weights,
+    unsigned int* siteScores)
+{
+  const uint64_t* mask = weights.getMask();
+  uint64_t unions[BLOCK_WORDS];
+  unsigned int score = 0;
+  for (size_t w0 = 0; w0 < nbWords; w0 += BLOCK_WORDS)
+  {
+    size_t n = min(BLOCK_WORDS, nbWords - w0);
+    __m256i acc[BLOCK_WORDS / 4];
+    for (size_t v = 0; v < n / 4; v++)
+      acc[v] = _mm256_setzero_si256();
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      const __m256i* a_s = reinterpret_cast<const __m256i*>(a + s * nbWords + w0);
+      const __m256i* b_s = reinterpret_cast<const __m256i*>(b + s * nbWords + w0);
+      for (size_t v = 0; v < n / 4; v++)
+        acc[v] = _mm256_or_si256(acc[v], _mm256_and_si256(_mm256_loadu_si256(a_s + v), _mm256_loadu_si256(b_s + v)));
+    }
+    for (size_t v = 0; v < n / 4; v++)
+    {
+      __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + w0) + v);
+      acc[v] = _mm256_andnot_si256(acc[v], m);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(unions) + v, acc[v]);
+    }
+    score += countUnions_(unions, n, w0, weights, siteScores);
+    if (STORE)
+    {
+      for (size_t s = 0; s < nbStates; s++)
+      {
+        const __m256i* a_s = reinterpret_cast<const __m256i*>(a + s * nbWords + w0);
+        const __m256i* b_s = reinterpret_cast<const __m256i*>(b + s * nbWords + w0);
+        __m256i* out_s = reinterpret_cast<__m256i*>(out + s * nbWords + w0);
+        for (size_t v = 0; v < n / 4; v++)
+        {
+          __m256i x = _mm256_loadu_si256(a_s + v);
+          __m256i y = _mm256_loadu_si256(b_s + v);
+          __m256i r = _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(acc[v], _mm256_or_si256(x, y)));
+          _mm256_storeu_si256(out_s + v, r);
+        }
+      }
+    }
+  }
+  return score;
+}
+
+#endif //BPP_PARSIMONY_KERNELS_X86
+
+template<bool STORE>
+unsigned int fitch_(
+    ParsimonyKernels::InstructionSet instructionSet,
+    const PackedStateSets& a,
+    const PackedStateSets& b,
+    const PackedSiteWeights& weights,
+    uint64_t* out,
+    unsigned int* siteScores)
+{
+  if (a.getNumberOfStates() != b.getNumberOfStates() || a.getNumberOfWords() != b.getNumberOfWords())
+    throw Exception("ParsimonyKernels::fitch. Input arrays must have the same dimensions.");
+  if (weights.getNumberOfWords() != a.getNumberOfWords())
+    throw Exception("ParsimonyKernels::fitch. Weights and state sets must have the same number of sites.");
+  if (a.getNumberOfWords() == 0)
+    return 0;
+#ifdef BPP_PARSIMONY_KERNELS_X86
+  if (instructionSet == LikelihoodKernels::AVX2)
+    return fitchAvx2_<STORE>(a.getData(), b.getData(), out, a.getNumberOfStates(), a.getNumberOfWords(), weights, siteScores);
+#endif
+  return fitchScalar_<STORE>(a.getData(), b.getData(), out, a.getNumberOfStates(), a.getNumberOfWords(), weights, siteScores);
+}
+
+} //end of anonymous namespace.
+
+/******************************************************************************/
+
+unsigned int ParsimonyKernels::fitch(
+    const PackedStateSets& a,
+    const PackedStateSets& b,
+    const PackedSiteWeights& weights,
+    PackedStateSets& out,
+    unsigned int* siteScores)
+{
+  if (out.getNumberOfStates() != a.getNumberOfStates() || out.getNumberOfSites() != a.getNumberOfSites())
+    out.resize(a.getNumberOfSites(), a.getNumberOfStates());
+  return fitch_<true>(instructionSet_, a, b, weights, out.getData(), siteScores);
+}
+
+/******************************************************************************/
+
+unsigned int ParsimonyKernels::fitchScore(
+    const PackedStateSets& a,
+    const PackedStateSets& b,
+    const PackedSiteWeights& weights)
+{
+  return fitch_<false>(instructionSet_, a, b, weights, 0, 0);
+}
+
+/******************************************************************************/
+
+bool ParsimonyKernels::isSupported(InstructionSet instructionSet)
+{
+  switch (instructionSet)
+  {
+  case LikelihoodKernels::SCALAR:
+    return true;
+  case LikelihoodKernels::AVX2:
+#ifdef BPP_PARSIMONY_KERNELS_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+void ParsimonyKernels::setInstructionSet(InstructionSet instructionSet)
+{
+  if (!isSupported(instructionSet))
+    throw Exception("ParsimonyKernels::setInstructionSet. Instruction set not supported by this processor.");
+  instructionSet_ = instructionSet;
+}
+
+/******************************************************************************/
+
+ParsimonyKernels::InstructionSet ParsimonyKernels::detectInstructionSet_()
+{
+  if (isSupported(LikelihoodKernels::AVX2))
+    return LikelihoodKernels::AVX2;
+  return LikelihoodKernels::SCALAR;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,269 @@
+//
+// File: ParsimonyKernels.h
+// Created by: agent
+// Created on: Fri Oct 16 20:47 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _PARSIMONYKERNELS_H_
+#define _PARSIMONYKERNELS_H_
+
+#include "../Likelihood/LikelihoodKernels.h"
+
+// From the STL:
+#include <vector>
+#include <cstdint>
+
+namespace bpp
+{
+
+/**
+ * @brief Sets of possible states for a block of sites, stored as bit planes.
+ *
+ * Sites are packed by blocks of 64, one bit per site: word w of state s tells,
+ * for sites 64w to 64w+63, whether s belongs to the set of possible states.
+ * The array is stored as
+ * <pre>
+ * x[s][w]
+ *   |------> State s
+ *      |---> Word w (64 sites)
+ * </pre>
+ * so that all words of a given state are contiguous. The number of words is rounded up
+ * to a multiple of getWordPadding(), bits beyond the last site are always 0.
+ * There is no limit on the number of states.
+ *
+ * @see ParsimonyKernels
+ */
+class PackedStateSets
+{
+  private:
+    size_t nbSites_;
+    size_t nbStates_;
+    size_t nbWords_;
+    std::vector<uint64_t> data_;
+
+  public:
+    PackedStateSets() : nbSites_(0), nbStates_(0), nbWords_(0), data_() {}
+
+    PackedStateSets(size_t nbSites, size_t nbStates) :
+      nbSites_(0), nbStates_(0), nbWords_(0), data_()
+    {
+      resize(nbSites, nbStates);
+    }
+
+  public:
+    /**
+     * @brief Resize the array, and set all sets to the empty set.
+     *
+     * @param nbSites  The number of sites.
+     * @param nbStates The number of states.
+     */
+    void resize(size_t nbSites, size_t nbStates)
+    {
+      nbSites_  = nbSites;
+      nbStates_ = nbStates;
+      nbWords_  = getNumberOfWords(nbSites);
+      data_.assign(nbStates_ * nbWords_, 0);
+    }
+
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+    size_t getNumberOfWords() const { return nbWords_; }
+
+    uint64_t* getStateWords(size_t state) { return &data_[state * nbWords_]; }
+    const uint64_t* getStateWords(size_t state) const { return &data_[state * nbWords_]; }
+
+    uint64_t* getData() { return data_.empty() ? 0 : &data_[0]; }
+    const uint64_t* getData() const { return data_.empty() ? 0 : &data_[0]; }
+
+    void addState(size_t site, size_t state)
+    {
+      data_[state * nbWords_ + site / 64] |= (static_cast<uint64_t>(1) << (site % 64));
+    }
+
+    bool hasState(size_t site, size_t state) const
+    {
+      return (data_[state * nbWords_ + site / 64] >> (site % 64)) & 1;
+    }
+
+    /**
+     * @return The number of words needed to store nbSites sites, padding included.
+     */
+    static size_t getNumberOfWords(size_t nbSites)
+    {
+      size_t n = (nbSites + 63) / 64;
+      return (n + getWordPadding() - 1) / getWordPadding() * getWordPadding();
+    }
+
+    /**
+     * @return The number of words per state is always a multiple of this number.
+     */
+    static size_t getWordPadding() { return 4; }
+};
+
+/**
+ * @brief Site weights, stored as bit planes in the same layout as PackedStateSets.
+ *
+ * Word w of plane j contains bit j of the weights of sites 64w to 64w+63,
+ * so that the total weight of a set of sites (given as a bit mask) can be computed
+ * using a few population counts.
+ * Sites beyond the last one have a weight of 0.
+ */
+class PackedSiteWeights
+{
+  private:
+    size_t nbSites_;
+    size_t nbWords_;
+    size_t nbPlanes_;
+    std::vector<uint64_t> mask_;
+    std::vector<uint64_t> planes_;
+
+  public:
+    PackedSiteWeights() : nbSites_(0), nbWords_(0), nbPlanes_(0), mask_(), planes_() {}
+
+    PackedSiteWeights(const std::vector<unsigned int>& weights) :
+      nbSites_(0), nbWords_(0), nbPlanes_(0), mask_(), planes_()
+    {
+      setWeights(weights);
+    }
+
+  public:
+    /**
+     * @brief Set the weights of all sites.
+     *
+     * @param weights The weight of each site.
+     */
+    void setWeights(const std::vector<unsigned int>& weights);
+
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfWords() const { return nbWords_; }
+    size_t getNumberOfPlanes() const { return nbPlanes_; }
+
+    /**
+     * @return The words with one bit set for each site.
+     */
+    const uint64_t* getMask() const { return mask_.empty() ? 0 : &mask_[0]; }
+
+    /**
+     * @return The words of bit plane j.
+     * @param j The index of the plane.
+     */
+    const uint64_t* getPlane(size_t j) const { return &planes_[j * nbWords_]; }
+};
+
+/**
+ * @brief Low-level routines for the computation of Fitch parsimony scores.
+ *
+ * The central operation of the Fitch algorithm combines the sets of possible states
+ * A and B of two subtrees: for each site, the resulting set is A inter B if it is not empty,
+ * and A union B otherwise, in which case the score increases by one.
+ *
+ * Sites being packed by 64 in PackedStateSets objects, this operation is performed with
+ * word-wide AND and OR operations for 64 sites at once, and the score is obtained by counting bits.
+ * Vectorized versions are used when the processor supports them (currently AVX2,
+ * on x86 processors compiled with GCC or Clang), the choice being made at runtime.
+ * All versions give exactly the same results.
+ */
+class ParsimonyKernels
+{
+  public:
+    typedef LikelihoodKernels::InstructionSet InstructionSet;
+
+  private:
+    static InstructionSet instructionSet_;
+
+  public:
+    /**
+     * @brief Combine two arrays of state sets.
+     *
+     * The output array may be one of the input ones.
+     * All arrays must have the same dimensions.
+     *
+     * @param a          The first array.
+     * @param b          The second array.
+     * @param weights    The weights of sites.
+     * @param out        [out] The resulting array.
+     * @param siteScores If not null, the score of each site for which a union was needed is increased by one.
+     * @return The weighted number of sites for which a union was needed.
+     */
+    static unsigned int fitch(
+        const PackedStateSets& a,
+        const PackedStateSets& b,
+        const PackedSiteWeights& weights,
+        PackedStateSets& out,
+        unsigned int* siteScores = 0);
+
+    /**
+     * @brief Same as fitch(), but only compute the score, without storing the resulting sets.
+     *
+     * @param a          The first array.
+     * @param b          The second array.
+     * @param weights    The weights of sites.
+     * @return The weighted number of sites for which a union was needed.
+     */
+    static unsigned int fitchScore(
+        const PackedStateSets& a,
+        const PackedStateSets& b,
+        const PackedSiteWeights& weights);
+
+    /**
+     * @return The instruction set currently used.
+     */
+    static InstructionSet getInstructionSet() { return instructionSet_; }
+
+    /**
+     * @brief Set the instruction set to use.
+     *
+     * This is mostly useful to force the scalar version, for instance for testing purposes.
+     *
+     * @param instructionSet The instruction set to use.
+     * @throw Exception If the instruction set is not supported by the processor.
+     */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+    /**
+     * @return True if the given instruction set is supported by the processor.
+     * @param instructionSet The instruction set to check.
+     */
+    static bool isSupported(InstructionSet instructionSet);
+
+  private:
+    static InstructionSet detectInstructionSet_();
+};
+
+} //end of namespace bpp.
+
+#endif //_PARSIMONYKERNELS_H_
+
@@ -0,0 +1,391 @@
+//
+// File: RobinsonFouldsDistance.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:57 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "RobinsonFouldsDistance.h"
+#include "TreeTemplate.h"
+#include "ThreadPool.h"
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Text/TextTools.h>
+
+// From the STL:
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+
+const size_t NONE = numeric_limits<size_t>::max();
+
+struct StackItem
+{
+  const Node* node;
+  const Node* from;
+  size_t father;
+  size_t branches; // The number of branches since the father.
+};
+
+/*
+ * The branch leading to the second son of a root with two sons carries the same bipartition
+ * as the branch leading to the first son, and is not counted (as in BipartitionList).
+ */
+size_t getBranchMultiplicity(const Node* node1, const Node* node2)
+{
+  const Node* father = (node2->hasFather() && node2->getFather() == node1) ? node1 : node2;
+  const Node* son = (father == node1) ? node2 : node1;
+  if (!father->hasFather() && father->getNumberOfSons() == 2 && father->getSon(1) == son)
+    return 0;
+  return 1;
+}
+
+} //end of anonymous namespace.
+
+/******************************************************************************/
+
+RobinsonFouldsDistance::RobinsonFouldsDistance(const std::vector<std::string>& leavesNames, bool countMultiplicities) :
+  elements_(leavesNames),
+  elementIndex_(),
+  countMultiplicities_(countMultiplicities)
+{
+  if (elements_.size() < 2)
+    throw Exception("RobinsonFouldsDistance::RobinsonFouldsDistance. At least two leaves are needed.");
+  sort(elements_.begin(), elements_.end());
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    if (!elementIndex_.insert(make_pair(elements_[i], i)).second)
+      throw Exception("RobinsonFouldsDistance::RobinsonFouldsDistance. Duplicated leaf name: " + elements_[i] + ".");
+  }
+}
+
+/******************************************************************************/
+
+void RobinsonFouldsDistance::getTopology(const Tree& tree, Topology& topology) const
+{
+  unique_ptr< TreeTemplate<Node> > copy;
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  if (!ttree)
+  {
+    copy.reset(new TreeTemplate<Node>(tree));
+    ttree = copy.get();
+  }
+
+  // Find the leaf used as a root:
+  const Node* first = 0;
+  vector<const Node*> nodes = ttree->getNodes();
+  for (size_t i = 0; i < nodes.size() && !first; i++)
+  {
+    if (nodes[i]->getNumberOfSons() == 0 && nodes[i]->getName() == elements_[0])
+      first = nodes[i];
+  }
+  if (!first)
+    throw Exception("RobinsonFouldsDistance::getTopology. Leaf " + elements_[0] + " not found in tree.");
+
+  size_t n = elements_.size();
+  topology.fathers_.clear();
+  topology.leaves_.clear();
+  topology.multiplicities_.clear();
+  topology.nbLeaves_ = n;
+  topology.nbBipartitions_ = 0;
+  vector<bool> found(n, false);
+  size_t nbFound = 0;
+
+  // Preorder traversal, with the tree seen as an unrooted graph:
+  vector<StackItem> stack;
+  StackItem start = { first, 0, NONE, 0 };
+  stack.push_back(start);
+  vector<const Node*> neighbors;
+  while (!stack.empty())
+  {
+    StackItem item = stack.back();
+    stack.pop_back();
+    const Node* node = item.node;
+    neighbors.clear();
+    if (node->hasFather() && node->getFather() != item.from)
+      neighbors.push_back(node->getFather());
+    for (size_t i = 0; i < node->getNumberOfSons(); i++)
+    {
+      if (node->getSon(i) != item.from)
+        neighbors.push_back(node->getSon(i));
+    }
+
+    bool isLeaf = (node->getNumberOfSons() == 0);
+    bool isKept = isLeaf || neighbors.size() >= 2;
+    size_t index = item.father;
+    if (isLeaf)
+    {
+      map<string, size_t>::const_iterator it = elementIndex_.find(node->getName());
+      if (it == elementIndex_.end())
+        throw Exception("RobinsonFouldsDistance::getTopology. Unknown leaf: " + node->getName() + ".");
+      if (found[it->second])
+        throw Exception("RobinsonFouldsDistance::getTopology. Duplicated leaf: " + node->getName() + ".");
+      found[it->second] = true;
+      nbFound++;
+      index = topology.fathers_.size();
+      topology.fathers_.push_back(item.father);
+      topology.leaves_.push_back(it->second);
+      topology.multiplicities_.push_back(item.branches);
+    }
+    else if (isKept)
+    {
+      index = topology.fathers_.size();
+      topology.fathers_.push_back(item.father);
+      topology.leaves_.push_back(NONE);
+      topology.multiplicities_.push_back(item.branches);
+    }
+    // Otherwise, the node has at most one son and is not kept: its branches are merged.
+
+    for (size_t i = neighbors.size(); i > 0; i--)
+    {
+      size_t branches = (isKept ? 0 : item.branches) + getBranchMultiplicity(node, neighbors[i - 1]);
+      StackItem next = { neighbors[i - 1], node, index, branches };
+      stack.push_back(next);
+    }
+  }
+  if (nbFound != n)
+    throw Exception("RobinsonFouldsDistance::getTopology. The tree does not contain all leaves.");
+
+  // Count non-trivial bipartitions:
+  size_t m = topology.fathers_.size();
+  vector<size_t> sizes(m, 0);
+  for (size_t v = m; v > 1; v--)
+  {
+    if (topology.leaves_[v - 1] != NONE)
+      sizes[v - 1]++;
+    else if (sizes[v - 1] >= 2 && sizes[v - 1] + 2 <= n)
+      topology.nbBipartitions_ += (countMultiplicities_ ? topology.multiplicities_[v - 1] : 1);
+    sizes[topology.fathers_[v - 1]] += sizes[v - 1];
+  }
+}
+
+/******************************************************************************/
+
+void RobinsonFouldsDistance::buildClusterTable_(const Topology& topology, ClusterTable& table) const
+{
+  size_t n = topology.nbLeaves_;
+  size_t m = topology.fathers_.size();
+
+  // Leaves are ranked in preorder, so that the leaves of any subtree have consecutive ranks:
+  table.ranks.assign(n, 0);
+  size_t rank = 0;
+  for (size_t v = 0; v < m; v++)
+  {
+    if (topology.leaves_[v] != NONE)
+      table.ranks[topology.leaves_[v]] = rank++;
+  }
+
+  table.sizes.assign(m, 0);
+  table.mins.assign(m, n);
+  for (size_t v = m; v > 0; v--)
+  {
+    size_t leaf = topology.leaves_[v - 1];
+    if (leaf != NONE)
+    {
+      table.sizes[v - 1] = 1;
+      table.mins[v - 1] = table.ranks[leaf];
+    }
+    if (v > 1)
+    {
+      size_t f = topology.fathers_[v - 1];
+      table.sizes[f] += table.sizes[v - 1];
+      table.mins[f] = min(table.mins[f], table.mins[v - 1]);
+    }
+  }
+
+  // Day's tables: an interval is stored at its left bound, unless it shares it with its father,
+  // in which case it is stored at its right bound. In both cases, the position is unique.
+  table.byLeft.assign(n, NONE);
+  table.byRight.assign(n, NONE);
+  table.countsByLeft.assign(n, 0);
+  table.countsByRight.assign(n, 0);
+  for (size_t v = 1; v < m; v++)
+  {
+    size_t size = table.sizes[v];
+    if (topology.leaves_[v] != NONE || size < 2 || size + 2 > n)
+      continue;
+    size_t left = table.mins[v];
+    size_t right = left + size - 1;
+    if (left > table.mins[topology.fathers_[v]])
+    {
+      table.byLeft[left] = right;
+      table.countsByLeft[left] = topology.multiplicities_[v];
+    }
+    else
+    {
+      table.byRight[right] = left;
+      table.countsByRight[right] = topology.multiplicities_[v];
+    }
+  }
+}
+
+/******************************************************************************/
+
+size_t RobinsonFouldsDistance::countSharedBipartitions_(const ClusterTable& table, const Topology& topology, ClusterTable& workspace) const
+{
+  size_t n = topology.nbLeaves_;
+  size_t m = topology.fathers_.size();
+  vector<size_t>& sizes = workspace.sizes;
+  vector<size_t>& mins = workspace.mins;
+  vector<size_t>& maxs = workspace.maxs;
+  sizes.assign(m, 0);
+  mins.assign(m, n);
+  maxs.assign(m, 0);
+
+  size_t nbShared = 0;
+  for (size_t v = m; v > 1; v--)
+  {
+    size_t leaf = topology.leaves_[v - 1];
+    if (leaf != NONE)
+    {
+      sizes[v - 1] = 1;
+      mins[v - 1] = maxs[v - 1] = table.ranks[leaf];
+    }
+    else
+    {
+      size_t size = sizes[v - 1];
+      size_t left = mins[v - 1];
+      size_t right = maxs[v - 1];
+      if (size >= 2 && size + 2 <= n && right - left + 1 == size)
+      {
+        size_t count = 0;
+        if (table.byLeft[left] == right)
+          count = table.countsByLeft[left];
+        else if (table.byRight[right] == left)
+          count = table.countsByRight[right];
+        if (count > 0)
+          nbShared += (countMultiplicities_ ? min(count, topology.multiplicities_[v - 1]) : 1);
+      }
+    }
+    size_t f = topology.fathers_[v - 1];
+    sizes[f] += sizes[v - 1];
+    mins[f] = min(mins[f], mins[v - 1]);
+    maxs[f] = max(maxs[f], maxs[v - 1]);
+  }
+  return nbShared;
+}
+
+/******************************************************************************/
+
+size_t RobinsonFouldsDistance::getDistance(const Topology& topology1, const Topology& topology2, size_t* missingIn2, size_t* missingIn1) const
+{
+  if (topology1.nbLeaves_ != elements_.size() || topology2.nbLeaves_ != elements_.size())
+    throw Exception("RobinsonFouldsDistance::getDistance. Topologies do not have the expected number of leaves.");
+  ClusterTable table, workspace;
+  buildClusterTable_(topology1, table);
+  size_t nbShared = countSharedBipartitions_(table, topology2, workspace);
+  size_t missing2 = topology1.nbBipartitions_ - nbShared;
+  size_t missing1 = topology2.nbBipartitions_ - nbShared;
+  if (missingIn2)
+    *missingIn2 = missing2;
+  if (missingIn1)
+    *missingIn1 = missing1;
+  return missing1 + missing2;
+}
+
+/******************************************************************************/
+
+size_t RobinsonFouldsDistance::getDistance(const Tree& tree1, const Tree& tree2, size_t* missingIn2, size_t* missingIn1) const
+{
+  Topology topology1, topology2;
+  getTopology(tree1, topology1);
+  getTopology(tree2, topology2);
+  return getDistance(topology1, topology2, missingIn2, missingIn1);
+}
+
+/******************************************************************************/
+
+DistanceMatrix* RobinsonFouldsDistance::getDistanceMatrix(const std::vector<Tree*>& trees, size_t nbThreads) const
+{
+  size_t nbTrees = trees.size();
+  unique_ptr<ThreadPool> pool;
+  if (nbThreads != 1 && nbTrees > 2)
+  {
+    pool.reset(new ThreadPool(nbThreads));
+    if (pool->getNumberOfThreads() == 1)
+      pool.reset();
+  }
+
+  vector<Topology> topologies(nbTrees);
+  ThreadPool::parallelFor(pool.get(), nbTrees, [&] (size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+    {
+      getTopology(*trees[i], topologies[i]);
+    }
+  });
+
+  vector<string> names(nbTrees);
+  for (size_t i = 0; i < nbTrees; i++)
+  {
+    names[i] = "Tree" + TextTools::toString(i + 1);
+  }
+  DistanceMatrix* mat = new DistanceMatrix(names);
+
+  // Rows have different sizes, they are therefore processed as independent tasks:
+  function<void (size_t)> computeRow = [&] (size_t i)
+  {
+    ClusterTable table, workspace;
+    buildClusterTable_(topologies[i], table);
+    (*mat)(i, i) = 0;
+    for (size_t j = i + 1; j < nbTrees; j++)
+    {
+      size_t nbShared = countSharedBipartitions_(table, topologies[j], workspace);
+      size_t d = topologies[i].nbBipartitions_ + topologies[j].nbBipartitions_ - 2 * nbShared;
+      (*mat)(i, j) = (*mat)(j, i) = static_cast<double>(d);
+    }
+  };
+  if (pool)
+    pool->run(nbTrees, computeRow);
+  else
+  {
+    for (size_t i = 0; i < nbTrees; i++)
+    {
+      computeRow(i);
+    }
+  }
+  return mat;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,201 @@
+//
+// File: RobinsonFouldsDistance.h
+// Created by: agent
+// Created on: Fri Oct 16 20:57 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _ROBINSONFOULDSDISTANCE_H_
+#define _ROBINSONFOULDSDISTANCE_H_
+
+#include "Tree.h"
+
+#include <Bpp/Seq/DistanceMatrix.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <map>
+
+namespace bpp
+{
+
+/**
+ * @brief Compute Robinson-Foulds distances in linear time.
+ *
+ * This class implements Day's algorithm (Day, J. Classif. 1985): both trees are rerooted on the same leaf (the first one in alphabetic order),
+ * and leaves are ranked in the order they are visited in the first tree. Each bipartition of the first tree
+ * then corresponds to an interval of ranks, which are stored in two tables of size n.
+ * Checking if a bipartition of the second tree is also present in the first one takes constant time,
+ * so that the distance between two trees with n leaves is computed in O(n).
+ *
+ * Leaf names are indexed once, when the object is built, and trees are converted to a compact
+ * representation (see Topology), which can be reused for several comparisons.
+ * This is how all pairwise distances in a set of trees are computed by getDistanceMatrix().
+ *
+ * Only non-trivial bipartitions are considered, and the position of the root, if any, is ignored.
+ * By default, bipartitions are compared as sets. If multiplicities are counted, a bipartition found on several
+ * branches of a tree (as with nodes with only one son) is counted once per branch, and two trees share
+ * the minimum of the two numbers of occurrences. This is what TreeTools::robinsonFouldsDistance does.
+ *
+ * @see TreeTools::robinsonFouldsDistance
+ */
+class RobinsonFouldsDistance
+{
+  public:
+    /**
+     * @brief A compact representation of a tree topology, rooted on the first leaf.
+     *
+     * Nodes are stored in preorder, each one with the index of its father (the first node, that is the leaf used as a root, has none)
+     * and, for leaves, the index of their name. Nodes with only one son are removed, and the number of branches
+     * of the original tree merged into each branch is recorded.
+     */
+    class Topology
+    {
+      private:
+        std::vector<size_t> fathers_;
+        std::vector<size_t> leaves_;
+        std::vector<size_t> multiplicities_;
+        size_t nbLeaves_;
+        size_t nbBipartitions_;
+
+      public:
+        Topology() : fathers_(), leaves_(), multiplicities_(), nbLeaves_(0), nbBipartitions_(0) {}
+
+      public:
+        /**
+         * @return The number of non-trivial bipartitions in the tree, counted with their multiplicity
+         * if the calculator used to build this topology does so.
+         */
+        size_t getNumberOfBipartitions() const { return nbBipartitions_; }
+
+        size_t getNumberOfLeaves() const { return nbLeaves_; }
+
+        friend class RobinsonFouldsDistance;
+    };
+
+  private:
+    std::vector<std::string> elements_;
+    std::map<std::string, size_t> elementIndex_;
+    bool countMultiplicities_;
+
+  public:
+    /**
+     * @brief Build a new calculator.
+     *
+     * @param leavesNames The names of the leaves of the trees to compare.
+     * @param countMultiplicities Tell if bipartitions found on several branches of a tree should be counted several times.
+     */
+    RobinsonFouldsDistance(const std::vector<std::string>& leavesNames, bool countMultiplicities = false);
+
+    virtual ~RobinsonFouldsDistance() {}
+
+  public:
+    /**
+     * @return The names of the leaves, in alphabetic order.
+     */
+    const std::vector<std::string>& getElementNames() const { return elements_; }
+
+    /**
+     * @brief Compute the compact representation of a tree.
+     *
+     * @param tree     The input tree.
+     * @param topology [out] The topology of the tree.
+     * @throw Exception If the tree does not have the same leaves as the ones used to build this object.
+     */
+    void getTopology(const Tree& tree, Topology& topology) const;
+
+    /**
+     * @brief Compute the Robinson-Foulds distance between two topologies.
+     *
+     * @param topology1 The first topology.
+     * @param topology2 The second topology.
+     * @param missingIn2 [out] If not null, the number of bipartitions occurring in the first tree but not the second.
+     * @param missingIn1 [out] If not null, the number of bipartitions occurring in the second tree but not the first.
+     * @return The Robinson-Foulds distance, that is the total number of bipartitions found in only one of the two trees.
+     */
+    size_t getDistance(const Topology& topology1, const Topology& topology2, size_t* missingIn2 = 0, size_t* missingIn1 = 0) const;
+
+    /**
+     * @brief Compute the Robinson-Foulds distance between two trees.
+     *
+     * @param tree1 The first tree.
+     * @param tree2 The second tree.
+     * @param missingIn2 [out] If not null, the number of bipartitions occurring in the first tree but not the second.
+     * @param missingIn1 [out] If not null, the number of bipartitions occurring in the second tree but not the first.
+     * @return The Robinson-Foulds distance.
+     * @throw Exception If the trees do not have the same leaves as the ones used to build this object.
+     */
+    size_t getDistance(const Tree& tree1, const Tree& tree2, size_t* missingIn2 = 0, size_t* missingIn1 = 0) const;
+
+    /**
+     * @brief Compute all pairwise Robinson-Foulds distances in a set of trees.
+     *
+     * Each tree is converted only once. Rows of the matrix are computed in parallel
+     * if several threads are used.
+     *
+     * @param trees     The input trees.
+     * @param nbThreads The number of threads to use (0 means the number of hardware threads).
+     * @return A new distance matrix, with trees named "Tree1", "Tree2", etc.
+     * @throw Exception If the trees do not have the same leaves as the ones used to build this object.
+     */
+    DistanceMatrix* getDistanceMatrix(const std::vector<Tree*>& trees, size_t nbThreads = 1) const;
+
+  private:
+    /*
+     * Intervals of ranks corresponding to the bipartitions of a reference topology.
+     */
+    struct ClusterTable
+    {
+      std::vector<size_t> ranks;   // The rank of each leaf, indexed by element.
+      std::vector<size_t> byLeft;  // byLeft[l] = r if [l, r] is stored as a left bound.
+      std::vector<size_t> byRight; // byRight[r] = l if [l, r] is stored as a right bound.
+      std::vector<size_t> countsByLeft;  // The multiplicity of the interval stored at byLeft[l].
+      std::vector<size_t> countsByRight; // The multiplicity of the interval stored at byRight[r].
+      std::vector<size_t> sizes;
+      std::vector<size_t> mins;
+      std::vector<size_t> maxs;
+
+      ClusterTable() : ranks(), byLeft(), byRight(), countsByLeft(), countsByRight(), sizes(), mins(), maxs() {}
+    };
+
+    void buildClusterTable_(const Topology& topology, ClusterTable& table) const;
+    size_t countSharedBipartitions_(const ClusterTable& table, const Topology& topology, ClusterTable& workspace) const;
+};
+
+} //end of namespace bpp.
+
+#endif //_ROBINSONFOULDSDISTANCE_H_
+
@@ -41,6 +41,7 @@
 
 #include "NonHomogeneousSequenceSimulator.h"
 #include "../Model/SubstitutionModelSetTools.h"
+#include "../ThreadPool.h"
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -49,11 +50,23 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <random>
+#include <memory>
+#include <map>
+#include <limits>
+#include <functional>
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
+const size_t NonHomogeneousSequenceSimulator::BLOCK_SIZE = 4096;
+
+/******************************************************************************/
+
 NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   const SubstitutionModelSet* modelSet,
   const DiscreteDistribution* rate,
@@ -71,7 +84,9 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(modelSet_->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  blockSimulation_(false),
+  nbThreads_(1)
 {
   if (!modelSet->isFullySetUpFor(*tree))
     throw Exception("NonHomogeneousSequenceSimulator(constructor). Model set is not fully specified.");
@@ -97,7 +112,9 @@ NonHomogeneousSequenceSimulator::NonHomogeneousSequenceSimulator(
   nbClasses_(rate_->getNumberOfCategories()),
   nbStates_(model->getNumberOfStates()),
   continuousRates_(false),
-  outputInternalSequences_(false)
+  outputInternalSequences_(false),
+  blockSimulation_(false),
+  nbThreads_(1)
 {
   FixedFrequencySet* fSet = new FixedFrequencySet(model->shareStateMap(), model->getFrequencies());
   fSet->setNamespace("anc.");
@@ -141,6 +158,11 @@ void NonHomogeneousSequenceSimulator::init()
     double d = node->getDistanceToFather();
     VVVdouble* cumpxy_node_ = &node->getInfos().cumpxy;
     cumpxy_node_->resize(nbClasses_);
+    vector<double>* aliasProb = &node->getInfos().aliasProb;
+    vector<size_t>* alias = &node->getInfos().alias;
+    aliasProb->resize(nbClasses_ * nbStates_ * nbStates_);
+    alias->resize(nbClasses_ * nbStates_ * nbStates_);
+    Vdouble pxy(nbStates_);
     for (size_t c = 0; c < nbClasses_; c++)
     {
       VVdouble* cumpxy_node_c_ = &(*cumpxy_node_)[c];
@@ -155,6 +177,12 @@ void NonHomogeneousSequenceSimulator::init()
         {
           (*cumpxy_node_c_x_)[y] = (*cumpxy_node_c_x_)[y - 1] + P(x, y);
         }
+        for (size_t y = 0; y < nbStates_; y++)
+        {
+          pxy[y] = P(x, y);
+        }
+        size_t offset = (c * nbStates_ + x) * nbStates_;
+        buildAliasTable_(&pxy[0], nbStates_, &(*aliasProb)[offset], &(*alias)[offset]);
       }
     }
   }
@@ -305,6 +333,9 @@ Site* NonHomogeneousSequenceSimulator::simulateSite(double rate) const
 
 SiteContainer* NonHomogeneousSequenceSimulator::simulate(size_t numberOfSites) const
 {
+  if (!continuousRates_ && blockSimulation_)
+    return simulateByBlocks_(numberOfSites);
+
   vector<size_t> ancestralStateIndices(numberOfSites, 0);
   for (size_t j = 0; j < numberOfSites; j++)
   {
@@ -658,3 +689,187 @@ void NonHomogeneousSequenceSimulator::outputInternalSequences(bool yn) {
 }
 
 /******************************************************************************/
+
+SiteContainer* NonHomogeneousSequenceSimulator::simulateByBlocks_(size_t numberOfSites) const
+{
+  // Nodes are stored in postorder, so that fathers come after their sons, the root being the last one:
+  vector<SNode*> nodes = tree_.getNodes();
+  size_t nbAllNodes = nodes.size();
+  map<int, size_t> indices;
+  for (size_t i = 0; i < nbAllNodes; i++)
+  {
+    indices[nodes[i]->getId()] = i;
+  }
+  vector<size_t> fathers(nbAllNodes - 1);
+  for (size_t i = 0; i < nbAllNodes - 1; i++)
+  {
+    fathers[i] = indices[nodes[i]->getFather()->getId()];
+  }
+
+  // Sequences to output, and the alphabet states corresponding to each model state.
+  // As the root has no model, we take the one of the previous node.
+  vector<size_t> outputNodes;
+  vector<string> outputNames;
+  if (outputInternalSequences_)
+  {
+    for (size_t i = 0; i < nbAllNodes; i++)
+    {
+      outputNodes.push_back(i);
+      outputNames.push_back(nodes[i]->isLeaf() ? nodes[i]->getName() : TextTools::toString(nodes[i]->getId()));
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < leaves_.size(); i++)
+    {
+      outputNodes.push_back(indices[leaves_[i]->getId()]);
+      outputNames.push_back(leaves_[i]->getName());
+    }
+  }
+  size_t nbOutput = outputNodes.size();
+  vector<Vint> outputStates(nbOutput, Vint(nbStates_));
+  for (size_t k = 0; k < nbOutput; k++)
+  {
+    size_t i = outputNodes[k];
+    const TransitionModel* model = nodes[i < nbAllNodes - 1 ? i : i - 1]->getInfos().model;
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      outputStates[k][x] = model->getAlphabetStateAsInt(x);
+    }
+  }
+
+  vector<double> rootProb(nbStates_);
+  vector<size_t> rootAlias(nbStates_);
+  vector<double> freqs = modelSet_->getRootFrequencies();
+  buildAliasTable_(&freqs[0], nbStates_, &rootProb[0], &rootAlias[0]);
+
+  // One seed per block, so that results do not depend on the number of threads:
+  size_t nbBlocks = (numberOfSites + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  vector<unsigned int> seeds(nbBlocks);
+  for (size_t b = 0; b < nbBlocks; b++)
+  {
+    seeds[b] = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<unsigned int>(numeric_limits<unsigned int>::max());
+  }
+
+  // Simulated states, site by site:
+  Vint contents(numberOfSites * nbOutput);
+  function<void (size_t)> simulateBlock = [&](size_t b) {
+      size_t begin = b * BLOCK_SIZE;
+      size_t len = min(BLOCK_SIZE, numberOfSites - begin);
+      mt19937 generator(seeds[b]);
+      uniform_real_distribution<double> uniform(0., 1.);
+
+      // States of all nodes for all sites in the block:
+      vector<size_t> states(nbAllNodes * len);
+      vector<size_t> rateClasses(len);
+      size_t* rootStates = &states[(nbAllNodes - 1) * len];
+      for (size_t j = 0; j < len; j++)
+      {
+        rootStates[j] = drawFromAliasTable_(&rootProb[0], &rootAlias[0], nbStates_, uniform(generator));
+        rateClasses[j] = min(static_cast<size_t>(uniform(generator) * static_cast<double>(nbClasses_)), nbClasses_ - 1);
+      }
+      for (size_t i = nbAllNodes - 1; i > 0; i--)
+      {
+        const SimData& infos = nodes[i - 1]->getInfos();
+        const double* aliasProb = &infos.aliasProb[0];
+        const size_t* alias = &infos.alias[0];
+        const size_t* fatherStates = &states[fathers[i - 1] * len];
+        size_t* nodeStates = &states[(i - 1) * len];
+        for (size_t j = 0; j < len; j++)
+        {
+          size_t offset = (rateClasses[j] * nbStates_ + fatherStates[j]) * nbStates_;
+          nodeStates[j] = drawFromAliasTable_(aliasProb + offset, alias + offset, nbStates_, uniform(generator));
+        }
+      }
+
+      for (size_t k = 0; k < nbOutput; k++)
+      {
+        const size_t* nodeStates = &states[outputNodes[k] * len];
+        const Vint& alphabetStates = outputStates[k];
+        int* content = &contents[begin * nbOutput + k];
+        for (size_t j = 0; j < len; j++)
+        {
+          content[j * nbOutput] = alphabetStates[nodeStates[j]];
+        }
+      }
+    };
+
+  unique_ptr<ThreadPool> pool;
+  if (nbThreads_ != 1 && nbBlocks > 1)
+  {
+    pool.reset(new ThreadPool(nbThreads_));
+    if (pool->getNumberOfThreads() == 1)
+      pool.reset();
+  }
+  if (pool)
+    pool->run(nbBlocks, simulateBlock);
+  else
+  {
+    for (size_t b = 0; b < nbBlocks; b++)
+    {
+      simulateBlock(b);
+    }
+  }
+
+  // Now create a SiteContainer object.
+  // The container has no public access to its storage: each site is copied by addSite(),
+  // so a single Site object is reused for all columns.
+  VectorSiteContainer* sites = new VectorSiteContainer(nbOutput, alphabet_);
+  sites->setSequencesNames(outputNames, false);
+  Vint content(nbOutput);
+  Site site(alphabet_);
+  for (size_t j = 0; j < numberOfSites; j++)
+  {
+    copy(contents.begin() + static_cast<ptrdiff_t>(j * nbOutput), contents.begin() + static_cast<ptrdiff_t>((j + 1) * nbOutput), content.begin());
+    site.setContent(content);
+    site.setPosition(static_cast<int>(j));
+    sites->addSite(site, false);
+  }
+  return sites;
+}
+
+/******************************************************************************/
+
+void NonHomogeneousSequenceSimulator::buildAliasTable_(const double* p, size_t n, double* prob, size_t* alias)
+{
+  double sum = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    sum += p[i];
+  }
+  vector<size_t> smallValues, largeValues;
+  for (size_t i = 0; i < n; i++)
+  {
+    prob[i] = p[i] * static_cast<double>(n) / sum;
+    alias[i] = i;
+    if (prob[i] < 1.)
+      smallValues.push_back(i);
+    else
+      largeValues.push_back(i);
+  }
+  while (!smallValues.empty() && !largeValues.empty())
+  {
+    size_t s = smallValues.back();
+    smallValues.pop_back();
+    size_t l = largeValues.back();
+    alias[s] = l;
+    prob[l] -= 1. - prob[s];
+    if (prob[l] < 1.)
+    {
+      largeValues.pop_back();
+      smallValues.push_back(l);
+    }
+  }
+  // Remaining values only differ from 1 because of rounding errors:
+  for (size_t i = 0; i < smallValues.size(); i++)
+  {
+    prob[smallValues[i]] = 1.;
+  }
+  for (size_t i = 0; i < largeValues.size(); i++)
+  {
+    prob[largeValues[i]] = 1.;
+  }
+}
+
+/******************************************************************************/
+
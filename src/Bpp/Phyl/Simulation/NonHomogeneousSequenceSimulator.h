@@ -70,17 +70,28 @@ class SimData
     size_t state;
     std::vector<size_t> states;
     VVVdouble cumpxy;
+
+    /**
+     * @brief Alias tables for the transition probabilities of the branch.
+     *
+     * The table for rate class c and initial state x starts at index (c * n + x) * n,
+     * where n is the number of states. See NonHomogeneousSequenceSimulator::drawFromAliasTable_.
+     */
+    std::vector<double> aliasProb;
+    std::vector<size_t> alias;
     const TransitionModel* model;
 
   public:
-    SimData(): state(), states(), cumpxy(), model(0) {}
-    SimData(const SimData& sd): state(sd.state), states(sd.states), cumpxy(), model(sd.model) {}
+    SimData(): state(), states(), cumpxy(), aliasProb(), alias(), model(0) {}
+    SimData(const SimData& sd): state(sd.state), states(sd.states), cumpxy(sd.cumpxy), aliasProb(sd.aliasProb), alias(sd.alias), model(sd.model) {}
     SimData& operator=(const SimData& sd)
     {
-      state  = sd.state;
-      states = sd.states;
-      cumpxy = sd.cumpxy;
-      model  = sd.model;
+      state     = sd.state;
+      states    = sd.states;
+      cumpxy    = sd.cumpxy;
+      aliasProb = sd.aliasProb;
+      alias     = sd.alias;
+      model     = sd.model;
       return *this;
     }
 };
@@ -91,6 +102,15 @@ typedef NodeTemplate<SimData> SNode;
  * @brief Site and sequences simulation under non-homogeneous models.
  *
  * Rate across sites variation is supported, using a DiscreteDistribution object or by specifying explicitely the rate of the sites to simulate.
+ *
+ * When discrete rates are used, the simulate() method can work on blocks of sites (see enableBlockSimulation()):
+ * all sites of a block are evolved along a branch before the next branch is considered,
+ * and states are drawn in constant time using alias tables computed once for each branch,
+ * rate class and initial state. Blocks can be simulated in parallel, see setNumberOfThreads().
+ * Each block uses its own random number generator, seeded using RandomTools,
+ * so that the simulated data set only depends on the seed of RandomTools,
+ * whatever the number of threads. It is however not the same as the one obtained
+ * with the default algorithm.
  */
 class NonHomogeneousSequenceSimulator:
   public DetailedSiteSimulator,
@@ -122,6 +142,14 @@ class NonHomogeneousSequenceSimulator:
     // Should we ouptut internal sequences as well?
     bool outputInternalSequences_;
 
+    bool blockSimulation_;
+    size_t nbThreads_;
+
+    /**
+     * @brief Number of sites simulated together in simulate().
+     */
+    static const size_t BLOCK_SIZE;
+
     /**
      * @name Stores intermediate results.
      *
@@ -160,7 +188,9 @@ class NonHomogeneousSequenceSimulator:
       nbClasses_      (nhss.nbClasses_),
       nbStates_       (nhss.nbStates_),
       continuousRates_(nhss.continuousRates_),
-      outputInternalSequences_(nhss.outputInternalSequences_)
+      outputInternalSequences_(nhss.outputInternalSequences_),
+      blockSimulation_(nhss.blockSimulation_),
+      nbThreads_      (nhss.nbThreads_)
     {}
 
     NonHomogeneousSequenceSimulator& operator=(const NonHomogeneousSequenceSimulator& nhss)
@@ -179,6 +209,8 @@ class NonHomogeneousSequenceSimulator:
       nbStates_        = nhss.nbStates_;
       continuousRates_ = nhss.continuousRates_;
       outputInternalSequences_ = nhss.outputInternalSequences_;
+      blockSimulation_ = nhss.blockSimulation_;
+      nbThreads_       = nhss.nbThreads_;
       return *this;
     }
 
@@ -287,6 +319,31 @@ class NonHomogeneousSequenceSimulator:
      */
     void outputInternalSequences(bool yn) ;
 
+    /**
+     * @brief Tell if simulate() should work on blocks of sites, when discrete rates are used.
+     *
+     * This is faster on large data sets, and allows multithreading, but a given seed
+     * of RandomTools does not give the same data set as the default algorithm.
+     *
+     * @param yn Tell if sites should be simulated by blocks (false by default).
+     */
+    void enableBlockSimulation(bool yn) { blockSimulation_ = yn; }
+
+    bool isBlockSimulationEnabled() const { return blockSimulation_; }
+
+    /**
+     * @brief Set the number of threads used by simulate() with discrete rates, when sites are simulated by blocks.
+     *
+     * @param nbThreads The number of threads to use. 1 (the default) disables multithreading,
+     * 0 uses as many threads as available on the machine.
+     */
+    void setNumberOfThreads(size_t nbThreads) { nbThreads_ = nbThreads; }
+
+    /**
+     * @return The number of threads used, 0 meaning as many as available.
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
+
 
   protected:
 
@@ -348,6 +405,42 @@ class NonHomogeneousSequenceSimulator:
     void dEvolveInternal(SNode * node, double rate, RASiteSimulationResult & rassr) const;
     /** @} */
 
+  private:
+    /**
+     * @brief Simulate sites with discrete rates, by blocks of BLOCK_SIZE sites.
+     *
+     * @param numberOfSites The number of sites to simulate.
+     * @return A container with the simulated sequences.
+     */
+    SiteContainer* simulateByBlocks_(size_t numberOfSites) const;
+
+    /**
+     * @brief Build an alias table (Walker's method, as described by Vose 1991).
+     *
+     * @param p      The n probabilities of the distribution. They are normalized if needed.
+     * @param n      The number of values.
+     * @param prob   [out] The n probabilities of keeping each value.
+     * @param alias  [out] The n alternative values.
+     */
+    static void buildAliasTable_(const double* p, size_t n, double* prob, size_t* alias);
+
+    /**
+     * @brief Draw a value from an alias table.
+     *
+     * @param prob  The probabilities of the alias table.
+     * @param alias The alternative values of the alias table.
+     * @param n     The number of values.
+     * @param u     A random number in [0, 1).
+     * @return The value drawn.
+     */
+    static size_t drawFromAliasTable_(const double* prob, const size_t* alias, size_t n, double u)
+    {
+      double x = u * static_cast<double>(n);
+      size_t k = static_cast<size_t>(x);
+      if (k >= n) k = n - 1;
+      return x - static_cast<double>(k) < prob[k] ? k : alias[k];
+    }
+
 };
 
 } //end of namespace bpp.
@@ -0,0 +1,174 @@
+//
+// File: ThreadPool.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:19 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "ThreadPool.h"
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+ThreadPool::ThreadPool(size_t nbThreads) :
+  workers_(),
+  mutex_(),
+  taskAvailable_(),
+  tasksDone_(),
+  task_(0),
+  nbTasks_(0),
+  nextTask_(0),
+  nbTasksDone_(0),
+  generation_(0),
+  busy_(false),
+  stop_(false),
+  exception_()
+{
+  if (nbThreads == 0)
+    nbThreads = static_cast<size_t>(thread::hardware_concurrency());
+  for (size_t i = 1; i < nbThreads; i++)
+  {
+    workers_.push_back(thread(&ThreadPool::workerLoop_, this));
+  }
+}
+
+/******************************************************************************/
+
+ThreadPool::~ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  taskAvailable_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+  {
+    workers_[i].join();
+  }
+}
+
+/******************************************************************************/
+
+void ThreadPool::run(size_t nbTasks, const std::function<void (size_t)>& task)
+{
+  unique_lock<mutex> lock(mutex_);
+  if (busy_ || workers_.empty() || nbTasks < 2)
+  {
+    // Sequential execution:
+    lock.unlock();
+    for (size_t i = 0; i < nbTasks; i++)
+    {
+      task(i);
+    }
+    return;
+  }
+  busy_        = true;
+  task_        = &task;
+  nbTasks_     = nbTasks;
+  nextTask_    = 0;
+  nbTasksDone_ = 0;
+  exception_   = exception_ptr();
+  generation_++;
+  taskAvailable_.notify_all();
+  executeTasks_(lock);
+  tasksDone_.wait(lock, [this] { return nbTasksDone_ == nbTasks_; });
+  exception_ptr exception = exception_;
+  exception_ = exception_ptr();
+  task_ = 0;
+  busy_ = false;
+  lock.unlock();
+  if (exception)
+    rethrow_exception(exception);
+}
+
+/******************************************************************************/
+
+void ThreadPool::parallelFor(size_t n, const std::function<void (size_t, size_t)>& task)
+{
+  if (n == 0) return;
+  size_t nbChunks = min(n, getNumberOfThreads());
+  run(nbChunks, [n, nbChunks, &task] (size_t chunk) {
+    size_t begin, end;
+    getChunkBounds(n, nbChunks, chunk, begin, end);
+    task(begin, end);
+  });
+}
+
+/******************************************************************************/
+
+void ThreadPool::workerLoop_()
+{
+  size_t generation = 0;
+  unique_lock<mutex> lock(mutex_);
+  while (true)
+  {
+    taskAvailable_.wait(lock, [this, generation] { return stop_ || generation_ != generation; });
+    if (stop_) return;
+    generation = generation_;
+    executeTasks_(lock);
+  }
+}
+
+/******************************************************************************/
+
+void ThreadPool::executeTasks_(std::unique_lock<std::mutex>& lock)
+{
+  while (task_ && nextTask_ < nbTasks_)
+  {
+    size_t i = nextTask_++;
+    const std::function<void (size_t)>* task = task_;
+    lock.unlock();
+    exception_ptr exception;
+    try
+    {
+      (*task)(i);
+    }
+    catch (...)
+    {
+      exception = current_exception();
+    }
+    lock.lock();
+    if (exception && !exception_)
+      exception_ = exception;
+    nbTasksDone_++;
+    if (nbTasksDone_ == nbTasks_)
+      tasksDone_.notify_all();
+  }
+}
+
+/******************************************************************************/
+
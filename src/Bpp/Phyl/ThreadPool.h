@@ -0,0 +1,167 @@
+//
+// File: ThreadPool.h
+// Created by: agent
+// Created on: Fri Oct 16 20:19 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+// From the STL:
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace bpp
+{
+
+/**
+ * @brief A simple pool of threads, used to split loops over independent items (typically sites).
+ *
+ * Threads are created once, when the pool is built, and wait for work.
+ * The calling thread always takes part in the computation, so that a pool with
+ * n threads only creates n - 1 additional threads.
+ *
+ * Work is always split in the same way for a given number of items and number of threads,
+ * so that results do not depend on scheduling. Callers which need to reduce results
+ * (sums, products...) should store them per item or per chunk, and combine them
+ * in a fixed order once the parallel section is over. Results are then the same for any
+ * number of threads, as long as the same instruction set is used: vectorized code
+ * may sum terms in a different order than scalar code (see LikelihoodKernels).
+ *
+ * If the pool is already busy (for instance if run() is called from within a task),
+ * tasks are executed sequentially by the calling thread.
+ */
+class ThreadPool
+{
+  private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable taskAvailable_;
+    std::condition_variable tasksDone_;
+    const std::function<void (size_t)>* task_;
+    size_t nbTasks_;
+    size_t nextTask_;
+    size_t nbTasksDone_;
+    size_t generation_;
+    bool busy_;
+    bool stop_;
+    std::exception_ptr exception_;
+
+  public:
+    /**
+     * @brief Build a new pool.
+     *
+     * @param nbThreads The total number of threads to use, including the calling one.
+     * 0 means the number of hardware threads available.
+     */
+    ThreadPool(size_t nbThreads);
+
+    virtual ~ThreadPool();
+
+  private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+  public:
+    /**
+     * @return The total number of threads used, including the calling one.
+     */
+    size_t getNumberOfThreads() const { return workers_.size() + 1; }
+
+    /**
+     * @brief Run nbTasks tasks, and return once they are all completed.
+     *
+     * @param nbTasks The number of tasks.
+     * @param task    The function to call, with the task index as argument.
+     * If one or several tasks throw an exception, the first one caught is rethrown once all tasks are done.
+     */
+    void run(size_t nbTasks, const std::function<void (size_t)>& task);
+
+    /**
+     * @brief Split the range [0, n) in contiguous chunks, one per thread, and process them in parallel.
+     *
+     * @param n    The number of items.
+     * @param task The function to call, with the bounds [begin, end) of the chunk as arguments.
+     */
+    void parallelFor(size_t n, const std::function<void (size_t, size_t)>& task);
+
+    /**
+     * @brief Same as parallelFor, but works sequentially if no pool is provided.
+     *
+     * @param pool A pointer toward a thread pool, possibly null.
+     * @param n    The number of items.
+     * @param task The function to call, with the bounds [begin, end) of the chunk as arguments.
+     */
+    static void parallelFor(ThreadPool* pool, size_t n, const std::function<void (size_t, size_t)>& task)
+    {
+      if (pool)
+        pool->parallelFor(n, task);
+      else if (n > 0)
+        task(0, n);
+    }
+
+    /**
+     * @brief Compute the bounds of a chunk.
+     *
+     * The range [0, n) is split into nbChunks parts whose sizes differ by at most one.
+     *
+     * @param n        The number of items.
+     * @param nbChunks The number of chunks.
+     * @param chunk    The index of the chunk.
+     * @param begin    [out] The first item of the chunk.
+     * @param end      [out] The item after the last one in the chunk.
+     */
+    static void getChunkBounds(size_t n, size_t nbChunks, size_t chunk, size_t& begin, size_t& end)
+    {
+      size_t size = n / nbChunks;
+      size_t remainder = n % nbChunks;
+      begin = chunk * size + (chunk < remainder ? chunk : remainder);
+      end = begin + size + (chunk < remainder ? 1 : 0);
+    }
+
+  private:
+    void workerLoop_();
+    void executeTasks_(std::unique_lock<std::mutex>& lock);
+};
+
+} //end of namespace bpp.
+
+#endif //_THREADPOOL_H_
+
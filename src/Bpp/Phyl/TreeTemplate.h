@@ -49,6 +49,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace bpp
 {
@@ -84,6 +89,16 @@ namespace bpp
  * The TreeTools::getMaxId() method may also prove useful in this respect.
  * The resetNodesId() method can also be used to re-initialize all ids.
  *
+ * Nodes are retrieved by id in constant time, using an index which is built on first use.
+ * The index is stored in a vector if ids are compact, in a hash table otherwise.
+ * Each tree has its own modification counter, which is shared with its nodes when the index is built.
+ * The index is rebuilt automatically after any node of the tree has been modified (see getRevision()),
+ * so that it always remains consistent with the tree, even if nodes are edited directly.
+ * Modifications of the nodes of other trees do not affect the index.
+ * Const methods can be called concurrently, as long as no node is modified at the same time.
+ * For debugging purposes, setNodeIndexValidation() can be used to check each indexed lookup
+ * against a full search of the tree.
+ *
  * @see Node
  * @see NodeTemplate
  * @see TreeTools
@@ -100,14 +115,35 @@ private:
   N* root_;
   std::string name_;
 
+  /**
+   * @brief Index of nodes by id.
+   *
+   * Only one of the dense (vector, offset by minIndexedId_) or sparse (hash table) index is used.
+   * The index is valid if indexRevision_ is equal to the value of revision_, the modification
+   * counter of the tree, which is shared with all indexed nodes.
+   * It is 0 if the index has never been built, or is being rebuilt.
+   */
+  mutable std::vector<N*> denseNodeIndex_;
+  mutable std::unordered_map<int, N*> sparseNodeIndex_;
+  mutable int minIndexedId_;
+  std::shared_ptr< std::atomic<unsigned long> > revision_;
+  mutable std::atomic<unsigned long> indexRevision_;
+  mutable std::atomic<unsigned int> nbActiveLookups_;
+  mutable std::mutex indexMutex_;
+  bool validateNodeIndex_;
+
 public:
   // Constructors and destructor:
   TreeTemplate() : root_(0),
-    name_() {}
+    name_(),
+    denseNodeIndex_(), sparseNodeIndex_(), minIndexedId_(0),
+    revision_(newRevisionCounter_()), indexRevision_(0), nbActiveLookups_(0), indexMutex_(), validateNodeIndex_(false) {}
 
   TreeTemplate(const TreeTemplate<N>& t) :
     root_(0),
-    name_(t.name_)
+    name_(t.name_),
+    denseNodeIndex_(), sparseNodeIndex_(), minIndexedId_(0),
+    revision_(newRevisionCounter_()), indexRevision_(0), nbActiveLookups_(0), indexMutex_(), validateNodeIndex_(t.validateNodeIndex_)
   {
     // Perform a hard copy of the nodes:
     root_ = TreeTemplateTools::cloneSubtree<N>(*t.getRootNode());
@@ -115,14 +151,18 @@ public:
 
   TreeTemplate(const Tree& t) :
     root_(0),
-    name_(t.getName())
+    name_(t.getName()),
+    denseNodeIndex_(), sparseNodeIndex_(), minIndexedId_(0),
+    revision_(newRevisionCounter_()), indexRevision_(0), nbActiveLookups_(0), indexMutex_(), validateNodeIndex_(false)
   {
     // Create new nodes from an existing tree:
     root_ = TreeTemplateTools::cloneSubtree<N>(t, t.getRootId());
   }
 
   TreeTemplate(N* root) : root_(root),
-    name_()
+    name_(),
+    denseNodeIndex_(), sparseNodeIndex_(), minIndexedId_(0),
+    revision_(newRevisionCounter_()), indexRevision_(0), nbActiveLookups_(0), indexMutex_(), validateNodeIndex_(false)
   {
     root_->removeFather(); // In case this is a subtree from somewhere else...
   }
@@ -133,6 +173,8 @@ public:
     if (root_) { TreeTemplateTools::deleteSubtree(root_); delete root_; }
     root_ = TreeTemplateTools::cloneSubtree<N>(*t.getRootNode());
     name_ = t.name_;
+    validateNodeIndex_ = t.validateNodeIndex_;
+    invalidateNodeIndex_();
     return *this;
   }
 
@@ -197,7 +239,7 @@ public:
 
   void deleteNodeName(int nodeId) { return getNode(nodeId)->deleteName(); }
 
-  bool hasNode(int nodeId) const { return TreeTemplateTools::hasNodeWithId(*root_, nodeId); }
+  bool hasNode(int nodeId) const { return lookupNode_(nodeId) != 0; }
 
   bool isLeaf(int nodeId) const { return getNode(nodeId)->isLeaf(); }
 
@@ -400,7 +442,7 @@ public:
    *
    * @{
    */
-  virtual void setRootNode(N* root) { root_ = root; root_->removeFather(); }
+  virtual void setRootNode(N* root) { root_ = root; root_->removeFather(); invalidateNodeIndex_(); }
 
   virtual N* getRootNode() { return root_; }
 
@@ -427,7 +469,7 @@ public:
       if (nodes.size() == 0) throw NodeNotFoundException("TreeTemplate::getNode(): Node with id not found.", TextTools::toString(id));
       return nodes[0];
     } else {
-      N* node = dynamic_cast<N*>(TreeTemplateTools::searchFirstNodeWithId(*root_, id));
+      N* node = lookupNode_(id);
       if (node)
         return node;
       else
@@ -444,7 +486,7 @@ public:
       if (nodes.size() == 0) throw NodeNotFoundException("TreeTemplate::getNode(): Node with id not found.", TextTools::toString(id));
       return nodes[0];
     } else {
-      const N* node = dynamic_cast<const N*>(TreeTemplateTools::searchFirstNodeWithId(*root_, id));
+      const N* node = lookupNode_(id);
       if (node)
         return node;
       else
@@ -495,6 +537,7 @@ public:
     newRoot->deleteDistanceToFather();
     newRoot->deleteBranchProperties();
     root_ = newRoot;
+    invalidateNodeIndex_();
   }
 
   void newOutGroup(N* outGroup)
@@ -530,7 +573,168 @@ public:
     }
   }
 
+  /**
+   * @brief Enable or disable the validation of the node index.
+   *
+   * When enabled, each lookup by id is compared to a full search of the tree,
+   * and an exception is thrown in case of mismatch. This is slow, and meant for debugging only.
+   *
+   * @param yn Whether lookups should be validated.
+   */
+  void setNodeIndexValidation(bool yn) { validateNodeIndex_ = yn; }
+
+  bool isNodeIndexValidationEnabled() const { return validateNodeIndex_; }
+
+  /**
+   * @return The modification counter of the tree.
+   *
+   * Its value changes each time the topology or the node ids of the tree are modified, either through
+   * the methods of the tree or through its nodes directly. It is not affected by modifications of
+   * other trees, so that it can be used to know if data computed from this tree are still valid.
+   */
+  unsigned long getRevision() const
+  {
+    unsigned long revision = revision_->load();
+    if (indexRevision_.load() != revision)
+    {
+      // Nodes only report their modifications to the tree once they are indexed:
+      std::lock_guard<std::mutex> lock(indexMutex_);
+      revision = updateNodeIndex_();
+    }
+    return revision;
+  }
+
   /** @} */
+
+private:
+  /**
+   * @return The first node with the given id in prefix order, as TreeTemplateTools::searchFirstNodeWithId, or 0 if not found.
+   */
+  N* lookupNode_(int id) const
+  {
+    N* node = 0;
+    // Fast path: the index is up to date, it can be read concurrently.
+    nbActiveLookups_++;
+    if (indexRevision_.load() == revision_->load())
+    {
+      node = findInNodeIndex_(id);
+      nbActiveLookups_--;
+    }
+    else
+    {
+      nbActiveLookups_--;
+      std::lock_guard<std::mutex> lock(indexMutex_);
+      updateNodeIndex_();
+      node = findInNodeIndex_(id);
+    }
+    if (validateNodeIndex_)
+    {
+      Node* check = root_ ? TreeTemplateTools::searchFirstNodeWithId(*root_, id) : 0;
+      if (check != node)
+        throw Exception("TreeTemplate::getNode(). Node index is inconsistent for id " + TextTools::toString(id) + ".");
+    }
+    return node;
+  }
+
+  /**
+   * @brief Rebuild the index if the tree was modified since it was built. indexMutex_ must be locked.
+   *
+   * @return The value of the modification counter for which the index is valid.
+   */
+  unsigned long updateNodeIndex_() const
+  {
+    unsigned long revision = revision_->load();
+    if (indexRevision_.load() != revision)
+    {
+      // Prevent new fast lookups, and wait for the current ones to finish:
+      indexRevision_ = 0;
+      while (nbActiveLookups_.load() > 0)
+        std::this_thread::yield();
+      buildNodeIndex_();
+      indexRevision_ = revision;
+    }
+    return revision;
+  }
+
+  N* findInNodeIndex_(int id) const
+  {
+    if (!denseNodeIndex_.empty())
+    {
+      long pos = static_cast<long>(id) - static_cast<long>(minIndexedId_);
+      if (pos < 0 || pos >= static_cast<long>(denseNodeIndex_.size()))
+        return 0;
+      return denseNodeIndex_[static_cast<size_t>(pos)];
+    }
+    typename std::unordered_map<int, N*>::const_iterator it = sparseNodeIndex_.find(id);
+    return it == sparseNodeIndex_.end() ? 0 : it->second;
+  }
+
+  void buildNodeIndex_() const
+  {
+    denseNodeIndex_.clear();
+    sparseNodeIndex_.clear();
+    if (!root_) return;
+    std::vector<N*> nodes;
+    getNodesInPrefixOrder_(root_, nodes);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      // Nodes report their modifications to this tree from now on.
+      // A node previously indexed by another tree may not be part of it anymore:
+      const Node* node = nodes[i];
+      if (node->revision_ != revision_)
+      {
+        node->incrementRevision_();
+        node->revision_ = revision_;
+      }
+    }
+    int minId = nodes[0]->getId();
+    int maxId = minId;
+    for (size_t i = 1; i < nodes.size(); i++)
+    {
+      int id = nodes[i]->getId();
+      if (id < minId) minId = id;
+      if (id > maxId) maxId = id;
+    }
+    long range = static_cast<long>(maxId) - static_cast<long>(minId) + 1;
+    if (range <= 2 * static_cast<long>(nodes.size()))
+    {
+      // Ids are compact, use a vector:
+      minIndexedId_ = minId;
+      denseNodeIndex_.assign(static_cast<size_t>(range), 0);
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+        N*& entry = denseNodeIndex_[static_cast<size_t>(nodes[i]->getId() - minId)];
+        if (!entry) entry = nodes[i]; // Only keep the first node in case of duplicated ids.
+      }
+    }
+    else
+    {
+      sparseNodeIndex_.reserve(nodes.size());
+      for (size_t i = 0; i < nodes.size(); i++)
+      {
+        sparseNodeIndex_.insert(std::make_pair(nodes[i]->getId(), nodes[i]));
+      }
+    }
+  }
+
+  static void getNodesInPrefixOrder_(N* node, std::vector<N*>& nodes)
+  {
+    nodes.push_back(node);
+    for (size_t i = 0; i < node->getNumberOfSons(); i++)
+    {
+      getNodesInPrefixOrder_(node->getSon(i), nodes);
+    }
+  }
+
+  void invalidateNodeIndex_() const
+  {
+    (*revision_)++;
+  }
+
+  static std::shared_ptr< std::atomic<unsigned long> > newRevisionCounter_()
+  {
+    return std::make_shared< std::atomic<unsigned long> >(1);
+  }
 };
 } // end of namespace bpp.
 
@@ -40,6 +40,7 @@
 #include "TreeTools.h"
 #include "Tree.h"
 #include "BipartitionTools.h"
+#include "RobinsonFouldsDistance.h"
 #include "Model/Nucleotide/JCnuc.h"
 #include "Distance/DistanceEstimation.h"
 #include "Distance/BioNJ.h"
@@ -886,140 +887,49 @@ bool TreeTools::haveSameTopology(const Tree& tr1, const Tree& tr2)
 
 int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames, int* missing_in_tr2, int* missing_in_tr1)
 {
-  BipartitionList* bipL1, * bipL2;
-  size_t i, j;
-  vector<size_t> size1, size2;
-  vector<bool> bipOK2;
-
-
   if (checkNames && !VectorTools::haveSameElements(tr1.getLeavesNames(), tr2.getLeavesNames()))
     throw Exception("Distinct leaf sets between trees ");
 
-  /* prepare things */
-  int missing1 = 0;
-  int missing2 = 0;
-
-  bipL1 = new BipartitionList(tr1, true);
-  bipL1->removeTrivialBipartitions();
-  bipL1->sortByPartitionSize();
-  bipL2 = new BipartitionList(tr2, true);
-  bipL2->removeTrivialBipartitions();
-  bipL2->sortByPartitionSize();
-
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
-  {
-    size1.push_back(bipL1->getPartitionSize(i));
-  }
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
-  {
-    size2.push_back(bipL2->getPartitionSize(i));
-  }
-
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
-  {
-    bipOK2.push_back(false);
-  }
-
-  /* main loops */
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
-  {
-    for (j = 0; j < bipL2->getNumberOfBipartitions(); j++)
-    {
-      if (bipOK2[j])
-        continue;
-      if (size1[i] == size2[j] && BipartitionTools::areIdentical(*bipL1, i, *bipL2, j))
-      {
-        bipOK2[j] = true;
-        break;
-      }
-    }
-    if (j == bipL2->getNumberOfBipartitions())
-      missing2++;
-  }
-
-  missing1 = static_cast<int>(bipL2->getNumberOfBipartitions()) - static_cast<int>(bipL1->getNumberOfBipartitions()) + missing2;
+  RobinsonFouldsDistance rf(tr1.getLeavesNames(), true);
+  size_t missing1 = 0;
+  size_t missing2 = 0;
+  size_t distance = rf.getDistance(tr1, tr2, &missing2, &missing1);
 
   if (missing_in_tr1)
-    *missing_in_tr1 = missing1;
+    *missing_in_tr1 = static_cast<int>(missing1);
   if (missing_in_tr2)
-    *missing_in_tr2 = missing2;
-  return missing1 + missing2;
+    *missing_in_tr2 = static_cast<int>(missing2);
+  return static_cast<int>(distance);
 }
 
 /******************************************************************************/
 
-BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+DistanceMatrix* TreeTools::getRobinsonFouldsDistanceMatrix(const vector<Tree*>& vecTr, size_t nbThreads)
 {
-  vector<BipartitionList*> vecBipL;
-  BipartitionList* mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
-
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    vecBipL.push_back(new BipartitionList(*vecTr[i]));
-  }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    delete vecBipL[i];
-  }
-
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
-  bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
-  {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
-  }
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::getRobinsonFouldsDistanceMatrix. Empty vector passed");
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
-  {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
-    {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
-      {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
-      }
-    }
-  }
+  RobinsonFouldsDistance rf(vecTr[0]->getLeavesNames(), true);
+  return rf.getDistanceMatrix(vecTr, nbThreads);
+}
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
-  {
-    if (bipScore[i - 1] == 0)
-    {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
-    }
-  }
+/******************************************************************************/
 
-  /* add terminal branches */
-  mergedBipL->addTrivialBipartitions(false);
-  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
-  {
-    bipScore.push_back(vecTr.size());
-  }
+BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore, size_t nbThreads)
+{
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::bipartitionOccurrences. Empty vector passed");
 
-  return mergedBipL;
+  BipartitionCounter counter(vecTr[0]->getLeavesNames());
+  counter.addTrees(vecTr, nbThreads);
+  return counter.getBipartitionList(bipScore);
 }
 
 /******************************************************************************/
 
-TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, double threshold, bool checkNames)
+TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, double threshold, bool checkNames, size_t nbThreads)
 {
-  vector<size_t> bipScore;
   vector<string> tr0leaves;
-  BipartitionList* bipL;
-  double score;
 
   if (vecTr.size() == 0)
     throw Exception("TreeTools::thresholdConsensus. Empty vector passed");
@@ -1035,13 +945,30 @@ TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, do
     }
   }
 
-  bipL = bipartitionOccurrences(vecTr, bipScore);
+  BipartitionCounter counter(vecTr[0]->getLeavesNames());
+  counter.addTrees(vecTr, nbThreads);
+  return thresholdConsensus(counter, threshold);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TreeTools::thresholdConsensus(const BipartitionCounter& counter, double threshold)
+{
+  vector<size_t> bipScore;
+  double score;
+
+  size_t nbTrees = counter.getNumberOfTrees();
+  if (nbTrees == 0)
+    throw Exception("TreeTools::thresholdConsensus. No tree was counted");
+
+  /* bipartitions below the threshold are discarded by the counter */
+  BipartitionList* bipL = counter.getBipartitionList(bipScore, threshold);
 
   for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--)
   {
     if (bipL->getPartitionSize(i - 1) == 1)
       continue;
-    score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(vecTr.size());
+    score = static_cast<double>(bipScore[i - 1]) / static_cast<double>(nbTrees);
     if (score <= threshold && score != 1.)
     {
       bipL->deleteBipartition(i - 1);
@@ -1066,23 +993,23 @@ TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, do
 
 /******************************************************************************/
 
-TreeTemplate<Node>* TreeTools::fullyResolvedConsensus(const vector<Tree*>& vecTr, bool checkNames)
+TreeTemplate<Node>* TreeTools::fullyResolvedConsensus(const vector<Tree*>& vecTr, bool checkNames, size_t nbThreads)
 {
-  return thresholdConsensus(vecTr, 0., checkNames);
+  return thresholdConsensus(vecTr, 0., checkNames, nbThreads);
 }
 
 /******************************************************************************/
 
-TreeTemplate<Node>* TreeTools::majorityConsensus(const vector<Tree*>& vecTr, bool checkNames)
+TreeTemplate<Node>* TreeTools::majorityConsensus(const vector<Tree*>& vecTr, bool checkNames, size_t nbThreads)
 {
-  return thresholdConsensus(vecTr, 0.5, checkNames);
+  return thresholdConsensus(vecTr, 0.5, checkNames, nbThreads);
 }
 
 /******************************************************************************/
 
-TreeTemplate<Node>* TreeTools::strictConsensus(const vector<Tree*>& vecTr, bool checkNames)
+TreeTemplate<Node>* TreeTools::strictConsensus(const vector<Tree*>& vecTr, bool checkNames, size_t nbThreads)
 {
-  return thresholdConsensus(vecTr, 1., checkNames);
+  return thresholdConsensus(vecTr, 1., checkNames, nbThreads);
 }
 
 /******************************************************************************/
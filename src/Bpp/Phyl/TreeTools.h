@@ -44,6 +44,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Node.h"
 #include "Tree.h"
 #include "BipartitionList.h"
+#include "BipartitionCounter.h"
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -586,7 +587,12 @@ class TreeTools
      * @brief Calculates the Robinson-Foulds topological distance between two trees
      *
      * The two trees must share a common set of leaves (checked if checkNames is true)
-     * Three numbers are calculated:
+     * Three numbers are calculated. The computation takes a time linear in the number of leaves,
+     * see RobinsonFouldsDistance.
+     *
+     * Bipartitions are counted once per branch: a bipartition found on several branches of a tree
+     * (because of nodes with only one son) is counted several times. Use RobinsonFouldsDistance
+     * directly to compare the sets of distinct bipartitions.
      *
      * @author Nicolas Galtier
      * @param tr1 First input tree.
@@ -599,18 +605,33 @@ class TreeTools
      */
     static int robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames = true, int* missing_in_tr2 = NULL, int* missing_in_tr1 = NULL);
 
+    /**
+     * @brief Calculates the Robinson-Foulds distances between all pairs of trees in a set.
+     *
+     * Leaf names are indexed and each tree is converted only once, see RobinsonFouldsDistance::getDistanceMatrix.
+     * Distances are the same as the ones computed by robinsonFouldsDistance().
+     *
+     * @param vecTr Vector of input trees (must share a common set of leaves - an exception is thrown otherwise)
+     * @param nbThreads The number of threads to use (0 means the number of hardware threads).
+     * @return A new DistanceMatrix object, with trees named "Tree1", "Tree2", etc.
+     */
+    static DistanceMatrix* getRobinsonFouldsDistanceMatrix(const std::vector<Tree*>& vecTr, size_t nbThreads = 1);
+
     /**
      * @brief Counts the total number of occurrences of every bipartition from the input trees
      *
      * Returns the list of distinct bipartitions found at least once in the set of input trees,
      * and writes the number of occurrence of each of these bipartitions in vector bipScore.
      *
+     * Occurrences are counted in a single pass over the trees, using a BipartitionCounter object.
+     *
      * @author Nicolas Galtier
-     * @param vecTr Vector of input trees (must share a common set of leaves - not checked in this function)
+     * @param vecTr Vector of input trees (must share a common set of leaves - an exception is thrown otherwise)
      * @param bipScore Output as the numbers of occurrences of the returned distinct bipartitions
+     * @param nbThreads The number of threads to use to count bipartitions (0 means the number of hardware threads).
      * @return A BipartitionList object including only distinct bipartitions
      */
-    static BipartitionList* bipartitionOccurrences(const std::vector<Tree*>& vecTr, std::vector<size_t>& bipScore);
+    static BipartitionList* bipartitionOccurrences(const std::vector<Tree*>& vecTr, std::vector<size_t>& bipScore, size_t nbThreads = 1);
 
     /**
      * @brief General greedy consensus tree method
@@ -624,8 +645,27 @@ class TreeTools
      * @param vecTr Vector of input trees (must share a common set of leaves - checked if checkNames is true)
      * @param threshold Minimal acceptable score =number of occurrence of a bipartition/number of trees (0.<=threshold<=1.)
      * @param checkNames Tell whether we should check the trees first.
+     * @param nbThreads The number of threads to use to count bipartitions (0 means the number of hardware threads).
+     */
+    static TreeTemplate<Node>* thresholdConsensus(const std::vector<Tree*>& vecTr, double threshold, bool checkNames = true, size_t nbThreads = 1);
+
+    /**
+     * @brief General greedy consensus tree method, from precomputed bipartition counts.
+     *
+     * This is the same method as above, but bipartitions are taken from a counter,
+     * so that trees can be read and counted one at a time, without storing them all in memory:
+     * @code
+     * BipartitionCounter counter(leavesNames);
+     * Newick reader;
+     * reader.processTrees(input, [&] (TreeTemplate<Node>& tree) { counter.addTree(tree); return true; });
+     * TreeTemplate<Node>* consensus = TreeTools::thresholdConsensus(counter, 0.5);
+     * @endcode
+     *
+     * @param counter The bipartitions counted from the input trees.
+     * @param threshold Minimal acceptable score =number of occurrence of a bipartition/number of trees (0.<=threshold<=1.)
+     * @throw Exception If no tree was counted.
      */
-    static TreeTemplate<Node>* thresholdConsensus(const std::vector<Tree*>& vecTr, double threshold, bool checkNames = true);
+    static TreeTemplate<Node>* thresholdConsensus(const BipartitionCounter& counter, double threshold);
 
     /**
      * @brief Fully-resolved greedy consensus tree method
@@ -636,8 +676,9 @@ class TreeTools
      * @author Nicolas Galtier
      * @param vecTr Vector of input trees (must share a common set of leaves - checked if checkNames is true)
      * @param checkNames Tell whether we should check the trees first.
+     * @param nbThreads The number of threads to use to count bipartitions (0 means the number of hardware threads).
      */
-    static TreeTemplate<Node>* fullyResolvedConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* fullyResolvedConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true, size_t nbThreads = 1);
 
     /**
      * @brief Majority consensus tree method
@@ -647,8 +688,9 @@ class TreeTools
      * @author Nicolas Galtier
      * @param vecTr Vector of input trees (must share a common set of leaves - checked if checkNames is true)
      * @param checkNames Tell whether we should check the trees first.
+     * @param nbThreads The number of threads to use to count bipartitions (0 means the number of hardware threads).
      */
-    static TreeTemplate<Node>* majorityConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* majorityConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true, size_t nbThreads = 1);
 
     /**
      * @brief Strict consensus tree method
@@ -658,8 +700,9 @@ class TreeTools
      * @author Nicolas Galtier
      * @param vecTr Vector of input trees (must share a common set of leaves - checked if checkNames is true)
      * @param checkNames Tell whether we should check the trees first.
+     * @param nbThreads The number of threads to use to count bipartitions (0 means the number of hardware threads).
      */
-    static TreeTemplate<Node>* strictConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* strictConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true, size_t nbThreads = 1);
 
     /** @} */
 
@@ -0,0 +1,115 @@
+//
+// File: test_bipartitions.cpp
+// Created by: agent
+// Created on: Fri Oct 16 21:15 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/BipartitionList.h>
+#include <Bpp/Phyl/BipartitionTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  //Word operations, on more than one word:
+  size_t n = 100;
+  size_t nbWords = BipartitionTools::getNumberOfWords(n);
+  vector<uint64_t> a(nbWords, 0), b(nbWords, 0), c(nbWords, 0);
+  for (size_t i = 0; i < 70; i++)
+    BipartitionTools::bit1(&a[0], i);
+  for (size_t i = 0; i < 10; i++)
+    BipartitionTools::bit1(&b[0], i);
+  BipartitionTools::bitNot(&c[0], &a[0], n);
+  if (BipartitionTools::bitCount(&a[0], nbWords) != 70 || BipartitionTools::bitCount(&c[0], nbWords) != 30) {
+    cerr << "Wrong bit count." << endl;
+    return 1;
+  }
+  if (!BipartitionTools::isIncluded(&b[0], &a[0], nbWords) || BipartitionTools::isIncluded(&a[0], &b[0], nbWords)) {
+    cerr << "Wrong inclusion." << endl;
+    return 1;
+  }
+  if (!BipartitionTools::areIdentical(&a[0], &c[0], n) || BipartitionTools::areIdentical(&a[0], &b[0], n)) {
+    cerr << "Wrong identity." << endl;
+    return 1;
+  }
+  if (!BipartitionTools::areCompatible(&a[0], &b[0], n) || !BipartitionTools::areCompatible(&b[0], &c[0], n)) {
+    cerr << "Wrong compatibility." << endl;
+    return 1;
+  }
+  BipartitionTools::bit0(&b[0], 0);
+  BipartitionTools::bit1(&b[0], 90);
+  if (BipartitionTools::areCompatible(&a[0], &b[0], n)) {
+    cerr << "Wrong compatibility." << endl;
+    return 1;
+  }
+  cout << "Word operations ok." << endl;
+
+  //Bipartitions of random trees with more leaves than bits in a word:
+  vector<string> leaves;
+  for (size_t i = 0; i < n; i++)
+    leaves.push_back("T" + TextTools::toString(i));
+  for (size_t k = 0; k < 10; k++) {
+    unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leaves, k % 2 == 0));
+    BipartitionList bipL(*tree, true);
+    bipL.removeTrivialBipartitions();
+    if (bipL.getNumberOfBipartitions() != n - 3) {
+      cerr << "Wrong number of bipartitions: " << bipL.getNumberOfBipartitions() << endl;
+      return 1;
+    }
+    for (size_t i = 0; i < bipL.getNumberOfBipartitions(); i++) {
+      for (size_t j = 0; j < bipL.getNumberOfBipartitions(); j++) {
+        if (!bipL.areCompatible(i, j) || bipL.areIdentical(i, j) != (i == j)) {
+          cerr << "Bipartitions " << i << " and " << j << " of the same tree are not consistent." << endl;
+          return 1;
+        }
+      }
+    }
+    unique_ptr< TreeTemplate<Node> > tree2(bipL.toTree());
+    if (TreeTools::robinsonFouldsDistance(*tree, *tree2) != 0) {
+      cerr << "Tree rebuilt from bipartitions differs from the original one." << endl;
+      return 1;
+    }
+  }
+  cout << "Bipartition lists ok." << endl;
+  return 0;
+}
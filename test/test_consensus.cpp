@@ -0,0 +1,147 @@
+//
+// File: test_consensus.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:54 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/BipartitionCounter.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Text/TextTools.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> descriptions;
+  descriptions.push_back("((A,B),(C,D),E);");
+  descriptions.push_back("((A,B),C,(D,E));");
+  descriptions.push_back("(((B,A),(D,C)),E);");
+  vector<Tree*> trees;
+  for (size_t i = 0; i < descriptions.size(); i++)
+    trees.push_back(TreeTemplateTools::parenthesisToTree(descriptions[i]));
+
+  //Occurrences:
+  vector<size_t> bipScore;
+  unique_ptr<BipartitionList> bipL(TreeTools::bipartitionOccurrences(trees, bipScore));
+  if (bipL->getNumberOfBipartitions() != 8 || bipScore.size() != 8) {
+    cerr << "Wrong number of bipartitions: " << bipL->getNumberOfBipartitions() << endl;
+    return 1;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < 3; i++)
+    total += bipScore[i];
+  if (total != 6) {
+    cerr << "Wrong number of occurrences: " << total << endl;
+    return 1;
+  }
+
+  //Consensus trees:
+  unique_ptr< TreeTemplate<Node> > majority(TreeTools::majorityConsensus(trees));
+  unique_ptr< TreeTemplate<Node> > expected(TreeTemplateTools::parenthesisToTree("((A,B),(C,D),E);"));
+  cout << TreeTemplateTools::treeToParenthesis(*majority) << endl;
+  if (!TreeTools::haveSameTopology(*majority, *expected)) {
+    cerr << "Wrong majority consensus." << endl;
+    return 1;
+  }
+  unique_ptr< TreeTemplate<Node> > strict(TreeTools::strictConsensus(trees));
+  expected.reset(TreeTemplateTools::parenthesisToTree("((A,B),C,D,E);"));
+  cout << TreeTemplateTools::treeToParenthesis(*strict) << endl;
+  if (!TreeTools::haveSameTopology(*strict, *expected)) {
+    cerr << "Wrong strict consensus." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < trees.size(); i++)
+    delete trees[i];
+  trees.clear();
+
+  //Results must not depend on the number of threads, nor on the way trees are read:
+  vector<string> leaves;
+  for (size_t i = 0; i < 40; i++)
+    leaves.push_back("T" + TextTools::toString(i));
+  for (size_t i = 0; i < 200; i++)
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, i % 2 == 0));
+  unique_ptr< TreeTemplate<Node> > consensus1(TreeTools::fullyResolvedConsensus(trees, true, 1));
+  unique_ptr< TreeTemplate<Node> > consensus4(TreeTools::fullyResolvedConsensus(trees, true, 4));
+  string s1 = TreeTemplateTools::treeToParenthesis(*consensus1);
+  string s4 = TreeTemplateTools::treeToParenthesis(*consensus4);
+  if (s1 != s4) {
+    cerr << "Consensus trees differ with several threads:" << endl << s1 << endl << s4 << endl;
+    return 1;
+  }
+
+  Newick newick;
+  ostringstream out;
+  newick.writeTrees(trees, out);
+  istringstream in(out.str());
+  BipartitionCounter counter(leaves);
+  newick.processTrees(in, [&] (TreeTemplate<Node>& tree) {
+      counter.addTree(tree);
+      return true;
+    });
+  if (counter.getNumberOfTrees() != trees.size()) {
+    cerr << "Wrong number of trees counted: " << counter.getNumberOfTrees() << endl;
+    return 1;
+  }
+  unique_ptr< TreeTemplate<Node> > consensusStream(TreeTools::thresholdConsensus(counter, 0.));
+  string sStream = TreeTemplateTools::treeToParenthesis(*consensusStream);
+  if (s1 != sStream) {
+    cerr << "Consensus trees differ when reading trees as a stream:" << endl << s1 << endl << sStream << endl;
+    return 1;
+  }
+  cout << s1 << endl;
+
+  //Unknown leaves must be detected:
+  unique_ptr< TreeTemplate<Node> > wrong(TreeTemplateTools::parenthesisToTree("((A,B),(C,D),F);"));
+  BipartitionCounter counter2(expected->getLeavesNames());
+  try {
+    counter2.addTree(*wrong);
+    cerr << "Unknown leaf not detected." << endl;
+    return 1;
+  } catch (Exception& ex) {
+    cout << "Ok, unknown leaf detected." << endl;
+  }
+
+  for (size_t i = 0; i < trees.size(); i++)
+    delete trees[i];
+  return 0;
+}
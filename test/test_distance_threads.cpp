@@ -0,0 +1,116 @@
+//
+// File: test_distance_threads.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:27 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("B", "GACTGGATCTGCACGTCGACTGGATCTGCACTTC", alphabet));
+  sites.addSequence(BasicSequence("C", "CTCTGGATGTGCACGTGCTCTGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("D", "AAATGGCGGTGCGCCTAAAATGGCGGTGCGCCTA", alphabet));
+  sites.addSequence(BasicSequence("E", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTA", alphabet));
+  sites.addSequence(BasicSequence("F", "GACTGGATGTGCACGTCGACTGGATCTGCACGTC", alphabet));
+
+  DistanceEstimation de1(new T92(alphabet, 3.), new GammaDiscreteRateDistribution(4, 1.0), &sites, 0, false);
+  de1.computeMatrix();
+  unique_ptr<DistanceMatrix> d1(de1.getMatrix());
+
+  DistanceEstimation deN(new T92(alphabet, 3.), new GammaDiscreteRateDistribution(4, 1.0), &sites, 0, false);
+  deN.setNumberOfThreads(3);
+  deN.computeMatrix();
+  unique_ptr<DistanceMatrix> dN(deN.getMatrix());
+
+  //Results must be exactly the same, whatever the number of threads:
+  for (size_t i = 0; i < sites.getNumberOfSequences(); ++i) {
+    for (size_t j = 0; j < sites.getNumberOfSequences(); ++j) {
+      cout << setprecision(20) << (*d1)(i, j) << "\t" << (*dN)(i, j) << endl;
+      if ((*d1)(i, j) != (*dN)(i, j)) return 1;
+    }
+  }
+
+  //A larger data set, with more pairs than threads, so that all threads access the sequences at the same time:
+  RandomTools::setSeed(42);
+  string ancestor(300, 'A');
+  for (size_t k = 0; k < ancestor.size(); ++k)
+    ancestor[k] = "ACGT"[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<size_t>(4)];
+  VectorSiteContainer sites2(alphabet);
+  for (size_t i = 0; i < 40; ++i) {
+    string seq = ancestor;
+    for (size_t k = 0; k < seq.size(); ++k) {
+      if (RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) < 0.1)
+        seq[k] = "ACGT"[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<size_t>(4)];
+    }
+    sites2.addSequence(BasicSequence("S" + TextTools::toString(i), seq, alphabet));
+  }
+
+  DistanceEstimation de2(new T92(alphabet, 3.), new GammaDiscreteRateDistribution(4, 1.0), &sites2, 0, false);
+  de2.computeMatrix();
+  unique_ptr<DistanceMatrix> d2(de2.getMatrix());
+  for (size_t t = 0; t < 3; ++t) {
+    DistanceEstimation de2N(new T92(alphabet, 3.), new GammaDiscreteRateDistribution(4, 1.0), &sites2, 0, false);
+    de2N.setNumberOfThreads(8);
+    de2N.computeMatrix();
+    unique_ptr<DistanceMatrix> d2N(de2N.getMatrix());
+    for (size_t i = 0; i < sites2.getNumberOfSequences(); ++i) {
+      for (size_t j = 0; j < sites2.getNumberOfSequences(); ++j) {
+        if ((*d2)(i, j) != (*d2N)(i, j)) {
+          cerr << "Different distances between " << i << " and " << j << ": " << (*d2)(i, j) << ", " << (*d2N)(i, j) << endl;
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
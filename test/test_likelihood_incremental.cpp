@@ -0,0 +1,174 @@
+//
+// File: test_likelihood_incremental.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:36 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Change branch lengths one or two at a time, and compare with a likelihood computed from scratch:
+template<class TL>
+bool testIncremental(const TreeTemplate<Node>& tree, const SiteContainer& sites, SubstitutionModel* model, DiscreteDistribution* rdist) {
+  TL tl(tree, sites, model, rdist);
+  tl.initialize();
+  ParameterList brLens = tl.getBranchLengthsParameters();
+  for (size_t i = 0; i < brLens.size(); ++i) {
+    ParameterList changed;
+    changed.addParameter(brLens[i]);
+    changed[0].setValue(brLens[i].getValue() * 1.5 + 0.01);
+    if (i + 1 < brLens.size()) {
+      changed.addParameter(brLens[brLens.size() - 1 - i]);
+      changed[1].setValue(brLens[brLens.size() - 1 - i].getValue() * 0.5);
+    }
+    tl.setParameters(changed);
+
+    TL tlFull(tree, sites, model, rdist);
+    tlFull.initialize();
+    tlFull.setParameters(tl.getParameters());
+    cout << setprecision(20) << tl.getValue() << "\t" << tlFull.getValue() << endl;
+    if (abs(tl.getValue() - tlFull.getValue()) > 1e-9 * abs(tlFull.getValue())) return false;
+  }
+  return true;
+}
+
+//Count the full recomputations of the likelihood arrays:
+class CountingRHomogeneousTreeLikelihood:
+  public RHomogeneousTreeLikelihood
+{
+  public:
+    unsigned int nbFullComputations;
+
+  public:
+    CountingRHomogeneousTreeLikelihood(const Tree& tree, const SiteContainer& data, SubstitutionModel* model, DiscreteDistribution* rDist):
+      RHomogeneousTreeLikelihood(tree, data, model, rDist), nbFullComputations(0) {}
+
+  protected:
+    void computeSubtreeLikelihood(const Node* node)
+    {
+      nbFullComputations++;
+      RHomogeneousTreeLikelihood::computeSubtreeLikelihood(node);
+    }
+};
+
+class CountingDRHomogeneousTreeLikelihood:
+  public DRHomogeneousTreeLikelihood
+{
+  public:
+    unsigned int nbFullComputations;
+
+  public:
+    CountingDRHomogeneousTreeLikelihood(const Tree& tree, const SiteContainer& data, SubstitutionModel* model, DiscreteDistribution* rDist):
+      DRHomogeneousTreeLikelihood(tree, data, model, rDist), nbFullComputations(0) {}
+
+  protected:
+    void computeSubtreeLikelihoodPostfix(const Node* node)
+    {
+      nbFullComputations++;
+      DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(node);
+    }
+};
+
+//Edit and delete nodes of other trees between two evaluations, and check that arrays are still partially updated:
+template<class TL>
+bool testOtherTreeEdits(const TreeTemplate<Node>& tree, const SiteContainer& sites, SubstitutionModel* model, DiscreteDistribution* rdist) {
+  TL tl(tree, sites, model, rdist);
+  tl.initialize();
+  ParameterList brLens = tl.getBranchLengthsParameters();
+  for (size_t i = 0; i < brLens.size(); ++i) {
+    unique_ptr< TreeTemplate<Node> > other(tree.clone());
+    other->getRootNode()->getSon(0)->setId(100);
+    TreeTemplateTools::dropLeaf(*other, other->getLeavesNames()[0]);
+    other.reset();
+
+    unsigned int nbFullComputations = tl.nbFullComputations;
+    ParameterList changed;
+    changed.addParameter(brLens[i]);
+    changed[0].setValue(brLens[i].getValue() * 1.5 + 0.01);
+    tl.setParameters(changed);
+    if (tl.nbFullComputations != nbFullComputations) {
+      cerr << "Full recomputation after editing another tree." << endl;
+      return false;
+    }
+  }
+
+  //A copy has its own tree, and can also be partially updated:
+  TL tlCopy(tl);
+  ParameterList changed;
+  changed.addParameter(brLens[0]);
+  changed[0].setValue(brLens[0].getValue() * 0.5);
+  tlCopy.setParameters(changed);
+  if (tlCopy.nbFullComputations != tl.nbFullComputations) {
+    cerr << "Full recomputation after copy." << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("(((A:0.01, B:0.02):0.03,(C:0.05,E:0.02):0.04):0.02,D:0.1,F:0.07);"));
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("B", "GACTGGATCTGCACGTCGACTGGATCTGCACTTC", alphabet));
+  sites.addSequence(BasicSequence("C", "CTCTGGATGTGCACGTGCTCTGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("D", "AAATGGCGGTGCGCCTAAAATGGCGGTGCGCCTA", alphabet));
+  sites.addSequence(BasicSequence("E", "CTCTGGATGTGCACGTGCTCAGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("F", "AAATGGCTGTGCACGTCAAATGGCTGTGCATGTC", alphabet));
+  unique_ptr<SubstitutionModel> model(new T92(alphabet, 3.));
+  unique_ptr<DiscreteDistribution> rdist(new GammaDiscreteRateDistribution(4, 1.0));
+
+  cout << "RHomogeneousTreeLikelihood:" << endl;
+  if (!testIncremental<RHomogeneousTreeLikelihood>(*tree, sites, model.get(), rdist.get())) return 1;
+  cout << "DRHomogeneousTreeLikelihood:" << endl;
+  if (!testIncremental<DRHomogeneousTreeLikelihood>(*tree, sites, model.get(), rdist.get())) return 1;
+  cout << "Edits of other trees:" << endl;
+  if (!testOtherTreeEdits<CountingRHomogeneousTreeLikelihood>(*tree, sites, model.get(), rdist.get())) return 1;
+  if (!testOtherTreeEdits<CountingDRHomogeneousTreeLikelihood>(*tree, sites, model.get(), rdist.get())) return 1;
+  return 0;
+}
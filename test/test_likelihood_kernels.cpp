@@ -0,0 +1,92 @@
+//
+// File: test_likelihood_kernels.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:15 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/Likelihood/LikelihoodKernels.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  size_t sizes[] = { 2, 4, 20, 61, 64 };
+  size_t nbRows = 13;
+  for (size_t k = 0; k < 5; k++) {
+    size_t nbStates = sizes[k];
+    size_t stride = (nbStates + 3) / 4 * 4;
+    size_t step = 2 * stride; // Two rate classes.
+    VVdouble pxy(nbStates, Vdouble(nbStates));
+    for (size_t x = 0; x < nbStates; x++)
+      for (size_t y = 0; y < nbStates; y++)
+        pxy[x][y] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    vector<double> in(nbRows * step), ref(nbRows * step, 1.);
+    for (size_t i = 0; i < in.size(); i++)
+      in[i] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+
+    //Reference computation:
+    for (size_t r = 0; r < nbRows; r++) {
+      for (size_t x = 0; x < nbStates; x++) {
+        double l = 0;
+        for (size_t y = 0; y < nbStates; y++)
+          l += pxy[x][y] * in[r * step + y];
+        ref[r * step + x] *= l;
+      }
+    }
+
+    vector<double> matrix;
+    LikelihoodKernels::flattenTransitionMatrix(pxy, true, stride, matrix);
+    for (int s = 0; s < 2; s++) {
+      LikelihoodKernels::InstructionSet set = (s == 0 ? LikelihoodKernels::SCALAR : LikelihoodKernels::AVX2);
+      if (!LikelihoodKernels::isSupported(set)) continue;
+      LikelihoodKernels::setInstructionSet(set);
+      vector<double> out(nbRows * step, 1.);
+      LikelihoodKernels::multiplyTransitionProducts(&matrix[0], stride, &in[0], step, &out[0], step, nbRows, nbStates);
+      for (size_t i = 0; i < out.size(); i++) {
+        if (std::abs(out[i] - ref[i]) > 1e-12 * std::abs(ref[i])) {
+          cerr << "Error for " << nbStates << " states with instruction set " << s << ": " << out[i] << " vs " << ref[i] << endl;
+          return 1;
+        }
+      }
+      cout << nbStates << " states, instruction set " << s << ": OK" << endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,240 @@
+//
+// File: test_likelihood_mixed_graph.cpp
+// Created by: agent
+// Created on: Fri Oct 16 22:25 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/App/SequenceApplicationTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/RNonHomogeneousMixedGraphTreeLikelihood.h>
+#include <Bpp/Phyl/App/PhylogeneticsApplicationTools.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <iostream>
+#include <memory>
+#include <algorithm>
+
+using namespace bpp;
+using namespace std;
+
+bool compare(const string& what, double ref, double val, double tol)
+{
+  cout << what << ":\t" << ref << "\t" << val << endl;
+  if (abs(ref - val) > tol * max(1., abs(ref)))
+  {
+    cout << "Error! Different values for " << what << "." << endl;
+    return false;
+  }
+  return true;
+}
+
+// The foreground mixed model is put on the given nodes, the background one elsewhere:
+MixedSubstitutionModelSet* getModelSet(const TreeTemplate<Node>& tree, const vector<int>& fgIds,
+                                       const CodonAlphabet* alphabet, const GeneticCode* gCode, const SiteContainer& sites)
+{
+  vector<int> bgIds;
+  vector<int> ids = tree.getNodesId();
+  for (size_t i = 0; i < ids.size(); i++)
+  {
+    if (ids[i] != tree.getRootId() && find(fgIds.begin(), fgIds.end(), ids[i]) == fgIds.end())
+      bgIds.push_back(ids[i]);
+  }
+  string fg = TextTools::toString(fgIds[0]);
+  for (size_t i = 1; i < fgIds.size(); i++)
+    fg += "," + TextTools::toString(fgIds[i]);
+  string bg = TextTools::toString(bgIds[0]);
+  for (size_t i = 1; i < bgIds.size(); i++)
+    bg += "," + TextTools::toString(bgIds[i]);
+
+  map<string, string> params;
+  params["model1"] = "RELAX(kappa=2.0,p=0.1,omega1=0.5,omega2=2.0,k=1.0,theta1=0.5,theta2=0.8,Frequency=F0)";
+  params["model2"] = "RELAX(kappa=RELAX.kappa_1,p=RELAX.p_1,omega1=RELAX.omega1_1,omega2=RELAX.omega2_1,theta1=RELAX.theta1_1,theta2=RELAX.theta2_1,Frequency=F0,k=2.0)";
+  params["nonhomogeneous"] = "general";
+  params["nonhomogeneous.number_of_models"] = "2";
+  params["nonhomogeneous.stationarity"] = "yes";
+  params["site.number_of_paths"] = "2";
+  params["site.path1"] = "model1[YN98.omega_1]&model2[YN98.omega_1]";
+  params["site.path2"] = "model1[YN98.omega_2]&model2[YN98.omega_2]";
+  params["model1.nodes_id"] = bg;
+  params["model2.nodes_id"] = fg;
+  return dynamic_cast<MixedSubstitutionModelSet*>(
+      PhylogeneticsApplicationTools::getSubstitutionModelSet(alphabet, gCode, &sites, params));
+}
+
+int main()
+{
+  try
+  {
+    TreeTemplate<Node>* tree = TreeTemplateTools::parenthesisToTree("(((A:0.01,B:0.02):0.03,C:0.05):0.02,(D:0.04,(E:0.03,F:0.02):0.01):0.03);");
+
+    map<string, string> alphabetParams;
+    alphabetParams["alphabet"] = "Codon(letter=DNA)";
+    alphabetParams["genetic_code"] = "Standard";
+    const CodonAlphabet* alphabet = dynamic_cast<const CodonAlphabet*>(SequenceApplicationTools::getAlphabet(alphabetParams, "", false));
+    unique_ptr<GeneticCode> gCode(SequenceApplicationTools::getGeneticCode(alphabet->getNucleicAlphabet(), "Standard"));
+    VectorSiteContainer sites(alphabet);
+    sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCTGGA", alphabet));
+    sites.addSequence(BasicSequence("B", "AACTGGATCTGCATGTCTGGA", alphabet));
+    sites.addSequence(BasicSequence("C", "ATCTGGACGTGCACGTGTGGC", alphabet));
+    sites.addSequence(BasicSequence("D", "CAACGGGAGTGCGCCTATGCA", alphabet));
+    sites.addSequence(BasicSequence("E", "AAGTGGCTATGTACATCAGGA", alphabet));
+    sites.addSequence(BasicSequence("F", "GAATGGTTGTGCACCTCCGGT", alphabet));
+
+    // The foreground mixed model is used on both sides of the root and on
+    // nested branches, so that it has to be summed at the root:
+    const Node* root = tree->getRootNode();
+    vector<int> fgIds = TreeTools::getNodesId(*tree, root->getSon(0)->getId());
+    fgIds.push_back(tree->getNode("F")->getId());
+    unique_ptr<MixedSubstitutionModelSet> modelSet1(getModelSet(*tree, fgIds, alphabet, gCode.get(), sites));
+    unique_ptr<MixedSubstitutionModelSet> modelSet2(modelSet1->clone());
+    GammaDiscreteRateDistribution rdist(2, 0.5);
+
+    RNonHomogeneousMixedTreeLikelihood tlRef(*tree, sites, modelSet1.get(), &rdist, false, true);
+    tlRef.initialize();
+    RNonHomogeneousMixedGraphTreeLikelihood tl(*tree, sites, modelSet2.get(), &rdist, false, true);
+    tl.initialize();
+
+    bool ok = compare("Log likelihood", tlRef.getValue(), tl.getValue(), 1e-8);
+    for (size_t i = 0; i < sites.getNumberOfSites(); i++)
+      ok &= compare("Site " + TextTools::toString(i), tlRef.getLogLikelihoodForASite(i), tl.getLogLikelihoodForASite(i), 1e-8);
+
+    // Change a model parameter and a branch length:
+    tlRef.setParameterValue("RELAX.k_2", 0.5);
+    tl.setParameterValue("RELAX.k_2", 0.5);
+    ok &= compare("Log likelihood with new k", tlRef.getValue(), tl.getValue(), 1e-8);
+    tlRef.setParameterValue("BrLen1", 0.2);
+    tl.setParameterValue("BrLen1", 0.2);
+    ok &= compare("Log likelihood with new branch length", tlRef.getValue(), tl.getValue(), 1e-8);
+
+    // Copies must be independent:
+    double value = tl.getValue();
+    unique_ptr<RNonHomogeneousMixedGraphTreeLikelihood> tlCopy(tl.clone());
+    tlCopy->setParameterValue("BrLen2", 0.3);
+    tl.computeTreeLikelihood();
+    ok &= compare("Log likelihood after changing a copy", value, -tl.getLogLikelihood(), 1e-12);
+
+    // Derivatives, compared to finite differences:
+    double h = 1e-5;
+    for (size_t i = 0; i < 4; i++)
+    {
+      string brLen = "BrLen" + TextTools::toString(i);
+      double x = tl.getParameterValue(brLen);
+      double f0 = tl.getValue();
+      double d1 = tl.getFirstOrderDerivative(brLen);
+      double d2 = tl.getSecondOrderDerivative(brLen);
+      tl.setParameterValue(brLen, x + h);
+      double fp = tl.getValue();
+      tl.setParameterValue(brLen, x - h);
+      double fm = tl.getValue();
+      tl.setParameterValue(brLen, x);
+      ok &= compare("First order derivative for " + brLen, (fp - fm) / (2. * h), d1, 1e-3);
+      ok &= compare("Second order derivative for " + brLen, (fp - 2. * f0 + fm) / (h * h), d2, 1e-2);
+    }
+
+    // Splitting the branch of C, compared to a tree with a node with a single son above it,
+    // under the background model:
+    TreeTemplate<Node>* tree2 = TreeTemplateTools::parenthesisToTree("(((A:0.01,B:0.02):0.03,(C:0.02):0.03):0.02,(D:0.04,(E:0.03,F:0.02):0.01):0.03);");
+    vector<int> fgIds2 = TreeTools::getNodesId(*tree2, tree2->getRootNode()->getSon(0)->getId());
+    fgIds2.push_back(tree2->getNode("F")->getId());
+    fgIds2.erase(find(fgIds2.begin(), fgIds2.end(), tree2->getNode("C")->getFather()->getId()));
+    unique_ptr<MixedSubstitutionModelSet> modelSet3(getModelSet(*tree2, fgIds2, alphabet, gCode.get(), sites));
+    RNonHomogeneousMixedTreeLikelihood tlRef2(*tree2, sites, modelSet3.get(), &rdist, false, true);
+    tlRef2.initialize();
+
+    unique_ptr<MixedSubstitutionModelSet> modelSet4(getModelSet(*tree, fgIds, alphabet, gCode.get(), sites));
+    unique_ptr<MixedSubstitutionModelSet> modelSet5(modelSet4->clone());
+    RNonHomogeneousMixedTreeLikelihood tlRef3(*tree, sites, modelSet4.get(), &rdist, false, true);
+    tlRef3.initialize();
+    RNonHomogeneousMixedGraphTreeLikelihood tlSplit(*tree, sites, modelSet5.get(), &rdist, false, true);
+    tlSplit.initialize();
+
+    int idC = tree->getNode("C")->getId();
+    map<int, RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments> segments;
+    segments[idC].push_back(make_pair(static_cast<size_t>(0), 0.03));
+    segments[idC].push_back(make_pair(static_cast<size_t>(1), 0.02));
+    tlSplit.setBranchSegments(segments);
+    ok &= compare("Log likelihood with a split branch", tlRef2.getValue(), tlSplit.getValue(), 1e-8);
+
+    tlRef2.setParameterValue("RELAX.k_2", 0.5);
+    tlSplit.setParameterValue("RELAX.k_2", 0.5);
+    ok &= compare("Log likelihood with a split branch and new k", tlRef2.getValue(), tlSplit.getValue(), 1e-8);
+    tlSplit.setParameterValue("RELAX.k_2", 2.0);
+
+    // Segments of the model of the node give the same likelihood as an unsplit branch:
+    segments[idC][0].first = 1;
+    tlSplit.setBranchSegments(segments);
+    ok &= compare("Log likelihood with segments of the same model", tlRef3.getValue(), tlSplit.getValue(), 1e-8);
+    segments[idC][0].first = 0;
+    tlSplit.setBranchSegments(segments);
+
+    // Derivatives along the split branch:
+    ParameterList brLens = tlSplit.getBranchLengthsParameters();
+    for (size_t i = 0; i < brLens.size(); i++)
+    {
+      string brLen = brLens[i].getName();
+      double x = tlSplit.getParameterValue(brLen);
+      double f0 = tlSplit.getValue();
+      double d1 = tlSplit.getFirstOrderDerivative(brLen);
+      double d2 = tlSplit.getSecondOrderDerivative(brLen);
+      tlSplit.setParameterValue(brLen, x + h);
+      double fp = tlSplit.getValue();
+      tlSplit.setParameterValue(brLen, x - h);
+      double fm = tlSplit.getValue();
+      tlSplit.setParameterValue(brLen, x);
+      ok &= compare("First order derivative with a split branch for " + brLen, (fp - fm) / (2. * h), d1, 1e-3);
+      ok &= compare("Second order derivative with a split branch for " + brLen, (fp - 2. * f0 + fm) / (h * h), d2, 1e-2);
+    }
+
+    // Back to a single segment:
+    segments[idC] = RNonHomogeneousMixedGraphTreeLikelihood::BranchSegments(1, make_pair(static_cast<size_t>(1), 0.05));
+    tlSplit.setBranchSegments(segments);
+    ok &= compare("Log likelihood after merging the segments", tlRef3.getValue(), tlSplit.getValue(), 1e-8);
+
+    delete tree2;
+    delete tree;
+    return ok ? 0 : 1;
+  }
+  catch (exception& e)
+  {
+    cout << e.what() << endl;
+    return 1;
+  }
+}
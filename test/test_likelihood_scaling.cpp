@@ -0,0 +1,146 @@
+//
+// File: test_likelihood_scaling.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:23 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Build a balanced tree with leaves named L<first> to L<last - 1>:
+string balancedTree(size_t first, size_t last, double brLen) {
+  if (last - first == 1)
+    return "L" + TextTools::toString(first) + ":" + TextTools::toString(brLen);
+  size_t middle = (first + last) / 2;
+  return "(" + balancedTree(first, middle, brLen) + "," + balancedTree(middle, last, brLen) + "):" + TextTools::toString(brLen);
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+
+  //Without underflow, scaling must not change anything:
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);"));
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("B", "GACTGGATCTGCACGTCGACTGGATCTGCACTTC", alphabet));
+  sites.addSequence(BasicSequence("C", "CTCTGGATGTGCACGTGCTCTGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("D", "AAATGGCGGTGCGCCTAAAATGGCGGTGCGCCTA", alphabet));
+  unique_ptr<SubstitutionModel> model(new T92(alphabet, 3.));
+  unique_ptr<DiscreteDistribution> rdist(new GammaDiscreteRateDistribution(4, 1.0));
+
+  RHomogeneousTreeLikelihood tlScaled(*tree, sites, model.get(), rdist.get());
+  tlScaled.initialize();
+  RHomogeneousTreeLikelihood tlUnscaled(*tree, sites, model.get(), rdist.get());
+  tlUnscaled.getLikelihoodData()->enableScaling(false);
+  tlUnscaled.initialize();
+  cout << setprecision(20) << tlScaled.getValue() << "\t" << tlUnscaled.getValue() << endl;
+  if (tlScaled.getValue() != tlUnscaled.getValue()) return 1;
+  vector<string> params = tlScaled.getBranchLengthsParameters().getParameterNames();
+  for (size_t i = 0; i < params.size(); ++i) {
+    if (tlScaled.getFirstOrderDerivative(params[i]) != tlUnscaled.getFirstOrderDerivative(params[i])) return 1;
+    if (tlScaled.getSecondOrderDerivative(params[i]) != tlUnscaled.getSecondOrderDerivative(params[i])) return 1;
+  }
+
+  DRHomogeneousTreeLikelihood drtlScaled(*tree, sites, model.get(), rdist.get(), true, false);
+  drtlScaled.initialize();
+  DRHomogeneousTreeLikelihood drtlUnscaled(*tree, sites, model.get(), rdist.get(), true, false);
+  drtlUnscaled.getLikelihoodData()->enableScaling(false);
+  drtlUnscaled.initialize();
+  cout << setprecision(20) << drtlScaled.getValue() << "\t" << drtlUnscaled.getValue() << endl;
+  if (drtlScaled.getValue() != drtlUnscaled.getValue()) return 1;
+  params = drtlScaled.getBranchLengthsParameters().getParameterNames();
+  for (size_t i = 0; i < params.size(); ++i) {
+    if (drtlScaled.getFirstOrderDerivative(params[i]) != drtlUnscaled.getFirstOrderDerivative(params[i])) return 1;
+    if (drtlScaled.getSecondOrderDerivative(params[i]) != drtlUnscaled.getSecondOrderDerivative(params[i])) return 1;
+  }
+
+  //With long branches, leaves are almost independent, and the likelihood of a site
+  //is close to (1/4)^n, which is far below the smallest double for n = 2000.
+  size_t nbLeaves = 2000;
+  size_t nbSites = 10;
+  unique_ptr<TreeTemplate<Node> > bigTree(TreeTemplateTools::parenthesisToTree(
+        "(" + balancedTree(0, nbLeaves / 2, 20.) + "," + balancedTree(nbLeaves / 2, nbLeaves, 20.) + ");"));
+  VectorSiteContainer bigSites(alphabet);
+  string nucleotides = "ACGT";
+  unsigned int seed = 1;
+  for (size_t i = 0; i < nbLeaves; ++i) {
+    string seq;
+    for (size_t j = 0; j < nbSites; ++j) {
+      seed = seed * 1103515245 + 12345;
+      seq += nucleotides[(seed >> 16) % 4];
+    }
+    bigSites.addSequence(BasicSequence("L" + TextTools::toString(i), seq, alphabet));
+  }
+  unique_ptr<SubstitutionModel> jc(new JCnuc(alphabet));
+  unique_ptr<DiscreteDistribution> constRate(new ConstantRateDistribution());
+  RHomogeneousTreeLikelihood tlBig(*bigTree, bigSites, jc.get(), constRate.get(), false, false);
+  tlBig.initialize();
+  double expected = static_cast<double>(nbLeaves * nbSites) * log(0.25);
+  cout << "Large tree: " << -tlBig.getValue() << "\t" << expected << endl;
+  if (std::isnan(tlBig.getValue()) || std::isinf(tlBig.getValue())) return 1;
+  if (abs(-tlBig.getValue() - expected) > 1e-3 * abs(expected)) return 1;
+
+  //Same with double-recursive arrays, where the postfix, prefix and root arrays are all scaled:
+  DRHomogeneousTreeLikelihood drtlBig(*bigTree, bigSites, jc.get(), constRate.get(), true, false);
+  drtlBig.initialize();
+  cout << "Large tree (DR): " << -drtlBig.getValue() << "\t" << -tlBig.getValue() << endl;
+  if (std::isnan(drtlBig.getValue()) || std::isinf(drtlBig.getValue())) return 1;
+  if (abs(drtlBig.getValue() - tlBig.getValue()) > 1e-6 * abs(tlBig.getValue())) return 1;
+  params = drtlBig.getBranchLengthsParameters().getParameterNames();
+  for (size_t i = 0; i < params.size(); i += 100) {
+    double d1 = drtlBig.getFirstOrderDerivative(params[i]);
+    double d2 = drtlBig.getSecondOrderDerivative(params[i]);
+    if (std::isnan(d1) || std::isinf(d1) || std::isnan(d2) || std::isinf(d2)) return 1;
+  }
+  
+  return 0;
+}
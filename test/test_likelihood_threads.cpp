@@ -0,0 +1,127 @@
+//
+// File: test_likelihood_threads.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:19 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+//Results must be exactly the same, whatever the number of threads:
+bool compare(AbstractTreeLikelihood& tl1, AbstractTreeLikelihood& tlN) {
+  cout << setprecision(20) << tl1.getValue() << "\t" << tlN.getValue() << endl;
+  if (tl1.getValue() != tlN.getValue()) return false;
+  vector<string> params = tl1.getBranchLengthsParameters().getParameterNames();
+  for (size_t i = 0; i < params.size(); ++i) {
+    double d1 = tl1.getFirstOrderDerivative(params[i]);
+    double dN = tlN.getFirstOrderDerivative(params[i]);
+    double d21 = tl1.getSecondOrderDerivative(params[i]);
+    double d2N = tlN.getSecondOrderDerivative(params[i]);
+    cout << params[i] << "\t" << d1 << "\t" << dN << "\t" << d21 << "\t" << d2N << endl;
+    if (d1 != dN || d21 != d2N) return false;
+  }
+  return true;
+}
+
+int main() {
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);"));
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "AAATGGCTGTGCACGTCAAATGGCTGTGCACGTC", alphabet));
+  sites.addSequence(BasicSequence("B", "GACTGGATCTGCACGTCGACTGGATCTGCACTTC", alphabet));
+  sites.addSequence(BasicSequence("C", "CTCTGGATGTGCACGTGCTCTGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("D", "AAATGGCGGTGCGCCTAAAATGGCGGTGCGCCTA", alphabet));
+
+  unique_ptr<SubstitutionModel> model(new T92(alphabet, 3.));
+  unique_ptr<DiscreteDistribution> rdist(new GammaDiscreteRateDistribution(4, 1.0));
+
+  RHomogeneousTreeLikelihood tlsr1(*tree, sites, model.get(), rdist.get());
+  tlsr1.initialize();
+  RHomogeneousTreeLikelihood tlsrN(*tree, sites, model.get(), rdist.get());
+  tlsrN.setNumberOfThreads(3);
+  tlsrN.initialize();
+  cout << "Testing Single Tree Traversal likelihood class with " << tlsrN.getNumberOfThreads() << " threads..." << endl;
+  if (!compare(tlsr1, tlsrN)) return 1;
+
+  DRHomogeneousTreeLikelihood tldr1(*tree, sites, model.get(), rdist.get());
+  tldr1.initialize();
+  DRHomogeneousTreeLikelihood tldrN(*tree, sites, model.get(), rdist.get());
+  tldrN.setNumberOfThreads(3);
+  tldrN.initialize();
+  cout << "Testing Double Tree Traversal likelihood class with " << tldrN.getNumberOfThreads() << " threads..." << endl;
+  if (!compare(tldr1, tldrN)) return 1;
+
+  //NNIs tested in parallel must score as the ones tested one by one:
+  unique_ptr<TreeTemplate<Node> > tree6(TreeTemplateTools::parenthesisToTree("(((A:0.01, B:0.02):0.03,(C:0.05,E:0.02):0.04):0.02,D:0.1,F:0.07);"));
+  sites.addSequence(BasicSequence("E", "CTCTGGATGTGCACGTGCTCAGGATGTGCACGTG", alphabet));
+  sites.addSequence(BasicSequence("F", "AAATGGCTGTGCACGTCAAATGGCTGTGCATGTC", alphabet));
+  NNIHomogeneousTreeLikelihood tlnni1(*tree6, sites, model.get(), rdist.get());
+  tlnni1.initialize();
+  NNIHomogeneousTreeLikelihood tlnniN(*tree6, sites, model.get(), rdist.get());
+  tlnniN.setNumberOfThreads(3);
+  tlnniN.initialize();
+  cout << "Testing NNIs with " << tlnniN.getNumberOfThreads() << " threads..." << endl;
+  vector<int> nodeIds;
+  vector<int> ids = tree6->getNodesId();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (tree6->hasFather(ids[i]) && tree6->hasFather(tree6->getFatherId(ids[i])))
+      nodeIds.push_back(ids[i]);
+  }
+  vector<double> diffs;
+  tlnniN.testNNIs(nodeIds, diffs);
+  for (size_t i = 0; i < nodeIds.size(); ++i) {
+    double diff = tlnni1.testNNI(nodeIds[i]);
+    cout << nodeIds[i] << "\t" << diff << "\t" << diffs[i] << endl;
+    if (diff != diffs[i]) return 1;
+  }
+
+  return 0;
+}
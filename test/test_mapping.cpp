@@ -179,6 +179,16 @@ int main() {
   ProbabilisticSubstitutionMapping* probMapUniDet = 
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet);
 
+  //Results must be exactly the same, whatever the number of threads:
+  unique_ptr<ProbabilisticSubstitutionMapping> probMapUniDetThreads(
+    SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet, false, 3));
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      if (probMapUniDetThreads->getNumberOfSubstitutions(ids[j], i) != probMapUniDet->getNumberOfSubstitutions(ids[j], i))
+        throw Exception("Multithreaded substitution mapping differs from the sequential one.");
+    }
+  }
+
   //Check saturation:
   cout << "checking saturation..." << endl;
   double td[] = {0.001, 0.01, 0.1, 1, 2, 3, 4, 10};
@@ -76,6 +76,29 @@ class DummyFunction:
 
 };
 
+//Check that the eigen vectors are inverse of each other and give back the generator:
+bool testDecomposition(const SubstitutionModel& model) {
+  const Matrix<double>& q = model.getGenerator();
+  const Matrix<double>& u = model.getColumnRightEigenVectors();
+  const Matrix<double>& v = model.getRowLeftEigenVectors();
+  const vector<double>& d = model.getEigenValues();
+  size_t n = model.getNumberOfStates();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      double id = 0, gen = 0;
+      for (size_t k = 0; k < n; ++k) {
+        id += v(i, k) * u(k, j);
+        gen += u(i, k) * d[k] * v(k, j);
+      }
+      if (abs(id - (i == j ? 1. : 0.)) > 0.000001 || abs(gen - q(i, j)) > 0.000001) {
+        cerr << "ERROR in the eigen decomposition of " << model.getName() << " at " << i << ", " << j << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 bool testModel(SubstitutionModel& model) {
   ParameterList pl = model.getParameters();
   DummyFunction df(model);
@@ -96,6 +119,7 @@ bool testModel(SubstitutionModel& model) {
     //pl2.printParameters(cout);
     //Now apply the new parameters and retrieve them again:
     model.matchParametersValues(pl2);
+    if (model.isDiagonalizable() && !testDecomposition(model)) return false;
     ParameterList pl3 = model.getParameters();
     //Compare the two lists:
     for (size_t j = 0; j < pl.size(); ++j) {
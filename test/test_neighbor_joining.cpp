@@ -0,0 +1,244 @@
+//
+// File: test_neighbor_joining.cpp
+// Created by: agent
+// Created on: Fri Oct 16 22:13 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Straightforward O(n^3) implementation of neighbor joining, for comparison:
+TreeTemplate<Node>* naiveNJ(const DistanceMatrix& dist)
+{
+  size_t n = dist.size();
+  vector< vector<double> > d(n, vector<double>(n));
+  vector<Node*> nodes(n);
+  vector<size_t> active;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j)
+      d[i][j] = dist(i, j);
+    nodes[i] = new Node(static_cast<int>(i), dist.getName(i));
+    active.push_back(i);
+  }
+  int id = static_cast<int>(n);
+  while (active.size() > 3) {
+    size_t r = active.size();
+    vector<double> sum(n, 0.);
+    for (size_t a = 0; a < r; ++a)
+      for (size_t b = 0; b < r; ++b)
+        sum[active[a]] += d[active[a]][active[b]];
+    double best = log(0.);
+    size_t bi = 0, bj = 0;
+    for (size_t a = 0; a < r; ++a) {
+      for (size_t b = a + 1; b < r; ++b) {
+        double crit = sum[active[a]] + sum[active[b]] - static_cast<double>(r - 2) * d[active[a]][active[b]];
+        if (crit > best) { best = crit; bi = a; bj = b; }
+      }
+    }
+    size_t i = active[bi], j = active[bj];
+    double ratio = (sum[i] - sum[j]) / static_cast<double>(r - 2);
+    nodes[i]->setDistanceToFather(.5 * (d[i][j] + ratio));
+    nodes[j]->setDistanceToFather(.5 * (d[i][j] - ratio));
+    Node* parent = new Node(id++);
+    parent->addSon(nodes[i]);
+    parent->addSon(nodes[j]);
+    for (size_t a = 0; a < r; ++a) {
+      size_t k = active[a];
+      if (k != i && k != j)
+        d[i][k] = d[k][i] = .5 * (d[i][k] - nodes[i]->getDistanceToFather() + d[j][k] - nodes[j]->getDistanceToFather());
+    }
+    nodes[i] = parent;
+    active.erase(active.begin() + static_cast<ptrdiff_t>(bj));
+  }
+  Node* root = new Node(id);
+  size_t i1 = active[0], i2 = active[1], i3 = active[2];
+  root->addSon(nodes[i1]);
+  root->addSon(nodes[i2]);
+  root->addSon(nodes[i3]);
+  nodes[i1]->setDistanceToFather((d[i1][i2] + d[i1][i3] - d[i2][i3]) / 2.);
+  nodes[i2]->setDistanceToFather((d[i2][i1] + d[i2][i3] - d[i1][i3]) / 2.);
+  nodes[i3]->setDistanceToFather((d[i3][i1] + d[i3][i2] - d[i1][i2]) / 2.);
+  return new TreeTemplate<Node>(root);
+}
+
+//Check at each step that the bounded search returns the same pair as an exhaustive one:
+class CheckedNeighborJoining:
+  public NeighborJoining
+{
+  public:
+    size_t nbSteps;
+    size_t nbMismatches;
+    size_t nbTies;
+
+  public:
+    CheckedNeighborJoining(): NeighborJoining(false, false, false), nbSteps(0), nbMismatches(0), nbTies(0) {}
+
+  protected:
+    vector<size_t> getBestPair()
+    {
+      vector<size_t> pair = NeighborJoining::getBestPair();
+      //Exhaustive O(r^2) search, with ties broken in index order:
+      size_t r = activeNodes_.size();
+      double scale = static_cast<double>(r - 2);
+      double best = log(0.);
+      size_t bi = 0, bj = 0, nbBest = 0;
+      for (size_t p = 0; p < r; ++p) {
+        size_t i = activeNodes_[p];
+        for (size_t q = p + 1; q < r; ++q) {
+          size_t j = activeNodes_[q];
+          double crit = sumDist_[i] + sumDist_[j] - scale * matrix_.getRow(i)[j - i - 1];
+          if (crit > best) { best = crit; bi = i; bj = j; nbBest = 1; }
+          else if (crit == best) nbBest++;
+        }
+      }
+      nbSteps++;
+      if (nbBest > 1) nbTies++;
+      if (pair[0] != bi || pair[1] != bj) nbMismatches++;
+      return pair;
+    }
+};
+
+bool checkSearch(const DistanceMatrix& dist, const string& label)
+{
+  string ref;
+  size_t nbThreads[] = { 1, 4 };
+  for (size_t k = 0; k < 2; ++k) {
+    CheckedNeighborJoining cnj;
+    cnj.setNumberOfThreads(nbThreads[k]);
+    cnj.setDistanceMatrix(dist);
+    cnj.computeTree();
+    unique_ptr< TreeTemplate<Node> > cnjTree(cnj.getTree());
+    string parenthesis = TreeTemplateTools::treeToParenthesis(*cnjTree);
+    cout << label << ", " << nbThreads[k] << " thread(s):\t" << cnj.nbSteps << " steps\t" << cnj.nbTies << " with ties\t" << cnj.nbMismatches << " mismatches" << endl;
+    if (cnj.nbMismatches > 0) return false;
+    //Results must be exactly the same, whatever the number of threads:
+    if (k == 0) ref = parenthesis;
+    else if (parenthesis != ref) return false;
+  }
+  return true;
+}
+
+//Balanced tree with unit branch lengths and leaves named T<first> to T<last - 1>:
+string balancedTree(size_t first, size_t last) {
+  if (last - first == 1)
+    return "T" + TextTools::toString(first) + ":1";
+  size_t middle = (first + last) / 2;
+  return "(" + balancedTree(first, middle) + "," + balancedTree(middle, last) + "):1";
+}
+
+double totalLength(const TreeTemplate<Node>& tree)
+{
+  double l = 0;
+  vector<const Node*> nodes = tree.getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+    if (nodes[i]->hasDistanceToFather())
+      l += nodes[i]->getDistanceToFather();
+  return l;
+}
+
+int main() {
+  RandomTools::setSeed(42);
+  for (unsigned int n = 5; n <= 200; n *= 3) {
+    vector<string> names;
+    for (unsigned int i = 0; i < n; ++i)
+      names.push_back("T" + TextTools::toString(i));
+    unique_ptr< TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(names, false));
+    vector<Node*> nodes = tree->getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i)
+      if (nodes[i]->hasFather())
+        nodes[i]->setDistanceToFather(RandomTools::giveRandomNumberBetweenZeroAndEntry(1.) + 0.01);
+    unique_ptr<DistanceMatrix> additive(TreeTools::getDistanceMatrix(*tree));
+
+    //Additive distances: the true tree must be recovered.
+    NeighborJoining nj(*additive, false, false, false);
+    unique_ptr< TreeTemplate<Node> > njTree(nj.getTree());
+    BioNJ bionj(*additive, false, false, false);
+    unique_ptr< TreeTemplate<Node> > bionjTree(bionj.getTree());
+    cout << n << " taxa, additive:\t" << totalLength(*tree) << "\t" << totalLength(*njTree) << "\t" << totalLength(*bionjTree) << endl;
+    if (TreeTools::robinsonFouldsDistance(*tree, *njTree) != 0) return 1;
+    if (TreeTools::robinsonFouldsDistance(*tree, *bionjTree) != 0) return 1;
+    if (abs(totalLength(*tree) - totalLength(*njTree)) > 1e-6 * totalLength(*tree)) return 1;
+
+    //Noisy distances: compare with the straightforward implementation, and with several threads.
+    DistanceMatrix noisy(*additive);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = i + 1; j < n; ++j)
+        noisy(i, j) = noisy(j, i) = (*additive)(i, j) * (0.8 + RandomTools::giveRandomNumberBetweenZeroAndEntry(0.4));
+    NeighborJoining nj1(noisy, false, false, false);
+    unique_ptr< TreeTemplate<Node> > nj1Tree(nj1.getTree());
+    unique_ptr< TreeTemplate<Node> > refTree(naiveNJ(noisy));
+    NeighborJoining njN(false, false, false);
+    njN.setNumberOfThreads(4);
+    njN.setDistanceMatrix(noisy);
+    njN.computeTree();
+    unique_ptr< TreeTemplate<Node> > njNTree(njN.getTree());
+    cout << n << " taxa, noisy:\t" << totalLength(*refTree) << "\t" << totalLength(*nj1Tree) << "\t" << totalLength(*njNTree) << endl;
+    if (TreeTools::robinsonFouldsDistance(*refTree, *nj1Tree) != 0) return 1;
+    if (abs(totalLength(*refTree) - totalLength(*nj1Tree)) > 1e-6 * totalLength(*refTree)) return 1;
+    //Results must be exactly the same, whatever the number of threads:
+    if (TreeTemplateTools::treeToParenthesis(*nj1Tree) != TreeTemplateTools::treeToParenthesis(*njNTree)) return 1;
+  }
+
+  //Small integer distances give many pairs with the same criterion, and so do distances
+  //from a balanced tree with unit branch lengths. Matrices are large enough for the search
+  //to be split between threads.
+  for (unsigned int n = 10; n <= 400; n *= 3) {
+    vector<string> names;
+    for (unsigned int i = 0; i < n; ++i)
+      names.push_back("T" + TextTools::toString(i));
+    DistanceMatrix ties(names);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = i + 1; j < n; ++j)
+        ties(i, j) = ties(j, i) = static_cast<double>(1 + RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(2));
+    if (!checkSearch(ties, TextTools::toString(n) + " taxa, random ties")) return 1;
+    unique_ptr< TreeTemplate<Node> > balanced(TreeTemplateTools::parenthesisToTree(balancedTree(0, n) + ";", false, TreeTools::BOOTSTRAP, false, false));
+    unique_ptr<DistanceMatrix> balancedDist(TreeTools::getDistanceMatrix(*balanced));
+    if (!checkSearch(*balancedDist, TextTools::toString(n) + " taxa, balanced tree")) return 1;
+  }
+  return 0;
+}
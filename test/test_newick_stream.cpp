@@ -0,0 +1,117 @@
+//
+// File: test_newick_stream.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:49 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> descriptions;
+  descriptions.push_back("((A,B),C);");
+  descriptions.push_back("((A:1,B:2):3,C:4):5;");
+  descriptions.push_back("((A:1,B:2)80:3,C:4)2:5;");
+  descriptions.push_back("(( A name :0.1 , B:2e-3 )95 : 0.3,(C,(D,E)),F);");
+  descriptions.push_back("A;");
+
+  Newick newick;
+  //Trees are written on several lines, several trees per line:
+  string text = "((A,B),\n  C);" + descriptions[1] + "\n" + descriptions[2] + " " + descriptions[3] + "\r\n" + descriptions[4] + "\n\n";
+  istringstream in(text);
+  vector<Tree*> trees;
+  newick.readTrees(in, trees);
+  if (trees.size() != descriptions.size()) {
+    cerr << "Wrong number of trees: " << trees.size() << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < trees.size(); i++) {
+    unique_ptr< TreeTemplate<Node> > ref(TreeTemplateTools::parenthesisToTree(descriptions[i], true, TreeTools::BOOTSTRAP, false, false));
+    string s1 = TreeTemplateTools::treeToParenthesis(*ref);
+    string s2 = TreeTemplateTools::treeToParenthesis(*dynamic_cast<TreeTemplate<Node>*>(trees[i]));
+    cout << s2 << endl;
+    if (s1 != s2) {
+      cerr << "Trees differ: " << s1 << " " << s2 << endl;
+      return 1;
+    }
+    delete trees[i];
+  }
+
+  //Comments:
+  Newick newickWithComments(true);
+  istringstream inComments("[Comment [nested]]((A,B[x]),C);");
+  unique_ptr< TreeTemplate<Node> > tree(newickWithComments.readTree(inComments));
+  if (TreeTemplateTools::treeToParenthesis(*tree) != "((A,B),C);\n")
+    return 1;
+
+  //Trees can be processed one at a time, and reading can be stopped:
+  istringstream in2(text);
+  size_t nbLeaves = 0;
+  size_t nbTrees = newick.processTrees(in2, [&nbLeaves](TreeTemplate<Node>& t) {
+      nbLeaves += t.getNumberOfLeaves();
+      return nbLeaves < 6;
+    });
+  cout << nbTrees << " trees processed, " << nbLeaves << " leaves." << endl;
+  if (nbTrees != 2 || nbLeaves != 6)
+    return 1;
+
+  //The next tree is still available:
+  tree.reset(newick.readNextTree(in2));
+  if (!tree || tree->getNumberOfLeaves() != 3)
+    return 1;
+
+  //Incomplete trees are errors:
+  istringstream in3("((A,B),C);((A,B),");
+  try {
+    trees.clear();
+    newick.readTrees(in3, trees);
+    return 1;
+  } catch (IOException& e) {
+    cout << "Error correctly detected: " << e.what() << endl;
+    for (size_t i = 0; i < trees.size(); i++)
+      delete trees[i];
+  }
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+//
+// File: test_parsimony_packed.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:47 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TopologySearch.h>
+#include <Bpp/Phyl/Model/StateMap.h>
+#include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <Bpp/Phyl/Parsimony/ParsimonyKernels.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+//Straightforward implementation of the Fitch algorithm, one site at a time.
+vector<bool> fitch(const Node* node, const SiteContainer& sites, size_t site, const StateMap& stateMap, unsigned int& score) {
+  size_t nbStates = stateMap.getNumberOfModelStates();
+  vector<bool> states(nbStates, false);
+  if (node->isLeaf()) {
+    vector<int> aliases = sites.getAlphabet()->getAlias(sites.getSequence(node->getName()).getValue(site));
+    for (size_t s = 0; s < nbStates; s++)
+      for (size_t j = 0; j < aliases.size(); j++)
+        if (stateMap.getAlphabetStateAsInt(s) == aliases[j]) states[s] = true;
+    return states;
+  }
+  states = fitch(node->getSon(0), sites, site, stateMap, score);
+  for (size_t k = 1; k < node->getNumberOfSons(); k++) {
+    vector<bool> sonStates = fitch(node->getSon(k), sites, site, stateMap, score);
+    vector<bool> inter(nbStates, false);
+    bool empty = true;
+    for (size_t s = 0; s < nbStates; s++) {
+      inter[s] = states[s] && sonStates[s];
+      if (inter[s]) empty = false;
+    }
+    if (empty) {
+      for (size_t s = 0; s < nbStates; s++)
+        inter[s] = states[s] || sonStates[s];
+      score++;
+    }
+    states = inter;
+  }
+  return states;
+}
+
+//Random alignment, with some duplicated sites so that weights are not all 1.
+VectorSiteContainer* getRandomSites(const Alphabet* alphabet, const vector<string>& names, size_t nbSites) {
+  VectorSiteContainer* sites = new VectorSiteContainer(alphabet);
+  int size = static_cast<int>(alphabet->getSize());
+  for (size_t n = 0; n < names.size(); n++) {
+    vector<int> content(nbSites);
+    for (size_t i = 0; i < nbSites; i++) {
+      if (i >= nbSites / 2)
+        content[i] = content[i % 17];
+      else if (RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(10) == 0)
+        content[i] = alphabet->getUnknownCharacterCode();
+      else
+        content[i] = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<int>(size);
+    }
+    sites->addSequence(BasicSequence(names[n], content, alphabet));
+  }
+  return sites;
+}
+
+bool checkScores(const Alphabet* alphabet, size_t nbLeaves, size_t nbSites) {
+  vector<string> names;
+  for (size_t n = 0; n < nbLeaves; n++)
+    names.push_back("T" + TextTools::toString(n));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(names, false));
+  unique_ptr<VectorSiteContainer> sites(getRandomSites(alphabet, names, nbSites));
+  CanonicalStateMap stateMap(alphabet, false);
+
+  for (int k = 0; k < 2; k++) {
+    ParsimonyKernels::InstructionSet set = (k == 0 ? LikelihoodKernels::SCALAR : LikelihoodKernels::AVX2);
+    if (!ParsimonyKernels::isSupported(set)) continue;
+    ParsimonyKernels::setInstructionSet(set);
+    DRTreeParsimonyScore pars(*tree, *sites, false);
+
+    //Compare with the reference implementation, on the (unrooted) tree used internally:
+    TreeTemplate<Node> ptree(pars.getTree());
+    unsigned int total = 0;
+    for (size_t i = 0; i < nbSites; i++) {
+      unsigned int score = 0;
+      fitch(ptree.getRootNode(), *sites, i, stateMap, score);
+      if (pars.getScoreForSite(i) != score) {
+        cerr << "Wrong score for site " << i << ": " << pars.getScoreForSite(i) << " instead of " << score << endl;
+        return false;
+      }
+      total += score;
+    }
+    cout << alphabet->getAlphabetType() << ", " << nbSites << " sites, kernel " << set << ": " << pars.getScore() << " / " << total << endl;
+    if (pars.getScore() != total)
+      return false;
+
+    //Now check NNIs:
+    vector<int> ids = ptree.getNodesId();
+    for (size_t j = 0; j < ids.size(); j++) {
+      const Node* node = ptree.getNode(ids[j]);
+      if (!node->hasFather() || !node->getFather()->hasFather()) continue;
+      double diff = pars.testNNI(ids[j]);
+      DRTreeParsimonyScore pars2(pars);
+      pars2.doNNI(ids[j]);
+      pars2.topologyChangeTested(TopologyChangeEvent());
+      double diff2 = static_cast<double>(pars2.getScore()) - static_cast<double>(pars.getScore());
+      if (diff != diff2) {
+        cerr << "Wrong NNI score for node " << ids[j] << ": " << diff << " instead of " << diff2 << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  try {
+    unique_ptr<CodonAlphabet> codonAlphabet(new CodonAlphabet(&AlphabetTools::DNA_ALPHABET));
+    if (!checkScores(&AlphabetTools::DNA_ALPHABET, 12, 300)) return 1;
+    if (!checkScores(&AlphabetTools::PROTEIN_ALPHABET, 10, 70)) return 1;
+    if (!checkScores(codonAlphabet.get(), 8, 130)) return 1;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
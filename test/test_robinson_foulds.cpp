@@ -0,0 +1,179 @@
+//
+// File: test_robinson_foulds.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:57 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/BipartitionList.h>
+#include <Bpp/Phyl/BipartitionTools.h>
+#include <Bpp/Phyl/RobinsonFouldsDistance.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Text/TextTools.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace bpp;
+using namespace std;
+
+//Reference implementation, by comparing all pairs of bipartitions.
+//Each bipartition of the second tree is matched at most once, so that bipartitions found on several branches are counted several times.
+size_t referenceDistance(const Tree& tr1, const Tree& tr2) {
+  BipartitionList bipL1(tr1, true);
+  bipL1.removeTrivialBipartitions();
+  BipartitionList bipL2(tr2, true);
+  bipL2.removeTrivialBipartitions();
+  vector<bool> matched(bipL2.getNumberOfBipartitions(), false);
+  size_t nbShared = 0;
+  for (size_t i = 0; i < bipL1.getNumberOfBipartitions(); i++) {
+    for (size_t j = 0; j < bipL2.getNumberOfBipartitions(); j++) {
+      if (!matched[j] && BipartitionTools::areIdentical(bipL1, i, bipL2, j)) {
+        matched[j] = true;
+        nbShared++;
+        break;
+      }
+    }
+  }
+  return bipL1.getNumberOfBipartitions() + bipL2.getNumberOfBipartitions() - 2 * nbShared;
+}
+
+//Insert nodes with only one son above randomly chosen nodes:
+void addUnaryNodes(TreeTemplate<Node>& tree, size_t nb) {
+  for (size_t k = 0; k < nb; k++) {
+    vector<Node*> nodes = tree.getNodes();
+    Node* node = nodes[RandomTools::giveIntRandomNumberBetweenZeroAndEntry<size_t>(nodes.size())];
+    if (!node->hasFather())
+      continue;
+    Node* father = node->getFather();
+    size_t pos = father->getSonPosition(node);
+    father->removeSon(pos);
+    Node* unary = new Node();
+    unary->addSon(node);
+    father->addSon(pos, unary);
+  }
+  tree.resetNodesId();
+}
+
+int main() {
+  //Simple cases:
+  unique_ptr< TreeTemplate<Node> > tr1(TreeTemplateTools::parenthesisToTree("(((A,B),C),(D,E),F);"));
+  unique_ptr< TreeTemplate<Node> > tr2(TreeTemplateTools::parenthesisToTree("((((A,C),B),F),(D,E));"));
+  int missing2 = -1, missing1 = -1;
+  int d = TreeTools::robinsonFouldsDistance(*tr1, *tr2, true, &missing2, &missing1);
+  cout << "RF = " << d << " (" << missing2 << ", " << missing1 << ")" << endl;
+  if (d != 2 || missing2 != 1 || missing1 != 1) {
+    cerr << "Wrong distance." << endl;
+    return 1;
+  }
+  if (TreeTools::robinsonFouldsDistance(*tr1, *tr1) != 0) {
+    cerr << "Distance of a tree to itself is not 0." << endl;
+    return 1;
+  }
+
+  //Nodes with only one son: the bipartition AB is found twice in the first tree.
+  unique_ptr< TreeTemplate<Node> > tr3(TreeTemplateTools::parenthesisToTree("((((A,B)),C),(D,E),F);"));
+  d = TreeTools::robinsonFouldsDistance(*tr3, *tr1, true, &missing2, &missing1);
+  cout << "RF = " << d << " (" << missing2 << ", " << missing1 << ")" << endl;
+  if (d != 1 || missing2 != 1 || missing1 != 0) {
+    cerr << "Wrong distance with a node of degree 2." << endl;
+    return 1;
+  }
+  RobinsonFouldsDistance rf(tr1->getLeavesNames());
+  if (rf.getDistance(*tr3, *tr1) != 0) {
+    cerr << "Distinct bipartitions should be identical." << endl;
+    return 1;
+  }
+
+  //Random trees, rooted or not:
+  vector<string> leaves;
+  for (size_t i = 0; i < 30; i++)
+    leaves.push_back("T" + TextTools::toString(i));
+  vector<Tree*> trees;
+  for (size_t i = 0; i < 40; i++)
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, i % 2 == 0));
+  //Add a tree close to the first one:
+  TreeTemplate<Node>* tree = dynamic_cast<TreeTemplate<Node>*>(trees[0])->clone();
+  tree->unroot();
+  trees.push_back(tree);
+
+  unique_ptr<DistanceMatrix> mat1(TreeTools::getRobinsonFouldsDistanceMatrix(trees, 1));
+  unique_ptr<DistanceMatrix> mat4(TreeTools::getRobinsonFouldsDistanceMatrix(trees, 4));
+  for (size_t i = 0; i < trees.size(); i++) {
+    for (size_t j = 0; j < trees.size(); j++) {
+      double ref = static_cast<double>(referenceDistance(*trees[i], *trees[j]));
+      if ((*mat1)(i, j) != ref || (*mat4)(i, j) != ref) {
+        cerr << "Wrong distance between trees " << i << " and " << j << ": " << (*mat1)(i, j) << ", " << (*mat4)(i, j) << " instead of " << ref << endl;
+        return 1;
+      }
+    }
+  }
+  if ((*mat1)(0, trees.size() - 1) != 0) {
+    cerr << "Unrooting a tree should not change its bipartitions." << endl;
+    return 1;
+  }
+  cout << "Distance matrix ok." << endl;
+
+  //Random trees with nodes of degree 2:
+  for (size_t i = 0; i < 20; i++) {
+    TreeTemplate<Node>* tree1 = dynamic_cast<TreeTemplate<Node>*>(trees[i]);
+    unique_ptr< TreeTemplate<Node> > tree2(dynamic_cast<TreeTemplate<Node>*>(trees[i + 1])->clone());
+    unique_ptr< TreeTemplate<Node> > tree3(tree1->clone());
+    addUnaryNodes(*tree2, 10);
+    addUnaryNodes(*tree3, 10);
+    size_t ref12 = referenceDistance(*tree1, *tree2);
+    size_t ref32 = referenceDistance(*tree3, *tree2);
+    size_t ref13 = referenceDistance(*tree1, *tree3);
+    if (static_cast<size_t>(TreeTools::robinsonFouldsDistance(*tree1, *tree2)) != ref12
+        || static_cast<size_t>(TreeTools::robinsonFouldsDistance(*tree3, *tree2)) != ref32
+        || static_cast<size_t>(TreeTools::robinsonFouldsDistance(*tree1, *tree3)) != ref13) {
+      cerr << "Wrong distance between trees with nodes of degree 2." << endl;
+      return 1;
+    }
+    RobinsonFouldsDistance rfSet(leaves);
+    if (rfSet.getDistance(*tree1, *tree3) != 0 || rfSet.getDistance(*tree3, *tree2) != rfSet.getDistance(*tree1, *trees[i + 1])) {
+      cerr << "Nodes of degree 2 should not change distinct bipartitions." << endl;
+      return 1;
+    }
+  }
+  cout << "Nodes of degree 2 ok." << endl;
+
+  for (size_t i = 0; i < trees.size(); i++)
+    delete trees[i];
+  return 0;
+}
@@ -143,6 +143,42 @@ int main() {
   }
   delete modelSet3;
 
+  //Now try simulations by blocks of sites:
+
+  cout << "Block check:" << endl;
+
+  //Generate data set:
+  RandomTools::setSeed(12345);
+  simulator.enableBlockSimulation(true);
+  unique_ptr<SiteContainer> sites3(simulator.simulate(n));
+
+  //Now fit model:
+  SubstitutionModelSet* modelSet4 = modelSet->clone();
+  RNonHomogeneousTreeLikelihood tl3(*tree, *sites3, modelSet4, rdist);
+  tl3.initialize();
+
+  OptimizationTools::optimizeNumericalParameters2(
+      &tl3, tl3.getParameters(), 0,
+      0.0001, 10000, messenger, profiler, false, false, 1, OptimizationTools::OPTIMIZATION_NEWTON);
+
+  //Now compare estimated values to real ones:
+  for (size_t i = 0; i < thetas.size(); ++i) {
+    cout << thetas[i] << "\t" << modelSet4->getModel(i)->getParameter("theta").getValue() << endl;
+    double diff = abs(thetas[i] - modelSet4->getModel(i)->getParameter("theta").getValue());
+    if (diff > 0.1)
+      return 1;
+  }
+  delete modelSet4;
+
+  //Results must be exactly the same, whatever the number of threads:
+  RandomTools::setSeed(12345);
+  simulator.setNumberOfThreads(4);
+  unique_ptr<SiteContainer> sites4(simulator.simulate(n));
+  for (size_t i = 0; i < sites3->getNumberOfSequences(); ++i) {
+    if (sites3->getSequence(i).getContent() != sites4->getSequence(i).getContent())
+      return 1;
+  }
+
   //-------------
   delete tree;
   delete alphabet;
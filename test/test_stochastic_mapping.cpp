@@ -380,6 +380,47 @@ int main()
             }
         }
 
+        // sample mappings again with uniformization, and compare the average dwelling times along the longest branch (S10) to the ones of the rejection sampling
+        VDouble rejectionDwellingTimes(statesNum, 0);
+        for (size_t i=0; i<mappings.size(); ++i)
+        {
+            TreeTemplate<Node>* mapping = dynamic_cast<TreeTemplate<Node>*>(mappings[i]);
+            Node* curNode = mapping->getNode("S10");
+            Node* origFather = mapping->getNode((ttree->getNode("S10"))->getFather()->getName());
+            while (curNode != origFather)
+            {
+                rejectionDwellingTimes[StochasticMapping::getNodeState(curNode)] += curNode->getDistanceToFather() / mappingsNum;
+                curNode = curNode->getFather();
+            }
+        }
+        stocMapping->setSamplingMethod(StochasticMapping::UNIFORMIZATION);
+        vector<Tree*> uniformizationMappings;
+        stocMapping->generateStochasticMapping(uniformizationMappings);
+        VDouble uniformizationDwellingTimes(statesNum, 0);
+        for (size_t i=0; i<uniformizationMappings.size(); ++i)
+        {
+            checkIfMappingLegal(stocMapping, uniformizationMappings[i], ttree, characterTreeLikelihood);
+            TreeTemplate<Node>* mapping = dynamic_cast<TreeTemplate<Node>*>(uniformizationMappings[i]);
+            Node* curNode = mapping->getNode("S10");
+            Node* origFather = mapping->getNode((ttree->getNode("S10"))->getFather()->getName());
+            while (curNode != origFather)
+            {
+                uniformizationDwellingTimes[StochasticMapping::getNodeState(curNode)] += curNode->getDistanceToFather() / mappingsNum;
+                curNode = curNode->getFather();
+            }
+            delete uniformizationMappings[i];
+        }
+        stocMapping->setSamplingMethod(StochasticMapping::REJECTION);
+        for (size_t s=0; s<statesNum; ++s)
+        {
+            cout << "Dwelling time in state " << s << " along S10: " << rejectionDwellingTimes[s] << " (rejection) " << uniformizationDwellingTimes[s] << " (uniformization)" << endl;
+            if (abs(rejectionDwellingTimes[s] - uniformizationDwellingTimes[s]) > 0.5)
+            {
+                cout << "Error! rejection and uniformization sampling disagree" << endl;
+                return 1;
+            }
+        }
+
         // delete all the created stochastic mappings
         for (size_t i=0; i<mappings.size(); ++i)
         {
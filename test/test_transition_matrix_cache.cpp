@@ -0,0 +1,133 @@
+//
+// File: test_transition_matrix_cache.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:29 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool near(const Matrix<double>& m1, const Matrix<double>& m2) {
+  for (size_t i = 0; i < m1.getNumberOfRows(); ++i)
+    for (size_t j = 0; j < m1.getNumberOfColumns(); ++j)
+      if (abs(m1(i, j) - m2(i, j)) > 1e-12) return false;
+  return true;
+}
+
+bool near(const double* m1, size_t stride, const Matrix<double>& m2) {
+  for (size_t i = 0; i < m2.getNumberOfRows(); ++i)
+    for (size_t j = 0; j < m2.getNumberOfColumns(); ++j)
+      if (abs(m1[i * stride + j] - m2(i, j)) > 1e-12) return false;
+  return true;
+}
+
+//Matrices written in a flat buffer with padded rows, the padding must be left unchanged:
+bool testFill(const TransitionModel& model, const vector<double>& times) {
+  size_t n = model.getNumberOfStates();
+  size_t stride = n + 2;
+  vector<double> pijt(times.size() * n * stride, -1.), dpijt(pijt), d2pijt(pijt);
+  model.fillPij_t(times, &pijt[0], stride);
+  model.filldPij_dt(times, &dpijt[0], stride);
+  model.filld2Pij_dt2(times, &d2pijt[0], stride);
+  for (size_t k = 0; k < times.size(); ++k) {
+    size_t offset = k * n * stride;
+    if (!near(&pijt[offset], stride, model.getPij_t(times[k]))) return false;
+    if (!near(&dpijt[offset], stride, model.getdPij_dt(times[k]))) return false;
+    if (!near(&d2pijt[offset], stride, model.getd2Pij_dt2(times[k]))) return false;
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = n; j < stride; ++j)
+        if (pijt[offset + i * stride + j] != -1. || d2pijt[offset + i * stride + j] != -1.) return false;
+  }
+  return true;
+}
+
+bool equals(const Matrix<double>& m1, const Matrix<double>& m2) {
+  for (size_t i = 0; i < m1.getNumberOfRows(); ++i)
+    for (size_t j = 0; j < m1.getNumberOfColumns(); ++j)
+      if (m1(i, j) != m2(i, j)) return false;
+  return true;
+}
+
+int main() {
+  GTR ref(&AlphabetTools::DNA_ALPHABET, 1., 0.2, 0.3, 0.4, 0.5, 0.1, 0.2, 0.3, 0.4);
+  GTR model(&AlphabetTools::DNA_ALPHABET, 1., 0.2, 0.3, 0.4, 0.5, 0.1, 0.2, 0.3, 0.4);
+  model.setTransitionMatrixCacheSize(4);
+
+  double lengths[] = { 0.1, 0.2, 0.1, 0.3, 0.2, 0.4, 0.5, 0.6, 0.1 };
+  for (size_t k = 0; k < 9; ++k) {
+    double t = lengths[k];
+    if (!equals(model.getPij_t(t), ref.getPij_t(t))) return 1;
+    if (!equals(model.getdPij_dt(t), ref.getdPij_dt(t))) return 1;
+    if (!equals(model.getd2Pij_dt2(t), ref.getd2Pij_dt2(t))) return 1;
+  }
+  cout << "Hits: " << model.getTransitionMatrixCache().getNumberOfHits() << endl;
+  cout << "Misses: " << model.getTransitionMatrixCache().getNumberOfMisses() << endl;
+  if (model.getTransitionMatrixCache().getNumberOfHits() == 0) return 1;
+
+  //Cached matrices must not be used once the model has changed:
+  ref.setParameterValue("a", 2.);
+  model.setParameterValue("a", 2.);
+  if (!equals(model.getPij_t(0.1), ref.getPij_t(0.1))) return 1;
+  model.setRate(2.);
+  ref.setRate(2.);
+  if (!equals(model.getPij_t(0.1), ref.getPij_t(0.1))) return 1;
+  if (!equals(model.getdPij_dt(0.1), ref.getdPij_dt(0.1))) return 1;
+
+  //Matrices for several lengths at once:
+  vector<double> times(lengths, lengths + 9);
+  times.push_back(0.);
+  vector< RowMatrix<double> > pijt, dpijt, d2pijt;
+  ref.computePij_t(times, pijt);
+  ref.computedPij_dt(times, dpijt);
+  ref.computed2Pij_dt2(times, d2pijt);
+  for (size_t k = 0; k < times.size(); ++k) {
+    if (!near(pijt[k], ref.getPij_t(times[k]))) return 1;
+    if (!near(dpijt[k], ref.getdPij_dt(times[k]))) return 1;
+    if (!near(d2pijt[k], ref.getd2Pij_dt2(times[k]))) return 1;
+  }
+  if (!testFill(ref, times)) return 1;
+  if (!testFill(model, times)) return 1;
+  HKY85 hky(&AlphabetTools::DNA_ALPHABET, 2., 0.2, 0.3, 0.1, 0.4);
+  if (!testFill(hky, times)) return 1;
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+//
+// File: test_tree_index.cpp
+// Created by: agent
+// Created on: Fri Oct 16 20:26 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+//Check that all nodes are found by id (lookups are validated against a full search):
+bool checkAllNodes(const TreeTemplate<Node>& tree) {
+  vector<const Node*> nodes = tree.getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (tree.getNode(nodes[i]->getId()) != nodes[i]) return false;
+    if (!tree.hasNode(nodes[i]->getId())) return false;
+  }
+  return true;
+}
+
+int main() {
+  vector<string> leaves(200);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+  
+  try {
+    for (unsigned int j = 0; j < 20; ++j) {
+      TreeTemplate<Node>* tree = TreeTemplateTools::getRandomTree(leaves, true);
+      tree->resetNodesId();
+      tree->setNodeIndexValidation(true);
+      if (!checkAllNodes(*tree)) return 1;
+      if (tree->hasNode(-1)) return 1;
+
+      //Change the root:
+      vector<int> innerIds = tree->getInnerNodesId();
+      tree->rootAt(innerIds[j % innerIds.size()]);
+      if (!checkAllNodes(*tree)) return 1;
+      tree->newOutGroup(tree->getLeafId("leaf" + TextTools::toString(j)));
+      if (!checkAllNodes(*tree)) return 1;
+
+      //Sparse ids, modified through the nodes directly:
+      vector<Node*> nodes = tree->getNodes();
+      for (size_t i = 0; i < nodes.size(); ++i)
+        nodes[i]->setId(static_cast<int>(i * 1000));
+      if (!checkAllNodes(*tree)) return 1;
+      if (tree->hasNode(1)) return 1;
+
+      //Add and remove a node:
+      Node* newLeaf = new Node(-5, "new");
+      tree->getRootNode()->addSon(newLeaf);
+      if (tree->getNode(-5) != newLeaf) return 1;
+      tree->getRootNode()->removeSon(newLeaf);
+      delete newLeaf;
+      if (tree->hasNode(-5)) return 1;
+
+      tree->resetNodesId();
+      if (!checkAllNodes(*tree)) return 1;
+
+      //Copies have their own index:
+      TreeTemplate<Node> tree2(*tree);
+      if (!checkAllNodes(tree2)) return 1;
+      if (tree2.getNode(0) == tree->getNode(0)) return 1;
+
+      //Neither do read-only accesses to the sons:
+      unsigned long revision = tree->getRevision();
+      tree->getRootNode()->getSons();
+      if (tree->getRevision() != revision) return 1;
+
+      //Modifications of other trees must not invalidate the index:
+      tree2.getNode(0)->setId(-1);
+      Node* removed = tree2.getRootNode()->removeSon(static_cast<size_t>(0));
+      TreeTemplateTools::deleteSubtree(removed);
+      delete removed;
+      TreeTemplate<Node>* tree3 = TreeTemplateTools::getRandomTree(leaves, true);
+      tree3->getRootNode()->getSons();
+      delete tree3;
+      if (tree->getRevision() != revision) return 1;
+      if (!checkAllNodes(*tree)) return 1;
+      tree->getNode(0)->setId(-1);
+      if (tree->getRevision() == revision) return 1;
+      if (!checkAllNodes(*tree)) return 1;
+
+      delete tree;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  cout << "Node index ok." << endl;
+  return 0;
+}